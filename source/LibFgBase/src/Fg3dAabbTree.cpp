@@ -0,0 +1,331 @@
+//
+// Copyright (c) 2015 Singular Inversions Inc. (facegen.com)
+// Use, modification and distribution is subject to the MIT License,
+// see accompanying file LICENSE.txt or facegen.com/base_library_license.txt
+//
+
+#include "stdafx.h"
+
+#include "Fg3dAabbTree.hpp"
+#include "FgGeometry.hpp"
+#include "FgBounds.hpp"
+#include "FgThread.hpp"
+#include "Fg3dMeshOps.hpp"
+#include "Fg3dMeshIo.hpp"
+#include "FgCommand.hpp"
+#include "FgTime.hpp"
+#include "FgRandom.hpp"
+
+using namespace std;
+
+static const uint   maxLeafTris = 4;
+
+Fg3dAabbTree::Fg3dAabbTree(const FgVerts & verts,const vector<Fg3dSurface> & surfs)
+    : m_verts(verts)
+{
+    for (size_t ss=0; ss<surfs.size(); ++ss) {
+        const Fg3dSurface & surf = surfs[ss];
+        for (uint tt=0; tt<surf.numTriEquivs(); ++tt) {
+            m_tris.push_back(surf.getTriEquiv(tt));
+            m_triSurfs.push_back(uint(ss));
+            m_triEquivs.push_back(tt);
+        }
+    }
+    if (m_tris.empty())
+        return;
+    FGASSERT(m_tris.size() < numeric_limits<uint>::max());
+    FgVerts             centroids(m_tris.size());
+    for (size_t tt=0; tt<m_tris.size(); ++tt) {
+        FgVect3UI           tri = m_tris[tt];
+        centroids[tt] = (verts[tri[0]] + verts[tri[1]] + verts[tri[2]]) / 3.0f;
+    }
+    vector<uint>        order(m_tris.size());
+    for (size_t ii=0; ii<order.size(); ++ii)
+        order[ii] = uint(ii);
+    build(order,centroids,0,uint(order.size()));
+    vector<FgVect3UI>   tris(order.size());
+    vector<uint>        triSurfs(order.size()),
+                        triEquivs(order.size());
+    for (size_t ii=0; ii<order.size(); ++ii) {
+        tris[ii] = m_tris[order[ii]];
+        triSurfs[ii] = m_triSurfs[order[ii]];
+        triEquivs[ii] = m_triEquivs[order[ii]];
+    }
+    m_tris.swap(tris);
+    m_triSurfs.swap(triSurfs);
+    m_triEquivs.swap(triEquivs);
+    refit(verts);
+}
+
+Fg3dAabbTree::Fg3dAabbTree(const Fg3dMesh & mesh)
+{*this = Fg3dAabbTree(mesh.verts,mesh.surfaces); }
+
+namespace {
+
+struct  CentroidLess
+{
+    const FgVerts &     centroids;
+    uint                axis;
+
+    CentroidLess(const FgVerts & c,uint a) : centroids(c), axis(a) {}
+
+    bool
+    operator()(uint lhs,uint rhs) const
+    {return (centroids[lhs][axis] < centroids[rhs][axis]); }
+};
+
+}
+
+// Median split on the longest axis of the centroid bounds:
+void
+Fg3dAabbTree::build(vector<uint> & order,const FgVerts & centroids,uint begin,uint end)
+{
+    size_t              nodeIdx = m_nodes.size();
+    m_nodes.push_back(Node());
+    if (end - begin <= maxLeafTris) {
+        m_nodes[nodeIdx].idx = begin;
+        m_nodes[nodeIdx].num = end - begin;
+        return;
+    }
+    FgVect3F            lo = centroids[order[begin]],
+                        hi = lo;
+    for (uint ii=begin+1; ii<end; ++ii) {
+        const FgVect3F &    cc = centroids[order[ii]];
+        for (uint dd=0; dd<3; ++dd) {
+            fgSetIfLess(lo[dd],cc[dd]);
+            fgSetIfGreater(hi[dd],cc[dd]);
+        }
+    }
+    uint                axis = fgMaxIdx(hi-lo),
+                        mid = begin + (end - begin) / 2;
+    std::nth_element(order.begin()+begin,order.begin()+mid,order.begin()+end,CentroidLess(centroids,axis));
+    build(order,centroids,begin,mid);
+    m_nodes[nodeIdx].idx = uint(m_nodes.size());
+    m_nodes[nodeIdx].num = 0;
+    build(order,centroids,mid,end);
+}
+
+void
+Fg3dAabbTree::leafBounds(size_t blockSize,size_t block)
+{
+    size_t              end = std::min((block+1)*blockSize,m_nodes.size());
+    for (size_t nn=block*blockSize; nn<end; ++nn) {
+        Node &              node = m_nodes[nn];
+        if (node.num == 0)
+            continue;
+        node.lo = node.hi = m_verts[m_tris[node.idx][0]];
+        for (uint tt=node.idx; tt<node.idx+node.num; ++tt) {
+            for (uint ii=0; ii<3; ++ii) {
+                const FgVect3F &    vv = m_verts[m_tris[tt][ii]];
+                for (uint dd=0; dd<3; ++dd) {
+                    fgSetIfLess(node.lo[dd],vv[dd]);
+                    fgSetIfGreater(node.hi[dd],vv[dd]);
+                }
+            }
+        }
+    }
+}
+
+void
+Fg3dAabbTree::refit(const FgVerts & verts,uint numThreads)
+{
+    FGASSERT(verts.size() == m_verts.size());
+    m_verts = verts;
+    const size_t        blockSize = 1 << 12;
+    fgParallelFor((m_nodes.size()+blockSize-1)/blockSize,
+        boost::bind(&Fg3dAabbTree::leafBounds,this,blockSize,_1),numThreads);
+    // Children always follow their parent:
+    for (size_t nn=m_nodes.size(); nn>0; --nn) {
+        Node &              node = m_nodes[nn-1];
+        if (node.num > 0)
+            continue;
+        const Node &        n0 = m_nodes[nn],
+                   &        n1 = m_nodes[node.idx];
+        for (uint dd=0; dd<3; ++dd) {
+            node.lo[dd] = std::min(n0.lo[dd],n1.lo[dd]);
+            node.hi[dd] = std::max(n0.hi[dd],n1.hi[dd]);
+        }
+    }
+}
+
+static inline
+float
+boxDistSqr(FgVect3F pos,const FgVect3F & lo,const FgVect3F & hi)
+{
+    float           ret = 0.0f;
+    for (uint dd=0; dd<3; ++dd) {
+        float           del = 0.0f;
+        if (pos[dd] < lo[dd])
+            del = lo[dd] - pos[dd];
+        else if (pos[dd] > hi[dd])
+            del = pos[dd] - hi[dd];
+        ret += del * del;
+    }
+    return ret;
+}
+
+Fg3dClosestPoint
+Fg3dAabbTree::closest(FgVect3F pos,float maxDist) const
+{
+    Fg3dClosestPoint    ret;
+    if (m_nodes.empty())
+        return ret;
+    float               best = (maxDist < sqrt(numeric_limits<float>::max())) ?
+                            maxDist * maxDist : numeric_limits<float>::max();
+    uint                bestTri = 0;
+    FgVect3D            bestBary,
+                        posD(pos);
+    // The tree depth is at most about log2 of the number of tris since the splits are at
+    // the median:
+    uint                stack[64];
+    uint                stackSize = 0;
+    stack[stackSize++] = 0;
+    while (stackSize > 0) {
+        const Node &        node = m_nodes[stack[--stackSize]];
+        if (boxDistSqr(pos,node.lo,node.hi) >= best)
+            continue;
+        if (node.num > 0) {
+            for (uint tt=node.idx; tt<node.idx+node.num; ++tt) {
+                FgVect3UI           tri = m_tris[tt];
+                FgVect3D            v0(m_verts[tri[0]]),
+                                    v1(m_verts[tri[1]]),
+                                    v2(m_verts[tri[2]]),
+                                    bary = fgClosestBarycentricInTri(posD,v0,v1,v2);
+                float               distSqr = float((v0*bary[0] + v1*bary[1] + v2*bary[2] - posD).mag());
+                if (distSqr < best) {
+                    best = distSqr;
+                    bestTri = tt;
+                    bestBary = bary;
+                    ret.distSqr = distSqr;
+                }
+            }
+        }
+        else {
+            // Push the further child first so the nearer is searched first:
+            uint                c0 = uint(&node - &m_nodes[0]) + 1,
+                                c1 = node.idx;
+            float               d0 = boxDistSqr(pos,m_nodes[c0].lo,m_nodes[c0].hi),
+                                d1 = boxDistSqr(pos,m_nodes[c1].lo,m_nodes[c1].hi);
+            if (d0 < d1) {
+                std::swap(c0,c1);
+                std::swap(d0,d1);
+            }
+            FGASSERT(stackSize+2 <= 64);
+            if (d0 < best)
+                stack[stackSize++] = c0;
+            if (d1 < best)
+                stack[stackSize++] = c1;
+        }
+    }
+    if (ret.valid()) {
+        FgVect3UI           tri = m_tris[bestTri];
+        ret.surfIdx = m_triSurfs[bestTri];
+        ret.surfPoint = FgSurfPoint(m_triEquivs[bestTri],FgVect3F(bestBary));
+        ret.pos = m_verts[tri[0]] * float(bestBary[0]) +
+                  m_verts[tri[1]] * float(bestBary[1]) +
+                  m_verts[tri[2]] * float(bestBary[2]);
+    }
+    return ret;
+}
+
+void
+Fg3dAabbTree::closestRange(
+    const FgVerts *         poss,
+    float                   maxDist,
+    Fg3dClosestPoints *     ret,
+    size_t                  blockSize,
+    size_t                  block) const
+{
+    size_t              end = std::min((block+1)*blockSize,poss->size());
+    for (size_t ii=block*blockSize; ii<end; ++ii)
+        (*ret)[ii] = closest((*poss)[ii],maxDist);
+}
+
+Fg3dClosestPoints
+Fg3dAabbTree::closest(const FgVerts & poss,float maxDist,uint numThreads) const
+{
+    Fg3dClosestPoints   ret(poss.size());
+    const size_t        blockSize = 256;
+    fgParallelFor((poss.size()+blockSize-1)/blockSize,
+        boost::bind(&Fg3dAabbTree::closestRange,this,&poss,maxDist,&ret,blockSize,_1),numThreads);
+    return ret;
+}
+
+static
+double
+bruteForceDistSqr(const Fg3dMesh & mesh,FgVect3F pos)
+{
+    double              ret = numeric_limits<double>::max();
+    for (size_t ss=0; ss<mesh.surfaces.size(); ++ss) {
+        const Fg3dSurface & surf = mesh.surfaces[ss];
+        for (uint tt=0; tt<surf.numTriEquivs(); ++tt) {
+            FgVect3UI           tri = surf.getTriEquiv(tt);
+            FgVecMag            vm = fgClosestPointInTri(FgVect3D(pos),FgVect3D(mesh.verts[tri[0]]),
+                FgVect3D(mesh.verts[tri[1]]),FgVect3D(mesh.verts[tri[2]]));
+            fgSetIfLess(ret,vm.mag);
+        }
+    }
+    return ret;
+}
+
+static
+void
+checkClosest(const Fg3dMesh & mesh,const FgVerts & poss,const Fg3dClosestPoints & cps)
+{
+    for (size_t ii=0; ii<poss.size(); ++ii) {
+        const Fg3dClosestPoint &    cp = cps[ii];
+        FGASSERT(cp.valid());
+        double              ref = bruteForceDistSqr(mesh,poss[ii]);
+        FGASSERT(std::abs(cp.distSqr - ref) <= 1.0e-5 * std::max(ref,1.0));
+        // The surface point must give the same position:
+        FgVect3UI           tri = mesh.surfaces[cp.surfIdx].getTriEquiv(cp.surfPoint.triEquivIdx);
+        FgVect3F            pos = fgBarycentricPos(tri,cp.surfPoint.weights,mesh.verts);
+        FGASSERT((pos-cp.pos).mag() <= 1.0e-8f * std::max(cp.pos.mag(),1.0f));
+    }
+}
+
+void
+fg3dAabbTreeTest(const FgArgs &)
+{
+    // Includes quads:
+    Fg3dMesh            mesh = fgLoadTri(fgDataDir()+"base/Jane.tri");
+    FgMat32F            bounds = fgBounds(mesh.verts);
+    float               scale = fgMaxElem(bounds.colVec(1)-bounds.colVec(0));
+    fgRandSeedRepeatable();
+    FgVerts             poss;
+    for (uint ii=0; ii<200; ++ii) {
+        // Near the surface, and anywhere around the mesh:
+        FgVect3F            vert = mesh.verts[fgRandUint(uint(mesh.verts.size()))];
+        poss.push_back(vert + FgVect3F(fgMatRandNormal<3,1>() * 0.01 * scale));
+        poss.push_back(FgVect3F(fgMatRandNormal<3,1>() * scale));
+    }
+    FgTimer             timer;
+    Fg3dAabbTree        tree(mesh);
+    double              timeBuild = timer.read();
+    timer.start();
+    Fg3dClosestPoints   cps = tree.closest(poss,numeric_limits<float>::max(),4);
+    double              timeQuery = timer.read();
+    checkClosest(mesh,poss,cps);
+    // Distance bounded queries:
+    float               maxDist = scale * 0.05f;
+    for (size_t ii=0; ii<poss.size(); ++ii) {
+        Fg3dClosestPoint    cp = tree.closest(poss[ii],maxDist);
+        if (cps[ii].distSqr < maxDist*maxDist)
+            FGASSERT(cp.distSqr == cps[ii].distSqr);
+        else
+            FGASSERT(!cp.valid());
+    }
+    // Refit after deformation:
+    for (size_t ii=0; ii<mesh.verts.size(); ++ii)
+        mesh.verts[ii] += FgVect3F(fgMatRandNormal<3,1>() * 0.005 * scale);
+    timer.start();
+    tree.refit(mesh.verts);
+    double              timeRefit = timer.read();
+    checkClosest(mesh,poss,tree.closest(poss));
+    timer.start();
+    for (size_t ii=0; ii<poss.size(); ++ii)
+        bruteForceDistSqr(mesh,poss[ii]);
+    double              timeBrute = timer.read();
+    fgout << fgnl << mesh.numTriEquivs() << " tris: build " << timeBuild << "s, refit " << timeRefit
+        << "s, " << poss.size() << " queries " << timeQuery << "s, brute force " << timeBrute << "s";
+}
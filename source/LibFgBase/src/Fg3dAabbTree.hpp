@@ -0,0 +1,84 @@
+//
+// Copyright (c) 2015 Singular Inversions Inc. (facegen.com)
+// Use, modification and distribution is subject to the MIT License,
+// see accompanying file LICENSE.txt or facegen.com/base_library_license.txt
+//
+// Closest point on a mesh surface by axis-aligned bounding box tree.
+//
+// Used for projecting points onto a mesh (scan registration, landmark snapping, transferring
+// points between meshes) in time logarithmic rather than linear in the number of facets.
+// Quads are handled as their tri equivalents so results are given as 'FgSurfPoint's.
+//
+// When only the vertices move the tree can be refit in linear time without rebuilding.
+// Query speed degrades gracefully as the deformation from the construction shape increases.
+//
+
+#ifndef FG3DAABBTREE_HPP
+#define FG3DAABBTREE_HPP
+
+#include "FgStdLibs.hpp"
+#include "Fg3dMesh.hpp"
+
+struct  Fg3dClosestPoint
+{
+    uint            surfIdx;
+    FgSurfPoint     surfPoint;  // Tri equivalent index within the surface and barycentric weights
+    FgVect3F        pos;
+    float           distSqr;    // Initialized to invalid.
+
+    Fg3dClosestPoint() : surfIdx(0), distSqr(std::numeric_limits<float>::max()) {}
+
+    bool valid() const {return (distSqr != std::numeric_limits<float>::max()); }
+};
+
+typedef vector<Fg3dClosestPoint>    Fg3dClosestPoints;
+
+struct  Fg3dAabbTree
+{
+    Fg3dAabbTree(const FgVerts & verts,const vector<Fg3dSurface> & surfs);
+
+    explicit
+    Fg3dAabbTree(const Fg3dMesh & mesh);
+
+    // Vertices have moved but the facets are unchanged. Leaf bounds are computed concurrently:
+    void
+    refit(const FgVerts & verts,uint numThreads=0);
+
+    // Returns invalid if the mesh is empty or there is no surface point within 'maxDist':
+    Fg3dClosestPoint
+    closest(FgVect3F pos,float maxDist=std::numeric_limits<float>::max()) const;
+
+    // Concurrent queries:
+    Fg3dClosestPoints
+    closest(
+        const FgVerts &     poss,
+        float               maxDist=std::numeric_limits<float>::max(),
+        uint                numThreads=0) const;
+
+private:
+    // Depth first order so the first child of an internal node immediately follows it and
+    // every child comes after its parent:
+    struct  Node
+    {
+        FgVect3F            lo;
+        FgVect3F            hi;
+        uint                idx;        // Leaf: first tri. Internal: second child
+        uint                num;        // Leaf: number of tris. Internal: 0
+    };
+    FgVerts                 m_verts;
+    vector<FgVect3UI>       m_tris;     // In tree order
+    vector<uint>            m_triSurfs; // "
+    vector<uint>            m_triEquivs;// "
+    vector<Node>            m_nodes;
+
+    void
+    build(vector<uint> & order,const FgVerts & centroids,uint begin,uint end);
+
+    void
+    leafBounds(size_t blockSize,size_t block);
+
+    void
+    closestRange(const FgVerts * poss,float maxDist,Fg3dClosestPoints * ret,size_t blockSize,size_t block) const;
+};
+
+#endif
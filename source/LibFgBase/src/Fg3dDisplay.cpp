@@ -537,7 +537,7 @@ markAllSeams(FgDgn<vector<Fg3dMesh> > meshesN)
     vector<Fg3dMesh> &      meshes = g_gg.getRef(meshesN);
     for (size_t ii=0; ii<meshes.size(); ++ii) {
         Fg3dMesh &          mesh = meshes[ii];
-        Fg3dTopology        topo(mesh.verts,mesh.getTriEquivs().vertInds);
+        Fg3dTopoCsr         topo(mesh.verts,mesh.getTriEquivs().vertInds);
         vector<set<uint> >  seams = topo.seams();
         for (size_t ss=0; ss<seams.size(); ++ss) {
             const set<uint> &   seam = seams[ss];
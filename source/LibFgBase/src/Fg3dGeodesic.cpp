@@ -0,0 +1,279 @@
+//
+// Copyright (c) 2015 Singular Inversions Inc. (facegen.com)
+// Use, modification and distribution is subject to the MIT License,
+// see accompanying file LICENSE.txt or facegen.com/base_library_license.txt
+//
+
+#include "stdafx.h"
+
+#include "Fg3dGeodesic.hpp"
+#include "FgThread.hpp"
+#include "FgCommand.hpp"
+#include "FgTime.hpp"
+#include "FgRandom.hpp"
+#include "Fg3dMeshIo.hpp"
+#include "Fg3dMeshOps.hpp"
+#include "FgTestUtils.hpp"
+
+using namespace std;
+
+Fg3dGeodesic::Fg3dGeodesic(
+    const FgVerts &             verts,
+    const vector<FgVect3UI> &   tris,
+    uint                        numThreads)
+    : m_verts(verts), m_topo(verts,tris,numThreads)
+{
+    const vector<FgVect3UI> &   ts = m_topo.tris;
+    m_unfold.resize(ts.size()*3);
+    for (size_t tt=0; tt<ts.size(); ++tt) {
+        for (uint cc=0; cc<3; ++cc) {
+            FgVect3D    a(m_verts[ts[tt][cc]]),
+                        b(m_verts[ts[tt][(cc+1)%3]]),
+                        c(m_verts[ts[tt][(cc+2)%3]]),
+                        bc = c - b,
+                        ba = a - b;
+            double      len = bc.length(),
+                        x = (len > 0.0) ? fgDot(ba,bc) / len : 0.0,
+                        y2 = ba.mag() - x*x;
+            Unfold &    uf = m_unfold[tt*3+cc];
+            uf.len = float(len);
+            uf.x = float(x);
+            uf.y = float((y2 > 0.0) ? sqrt(y2) : 0.0);
+        }
+    }
+}
+
+vector<float>
+Fg3dGeodesic::distances(const vector<uint> & srcVertInds,float maxDist) const
+{
+    vector<float>       ret(m_verts.size(),numeric_limits<float>::max());
+    for (size_t ii=0; ii<srcVertInds.size(); ++ii) {
+        FGASSERT(srcVertInds[ii] < ret.size());
+        ret[srcVertInds[ii]] = 0.0f;
+    }
+    distances(ret,maxDist);
+    return ret;
+}
+
+// Distance to corner 'cc' of a tri from its two other corners, with 'dB' and 'dC' being the
+// accepted distances of corners cc+1 and cc+2 respectively (either may be unknown):
+static
+double
+updateFromTri(double dB,double dC,double len,double ax,double ay)
+{
+    const double    unknown = numeric_limits<float>::max();
+    double          distAB = sqrt(ax*ax + ay*ay),
+                    distAC = sqrt((ax-len)*(ax-len) + ay*ay),
+                    edgeB = (dB < unknown) ? dB + distAB : unknown,
+                    edgeC = (dC < unknown) ? dC + distAC : unknown,
+                    ret = std::min(edgeB,edgeC);
+    if ((dB < unknown) && (dC < unknown) && (len > 0.0) && (ay > 0.0)) {
+        // Virtual source on the far side of the edge at distances dB and dC from its ends:
+        double      sx = (dB*dB - dC*dC + len*len) / (2.0 * len),
+                    sy2 = dB*dB - sx*sx;
+        if (sy2 >= 0.0) {
+            double      sy = -sqrt(sy2),
+                        cross = sx + (ax - sx) * (-sy) / (ay - sy);
+            // Only valid if the straight path enters the tri through the edge:
+            if ((cross >= 0.0) && (cross <= len)) {
+                double      dx = ax - sx,
+                            dy = ay - sy;
+                ret = std::min(ret,sqrt(dx*dx + dy*dy));
+            }
+        }
+    }
+    return ret;
+}
+
+void
+Fg3dGeodesic::distances(vector<float> & vertDists,float maxDist) const
+{
+    FGASSERT(vertDists.size() == m_verts.size());
+    const float             unknown = numeric_limits<float>::max();
+    typedef std::pair<float,uint>   DistVert;
+    std::priority_queue<DistVert,vector<DistVert>,std::greater<DistVert> >  heap;
+    vector<FgBool>          accepted(vertDists.size(),false);
+    vector<uint>            touched;                    // Tentative values that may need reset
+    for (size_t vv=0; vv<vertDists.size(); ++vv) {
+        if (vertDists[vv] < unknown) {
+            heap.push(DistVert(vertDists[vv],uint(vv)));
+            // Sources may start beyond 'maxDist' and never be accepted:
+            touched.push_back(uint(vv));
+        }
+    }
+    const vector<FgVect3UI> &   tris = m_topo.tris;
+    while (!heap.empty()) {
+        DistVert        dv = heap.top();
+        heap.pop();
+        uint            vv = dv.second;
+        if (accepted[vv] || (dv.first > vertDists[vv]))   // Stale entry
+            continue;
+        if (dv.first > maxDist)
+            break;
+        accepted[vv] = true;
+        for (uint ii=m_topo.vertTriOffsets[vv]; ii<m_topo.vertTriOffsets[vv+1]; ++ii) {
+            uint            tt = m_topo.vertTriInds[ii];
+            FgVect3UI       tri = tris[tt];
+            for (uint cc=0; cc<3; ++cc) {
+                uint            ww = tri[cc];
+                if (accepted[ww])
+                    continue;
+                uint            vb = tri[(cc+1)%3],
+                                vc = tri[(cc+2)%3];
+                const Unfold &  uf = m_unfold[tt*3+cc];
+                double          dB = accepted[vb] ? vertDists[vb] : unknown,
+                                dC = accepted[vc] ? vertDists[vc] : unknown;
+                float           dist = float(updateFromTri(dB,dC,uf.len,uf.x,uf.y));
+                if (dist < vertDists[ww]) {
+                    vertDists[ww] = dist;
+                    heap.push(DistVert(dist,ww));
+                    touched.push_back(ww);
+                }
+            }
+        }
+    }
+    for (size_t ii=0; ii<touched.size(); ++ii)
+        if (!accepted[touched[ii]])
+            vertDists[touched[ii]] = unknown;
+}
+
+static
+void
+distancesQuery(
+    const Fg3dGeodesic *            geo,
+    const vector<vector<uint> > *   srcss,
+    float                           maxDist,
+    vector<vector<float> > *        ret,
+    size_t                          idx)
+{(*ret)[idx] = geo->distances((*srcss)[idx],maxDist); }
+
+vector<vector<float> >
+Fg3dGeodesic::distancesBatch(
+    const vector<vector<uint> > &   srcVertIndss,
+    float                           maxDist,
+    uint                            numThreads) const
+{
+    vector<vector<float> >  ret(srcVertIndss.size());
+    fgParallelFor(ret.size(),boost::bind(distancesQuery,this,&srcVertIndss,maxDist,&ret,_1),numThreads);
+    return ret;
+}
+
+// Flat grid so the true geodesic distance is the euclidean distance:
+static
+Fg3dMesh
+flatGrid(uint dim)
+{
+    Fg3dMesh            ret;
+    for (uint yy=0; yy<dim; ++yy)
+        for (uint xx=0; xx<dim; ++xx)
+            ret.verts.push_back(FgVect3F(float(xx),float(yy),0.0f));
+    vector<FgVect3UI>   tris;
+    for (uint yy=0; yy+1<dim; ++yy) {
+        for (uint xx=0; xx+1<dim; ++xx) {
+            uint        v0 = yy*dim+xx,
+                        v1 = v0+1,
+                        v2 = v1+dim,
+                        v3 = v0+dim;
+            // Alternate the diagonals to avoid a directional bias:
+            if ((xx+yy)%2 == 0) {
+                tris.push_back(FgVect3UI(v0,v1,v2));
+                tris.push_back(FgVect3UI(v0,v2,v3));
+            }
+            else {
+                tris.push_back(FgVect3UI(v0,v1,v3));
+                tris.push_back(FgVect3UI(v1,v2,v3));
+            }
+        }
+    }
+    ret.surfaces.push_back(Fg3dSurface(tris));
+    return ret;
+}
+
+void
+fg3dGeodesicTest(const FgArgs &)
+{
+    // Accuracy on a flat grid from a centre source:
+    const uint          dim = 101;
+    Fg3dMesh            grid = flatGrid(dim);
+    Fg3dGeodesic        geoGrid(grid.verts,grid.surfaces[0].tris.vertInds);
+    uint                centre = (dim/2)*dim + dim/2;
+    vector<float>       dists = geoGrid.distances(fgSvec(centre));
+    double              maxRelErr = 0;
+    for (size_t ii=0; ii<dists.size(); ++ii) {
+        float       trueDist = (grid.verts[ii]-grid.verts[centre]).length();
+        if (trueDist > 10.0f)
+            fgSetIfGreater(maxRelErr,double(std::abs(dists[ii]-trueDist)/trueDist));
+    }
+    fgout << fgnl << "Flat grid max relative error: " << maxRelErr;
+    FGASSERT(maxRelErr < 0.03);
+    // Bounded query must match the unbounded one within the bound:
+    vector<float>       distsBnd = geoGrid.distances(fgSvec(centre),20.0f);
+    for (size_t ii=0; ii<dists.size(); ++ii) {
+        if (dists[ii] <= 20.0f)
+            FGASSERT(distsBnd[ii] == dists[ii]);
+        else
+            FGASSERT(distsBnd[ii] == numeric_limits<float>::max());
+    }
+    // Offset sources starting beyond the bound must not be left in the result:
+    vector<float>       distsOff(grid.verts.size(),numeric_limits<float>::max());
+    distsOff[centre] = 0.0f;
+    distsOff[0] = 30.0f;
+    geoGrid.distances(distsOff,20.0f);
+    FGASSERT(distsOff == distsBnd);
+    // On a curved mesh the result must lie between the straight line and edge path distances:
+    Fg3dMesh            mesh = fgLoadTri(fgDataDir()+"base/Jane.tri");
+    mesh.surfaces[0] = mesh.surfaces[0].convertToTris();
+    vector<FgVect3UI>   tris = fgMergeSurfaces(mesh.surfaces).tris.vertInds;
+    Fg3dGeodesic        geo(mesh.verts,tris);
+    vector<float>       geoDists = geo.distances(fgSvec(0U)),
+                        edgeDists = geo.topology().edgeDistanceMap(mesh.verts,0);
+    for (size_t ii=0; ii<geoDists.size(); ++ii) {
+        FGASSERT((geoDists[ii] < numeric_limits<float>::max()) == (edgeDists[ii] < numeric_limits<float>::max()));
+        if (geoDists[ii] < numeric_limits<float>::max()) {
+            float       straight = (mesh.verts[ii]-mesh.verts[0]).length();
+            FGASSERT(geoDists[ii] <= edgeDists[ii] * 1.0001f);
+            FGASSERT(geoDists[ii] >= straight * 0.9999f);
+        }
+    }
+    // Multi-source and batch queries:
+    fgRandSeedRepeatable();
+    vector<vector<uint> >   srcss(8);
+    for (size_t ii=0; ii<srcss.size(); ++ii)
+        for (uint jj=0; jj<=ii; ++jj)
+            srcss[ii].push_back(fgRandUint(uint(mesh.verts.size())));
+    vector<vector<float> >  batch = geo.distancesBatch(srcss,numeric_limits<float>::max(),4);
+    for (size_t ii=0; ii<srcss.size(); ++ii) {
+        FGASSERT(batch[ii] == geo.distances(srcss[ii]));
+        for (size_t jj=0; jj<srcss[ii].size(); ++jj)
+            FGASSERT(batch[ii][srcss[ii][jj]] == 0.0f);
+    }
+}
+
+// Timing on meshes of approximately 100K to 2M vertices:
+void
+fg3dGeodesicBench(const FgArgs &)
+{
+    Fg3dMesh            mesh = fgLoadTri(fgDataDir()+"base/Jane.tri");
+    mesh.surfaces[0] = mesh.surfaces[0].convertToTris();
+    mesh = fgSubdivide(mesh,false);
+    fgRandSeedRepeatable();
+    for (uint ss=0; ss<3; ++ss) {
+        mesh = fgSubdivide(mesh,false);
+        vector<FgVect3UI>   tris = fgMergeSurfaces(mesh.surfaces).tris.vertInds;
+        FgTimer             timer;
+        Fg3dGeodesic        geo(mesh.verts,tris);
+        double              timeInit = timer.read();
+        vector<vector<uint> >   srcss(16,vector<uint>(1));
+        for (size_t ii=0; ii<srcss.size(); ++ii)
+            srcss[ii][0] = fgRandUint(uint(mesh.verts.size()));
+        timer.start();
+        geo.distances(srcss[0]);
+        double              timeOne = timer.read();
+        timer.start();
+        geo.distancesBatch(srcss);
+        double              timeBatch = timer.read();
+        fgout << fgnl << mesh.verts.size() << " verts: setup " << timeInit << "s, single query "
+            << timeOne << "s, " << srcss.size() << " queries on " << fgNumThreads() << " threads "
+            << timeBatch << "s";
+    }
+}
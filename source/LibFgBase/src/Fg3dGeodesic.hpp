@@ -0,0 +1,73 @@
+//
+// Copyright (c) 2015 Singular Inversions Inc. (facegen.com)
+// Use, modification and distribution is subject to the MIT License,
+// see accompanying file LICENSE.txt or facegen.com/base_library_license.txt
+//
+// Approximate geodesic distance fields on triangle meshes by the fast marching method.
+//
+// Unlike 'Fg3dTopology::edgeDistanceMap', distances are not restricted to paths along edges;
+// each vertex is updated from a virtual source unfolded across the opposite edge of each adjacent
+// triangle, with edge paths used where the unfolded path would leave the triangle. The result
+// is typically within a few percent of the true geodesic distance on reasonable meshes.
+//
+// The topology and per-triangle unfolding geometry are computed once on construction and are
+// shared read-only by all queries, which can be run concurrently.
+//
+
+#ifndef FG3DGEODESIC_HPP
+#define FG3DGEODESIC_HPP
+
+#include "FgStdLibs.hpp"
+#include "FgMatrixC.hpp"
+#include "Fg3dTopology.hpp"
+
+struct  Fg3dGeodesic
+{
+    Fg3dGeodesic(
+        const FgVerts &             verts,
+        const vector<FgVect3UI> &   tris,
+        uint                        numThreads=0);      // For topology construction
+
+    size_t
+    numVerts() const
+    {return m_verts.size(); }
+
+    // Distance from the nearest of the given source vertices. Vertices further than 'maxDist'
+    // (or unreachable) are left at numeric_limits<float>::max(). A finite 'maxDist' makes the
+    // cost proportional to the area covered rather than the whole mesh:
+    vector<float>
+    distances(
+        const vector<uint> &        srcVertInds,
+        float                       maxDist=std::numeric_limits<float>::max()) const;
+
+    // As above but with initial distances for any number of vertices (others must be set to
+    // numeric_limits<float>::max()). Useful for sources with offsets:
+    void
+    distances(
+        vector<float> &             vertDists,
+        float                       maxDist=std::numeric_limits<float>::max()) const;
+
+    // Independent queries run concurrently:
+    vector<vector<float> >
+    distancesBatch(
+        const vector<vector<uint> > & srcVertIndss,
+        float                       maxDist=std::numeric_limits<float>::max(),
+        uint                        numThreads=0) const;
+
+    const Fg3dTopoCsr &
+    topology() const
+    {return m_topo; }
+
+private:
+    FgVerts                 m_verts;
+    Fg3dTopoCsr             m_topo;
+    // For corner 'cc' of tri 'tt', at [tt*3+cc], the opposite edge from corner cc+1 to cc+2 lies
+    // along the X axis from the origin to (len,0) and the corner is at (x,y) with y > 0:
+    struct  Unfold
+    {
+        float               len,x,y;
+    };
+    vector<Unfold>          m_unfold;
+};
+
+#endif
@@ -0,0 +1,355 @@
+//
+// Copyright (c) 2015 Singular Inversions Inc. (facegen.com)
+// Use, modification and distribution is subject to the MIT License,
+// see accompanying file LICENSE.txt or facegen.com/base_library_license.txt
+//
+
+#include "stdafx.h"
+
+#include "Fg3dIcp.hpp"
+#include "Fg3dNormals.hpp"
+#include "FgThread.hpp"
+#include "FgBounds.hpp"
+#include "FgCommand.hpp"
+#include "FgTime.hpp"
+#include "FgRandom.hpp"
+#include "Fg3dMeshIo.hpp"
+
+using namespace std;
+
+// Unknowns of the linearized point-to-plane step: rotation (axis * angle), translation and
+// relative scale change:
+typedef FgMatrixC<double,7,7>   FgMat77D;
+typedef FgMatrixC<double,7,1>   FgVect7D;
+
+Fg3dIcp::Fg3dIcp(const Fg3dMesh & target) :
+    m_verts(target.verts),
+    m_surfs(target.surfaces),
+    m_vertNorms(fgNormals(target).vert),
+    m_tree(target)
+{}
+
+FgVect3D
+Fg3dIcp::normal(const Fg3dClosestPoint & cp) const
+{
+    FgVect3UI           tri = m_surfs[cp.surfIdx].getTriEquiv(cp.surfPoint.triEquivIdx);
+    FgVect3F            wgts = cp.surfPoint.weights;
+    FgVect3D            ret(m_vertNorms[tri[0]] * wgts[0] +
+                            m_vertNorms[tri[1]] * wgts[1] +
+                            m_vertNorms[tri[2]] * wgts[2]);
+    double              len = ret.length();
+    return (len > 0.0) ? ret / len : ret;
+}
+
+namespace {
+
+// Per-block partial sums, reduced in block order so results do not depend on the number of threads:
+struct  IcpPartial
+{
+    FgSimilarityStats   sim;        // Point-to-point
+    FgMat77D            ata;        // Point-to-plane normal equations
+    FgVect7D            atb;
+    double              ssd;        // Weighted sum of squared distances of used correspondences
+    double              wgt;
+    size_t              numUsed;
+
+    IcpPartial() : ata(0.0), atb(0.0), ssd(0.0), wgt(0.0), numUsed(0) {}
+};
+
+struct  IcpReduce
+{
+    const Fg3dIcp *             icp;
+    const FgVerts &             moved;
+    const Fg3dClosestPoints &   cps;
+    FgVect3D                    centre;
+    float                       maxDistSqr;     // Correspondences used are those closer than this
+    double                      cauchyScaleSqr; // Zero for no Cauchy weighting
+    bool                        pointToPlane;
+    vector<IcpPartial> &        partials;
+    size_t                      blockSize;
+
+    IcpReduce(
+        const Fg3dIcp *             i,
+        const FgVerts &             m,
+        const Fg3dClosestPoints &   c,
+        vector<IcpPartial> &        p) :
+        icp(i), moved(m), cps(c), partials(p)
+    {}
+};
+
+}
+
+// Cholesky solution of a symmetric positive definite system:
+static
+FgVect7D
+solveSpd(FgMat77D A,FgVect7D b)
+{
+    const uint          dim = 7;
+    for (uint cc=0; cc<dim; ++cc) {
+        double              diag = A.rc(cc,cc);
+        for (uint kk=0; kk<cc; ++kk)
+            diag -= fgSqr(A.rc(cc,kk));
+        if (!(diag > 0.0))
+            fgThrow("Fg3dIcp degenerate point-to-plane system, try point-to-point");
+        A.rc(cc,cc) = sqrt(diag);
+        for (uint rr=cc+1; rr<dim; ++rr) {
+            double              acc = A.rc(rr,cc);
+            for (uint kk=0; kk<cc; ++kk)
+                acc -= A.rc(rr,kk) * A.rc(cc,kk);
+            A.rc(rr,cc) = acc / A.rc(cc,cc);
+        }
+    }
+    for (uint rr=0; rr<dim; ++rr) {
+        for (uint kk=0; kk<rr; ++kk)
+            b[rr] -= A.rc(rr,kk) * b[kk];
+        b[rr] /= A.rc(rr,rr);
+    }
+    for (uint rr=dim; rr>0; --rr) {
+        for (uint kk=rr; kk<dim; ++kk)
+            b[rr-1] -= A.rc(kk,rr-1) * b[kk];
+        b[rr-1] /= A.rc(rr-1,rr-1);
+    }
+    return b;
+}
+
+static
+void
+reduceBlock(const IcpReduce * rd,size_t block)
+{
+    IcpPartial &        part = rd->partials[block];
+    size_t              end = std::min((block+1)*rd->blockSize,rd->moved.size());
+    for (size_t ii=block*rd->blockSize; ii<end; ++ii) {
+        const Fg3dClosestPoint &    cp = rd->cps[ii];
+        if (!(cp.distSqr < rd->maxDistSqr))
+            continue;
+        double              wgt = 1.0;
+        if (rd->cauchyScaleSqr > 0.0)
+            wgt = 1.0 / (1.0 + cp.distSqr / rd->cauchyScaleSqr);
+        FgVect3D            src = FgVect3D(rd->moved[ii]) - rd->centre,
+                            dst = FgVect3D(cp.pos) - rd->centre;
+        part.ssd += cp.distSqr * wgt;
+        part.wgt += wgt;
+        ++part.numUsed;
+        if (rd->pointToPlane) {
+            FgVect3D            nrm = rd->icp->normal(cp);
+            FgVect7D            row;
+            FgVect3D            rot = fgCrossProduct(src,nrm);
+            for (uint dd=0; dd<3; ++dd) {
+                row[dd] = rot[dd];
+                row[dd+3] = nrm[dd];
+            }
+            row[6] = fgDot(nrm,src);
+            double              res = fgDot(nrm,dst-src);
+            part.ata += (row * wgt) * row.transpose();
+            part.atb += row * (wgt * res);
+        }
+        else
+            part.sim.add(src,dst,wgt);
+    }
+}
+
+Fg3dIcpResult
+Fg3dIcp::align(
+    const FgVerts &         source,
+    const FgSimilarity &    initial,
+    const Fg3dIcpOptions &  opts) const
+{
+    FGASSERT(source.size() > 2);
+    FGASSERT((opts.keepFraction > 0.0) && (opts.keepFraction <= 1.0));
+    Fg3dIcpResult           ret;
+    ret.xform = initial;
+    ret.rms = 0.0;
+    ret.numUsed = 0;
+    ret.iters = 0;
+    const size_t            blockSize = 1024;
+    vector<IcpPartial>      partials((source.size()+blockSize-1)/blockSize);
+    FgVerts                 moved(source.size());
+    vector<float>           distSqrs;
+    double                  rmsPrev = 0.0;
+    for (uint it=0; it<opts.maxIters; ++it) {
+        FgAffine3F              xf(ret.xform.asAffine());
+        FgVect3D                centre(0.0);
+        for (size_t ii=0; ii<source.size(); ++ii) {
+            moved[ii] = xf * source[ii];
+            centre += FgVect3D(moved[ii]);
+        }
+        centre /= double(moved.size());
+        Fg3dClosestPoints       cps = m_tree.closest(moved,opts.maxDist,opts.numThreads);
+        distSqrs.clear();
+        for (size_t ii=0; ii<cps.size(); ++ii)
+            if (cps[ii].valid())
+                distSqrs.push_back(cps[ii].distSqr);
+        if (distSqrs.size() < 3)
+            fgThrow("Fg3dIcp too few correspondences within maximum distance",fgToString(distSqrs.size()));
+        IcpReduce               rd(this,moved,cps,partials);
+        rd.centre = centre;
+        rd.maxDistSqr = numeric_limits<float>::max();
+        if (opts.keepFraction < 1.0) {
+            size_t                  num = std::max(size_t(opts.keepFraction * distSqrs.size()),size_t(3));
+            if (num < distSqrs.size()) {
+                std::nth_element(distSqrs.begin(),distSqrs.begin()+num,distSqrs.end());
+                rd.maxDistSqr = distSqrs[num];
+            }
+        }
+        rd.cauchyScaleSqr = 0.0;
+        if (opts.cauchyFactor > 0.0) {
+            // Median absolute distance to standard deviation for a normal distribution:
+            size_t                  mid = distSqrs.size() / 2;
+            std::nth_element(distSqrs.begin(),distSqrs.begin()+mid,distSqrs.end());
+            rd.cauchyScaleSqr = fgSqr(opts.cauchyFactor * 1.4826) * distSqrs[mid];
+        }
+        rd.pointToPlane = opts.pointToPlane;
+        rd.blockSize = blockSize;
+        std::fill(partials.begin(),partials.end(),IcpPartial());
+        fgParallelFor(partials.size(),boost::bind(reduceBlock,&rd,_1),opts.numThreads);
+        IcpPartial              sum;
+        for (size_t bb=0; bb<partials.size(); ++bb) {
+            sum.sim += partials[bb].sim;
+            sum.ata += partials[bb].ata;
+            sum.atb += partials[bb].atb;
+            sum.ssd += partials[bb].ssd;
+            sum.wgt += partials[bb].wgt;
+            sum.numUsed += partials[bb].numUsed;
+        }
+        ret.numUsed = sum.numUsed;
+        ret.rms = sqrt(sum.ssd / sum.wgt);
+        ret.iters = it + 1;
+        // The update is computed relative to the centre for conditioning:
+        FgSimilarity            delta;
+        if (opts.pointToPlane) {
+            if (!opts.withScale) {
+                for (uint ii=0; ii<7; ++ii)
+                    sum.ata.rc(6,ii) = sum.ata.rc(ii,6) = 0.0;
+                sum.ata.rc(6,6) = 1.0;
+                sum.atb[6] = 0.0;
+            }
+            FgVect7D                x = solveSpd(sum.ata,sum.atb);
+            FgVect3D                axis(x[0],x[1],x[2]);
+            double                  angle = axis.length();
+            FgQuaternionD           rot;
+            if (angle > 0.0)
+                rot = FgQuaternionD(cos(angle/2.0),axis * (sin(angle/2.0) / angle));
+            delta = FgSimilarity(1.0 + x[6],rot,FgVect3D(x[3],x[4],x[5]));
+        }
+        else
+            delta = sum.sim.solve(opts.withScale);
+        ret.xform = FgSimilarity(centre) * delta * FgSimilarity(-centre) * ret.xform;
+        if ((it > 0) && (std::abs(rmsPrev - ret.rms) <= opts.tolerance * ret.rms))
+            break;
+        rmsPrev = ret.rms;
+    }
+    return ret;
+}
+
+void
+Fg3dIcp::alignOne(
+    const vector<FgVerts> *         sources,
+    const vector<FgSimilarity> *    initials,
+    Fg3dIcpOptions                  options,
+    vector<Fg3dIcpResult> *         results,
+    size_t                          idx) const
+{
+    FgSimilarity        initial;
+    if (!initials->empty())
+        initial = (*initials)[idx];
+    (*results)[idx] = align((*sources)[idx],initial,options);
+}
+
+vector<Fg3dIcpResult>
+Fg3dIcp::alignBatch(
+    const vector<FgVerts> &         sources,
+    const vector<FgSimilarity> &    initials,
+    const Fg3dIcpOptions &          options) const
+{
+    FGASSERT(initials.empty() || (initials.size() == sources.size()));
+    vector<Fg3dIcpResult>   ret(sources.size());
+    Fg3dIcpOptions          opts = options;
+    opts.numThreads = 1;
+    fgParallelFor(sources.size(),
+        boost::bind(&Fg3dIcp::alignOne,this,&sources,&initials,opts,&ret,_1),options.numThreads);
+    return ret;
+}
+
+static
+double
+xformErr(const FgSimilarity & xf,const FgSimilarity & ref,const FgVerts & verts)
+{
+    double          ret = 0.0;
+    FgAffine3D      a = xf.asAffine(),
+                    b = ref.asAffine();
+    for (size_t ii=0; ii<verts.size(); ++ii)
+        fgSetIfGreater(ret,(a * FgVect3D(verts[ii]) - b * FgVect3D(verts[ii])).length());
+    return ret;
+}
+
+void
+fg3dIcpTest(const FgArgs &)
+{
+    Fg3dMesh            target = fgLoadTri(fgDataDir()+"base/Jane.tri");
+    FgMat32F            bounds = fgBounds(target.verts);
+    double              scale = fgMaxElem(bounds.colVec(1)-bounds.colVec(0));
+    Fg3dIcp             icp(target);
+    fgRandSeedRepeatable();
+    // Sources are noisy subsets of the target vertices displaced by a known transform, plus
+    // outliers:
+    vector<FgVerts>         sources,
+                            inlierss;
+    vector<FgSimilarity>    refs;
+    for (uint ss=0; ss<4; ++ss) {
+        FgSimilarity        ref(1.0 + 0.05 * fgRandNormal(),
+                                FgQuaternionD(1.0,fgMatRandNormal<3,1>() * 0.05),
+                                fgMatRandNormal<3,1>() * (0.02 * scale));
+        FgAffine3D          inv = ref.inverse().asAffine();
+        FgVerts             src;
+        for (size_t ii=ss; ii<target.verts.size(); ii+=3) {
+            FgVect3D            pos = FgVect3D(target.verts[ii]) + fgMatRandNormal<3,1>() * (0.0005 * scale);
+            src.push_back(FgVect3F(inv * pos));
+        }
+        inlierss.push_back(src);
+        for (size_t ii=0; ii<src.size()/20; ++ii)
+            src.push_back(FgVect3F(fgMatRandNormal<3,1>() * scale));
+        sources.push_back(src);
+        refs.push_back(ref);
+    }
+    const FgVerts &     inliers = inlierss[0];
+    Fg3dIcpOptions      opts;
+    opts.withScale = true;
+    opts.keepFraction = 0.9;
+    FgTimer             timer;
+    Fg3dIcpResult       res = icp.align(sources[0],FgSimilarity(),opts);
+    double              timeOne = timer.read();
+    double              err = xformErr(res.xform,refs[0],inliers);
+    fgout << fgnl << "Point-to-plane trimmed: " << res.iters << " iterations, RMS " << res.rms
+        << ", max error " << err / scale << " of mesh size";
+    FGASSERT(err < 0.005 * scale);
+    // Point-to-point with Cauchy weighting:
+    opts.pointToPlane = false;
+    opts.keepFraction = 1.0;
+    opts.cauchyFactor = 2.0;
+    res = icp.align(sources[0],FgSimilarity(),opts);
+    err = xformErr(res.xform,refs[0],inliers);
+    fgout << fgnl << "Point-to-point Cauchy: " << res.iters << " iterations, RMS " << res.rms
+        << ", max error " << err / scale << " of mesh size";
+    FGASSERT(err < 0.005 * scale);
+    // Rigid:
+    opts = Fg3dIcpOptions();
+    opts.keepFraction = 0.9;
+    FgSimilarity        rigidRef(1.0,refs[0].m_rot,refs[0].m_trans);
+    FgVerts             rigidSrc = fgTransform(target.verts,FgAffine3F(rigidRef.inverse().asAffine()));
+    res = icp.align(rigidSrc,FgSimilarity(),opts);
+    FGASSERT(res.xform.m_scale == 1.0);
+    FGASSERT(xformErr(res.xform,rigidRef,target.verts) < 0.005 * scale);
+    // Batch results must match the individual results regardless of threads:
+    opts.withScale = true;
+    timer.start();
+    vector<Fg3dIcpResult>   batch = icp.alignBatch(sources,vector<FgSimilarity>(),opts);
+    double              timeBatch = timer.read();
+    for (size_t ss=0; ss<sources.size(); ++ss) {
+        Fg3dIcpResult       one = icp.align(sources[ss],FgSimilarity(),opts);
+        FGASSERT(one.rms == batch[ss].rms);
+        FGASSERT(one.iters == batch[ss].iters);
+        FGASSERT(xformErr(batch[ss].xform,refs[ss],inlierss[ss]) < 0.005 * scale);
+    }
+    fgout << fgnl << sources[0].size() << " points: single " << timeOne << "s, batch of "
+        << sources.size() << " " << timeBatch << "s";
+}
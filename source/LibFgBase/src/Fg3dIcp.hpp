@@ -0,0 +1,92 @@
+//
+// Copyright (c) 2015 Singular Inversions Inc. (facegen.com)
+// Use, modification and distribution is subject to the MIT License,
+// see accompanying file LICENSE.txt or facegen.com/base_library_license.txt
+//
+// Iterative closest point registration of point sets (eg. scan vertices) to a target mesh.
+//
+// Each iteration finds the closest target surface point to each transformed source point, then
+// solves for the rigid or similarity transform minimizing either the point-to-point distances
+// (closed form by 'FgSimilarityStats') or the point-to-plane distances (linearized). Outliers
+// are handled by trimming a fraction of the worst correspondences and / or by Cauchy weighting.
+//
+
+#ifndef FG3DICP_HPP
+#define FG3DICP_HPP
+
+#include "FgStdLibs.hpp"
+#include "Fg3dMesh.hpp"
+#include "Fg3dAabbTree.hpp"
+#include "FgSimilarity.hpp"
+
+struct  Fg3dIcpOptions
+{
+    bool            withScale;      // Similarity if true, otherwise rigid
+    bool            pointToPlane;   // Otherwise point-to-point
+    // Fraction of correspondences (those closest) used in each iteration:
+    double          keepFraction;
+    // If non-zero, correspondences are weighted by 1/(1+(d/(k*s))^2) where 'd' is the
+    // correspondence distance, 'k' is this value and 's' is a robust estimate of the standard
+    // deviation of 'd'. Values around 2-3 are typical:
+    double          cauchyFactor;
+    // Correspondences further than this (in target units) are ignored:
+    float           maxDist;
+    uint            maxIters;
+    // Stops when the relative change in RMS correspondence distance falls below this:
+    double          tolerance;
+    uint            numThreads;     // 0 for one per hardware thread
+
+    Fg3dIcpOptions() :
+        withScale(false), pointToPlane(true), keepFraction(1.0), cauchyFactor(0.0),
+        maxDist(std::numeric_limits<float>::max()), maxIters(50), tolerance(1.0e-6),
+        numThreads(0)
+    {}
+};
+
+struct  Fg3dIcpResult
+{
+    FgSimilarity    xform;          // Source to target
+    double          rms;            // Weighted RMS distance of correspondences used in the final iteration
+    size_t          numUsed;        // Number of correspondences used in the final iteration
+    uint            iters;
+};
+
+struct  Fg3dIcp
+{
+    explicit
+    Fg3dIcp(const Fg3dMesh & target);
+
+    Fg3dIcpResult
+    align(
+        const FgVerts &         source,
+        const FgSimilarity &    initial=FgSimilarity(),
+        const Fg3dIcpOptions &  options=Fg3dIcpOptions()) const;
+
+    // Aligns many point sets concurrently, each on a single thread. 'initials' must be empty
+    // (identity) or of the same size as 'sources':
+    vector<Fg3dIcpResult>
+    alignBatch(
+        const vector<FgVerts> &         sources,
+        const vector<FgSimilarity> &    initials=vector<FgSimilarity>(),
+        const Fg3dIcpOptions &          options=Fg3dIcpOptions()) const;
+
+    // Target surface normal at a closest point by interpolated vertex normals:
+    FgVect3D
+    normal(const Fg3dClosestPoint & cp) const;
+
+private:
+    FgVerts                 m_verts;
+    vector<Fg3dSurface>     m_surfs;
+    FgVerts                 m_vertNorms;
+    Fg3dAabbTree            m_tree;
+
+    void
+    alignOne(
+        const vector<FgVerts> *         sources,
+        const vector<FgSimilarity> *    initials,
+        Fg3dIcpOptions                  options,
+        vector<Fg3dIcpResult> *         results,
+        size_t                          idx) const;
+};
+
+#endif
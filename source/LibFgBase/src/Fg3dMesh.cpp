@@ -544,7 +544,7 @@ operator<<(std::ostream & os,const Fg3dMesh & m)
         if (sortVerts[ii] == sortVerts[ii-1])
             ++numDups;
     os << fgnl << "Duplicate vertices: " << numDups;
-    Fg3dTopology        topo(m.verts,m.getTriEquivs().vertInds);
+    Fg3dTopoCsr         topo(m.verts,m.getTriEquivs().vertInds);
     FgVect3UI           te = topo.isManifold();
     os << fgnl << "Watertight: ";
     if (te == FgVect3UI(0))
@@ -9,6 +9,7 @@
 
 #include "stdafx.h"
 #include "Fg3dMeshIo.hpp"
+#include "FgProfile.hpp"
 #include "FgFileSystem.hpp"
 #include "FgMetaFormat.hpp"
 #include "FgException.hpp"
@@ -22,6 +23,7 @@ fgLoadMeshAnyFormat(
     const FgString &    fname,
     Fg3dMesh &          mesh)
 {
+    FG_PROFILE_SCOPE("fgLoadMeshAnyFormat");
     FgPath      path(fname);
     if (path.ext.empty()) {
         if (fgExists(fname+".tri"))
@@ -32,6 +34,10 @@ fgLoadMeshAnyFormat(
             path.ext = "obj";
         else if (fgExists(fname + ".fgmesh"))
             path.ext = "fgmesh";
+        else if (fgExists(fname + ".ply"))
+            path.ext = "ply";
+        else if (fgExists(fname + ".stl"))
+            path.ext = "stl";
         else
             return false;
     }
@@ -42,6 +48,10 @@ fgLoadMeshAnyFormat(
         mesh = fgLoadWobj(path.str());
     else if (ext == "fgmesh")
         mesh = fgLoadFgmesh(path.str());
+    else if (ext == "ply")
+        mesh = fgLoadPly(path.str());
+    else if (ext == "stl")
+        mesh = fgLoadStl(path.str());
     else
         fgThrow("Not a readable 3D mesh format",fname);
     return true;
@@ -58,11 +68,11 @@ fgLoadMeshAnyFormat(const FgString & fname)
 
 vector<string>
 fgLoadMeshFormats()
-{return fgSvec<string>("fgmesh","obj","wobj","tri"); }
+{return fgSvec<string>("fgmesh","obj","wobj","tri","ply","stl"); }
 
 string
 fgLoadMeshFormatsDescription()
-{return string("(fgmesh | [w]obj | tri)"); }
+{return string("(fgmesh | [w]obj | tri | ply | stl)"); }
 
 void
 fgSaveMeshesAnyFormat(
@@ -12,6 +12,7 @@
 
 #include "FgString.hpp"
 #include "Fg3dMeshOps.hpp"
+#include "FgRgba.hpp"
 
 // Returns false if 'fname' has no extension and no mesh file was found with a valid extension.
 // Returns true otherwise. Throws an exception if the specified extension cannot be read as a mesh.
@@ -83,11 +84,26 @@ fgSaveTri(const FgString & fname,const vector<Fg3dMesh> & meshes)
 
 // Third party mesh formats:
 
+// Files larger than a few MB are parsed in parallel chunks:
 Fg3dMesh
 fgLoadWobj(
     const FgString &    filename,
     // Break up the surfaces by the given WOBJ separator. Valid values are 'usemtl', 'o' and 'g':
-    string              surfSeparator=string());
+    string              surfSeparator=string(),
+    uint                numThreads=0);      // 0: one per hardware thread
+
+// ASCII or binary (either endian) PLY. Polygons with more than 4 sides are split into tris,
+// per-vertex or per-corner ('texcoord') UVs are loaded, each 'texnumber' becomes a separate
+// surface and 'comment TextureFile' images are loaded if present. Other data is ignored:
+Fg3dMesh
+fgLoadPly(const FgString & fname,uint numThreads=0);
+// As above also returning the vertex colors if present (otherwise empty):
+Fg3dMesh
+fgLoadPly(const FgString & fname,vector<FgRgbaUB> & vertColors,uint numThreads=0);
+
+// Binary or ASCII STL. Coincident vertices are welded (exact match) in first-appearance order:
+Fg3dMesh
+fgLoadStl(const FgString & fname,uint numThreads=0);
 
 // Ignores morphs:
 void
@@ -11,6 +11,7 @@
 #include "stdafx.h"
 #include "Fg3dMeshLegacy.hpp"
 #include "FgStdStream.hpp"
+#include "FgTextBuf.hpp"
 #include "FgImage.hpp"
 #include "FgFileSystem.hpp"
 #include "Fg3dMeshOps.hpp"
@@ -235,6 +236,8 @@ static bool saveLwoLwsFile(
         fgThrow("Unable to write to LWO file",fullLwoName);
         return false;
     }
+    // The chunks are written a few bytes at a time so use a large stdio buffer:
+    setvbuf(fptr,NULL,_IOFBF,1 << 20);
 
     // Write the FORM file chunk header
     long fileChunkStartPos = ftell(fptr);
@@ -440,18 +443,10 @@ static bool errorFcloseExit(FILE *fptr, const FgString &)
 //****************************************************************************
 static bool swap4BytesWrite(FILE *fptr, const void *ptr)
 {
-    char *pp = (char*)ptr;
+    const char *pp = (const char*)ptr;
+    char        swapped[4] = {pp[3],pp[2],pp[1],pp[0]};
 
-    if (fwrite(&pp[3],1,1,fptr) != 1)
-        return false;
-    if (fwrite(&pp[2],1,1,fptr) != 1)
-        return false;
-    if (fwrite(&pp[1],1,1,fptr) != 1)
-        return false;
-    if (fwrite(&pp[0],1,1,fptr) != 1)
-        return false;
-
-    return true;
+    return (fwrite(swapped,1,4,fptr) == 4);
 }
 
 
@@ -460,14 +455,10 @@ static bool swap4BytesWrite(FILE *fptr, const void *ptr)
 //****************************************************************************
 static bool swap2BytesWrite(FILE *fptr, const void *ptr)
 {
-    char *pp = (char*)ptr;
+    const char *pp = (const char*)ptr;
+    char        swapped[2] = {pp[1],pp[0]};
 
-    if (fwrite(&pp[1],1,1,fptr) != 1)
-        return false;
-    if (fwrite(&pp[0],1,1,fptr) != 1)
-        return false;
-
-    return true;
+    return (fwrite(swapped,1,2,fptr) == 2);
 }
 
 
@@ -2275,11 +2266,7 @@ static bool writeLwsFile(
     unsigned long           numMorphs, 
     const vector<string>    *morphNames)
 {
-    FgOfstream file(lwsName);
-    if (!file)
-    {
-        return false;
-    }
+    FgTextBuf file;
 
     // Start the file write
     file << "LWSC\n";
@@ -2346,7 +2333,7 @@ static bool writeLwsFile(
             file << "EndPlugin\n";
         }
         file << "ShadowOptions 7\n";
-        file << "\n" << flush;
+        file << "\n";
     }
 
     // Estimate a proper grid size
@@ -2364,9 +2351,10 @@ static bool writeLwsFile(
     else if (gridSize >= 2) gridSize = 2 * power10;
     else                    gridSize = power10;
 
-    file << "GridSize " << gridSize << endl << flush;
+    file << "GridSize " << gridSize << "\n";
+    fgDump(file,lwsName);
 
-    return (!file.fail());
+    return true;
 }
 
 void
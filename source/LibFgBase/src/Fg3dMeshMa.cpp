@@ -10,6 +10,7 @@
 #include "stdafx.h"
 #include "Fg3dMeshLegacy.hpp"
 #include "FgStdStream.hpp"
+#include "FgTextBuf.hpp"
 #include "FgImage.hpp"
 #include "FgFileSystem.hpp"
 #include "Fg3dMeshOps.hpp"
@@ -129,11 +130,11 @@ static string getObjectTexFileName(
 static string getObjectTexPlaceName(
         const FffMultiObjectC &model, unsigned long mm);
 
-static void writeTexCoord(ofstream &ofs, const vector<FgVect2F> &texCoord);
-static void writeVertices(ofstream &ofs, const vector<FgVect3F> &vtxList);
-static void writeEdges(ofstream &ofs, const vector<FgVect2UI> &edgeList);
+static void writeTexCoord(FgTextBuf &ofs, const vector<FgVect2F> &texCoord);
+static void writeVertices(FgTextBuf &ofs, const vector<FgVect3F> &vtxList);
+static void writeEdges(FgTextBuf &ofs, const vector<FgVect2UI> &edgeList);
 static void writeFacets(
-        ofstream                    &ofs,
+        FgTextBuf                   &ofs,
         const vector<FgVect3F>    &vtxList,
         const vector<FgVect3UI>    &triList,
         const vector<FgVect4UI>    &quadList,
@@ -142,26 +143,26 @@ static void writeFacets(
         const vector<FgVect3UI>    &texTriList,
         const vector<FgVect4UI>    &texQuadList);
 static void writeObjects(
-        ofstream                        &ofs,
+        FgTextBuf                       &ofs,
         const FffMultiObjectC           &model,
         const vector<FffMultiObjectC>   *morphTargets,
         const vector<string>            *morphNames,
         vector<int>                     &edgeSizeList);
 static int writeShadingMaterialPhong(
-        ofstream                        &ofs,
+        FgTextBuf                       &ofs,
         const FffMultiObjectC           &model,
         const vector<string>            *morphNames);
 static void writeBlendShapes(
-        ofstream                        &ofs, 
+        FgTextBuf                       &ofs, 
         const FffMultiObjectC           &model,
         const vector<string>            *morphNames);
 static void writePolySoftEdge(
-        ofstream                        &ofs, 
+        FgTextBuf                       &ofs, 
         const FffMultiObjectC           &model,
         const vector<string>            *morphNames,
         const vector<int>               &edgeSizeList);
 static void connectAttributes(
-        ofstream                        &ofs,
+        FgTextBuf                       &ofs,
         const FffMultiObjectC           &model,
         const vector<string>            *morphNames);
 
@@ -222,28 +223,24 @@ static bool saveMayaAsciiFile(
 
     FgPath      path(fname);
     path.ext = "ma";
-    FgOfstream ofs(path.str());
-    if (!ofs)
-    {
-        return false;
-    }
+    // Morph-heavy models produce very large files so format in memory and write once:
+    FgTextBuf   ofs(1 << 20);
 
     //
     // Write header
     //
     ofs << "//Maya ASCII 4.0 scene\n";
-    ofs << "//Name: " << path.base << endl;
+    ofs << "//Name: " << path.base << "\n";
     if (cmts)
     {
         ofs << "//\n";
         for (unsigned long cc=0; cc<cmts->size(); ++cc)
         {
-            ofs << "//" << (*cmts)[cc] << endl;
+            ofs << "//" << (*cmts)[cc] << "\n";
         }
         ofs << "//\n";
     }
     ofs << "requires maya \"4.0\";\n";
-    ofs << flush;
 
     //
     // Now write out the shape information for each object and target.
@@ -336,21 +333,10 @@ static bool saveMayaAsciiFile(
     //
     connectAttributes(ofs,model,morphNames);
 
-    ofs << "// End of " << path.base << endl << flush;
+    ofs << "// End of " << path.base << "\n";
 
-    //
-    // Done.
-    //
-    if (ofs.fail())
-    {
-        ofs.close();
-        return false;
-    }
-    else
-    {
-        ofs.close();
-        return true;
-    }
+    fgDump(ofs,path.str());
+    return true;
 }
 
 
@@ -842,7 +828,7 @@ static string getObjectTexPlaceName(
 //****************************************************************************
 //                              writeTexCoord
 //****************************************************************************
-static void writeTexCoord(ofstream &ofs, const vector<FgVect2F> &texCoord)
+static void writeTexCoord(FgTextBuf &ofs, const vector<FgVect2F> &texCoord)
 {
     if (texCoord.size())
     {
@@ -870,7 +856,7 @@ static void writeTexCoord(ofstream &ofs, const vector<FgVect2F> &texCoord)
 //****************************************************************************
 //                              writeVertices
 //****************************************************************************
-static void writeVertices(ofstream &ofs, const vector<FgVect3F> &vtxList)
+static void writeVertices(FgTextBuf &ofs, const vector<FgVect3F> &vtxList)
 {
     ofs << "\tsetAttr -s " << vtxList.size() 
                 << " \".vt[0:" << vtxList.size()-1 << "]\"\n";
@@ -895,7 +881,7 @@ static void writeVertices(ofstream &ofs, const vector<FgVect3F> &vtxList)
 //****************************************************************************
 //                              writeEdges
 //****************************************************************************
-static void writeEdges(ofstream &ofs, const vector<FgVect2UI> &edgeList)
+static void writeEdges(FgTextBuf &ofs, const vector<FgVect2UI> &edgeList)
 {
     ofs << "\tsetAttr -s " << edgeList.size() 
                 << " \".ed[0:" << edgeList.size()-1 << "]\"\n";
@@ -921,7 +907,7 @@ static void writeEdges(ofstream &ofs, const vector<FgVect2UI> &edgeList)
 //****************************************************************************
 static void writeFacets(
 
-    ofstream                    &ofs,
+    FgTextBuf                   &ofs,
     const vector<FgVect3F>    &vtxList,
     const vector<FgVect3UI>    &triList,
     const vector<FgVect4UI>    &quadList,
@@ -1014,12 +1000,71 @@ static void writeFacets(
 }
 
 
+//****************************************************************************
+//                              writeMorphTarget
+//****************************************************************************
+static void writeMorphTarget(
+
+    const FffMultiObjectC           &model,
+    const vector<FffMultiObjectC>   &morphTargets,
+    const vector<string>            &morphNames,
+    const vector<FgTextBuf>         &topoText,
+    size_t                          mm,
+    FgTextBuf                       &ofs)
+{
+    string morphGrp = getMorphName(morphNames[mm]);
+
+    ofs << "createNode transform -n \"" << morphGrp << "\";\n";
+
+    for (unsigned long objId=0; objId<model.numObjs(); ++objId)
+    {
+        string texFname = model.getTextureFilename(objId);
+        if (texFname.length() == 0)
+            texFname = "";
+
+        const vector<FgVect3F> &mVtxList = morphTargets[mm].getPtList(objId);
+        size_t  numFacets = model.getTriList(objId).size() + model.getQuadList(objId).size();
+
+        string morphName = 
+            getObjMorphName(model,objId,morphNames[mm]);
+        string morphShapeName = 
+            getObjMorphShapeName(model,objId,morphNames[mm]);
+
+        ofs << "createNode transform -n \"" << morphName << "\" "
+                    << "-p \"" << morphGrp << "\";\n";
+        ofs << "\tsetAttr \".v\" no;\n";
+        ofs << "createNode mesh -n \"" << morphShapeName << "\" "
+                    << "-p \"" << morphName << "\";\n";
+        ofs << "\tsetAttr -k off \".v\";\n";
+
+        if (texFname != "")
+        {
+            ofs << "\tsetAttr -s 2 \".iog[0].og\";\n";
+            ofs << "\tsetAttr \".iog[0].og[0].gcl\" "
+                        << "-type \"componentList\" 0;\n";
+            ofs << "\tsetAttr \".iog[0].og[1].gcl\" "
+                        << "-type \"componentList\" 1 "
+                        << "\"f[0:" << numFacets-1 << "]\";\n";
+        }
+
+        ofs << "\tsetAttr \".uvst[0].uvsn\" -type \"string\" \"map1\";\n"; 
+        ofs << "\tsetAttr \".cuvs\" -type \"string\" \"map1\";\n";
+
+        // Morph vertices
+        writeVertices(ofs,mVtxList);
+
+        // Edges and faces are the same as the base
+        ofs << topoText[objId];
+    }
+}
+
+
 //****************************************************************************
 //                              writeObjects
 //****************************************************************************
 static void writeObjects(
 
-    ofstream                        &ofs,
+    FgTextBuf                       &ofs,
     const FffMultiObjectC           &model,
     const vector<FffMultiObjectC>   *morphTargets,
     const vector<string>            *morphNames,
@@ -1040,6 +1085,7 @@ static void writeObjects(
 
     vector< EdgeMapT > edgeMap;
     vector< vector<FgVect2UI> > edgeList;
+    vector<FgTextBuf> topoText(model.numObjs());
     edgeMap.resize(model.numObjs());
     edgeList.resize(model.numObjs());
     edgeSizeList.clear();
@@ -1123,72 +1169,18 @@ static void writeObjects(
         // Vertices
         writeVertices(ofs,vtxList);
 
-        // Edges
-        writeEdges(ofs,edgeList[objId]);
-
-        // Faces
-        writeFacets(ofs,vtxList,triList,quadList,edgeMap[objId],
+        // Edges and faces. The morph targets share these so only format them once:
+        writeEdges(topoText[objId],edgeList[objId]);
+        writeFacets(topoText[objId],vtxList,triList,quadList,edgeMap[objId],
                     texCoord,texTriList,texQuadList);
+        ofs << topoText[objId];
     }
 
-    // Now the morph targets
-    for (unsigned long mm=0; mm < numTargets; ++mm)
-    {
-        string morphGrp = getMorphName((*morphNames)[mm]);
-
-        ofs << "createNode transform -n \"" << morphGrp << "\";\n";
-
-        for (unsigned long objId=0; objId<model.numObjs(); ++objId)
-        {
-            string texFname = model.getTextureFilename(objId);
-            if (texFname.length() == 0)
-                texFname = "";
-
-            const vector<FgVect3F> &mVtxList = 
-                (*morphTargets)[mm].getPtList(objId);
-            const vector<FgVect3F> &vtxList = model.getPtList(objId);
-            const vector<FgVect3UI> &triList = model.getTriList(objId);
-            const vector<FgVect4UI> &quadList = model.getQuadList(objId);
-            const vector<FgVect2F> &texCoord = model.getTextCoord(objId);
-            const vector<FgVect3UI> &texTriList = model.getTexTriList(objId);
-            const vector<FgVect4UI> &texQuadList=model.getTexQuadList(objId);
-
-            size_t  numFacets = triList.size() + quadList.size();
-
-            string morphName = 
-                getObjMorphName(model,objId,(*morphNames)[mm]);
-            string morphShapeName = 
-                getObjMorphShapeName(model,objId,(*morphNames)[mm]);
-
-            ofs << "createNode transform -n \"" << morphName << "\" "
-                        << "-p \"" << morphGrp << "\";\n";
-            ofs << "\tsetAttr \".v\" no;\n";
-            ofs << "createNode mesh -n \"" << morphShapeName << "\" "
-                        << "-p \"" << morphName << "\";\n";
-            ofs << "\tsetAttr -k off \".v\";\n";
-
-            if (texFname != "")
-            {
-                ofs << "\tsetAttr -s 2 \".iog[0].og\";\n";
-                ofs << "\tsetAttr \".iog[0].og[0].gcl\" "
-                            << "-type \"componentList\" 0;\n";
-                ofs << "\tsetAttr \".iog[0].og[1].gcl\" "
-                            << "-type \"componentList\" 1 "
-                            << "\"f[0:" << numFacets-1 << "]\";\n";
-            }
-
-            ofs << "\tsetAttr \".uvst[0].uvsn\" -type \"string\" \"map1\";\n"; 
-            ofs << "\tsetAttr \".cuvs\" -type \"string\" \"map1\";\n";
-
-            // Morph vertices
-            writeVertices(ofs,mVtxList);
-
-            // Other info.
-            writeEdges(ofs,edgeList[objId]);
-            writeFacets(ofs,vtxList,triList,quadList,edgeMap[objId],
-                        texCoord,texTriList,texQuadList);
-        }
-    }
+    // Now the morph targets. These are independent so are formatted concurrently:
+    if (numTargets)
+        fgTextBlocks(ofs,numTargets,
+            boost::bind(writeMorphTarget,boost::cref(model),boost::cref(*morphTargets),
+                        boost::cref(*morphNames),boost::cref(topoText),_1,_2));
 }
 
 
@@ -1197,7 +1189,7 @@ static void writeObjects(
 //****************************************************************************
 static int writeShadingMaterialPhong(
 
-    ofstream                    &ofs,
+    FgTextBuf                   &ofs,
     const FffMultiObjectC       &model,
     const vector<string>        *morphNames)
 {
@@ -1264,7 +1256,7 @@ static int writeShadingMaterialPhong(
 //****************************************************************************
 static void writeBlendShapes(
 
-    ofstream                    &ofs, 
+    FgTextBuf                   &ofs, 
     const FffMultiObjectC       &model,
     const vector<string>        *morphNames)
 {
@@ -1371,7 +1363,7 @@ static void writeBlendShapes(
 //****************************************************************************
 static void writePolySoftEdge(
 
-    ofstream                    &ofs, 
+    FgTextBuf                   &ofs, 
     const FffMultiObjectC       &model,
     const vector<string>        *morphNames,
     const vector<int>           &edgeSizeList)
@@ -1415,7 +1407,7 @@ static void writePolySoftEdge(
 //****************************************************************************
 static void connectAttributes(
 
-    ofstream                        &ofs,
+    FgTextBuf                       &ofs,
     const FffMultiObjectC           &model,
     const vector<string>            *morphNames)
 {
@@ -8,12 +8,17 @@
 
 #include "stdafx.h"
 #include "FgStdStream.hpp"
+#include "FgTextBuf.hpp"
 #include "FgImage.hpp"
 #include "FgFileSystem.hpp"
 #include "Fg3dMeshOps.hpp"
 #include "FgTokenizer.hpp"
 #include "FgParse.hpp"
 #include "Fg3dNormals.hpp"
+#include "FgThread.hpp"
+#include "FgCommand.hpp"
+#include "FgTime.hpp"
+#include "FgProfile.hpp"
 
 #include <boost/algorithm/string.hpp>
 
@@ -39,167 +44,586 @@ fgObjTest()
     ofs.close();
 }
 
-static
-float
-parseFloat(const string & str)
+namespace {
+
+// The WOBJ parser below works in place on the file contents: lines and tokens are (pointer,end)
+// ranges into the buffer and numbers are parsed directly from them, so no per-line or per-token
+// strings are allocated. Number parsing is locale-independent.
+
+inline bool
+isBlank(char c)
+{return ((c == ' ') || (c == '\t')); }
+
+inline void
+skipBlanks(const char * & pos,const char * end)
 {
-    istringstream   iss(str);
-    float           ret;
-    iss >> ret;
-    return ret;
+    while ((pos < end) && isBlank(*pos))
+        ++pos;
 }
 
-static
-FgVect3F
-parseVert(
-    const string &  str,
-    bool &          homogenous, // Set to true if there is a homogenous coord (which is ignored)
-    bool &          vertColors) // Set to true if there is a vertex color specified (which is ignored)
+// Exact powers of 10 representable as double:
+const double pow10Tab[] = {
+    1e0,1e1,1e2,1e3,1e4,1e5,1e6,1e7,1e8,1e9,1e10,1e11,
+    1e12,1e13,1e14,1e15,1e16,1e17,1e18,1e19,1e20,1e21,1e22
+};
+
+// Returns false if there is no valid number at 'pos'. On success 'pos' is advanced past the number:
+bool
+parseFloat(const char * & pos,const char * end,float & val)
 {
-    vector<string>  nums = fgSplitChar(str,' ');
-    if (nums.size() < 3)
-        FGASSERT_FALSE1("Too few values specifying vertex");
-    else if (nums.size() == 4)
-        // A fourth homogenous coord value can also be specified but is only used for rational
-        // cureves so we ignore:
-        homogenous = true;
-    else if (nums.size() == 6)
-        vertColors = true;
-    else if (nums.size() != 3)
-        FGASSERT_FALSE1("Invalid number of arguments for vertex");
-    FgVect3F        ret;
-    for (uint ii=0; ii<3; ++ii)
-        ret[ii] = parseFloat(nums[ii]);
-    return ret;
+    const char *    p = pos;
+    bool            neg = false;
+    if ((p < end) && ((*p == '-') || (*p == '+'))) {
+        neg = (*p == '-');
+        ++p;
+    }
+    uint64          mant = 0;
+    int             exp10 = 0,
+                    numDigits = 0,
+                    sigDigits = 0;
+    for (; (p < end) && (uint(*p-'0') < 10); ++p, ++numDigits) {
+        if (sigDigits < 19) {
+            mant = mant * 10 + uint(*p-'0');
+            if (mant > 0)
+                ++sigDigits;
+        }
+        else
+            ++exp10;            // Digits beyond uint64 precision only affect magnitude
+    }
+    if ((p < end) && (*p == '.')) {
+        for (++p; (p < end) && (uint(*p-'0') < 10); ++p, ++numDigits) {
+            if (sigDigits < 19) {
+                mant = mant * 10 + uint(*p-'0');
+                if (mant > 0)
+                    ++sigDigits;
+                --exp10;
+            }
+        }
+    }
+    if (numDigits == 0)
+        return false;
+    if ((p < end) && ((*p == 'e') || (*p == 'E'))) {
+        const char *    q = p + 1;
+        bool            eneg = false;
+        if ((q < end) && ((*q == '-') || (*q == '+'))) {
+            eneg = (*q == '-');
+            ++q;
+        }
+        if ((q < end) && (uint(*q-'0') < 10)) {
+            int         ev = 0;
+            for (; (q < end) && (uint(*q-'0') < 10); ++q)
+                if (ev < 10000)
+                    ev = ev * 10 + (*q-'0');
+            exp10 += eneg ? -ev : ev;
+            p = q;
+        }
+    }
+    double          dv = double(mant);
+    if (mant != 0) {
+        if ((exp10 >= 0) && (exp10 <= 22))
+            dv *= pow10Tab[exp10];
+        else if ((exp10 < 0) && (exp10 >= -22))
+            dv /= pow10Tab[-exp10];
+        else
+            dv *= std::pow(10.0,double(exp10));
+    }
+    val = float(neg ? -dv : dv);
+    pos = p;
+    return true;
 }
 
-static
-FgVect2F
-parseUv(const string & str)
+bool
+parseInt(const char * & pos,const char * end,int & val)
 {
-    vector<string>  nums = fgSplitChar(str,' ');
-    // A third homogenous coord value can also be specified but is only used for rational
-    // cureves so we ignore:
-    FGASSERT((nums.size() > 1) && (nums.size() < 4));
-    FgVect2F        ret;
-    for (uint ii=0; ii<2; ++ii)
-        ret[ii] = parseFloat(nums[ii]);
-    return ret;
+    const char *    p = pos;
+    bool            neg = false;
+    if ((p < end) && ((*p == '-') || (*p == '+'))) {
+        neg = (*p == '-');
+        ++p;
+    }
+    if ((p == end) || (uint(*p-'0') >= 10))
+        return false;
+    int64           acc = 0;
+    for (; (p < end) && (uint(*p-'0') < 10); ++p)
+        if (acc <= std::numeric_limits<int>::max())
+            acc = acc * 10 + (*p-'0');
+    if (acc > std::numeric_limits<int>::max())
+        return false;
+    val = int(neg ? -acc : acc);
+    pos = p;
+    return true;
 }
 
-static
-bool
-parseFacet(
-    const string &      str,
-    size_t              numVerts,
-    size_t              numUvs,
-    FgFacetInds<3> &    tris,
-    FgFacetInds<4> &    quads)
+// Parses up to 'maxNum' blank-separated floats, returns the number of values found (maxNum+1 if
+// there are more). Invalid values are set to zero and flagged by 'bad' so that the caller can
+// still keep the element (and thus the indexing of all subsequent elements):
+uint
+parseFloats(const char * pos,const char * end,float * vals,uint maxNum,bool & bad)
 {
-    bool            ret = false;
-    vector<string>  strs = fgSplitChar(str,' ');
-    FGASSERT(strs.size() > 2);
-    vector<vector<uint> >   nums;
-    for (size_t ii=0; ii<strs.size(); ++ii) {
-        vector<string>  ns = fgSplitChar(strs[ii],'/',true);
-        size_t          sz = fgMin(ns.size(),size_t(2));    // Ignore normal indices
-        vector<uint>    nms;
-        for (size_t jj=0; jj<sz; ++jj) {
-            size_t      numLim = ((jj == 0) ? numVerts : numUvs);
-            if (!ns[jj].empty()) {
-                istringstream   iss(ns[jj]);
-                int             num;
-                iss >> num;
-                --num;                              // WOBJ indexing starts at 1
-                FGASSERT(num < int(numLim));
-                // Indices can be negative in which case -1 refers to last index and so on backward:
-                if (num < 0) {
-                    FGASSERT(size_t(-num) <= numLim);
-                    nms.push_back(uint(int(numLim)+num));
+    uint            num = 0;
+    for (;;) {
+        skipBlanks(pos,end);
+        if (pos == end)
+            return num;
+        if (num == maxNum)
+            return maxNum + 1;
+        if (!parseFloat(pos,end,vals[num]) || ((pos < end) && !isBlank(*pos))) {
+            vals[num] = 0.0f;
+            bad = true;
+            while ((pos < end) && !isBlank(*pos))
+                ++pos;
+        }
+        ++num;
+    }
+}
+
+// Number of blank-separated tokens, up to 'maxNum'+1. Each token is one value to 'parseFloats':
+uint
+countTokens(const char * pos,const char * end,uint maxNum)
+{
+    uint            num = 0;
+    for (;;) {
+        skipBlanks(pos,end);
+        if (pos == end)
+            return num;
+        if (num == maxNum)
+            return maxNum + 1;
+        while ((pos < end) && !isBlank(*pos))
+            ++pos;
+        ++num;
+    }
+}
+
+// Vertex and UV lines with other numbers of values are rejected. The counting and parsing
+// passes must agree on this so that chunk offsets match array positions:
+const uint      maxVertVals = 7,
+                maxUvVals = 3;
+
+inline bool
+vertNumValid(uint num)
+{return ((num == 3) || (num == 4) || (num == 6)); }
+
+inline bool
+uvNumValid(uint num)
+{return ((num == 2) || (num == 3)); }
+
+struct  ObjWarning
+{
+    size_t          offset;     // Byte offset of line in buffer
+    string          msg;
+
+    ObjWarning(size_t o,const string & m) : offset(o), msg(m) {}
+};
+
+// Facets between separator lines:
+struct  ObjSegment
+{
+    bool            named;      // Otherwise continues the surface of the previous segment
+    string          name;
+    Fg3dSurface     surf;
+
+    ObjSegment() : named(false) {}
+};
+
+// The results of parsing a range of whole lines:
+struct  ObjChunk
+{
+    const char *        begin;
+    const char *        end;
+    size_t              vertOffset;     // Number of verts and uvs defined before this chunk
+    size_t              uvOffset;
+    FgVerts             verts;
+    vector<FgVect2F>    uvs;
+    vector<ObjSegment>  segs;
+    vector<ObjWarning>  warnings;
+    size_t              numNgons;
+    bool                homogenous;
+    bool                colors;
+    bool                truncated;      // An invalid separator line stops all further parsing
+
+    ObjChunk() : vertOffset(0), uvOffset(0), numNgons(0), homogenous(false), colors(false), truncated(false) {}
+};
+
+// Calls 'func(lineBegin,lineEnd)' for each non-empty logical line in [begin,end), honouring
+// backslash line continuation. Returns false if 'func' does:
+template<class Func>
+void
+forEachLine(const char * begin,const char * end,Func & func)
+{
+    string          joined;             // Only used for continued lines
+    const char *    pos = begin;
+    while (pos < end) {
+        const char *    lineBeg = pos;
+        const char *    nl = static_cast<const char *>(memchr(pos,'\n',end-pos));
+        const char *    lineEnd = (nl == NULL) ? end : nl;
+        pos = (nl == NULL) ? end : nl + 1;
+        while ((lineEnd > lineBeg) && (lineEnd[-1] == '\r'))
+            --lineEnd;
+        if ((lineEnd > lineBeg) && (lineEnd[-1] == '\\')) {
+            joined.assign(lineBeg,lineEnd-1);
+            while (pos < end) {
+                const char *    b = pos;
+                nl = static_cast<const char *>(memchr(pos,'\n',end-pos));
+                const char *    e = (nl == NULL) ? end : nl;
+                pos = (nl == NULL) ? end : nl + 1;
+                while ((e > b) && (e[-1] == '\r'))
+                    --e;
+                if ((e > b) && (e[-1] == '\\'))
+                    joined.append(b,e-1);
+                else {
+                    joined.append(b,e);
+                    break;
                 }
-                else
-                    nms.push_back(uint(num));
             }
+            if (!joined.empty() && !func(lineBeg,joined.data(),joined.data()+joined.size()))
+                return;
+        }
+        else if (lineEnd > lineBeg) {
+            if (!func(lineBeg,lineBeg,lineEnd))
+                return;
         }
-        nums.push_back(nms);
     }
-    for (size_t ii=1; ii<nums.size(); ++ii)
-        FGASSERT(nums[ii].size() == nums[ii-1].size());
-    if (nums.size() == 3) {
-        tris.vertInds.push_back(FgVect3UI(nums[0][0],nums[1][0],nums[2][0]));
-        if (nums[0].size() > 1)
-            tris.uvInds.push_back(FgVect3UI(nums[0][1],nums[1][1],nums[2][1]));
+}
+
+inline bool
+isContinued(const char * lineEnd,const char * begin)
+{
+    while ((lineEnd > begin) && (lineEnd[-1] == '\r'))
+        --lineEnd;
+    return ((lineEnd > begin) && (lineEnd[-1] == '\\'));
+}
+
+// Count the vertex and UV definitions that 'ParseLines' will keep, so chunk offsets are known
+// before parsing facets:
+struct  CountLines
+{
+    size_t      verts;
+    size_t      uvs;
+
+    CountLines() : verts(0), uvs(0) {}
+
+    bool
+    operator()(const char *,const char * pos,const char * end)
+    {
+        skipBlanks(pos,end);
+        if ((end-pos > 1) && (pos[0] == 'v')) {
+            if (isBlank(pos[1])) {
+                if (vertNumValid(countTokens(pos+2,end,maxVertVals)))
+                    ++verts;
+            }
+            else if ((pos[1] == 't') && (end-pos > 2) && isBlank(pos[2])) {
+                if (uvNumValid(countTokens(pos+3,end,maxUvVals)))
+                    ++uvs;
+            }
+        }
+        return true;
     }
-    if (nums.size() == 4) {
-        quads.vertInds.push_back(FgVect4UI(nums[0][0],nums[1][0],nums[2][0],nums[3][0]));
-        if (nums[0].size() > 1)
-            quads.uvInds.push_back(FgVect4UI(nums[0][1],nums[1][1],nums[2][1],nums[3][1]));
+};
+
+struct  ParseLines
+{
+    ObjChunk &          chunk;
+    const string &      surfSeparator;
+    const char *        bufBegin;
+    // Facet vertex index lists are re-used to avoid allocation:
+    vector<uint>        vertInds,
+                        uvInds;
+
+    ParseLines(ObjChunk & c,const string & s,const char * b) : chunk(c), surfSeparator(s), bufBegin(b)
+    {chunk.segs.resize(1); }
+
+    void
+    parseFacet(const char * pos,const char * end)
+    {
+        size_t          numVerts = chunk.vertOffset + chunk.verts.size(),
+                        numUvs = chunk.uvOffset + chunk.uvs.size();
+        vertInds.clear();
+        uvInds.clear();
+        size_t          numIndsPerVert = 0;
+        for (;;) {
+            skipBlanks(pos,end);
+            if (pos == end)
+                break;
+            int         inds[2];
+            size_t      numInds = 0;
+            bool        hasVert = false;
+            // Ignore normal indices (third index):
+            for (uint jj=0; jj<3; ++jj) {
+                if ((pos < end) && !isBlank(*pos) && (*pos != '/')) {
+                    int         num;
+                    if (!parseInt(pos,end,num))
+                        fgThrow("Invalid facet index");
+                    if (jj < 2) {
+                        size_t      numLim = ((jj == 0) ? numVerts : numUvs);
+                        // Indices can be negative in which case -1 refers to last index and so on backward:
+                        if (num < 0) {
+                            FGASSERT(size_t(-num) <= numLim);
+                            num = int(numLim) + num;
+                        }
+                        else {
+                            --num;                          // WOBJ indexing starts at 1
+                            FGASSERT((num >= 0) && (num < int(numLim)));
+                        }
+                        inds[jj] = num;
+                        hasVert = hasVert || (jj == 0);
+                        ++numInds;
+                    }
+                }
+                if ((pos < end) && (*pos == '/'))
+                    ++pos;
+                else
+                    break;
+            }
+            if ((pos < end) && !isBlank(*pos))
+                fgThrow("Invalid facet index");
+            if (!hasVert)
+                fgThrow("Missing facet vertex index");
+            if (vertInds.empty())
+                numIndsPerVert = numInds;
+            else if (numInds != numIndsPerVert)
+                fgThrow("Inconsistent facet indices");
+            vertInds.push_back(uint(inds[0]));
+            if (numInds > 1)
+                uvInds.push_back(uint(inds[1]));
+        }
+        size_t          num = vertInds.size();
+        FGASSERT(num > 2);
+        bool            uvs = (uvInds.size() == num);
+        Fg3dSurface &   surf = chunk.segs.back().surf;
+        if (num == 3) {
+            surf.tris.vertInds.push_back(FgVect3UI(vertInds[0],vertInds[1],vertInds[2]));
+            if (uvs)
+                surf.tris.uvInds.push_back(FgVect3UI(uvInds[0],uvInds[1],uvInds[2]));
+        }
+        else if (num == 4) {
+            surf.quads.vertInds.push_back(FgVect4UI(vertInds[0],vertInds[1],vertInds[2],vertInds[3]));
+            if (uvs)
+                surf.quads.uvInds.push_back(FgVect4UI(uvInds[0],uvInds[1],uvInds[2],uvInds[3]));
+        }
+        else {                          // N-gon
+            for (size_t ii=0; ii<num-2; ++ii) {
+                surf.tris.vertInds.push_back(FgVect3UI(vertInds[0],vertInds[ii+1],vertInds[ii+2]));
+                if (uvs)
+                    surf.tris.uvInds.push_back(FgVect3UI(uvInds[0],uvInds[ii+1],uvInds[ii+2]));
+            }
+            ++chunk.numNgons;
+        }
     }
-    if (nums.size() > 4) {          // N-gon
-        for (size_t ii=0; ii<nums.size()-2; ++ii) {
-            tris.vertInds.push_back(FgVect3UI(nums[0][0],nums[ii+1][0],nums[ii+2][0]));
-            if (nums[ii].size() > 1)
-                tris.uvInds.push_back(FgVect3UI(nums[0][1],nums[ii+1][1],nums[ii+2][1]));
+
+    // Returns false if parsing must stop:
+    bool
+    parseSeparator(const char * lineOrig,const char * pos,const char * end)
+    {
+        const char *    words[2][2];
+        uint            numWords = 0;
+        for (;;) {
+            skipBlanks(pos,end);
+            if (pos == end)
+                break;
+            const char *    wb = pos;
+            while ((pos < end) && !isBlank(*pos))
+                ++pos;
+            if (numWords < 2) {
+                words[numWords][0] = wb;
+                words[numWords][1] = pos;
+            }
+            ++numWords;
         }
-        ret = true;
+        if (numWords != 2) {
+            chunk.warnings.push_back(ObjWarning(lineOrig-bufBegin,"Invalid " + surfSeparator + " name"));
+            chunk.truncated = true;
+            return false;
+        }
+        chunk.segs.push_back(ObjSegment());
+        chunk.segs.back().named = true;
+        chunk.segs.back().name.assign(words[1][0],words[1][1]);
+        return true;
     }
-    return ret;
+
+    bool
+    operator()(const char * lineOrig,const char * pos,const char * end)
+    {
+        try {
+            skipBlanks(pos,end);
+            if (pos == end)
+                return true;
+            if ((end-pos > 1) && (pos[0] == 'v')) {
+                if (isBlank(pos[1])) {
+                    float       vals[maxVertVals];
+                    bool        bad = false;
+                    uint        num = parseFloats(pos+2,end,vals,maxVertVals,bad);
+                    if (num < 3)
+                        fgThrow("Too few values specifying vertex");
+                    else if (!vertNumValid(num))
+                        fgThrow("Invalid number of arguments for vertex");
+                    else if (num == 4)
+                        // A fourth homogenous coord value can also be specified but is only used for
+                        // rational curves so we ignore:
+                        chunk.homogenous = true;
+                    else if (num == 6)
+                        chunk.colors = true;
+                    chunk.verts.push_back(FgVect3F(vals[0],vals[1],vals[2]));
+                    if (bad)
+                        fgThrow("Invalid number in vertex (set to zero)");
+                }
+                else if ((pos[1] == 't') && (end-pos > 2) && isBlank(pos[2])) {
+                    float       vals[maxUvVals];
+                    bool        bad = false;
+                    uint        num = parseFloats(pos+3,end,vals,maxUvVals,bad);
+                    // A third homogenous coord value can also be specified but is only used for
+                    // rational curves so we ignore:
+                    if (!uvNumValid(num))
+                        fgThrow("Invalid number of arguments for UV");
+                    chunk.uvs.push_back(FgVect2F(vals[0],vals[1]));
+                    if (bad)
+                        fgThrow("Invalid number in UV (set to zero)");
+                }
+            }
+            else if ((end-pos > 1) && (pos[0] == 'f') && isBlank(pos[1]))
+                parseFacet(pos+2,end);
+            if (!surfSeparator.empty() && (size_t(end-pos) >= surfSeparator.size()) &&
+                (memcmp(pos,surfSeparator.data(),surfSeparator.size()) == 0))
+                return parseSeparator(lineOrig,pos,end);
+        }
+        catch(const FgException & e) {
+            chunk.warnings.push_back(ObjWarning(lineOrig-bufBegin,e.tr_message().as_utf8_string()));
+        }
+        return true;
+    }
+};
+
+void
+countChunk(vector<ObjChunk> & chunks,size_t idx)
+{
+    ObjChunk &      chunk = chunks[idx];
+    CountLines      cl;
+    forEachLine(chunk.begin,chunk.end,cl);
+    chunk.vertOffset = cl.verts;        // Converted to offsets once all are counted
+    chunk.uvOffset = cl.uvs;
+}
+
+void
+parseChunk(const string & surfSeparator,const char * bufBegin,vector<ObjChunk> & chunks,size_t idx)
+{
+    ObjChunk &      chunk = chunks[idx];
+    ParseLines      pl(chunk,surfSeparator,bufBegin);
+    forEachLine(chunk.begin,chunk.end,pl);
+}
+
+void
+addSurf(map<string,Fg3dSurface> & surfs,const string & name,const Fg3dSurface & surf)
+{
+    if (surf.empty())
+        return;
+    map<string,Fg3dSurface>::iterator   it = surfs.find(name);
+    if (it == surfs.end())
+        surfs[name] = surf;
+    else
+        it->second.merge(surf);
+}
+
 }
 
+// Files smaller than this are not worth splitting:
+static const size_t     wobjMinChunkBytes = 1 << 20;
+
 Fg3dMesh
 fgLoadWobj(
     const FgString &    fname,
-    string              surfSeparator)
+    string              surfSeparator,
+    uint                numThreads)
 {
+    FG_PROFILE_SCOPE("fgLoadWobj");
+    FgFileMap           file(fname);
+    const char *        bufBegin = reinterpret_cast<const char *>(file.data),
+               *        bufEnd = bufBegin + file.size;
+    size_t              numChunks = fgMin(size_t(fgNumThreads(numThreads)),file.size/wobjMinChunkBytes);
+    vector<ObjChunk>    chunks(fgMax(numChunks,size_t(1)));
+    // Split at line ends which are not continued:
+    const char *        pos = bufBegin;
+    for (size_t cc=0; cc<chunks.size(); ++cc) {
+        chunks[cc].begin = pos;
+        if (cc+1 == chunks.size())
+            pos = bufEnd;
+        else {
+            pos = fgMax(pos,bufBegin + (file.size * (cc+1)) / chunks.size());
+            for (;;) {
+                const char *    nl = static_cast<const char *>(memchr(pos,'\n',bufEnd-pos));
+                if (nl == NULL) {
+                    pos = bufEnd;
+                    break;
+                }
+                pos = nl + 1;
+                if (!isContinued(nl,chunks[cc].begin))
+                    break;
+            }
+        }
+        chunks[cc].end = pos;
+    }
+    if (chunks.size() > 1) {
+        fgParallelFor(chunks.size(),boost::bind(countChunk,boost::ref(chunks),_1),numThreads);
+        size_t          vertAcc = 0,
+                        uvAcc = 0;
+        for (size_t cc=0; cc<chunks.size(); ++cc) {
+            size_t      nv = chunks[cc].vertOffset,
+                        nu = chunks[cc].uvOffset;
+            chunks[cc].vertOffset = vertAcc;
+            chunks[cc].uvOffset = uvAcc;
+            vertAcc += nv;
+            uvAcc += nu;
+        }
+    }
+    fgParallelFor(chunks.size(),boost::bind(parseChunk,boost::cref(surfSeparator),bufBegin,boost::ref(chunks),_1),numThreads);
+    // Merge in order:
     Fg3dMesh                    mesh;
-    string                      currName;
     map<string,Fg3dSurface>     surfs;
-    vector<string>              lines = fgSplitLines(fgSlurp(fname));
+    string                      currName;
     Fg3dSurface                 surf;
-    size_t                      numNgons = 0;
+    size_t                      numNgons = 0,
+                                numVerts = 0,
+                                numUvs = 0;
     bool                        vertexColors = false,
                                 vertexHomogenous = false;
-    for (size_t ii=0; ii<lines.size(); ++ii) {
-        try {
-            const string &  line = lines[ii];
-            if (line[0] == 'v') {
-                if (line[1] == ' ')
-                    mesh.verts.push_back(parseVert(line.substr(2),vertexHomogenous,vertexColors));
-                if (line[1] == 't')
-                    if (line[2] == ' ')
-                        mesh.uvs.push_back(parseUv(line.substr(3)));
-            }
-            if (line[0] == 'f') {
-                if (line[1] == ' ') {
-                    if (parseFacet(line.substr(2),mesh.verts.size(),mesh.uvs.size(),surf.tris,surf.quads))
-                        ++numNgons;
-                }
-            }
-            if (!surfSeparator.empty() && fgStartsWith(line,surfSeparator)) {
-                vector<string>  words = fgSplitAtSeparators(line,' ');
-                if (words.size() != 2) {
-                    fgout << "WARNING: Invalid " << surfSeparator << " name on line " << ii << " of " << fname;
-                    break;
-                }
-                string          name = words[1];
-                if (currName != name) {
-                    if (!surf.empty()) {
-                        if (surfs.find(currName) == surfs.end())
-                            surfs[currName] = surf;
-                        else
-                            surfs[currName].merge(surf);
-                    }
-                    currName = name;
-                    surf = Fg3dSurface();
-                }
+    size_t                      numChunksUsed = 0;
+    for (; numChunksUsed<chunks.size(); ++numChunksUsed) {
+        const ObjChunk &    chunk = chunks[numChunksUsed];
+        numVerts += chunk.verts.size();
+        numUvs += chunk.uvs.size();
+        if (chunk.truncated) {
+            ++numChunksUsed;
+            break;
+        }
+    }
+    mesh.verts.reserve(numVerts);
+    mesh.uvs.reserve(numUvs);
+    size_t                      lineNum = 1;
+    const char *                linePos = bufBegin;
+    for (size_t cc=0; cc<numChunksUsed; ++cc) {
+        const ObjChunk &    chunk = chunks[cc];
+        fgAppend(mesh.verts,chunk.verts);
+        fgAppend(mesh.uvs,chunk.uvs);
+        for (size_t ss=0; ss<chunk.segs.size(); ++ss) {
+            const ObjSegment &  seg = chunk.segs[ss];
+            if (seg.named && (seg.name != currName)) {
+                addSurf(surfs,currName,surf);
+                currName = seg.name;
+                surf = Fg3dSurface();
             }
-            if (line[0] == '#')
-                continue;
+            if (surf.empty())
+                surf = seg.surf;
+            else
+                surf.merge(seg.surf);
         }
-        catch(const FgException & e) {
-            fgout << fgnl << "WARNING: Error in line " << ii+1 << " of " << fname << ": " << e.tr_message() << fgpush
-                << fgnl << lines[ii] << fgpop;
+        for (size_t ww=0; ww<chunk.warnings.size(); ++ww) {
+            const ObjWarning &  w = chunk.warnings[ww];
+            const char *        wpos = bufBegin + w.offset;
+            lineNum += std::count(linePos,wpos,'\n');
+            linePos = wpos;
+            fgout << fgnl << "WARNING: Error in line " << lineNum << " of " << fname << ": " << w.msg;
         }
+        numNgons += chunk.numNgons;
+        vertexHomogenous = vertexHomogenous || chunk.homogenous;
+        vertexColors = vertexColors || chunk.colors;
     }
     if (numNgons > 0)
         fgout << fgnl << "WARNING: " << numNgons << " N-gons broken into tris in " << fname;
@@ -207,12 +631,7 @@ fgLoadWobj(
         fgout << fgnl << "WARNING: Vertex homogenous coordinates ignored.";
     if (vertexColors)
         fgout << fgnl << "WARNING: Vertex color values ignored.";
-    if (!surf.empty()) {
-        if (surfs.find(currName) == surfs.end())
-            surfs[currName] = surf;
-        else
-            surfs[currName].merge(surf);
-    }
+    addSurf(surfs,currName,surf);
     mesh.name = fgPathToBase(fname);
     for (map<string,Fg3dSurface>::iterator it = surfs.begin(); it != surfs.end(); ++it) {
         Fg3dSurface &   srf = it->second;
@@ -254,7 +673,7 @@ struct  Offsets
 template<uint dim>
 void
 writeFacets(
-    FgOfstream &    ofs,
+    FgTextBuf &     ofs,
     const vector<FgMatrixC<uint,dim,1> > &  vertInds,
     const vector<FgMatrixC<uint,dim,1> > &  uvInds,
     Offsets         offsets)
@@ -267,7 +686,7 @@ writeFacets(
                 uint        vi = vert[kk]+offsets.vert;
                 ofs << vi << "//" << vi << " ";
             }
-            ofs << endl;
+            ofs << "\n";
         }
     }
     else {
@@ -280,7 +699,7 @@ writeFacets(
                 uint        vi = vert[kk]+offsets.vert;
                 ofs << vi << "/" << uv[kk]+offsets.uv << "/" << vi << " ";
             }
-            ofs << endl;
+            ofs << "\n";
         }
     }
 }
@@ -297,10 +716,24 @@ writeMtlBase(
         << "    Ka 0 0 0\n";
 }
 
+// Writes elements [begin,end) of 'vals' as lines prefixed by 'tag':
+template<uint dim>
+void
+writeVals(
+    const char *                            tag,
+    const vector<FgMatrixC<float,dim,1> > * vals,
+    size_t                                  begin,
+    size_t                                  end,
+    FgTextBuf &                             ofs)
+{
+    for (size_t ii=begin; ii<end; ++ii)
+        ofs << tag << (*vals)[ii] << "\n";
+}
+
 static
 Offsets
 writeMesh(
-    FgOfstream &        ofs,
+    FgTextBuf &         ofs,
     FgOfstream &        ofsMtl,
     const Fg3dMesh &    mesh,
     const FgPath &      fpath,
@@ -310,19 +743,10 @@ writeMesh(
     if (!mesh.deltaMorphs.empty())
         fgout << endl << "WARNING: OBJ format does not support morphs";
 
-    for (uint ii=0; ii<mesh.verts.size(); ++ii) {
-        FgVect3F    vert = mesh.verts[ii];
-        ofs << "v " << vert[0] << " " << vert[1] << " " << vert[2] << endl;
-    }
-    for (size_t ii=0; ii<mesh.uvs.size(); ++ii) {
-        FgVect2F    uv = mesh.uvs[ii];
-        ofs << "vt " << uv[0] << " " << uv[1] << endl;
-    }
+    fgTextRanges(ofs,mesh.verts.size(),boost::bind(writeVals<3>,"v ",&mesh.verts,_1,_2,_3));
+    fgTextRanges(ofs,mesh.uvs.size(),boost::bind(writeVals<2>,"vt ",&mesh.uvs,_1,_2,_3));
     Fg3dNormals         norms = fgNormals(mesh.surfaces,mesh.verts);
-    for (size_t ii=0; ii<norms.vert.size(); ++ii) {
-        FgVect3F    n = norms.vert[ii];
-        ofs << "vn " << n[0] << " " << n[1] << " " << n[2] << endl;
-    }
+    fgTextRanges(ofs,norms.vert.size(),boost::bind(writeVals<3>,"vn ",&norms.vert,_1,_2,_3));
     for (uint tt=0; tt<mesh.surfaces.size(); ++tt) {
         if (mesh.surfaces[tt].albedoMap) {
             string  idxString = fgToString(offsets.mat+tt);
@@ -338,8 +762,8 @@ writeMesh(
     for (size_t ii=0; ii<mesh.surfaces.size(); ++ii) {
         const Fg3dSurface & surf = mesh.surfaces[ii];
         FgString    name = (surf.name.empty() ? FgString("Surf")+fgToString(ii) : surf.name);
-        ofs << "g " << name << endl;
-        ofs << "usemtl Texture" << fgToString(offsets.mat+ii) << endl;
+        ofs << "g " << name << "\n";
+        ofs << "usemtl Texture" << offsets.mat+uint(ii) << "\n";
         writeFacets(ofs,surf.tris.vertInds,surf.tris.uvInds,offsets);
         writeFacets(ofs,surf.quads.vertInds,surf.quads.uvInds,offsets);
     }
@@ -360,16 +784,15 @@ fgSaveObj(
     for (size_t ii=0; ii<meshes.size(); ++ii)
         if (meshes[ii].numValidAlbedoMaps() > 0)
             texImage = true;
-    FgOfstream  ofs(fpath.dirBase()+".obj");
+    FgTextBuf   ofs(1 << 20);
     FgOfstream  ofsMtl;
-    ofs.precision(7);
     ofs <<
         "# Wavefront OBJ format.\n"
         "# Generated by FaceGen, for more information visit https://facegen.com\n";
     // Some OBJ parsers (MeshLab) can't handle spaces in filenames:
     if (texImage) {
         FgString    mtlBaseExt = fpath.base.replace(' ','_') + ".mtl";
-        ofs << "mtllib " << mtlBaseExt << endl;
+        ofs << "mtllib " << mtlBaseExt << "\n";
         ofsMtl.open(fpath.dir() + mtlBaseExt);
         writeMtlBase(ofsMtl,0);
     }
@@ -379,10 +802,307 @@ fgSaveObj(
         FgString            name = (mesh.name.empty() ? fpath.base : mesh.name);
         // Replace spaces with underscores in case some OBJ parsers can't handle that:
         name = name.replace(' ','_');
-        ofs << "o " << name << endl
-            << "s 1" << endl;    // Enable smooth shading
+        ofs << "o " << name << "\n"
+            << "s 1\n";         // Enable smooth shading
         offsets = writeMesh(ofs,ofsMtl,meshes[ii],fpath,offsets,imgFormat);
     }
+    fgDump(ofs,fpath.dirBase()+".obj");
+}
+
+// The original line-splitting loader (with negative facet indices resolved as in the OBJ spec),
+// kept as a reference for the output and speed of 'fgLoadWobj' in 'fgLoadWobjTest':
+static
+float
+refParseFloat(const string & str)
+{
+    istringstream   iss(str);
+    float           ret;
+    iss >> ret;
+    return ret;
+}
+
+static
+FgVect3F
+refParseVert(
+    const string &  str,
+    bool &          homogenous, // Set to true if there is a homogenous coord (which is ignored)
+    bool &          vertColors) // Set to true if there is a vertex color specified (which is ignored)
+{
+    vector<string>  nums = fgSplitChar(str,' ');
+    if (nums.size() < 3)
+        FGASSERT_FALSE1("Too few values specifying vertex");
+    else if (nums.size() == 4)
+        homogenous = true;
+    else if (nums.size() == 6)
+        vertColors = true;
+    else if (nums.size() != 3)
+        FGASSERT_FALSE1("Invalid number of arguments for vertex");
+    FgVect3F        ret;
+    for (uint ii=0; ii<3; ++ii)
+        ret[ii] = refParseFloat(nums[ii]);
+    return ret;
+}
+
+static
+FgVect2F
+refParseUv(const string & str)
+{
+    vector<string>  nums = fgSplitChar(str,' ');
+    FGASSERT((nums.size() > 1) && (nums.size() < 4));
+    FgVect2F        ret;
+    for (uint ii=0; ii<2; ++ii)
+        ret[ii] = refParseFloat(nums[ii]);
+    return ret;
+}
+
+static
+bool
+refParseFacet(
+    const string &      str,
+    size_t              numVerts,
+    size_t              numUvs,
+    FgFacetInds<3> &    tris,
+    FgFacetInds<4> &    quads)
+{
+    bool            ret = false;
+    vector<string>  strs = fgSplitChar(str,' ');
+    FGASSERT(strs.size() > 2);
+    vector<vector<uint> >   nums;
+    for (size_t ii=0; ii<strs.size(); ++ii) {
+        vector<string>  ns = fgSplitChar(strs[ii],'/',true);
+        size_t          sz = fgMin(ns.size(),size_t(2));    // Ignore normal indices
+        vector<uint>    nms;
+        for (size_t jj=0; jj<sz; ++jj) {
+            size_t      numLim = ((jj == 0) ? numVerts : numUvs);
+            if (!ns[jj].empty()) {
+                istringstream   iss(ns[jj]);
+                int             num;
+                iss >> num;
+                if (num < 0) {
+                    FGASSERT(size_t(-num) <= numLim);
+                    nms.push_back(uint(int(numLim)+num));
+                }
+                else {
+                    --num;                              // WOBJ indexing starts at 1
+                    FGASSERT((num >= 0) && (num < int(numLim)));
+                    nms.push_back(uint(num));
+                }
+            }
+        }
+        nums.push_back(nms);
+    }
+    for (size_t ii=1; ii<nums.size(); ++ii)
+        FGASSERT(nums[ii].size() == nums[ii-1].size());
+    if (nums.size() == 3) {
+        tris.vertInds.push_back(FgVect3UI(nums[0][0],nums[1][0],nums[2][0]));
+        if (nums[0].size() > 1)
+            tris.uvInds.push_back(FgVect3UI(nums[0][1],nums[1][1],nums[2][1]));
+    }
+    if (nums.size() == 4) {
+        quads.vertInds.push_back(FgVect4UI(nums[0][0],nums[1][0],nums[2][0],nums[3][0]));
+        if (nums[0].size() > 1)
+            quads.uvInds.push_back(FgVect4UI(nums[0][1],nums[1][1],nums[2][1],nums[3][1]));
+    }
+    if (nums.size() > 4) {          // N-gon
+        for (size_t ii=0; ii<nums.size()-2; ++ii) {
+            tris.vertInds.push_back(FgVect3UI(nums[0][0],nums[ii+1][0],nums[ii+2][0]));
+            if (nums[ii].size() > 1)
+                tris.uvInds.push_back(FgVect3UI(nums[0][1],nums[ii+1][1],nums[ii+2][1]));
+        }
+        ret = true;
+    }
+    return ret;
+}
+
+static
+Fg3dMesh
+loadWobjReference(
+    const FgString &    fname,
+    string              surfSeparator)
+{
+    Fg3dMesh                    mesh;
+    string                      currName;
+    map<string,Fg3dSurface>     surfs;
+    vector<string>              lines = fgSplitLines(fgSlurp(fname));
+    Fg3dSurface                 surf;
+    bool                        vertexColors = false,
+                                vertexHomogenous = false;
+    for (size_t ii=0; ii<lines.size(); ++ii) {
+        try {
+            const string &  line = lines[ii];
+            if (line[0] == 'v') {
+                if (line[1] == ' ')
+                    mesh.verts.push_back(refParseVert(line.substr(2),vertexHomogenous,vertexColors));
+                if (line[1] == 't')
+                    if (line[2] == ' ')
+                        mesh.uvs.push_back(refParseUv(line.substr(3)));
+            }
+            if (line[0] == 'f') {
+                if (line[1] == ' ')
+                    refParseFacet(line.substr(2),mesh.verts.size(),mesh.uvs.size(),surf.tris,surf.quads);
+            }
+            if (!surfSeparator.empty() && fgStartsWith(line,surfSeparator)) {
+                vector<string>  words = fgSplitAtSeparators(line,' ');
+                if (words.size() != 2)
+                    break;
+                string          name = words[1];
+                if (currName != name) {
+                    if (!surf.empty()) {
+                        if (surfs.find(currName) == surfs.end())
+                            surfs[currName] = surf;
+                        else
+                            surfs[currName].merge(surf);
+                    }
+                    currName = name;
+                    surf = Fg3dSurface();
+                }
+            }
+        }
+        catch(const FgException &) {}
+    }
+    if (!surf.empty()) {
+        if (surfs.find(currName) == surfs.end())
+            surfs[currName] = surf;
+        else
+            surfs[currName].merge(surf);
+    }
+    mesh.name = fgPathToBase(fname);
+    for (map<string,Fg3dSurface>::iterator it = surfs.begin(); it != surfs.end(); ++it) {
+        Fg3dSurface &   srf = it->second;
+        if (!srf.tris.valid() || !srf.quads.valid()) {
+            srf.tris.uvInds.clear();
+            srf.quads.uvInds.clear();
+        }
+        srf.name = it->first;
+        mesh.surfaces.push_back(srf);
+    }
+    for (size_t ii=0; ii<mesh.uvs.size(); ++ii) {
+        FgVect2F &  uv = mesh.uvs[ii];
+        for (uint xx=0; xx<2; ++xx)
+            if ((uv[xx] < 0.0f) || (uv[xx] > 1.0f))
+                uv[xx] = uv[xx] - floor(uv[xx]);
+    }
+    return mesh;
+}
+
+// Writes the coordinates as text and returns the values that text represents:
+template<uint dim>
+static
+FgMatrixC<float,dim,1>
+writeCoords(ostream & os,const string & tag,FgMatrixC<float,dim,1> vals)
+{
+    os << tag;
+    for (uint ii=0; ii<dim; ++ii) {
+        ostringstream   oss;
+        oss << vals[ii];
+        istringstream   iss(oss.str());
+        iss >> vals[ii];
+        os << " " << oss.str();
+    }
+    return vals;
+}
+
+static
+void
+checkSameMesh(const Fg3dMesh & ref,const Fg3dMesh & tst)
+{
+    FGASSERT(ref.verts == tst.verts);
+    FGASSERT(ref.uvs == tst.uvs);
+    FGASSERT(ref.surfaces.size() == tst.surfaces.size());
+    for (size_t ss=0; ss<ref.surfaces.size(); ++ss) {
+        const Fg3dSurface & rs = ref.surfaces[ss];
+        const Fg3dSurface & ts = tst.surfaces[ss];
+        FGASSERT(rs.name == ts.name);
+        FGASSERT(rs.tris.vertInds == ts.tris.vertInds);
+        FGASSERT(rs.tris.uvInds == ts.tris.uvInds);
+        FGASSERT(rs.quads.vertInds == ts.quads.vertInds);
+        FGASSERT(rs.quads.uvInds == ts.quads.uvInds);
+    }
+}
+
+void
+fgLoadWobjTest(const FgArgs & args)
+{
+    FGTESTDIR
+    // Synthesize a grid mesh large enough to be parsed in several chunks, using the less common
+    // syntax (negative indices, N-gons, repeated separators, CRLF, line continuation) and some
+    // malformed vertex and UV lines, which are skipped. The expected mesh is built alongside:
+    const uint      dim = 300;
+    Fg3dMesh        ref;
+    ref.surfaces.resize(4);
+    for (uint ss=0; ss<4; ++ss)
+        ref.surfaces[ss].name = "mat" + fgToString(ss);
+    {
+        FgOfstream      ofs("grid.obj");
+        ofs << "# Synthetic grid\n";
+        for (uint yy=0; yy<dim; ++yy) {
+            for (uint xx=0; xx<dim; ++xx) {
+                FgVect3F    vert(xx*0.01f-1.5f,yy*0.013f,(xx*yy%97)*1.0e-3f);
+                FgVect2F    uv(float(xx)/dim,float(yy)/dim);
+                // Early in the file so that many chunks follow:
+                if ((xx == 0) && ((yy == 1) || (yy == dim/3)))
+                    ofs << "v 1.0 2.0\nv 1 2 3 4 5\nvt 0.5\nvt 0.1 0.2 0.3 0.4\n";
+                ref.verts.push_back(writeCoords(ofs,"v",vert));
+                ofs << ((xx%7 == 0) ? "\r\n" : "\n");
+                ref.uvs.push_back(writeCoords(ofs,"vt",uv));
+                ofs << "\n";
+            }
+        }
+        for (uint yy=0; yy+1<dim; ++yy) {
+            if (yy%5 == 0)
+                ofs << "g rows\nusemtl mat" << (yy/5)%4 << "\n";
+            Fg3dSurface &   surf = ref.surfaces[(yy/5)%4];
+            for (uint xx=0; xx+1<dim; ++xx) {
+                uint        v0 = yy*dim+xx+1,
+                            v1 = v0+1,
+                            v2 = v1+dim,
+                            v3 = v0+dim;
+                FgVect3UI   t0(v0-1,v1-1,v2-1),
+                            t1(v0-1,v2-1,v3-1);
+                if (xx%11 == 0) {       // Triangles with negative indices:
+                    ofs << "f " << int(v0)-int(dim*dim)-1 << "/" << v0 << " " << v1 << "/" << v1
+                        << " " << v2 << "/" << int(v2)-int(dim*dim)-1 << "\n"
+                        << "f " << v0 << "/" << v0 << " " << v2 << "/" << v2 << " " << v3 << "/" << v3 << "\n";
+                    surf.tris.vertInds.push_back(t0);
+                    surf.tris.vertInds.push_back(t1);
+                }
+                else if (xx%13 == 0) {  // Pentagon (repeats a vertex) continued over 2 lines:
+                    ofs << "f " << v0 << "/" << v0 << "/1 " << v1 << "/" << v1 << "/1 \\\n"
+                        << v2 << "/" << v2 << "/1 " << v3 << "/" << v3 << "/1 " << v0 << "/" << v0 << "/1\n";
+                    surf.tris.vertInds.push_back(t0);
+                    surf.tris.vertInds.push_back(t1);
+                    surf.tris.vertInds.push_back(FgVect3UI(v0-1,v3-1,v0-1));
+                }
+                else {
+                    ofs << "f " << v0 << "/" << v0 << " " << v1 << "/" << v1 << " "
+                        << v2 << "/" << v2 << " " << v3 << "/" << v3 << "\n";
+                    surf.quads.vertInds.push_back(FgVect4UI(v0-1,v1-1,v2-1,v3-1));
+                }
+            }
+        }
+    }
+    // Vertex and UV indices are the same throughout:
+    for (size_t ss=0; ss<ref.surfaces.size(); ++ss) {
+        ref.surfaces[ss].tris.uvInds = ref.surfaces[ss].tris.vertInds;
+        ref.surfaces[ss].quads.uvInds = ref.surfaces[ss].quads.vertInds;
+    }
+    FgTimer         timer;
+    Fg3dMesh        old = loadWobjReference("grid.obj","usemtl");
+    double          timeOld = timer.read();
+    timer.start();
+    Fg3dMesh        tst1 = fgLoadWobj("grid.obj","usemtl",1);
+    double          time1 = timer.read();
+    timer.start();
+    Fg3dMesh        tstN = fgLoadWobj("grid.obj","usemtl",4);
+    double          timeN = timer.read();
+    checkSameMesh(ref,old);
+    checkSameMesh(ref,tst1);
+    checkSameMesh(ref,tstN);
+    fgout << fgnl << "OBJ load times (s): line-splitting " << timeOld << ", streaming " << time1
+        << ", 4 chunks " << timeN;
+    // The margin is large, the line-splitting loader is several times slower:
+    if (time1 > timeOld)
+        fgThrow("Streaming OBJ load slower than line-splitting load");
 }
 
 // */
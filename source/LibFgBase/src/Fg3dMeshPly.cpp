@@ -11,14 +11,56 @@
 
 #include "Fg3dMeshOps.hpp"
 #include "Fg3dMeshIo.hpp"
+#include "FgProfile.hpp"
 #include "Fg3dNormals.hpp"
 #include "FgStdStream.hpp"
+#include "FgTextBuf.hpp"
 #include "FgFileSystem.hpp"
+#include "FgParse.hpp"
+#include "FgThread.hpp"
+#include "FgTime.hpp"
+#include "FgRandom.hpp"
 #include "FgCommand.hpp"
 #include "FgTestUtils.hpp"
 
 using namespace std;
 
+static
+void
+writeVerts(
+    const vector<FgVect3F> *    verts,
+    const vector<FgVect3F> *    norms,
+    size_t                      begin,
+    size_t                      end,
+    FgTextBuf &                 ofs)
+{
+    for (size_t vv=begin; vv<end; ++vv)
+        ofs << (*verts)[vv] << ' ' << (*norms)[vv] << '\n';
+}
+
+static
+void
+writeTris(
+    const FgFacetInds<3> *      tris,
+    const vector<FgVect2F> *    uvs,            // NULL if no UVs
+    size_t                      imgIdx,
+    size_t                      begin,
+    size_t                      end,
+    FgTextBuf &                 ofs)
+{
+    for (size_t ii=begin; ii<end; ++ii) {
+        ofs << "3 " << tris->vertInds[ii] << " 6 ";
+        if (uvs == NULL)
+            ofs << "0 0 0 0 0 0 ";
+        else {
+            FgVect3UI   uvInds = tris->uvInds[ii];
+            for (uint vv=0; vv<3; ++vv)
+                ofs << (*uvs)[uvInds[vv]] << ' ';
+        }
+        ofs << imgIdx << '\n';
+    }
+}
+
 void
 fgSavePly(
     const FgString &        fname,
@@ -28,7 +70,7 @@ fgSavePly(
     Fg3dMesh    mesh = fgMergeMeshes(meshes);
     FgPath      path(fname);
     path.ext = "ply";
-    FgOfstream  ofs(path.str());
+    FgTextBuf   ofs(1 << 20);
     ofs <<
         "ply\n"
         "format ascii 1.0\n"
@@ -38,48 +80,679 @@ fgSavePly(
         if (mesh.surfaces[ii].albedoMap) {
             FgString    texFile = path.base + fgToString(ii) + "." + imgFormat;
             fgSaveImgAnyFormat(path.dir()+texFile,*mesh.surfaces[ii].albedoMap);
-            ofs << "comment TextureFile " << texFile << endl;
+            ofs << "comment TextureFile " << texFile << "\n";
         }
     }
-    ofs << "element vertex " << mesh.verts.size() << endl
-        << "property float x" << endl
-        << "property float y" << endl
-        << "property float z" << endl
-        << "property float nx" << endl
-        << "property float ny" << endl
-        << "property float nz" << endl
-        << "element face " << mesh.numTriEquivs() << endl
-        << "property list uchar int vertex_indices" << endl
-        << "property list uchar float texcoord" << endl
-        << "property int texnumber" << endl
-        << "end_header" << endl;
+    ofs << "element vertex " << mesh.verts.size() << "\n"
+        << "property float x\n"
+        << "property float y\n"
+        << "property float z\n"
+        << "property float nx\n"
+        << "property float ny\n"
+        << "property float nz\n"
+        << "element face " << mesh.numTriEquivs() << "\n"
+        << "property list uchar int vertex_indices\n"
+        << "property list uchar float texcoord\n"
+        << "property int texnumber\n"
+        << "end_header\n";
     Fg3dNormals         norms = fgNormals(mesh);
-    for (size_t vv=0; vv<mesh.verts.size(); ++vv) {
-        FgVect3F    pos = mesh.verts[vv],
-                    nrm = norms.vert[vv];
-        ofs << pos[0] << " " << pos[1] << " " << pos[2] << " " << nrm[0] << " " << nrm[1] << " " << nrm[2] << endl;
-    }
+    fgTextRanges(ofs,mesh.verts.size(),boost::bind(writeVerts,&mesh.verts,&norms.vert,_1,_2,_3));
     imgCnt = 0;
     for (size_t ss=0; ss<mesh.surfaces.size(); ++ss) {
         const Fg3dSurface &     surf = mesh.surfaces[ss];
         FgFacetInds<3>          tris = surf.getTriEquivs();
-        for (size_t ii=0; ii<tris.vertInds.size(); ++ii) {
-            FgVect3UI           vinds = tris.vertInds[ii];
-            ofs << "3 " << vinds[0] << " " << vinds[1] << " " << vinds[2] << " 6 ";
-            if (surf.tris.uvInds.empty())
-                ofs << "0 0 0 0 0 0 ";
+        const vector<FgVect2F> *uvs = tris.uvInds.empty() ? NULL : &mesh.uvs;
+        fgTextRanges(ofs,tris.vertInds.size(),boost::bind(writeTris,&tris,uvs,imgCnt,_1,_2,_3));
+        if (mesh.surfaces[ss].albedoMap)
+            ++imgCnt;
+    }
+    fgDump(ofs,path.str());
+}
+
+namespace {
+
+enum PlyType {plyInt8,plyUint8,plyInt16,plyUint16,plyInt32,plyUint32,plyFloat32,plyFloat64};
+
+uint
+plyTypeSize(PlyType type)
+{
+    static const uint   sizes[] = {1,1,2,2,4,4,4,8};
+    return sizes[type];
+}
+
+PlyType
+plyType(const string & name)
+{
+    static const char * names[] = {"char","uchar","short","ushort","int","uint","float","double"};
+    static const char * sizedNames[] = {"int8","uint8","int16","uint16","int32","uint32","float32","float64"};
+    for (uint ii=0; ii<8; ++ii)
+        if ((name == names[ii]) || (name == sizedNames[ii]))
+            return PlyType(ii);
+    fgThrow("PLY unknown property type",name);
+    return plyInt8;
+}
+
+struct  PlyProp
+{
+    string      name;
+    PlyType     type;
+    bool        isList;
+    PlyType     countType;      // Only used by lists
+};
+
+struct  PlyElem
+{
+    string          name;
+    size_t          count;
+    vector<PlyProp> props;
+
+    // Byte size of each element if it has no list properties, 0 otherwise:
+    size_t
+    fixedSize() const
+    {
+        size_t      ret = 0;
+        for (size_t ii=0; ii<props.size(); ++ii) {
+            if (props[ii].isList)
+                return 0;
+            ret += plyTypeSize(props[ii].type);
+        }
+        return ret;
+    }
+
+    // Returns -1 if not found:
+    int
+    propIdx(const char * name) const
+    {
+        for (size_t ii=0; ii<props.size(); ++ii)
+            if (props[ii].name == name)
+                return int(ii);
+        return -1;
+    }
+};
+
+template<class T>
+inline
+double
+plyDecode(const char * buf)
+{
+    T           val;
+    memcpy(&val,buf,sizeof(T));
+    return double(val);
+}
+
+// Decode a binary scalar. Native byte order is assumed to be little-endian:
+inline
+double
+plyBinary(const char * ptr,PlyType type,bool swap)
+{
+    char        buf[8];
+    uint        sz = plyTypeSize(type);
+    if (swap)
+        for (uint ii=0; ii<sz; ++ii)
+            buf[ii] = ptr[sz-1-ii];
+    else
+        memcpy(buf,ptr,sz);
+    switch (type) {
+        case plyInt8: return plyDecode<int8_t>(buf);
+        case plyUint8: return plyDecode<uint8_t>(buf);
+        case plyInt16: return plyDecode<int16_t>(buf);
+        case plyUint16: return plyDecode<uint16_t>(buf);
+        case plyInt32: return plyDecode<int32_t>(buf);
+        case plyUint32: return plyDecode<uint32_t>(buf);
+        case plyFloat32: return plyDecode<float>(buf);
+        case plyFloat64: return plyDecode<double>(buf);
+    }
+    return 0.0;
+}
+
+// Sequential reader for either ASCII or binary element data:
+struct  PlyReader
+{
+    const char *    ptr;
+    const char *    end;
+    bool            ascii;
+    bool            swap;
+
+    double
+    read(PlyType type)
+    {
+        if (ascii) {
+            while ((ptr < end) && (std::isspace(uchar(*ptr))))
+                ++ptr;
+            if (ptr == end)
+                fgThrow("PLY file data truncated");
+            double      ret;
+            if (!fgParseDouble(ptr,end,ret))
+                fgThrow("PLY invalid ASCII value",string(ptr,std::min(ptr+16,end)));
+            return ret;
+        }
+        uint        sz = plyTypeSize(type);
+        if (ptr + sz > end)
+            fgThrow("PLY file data truncated");
+        double      ret = plyBinary(ptr,type,swap);
+        ptr += sz;
+        return ret;
+    }
+
+    // Reads a list count or index, which can't be negative:
+    size_t
+    readIndex(PlyType type)
+    {
+        double      val = read(type);
+        if (val < 0.0)
+            fgThrow("PLY negative list count or index",fgToString(val));
+        return size_t(val);
+    }
+
+    void
+    skip(const PlyProp & prop)
+    {
+        size_t      num = prop.isList ? readIndex(prop.countType) : 1;
+        for (size_t ii=0; ii<num; ++ii)
+            read(prop.type);
+    }
+};
+
+// Vertex attributes which are loaded when present:
+enum PlyVertAttr {plyX,plyY,plyZ,plyU,plyV,plyRed,plyGreen,plyBlue,plyAlpha,plyNumVertAttrs};
+
+struct  PlyVertLayout
+{
+    int             idx[plyNumVertAttrs];   // Property index, -1 if absent
+    size_t          offset[plyNumVertAttrs];
+    PlyType         type[plyNumVertAttrs];
+    size_t          stride;
+    bool            swap;
+    bool            colorsFloat;
+
+    explicit
+    PlyVertLayout(const PlyElem & elem,bool swp) : stride(elem.fixedSize()), swap(swp)
+    {
+        static const char * names[plyNumVertAttrs][2] = {
+            {"x",""},{"y",""},{"z",""},
+            {"u","s"},{"v","t"},
+            {"red","r"},{"green","g"},{"blue","b"},{"alpha","a"}
+        };
+        for (uint aa=0; aa<plyNumVertAttrs; ++aa) {
+            idx[aa] = elem.propIdx(names[aa][0]);
+            if ((idx[aa] < 0) && (names[aa][1][0] != 0))
+                idx[aa] = elem.propIdx(names[aa][1]);
+            if ((aa == plyU) && (idx[aa] < 0))
+                idx[aa] = elem.propIdx("texture_u");
+            if ((aa == plyV) && (idx[aa] < 0))
+                idx[aa] = elem.propIdx("texture_v");
+            offset[aa] = 0;
+            type[aa] = plyFloat32;
+            if (idx[aa] >= 0) {
+                const PlyProp & prop = elem.props[idx[aa]];
+                if (prop.isList)
+                    fgThrow("PLY vertex property cannot be a list",prop.name);
+                type[aa] = prop.type;
+                for (int ii=0; ii<idx[aa]; ++ii)
+                    offset[aa] += plyTypeSize(elem.props[ii].type);
+            }
+        }
+        if ((idx[plyX] < 0) || (idx[plyY] < 0) || (idx[plyZ] < 0))
+            fgThrow("PLY vertex element missing x, y or z property");
+        colorsFloat = (idx[plyRed] >= 0) && ((type[plyRed] == plyFloat32) || (type[plyRed] == plyFloat64));
+    }
+
+    bool
+    hasUvs() const
+    {return ((idx[plyU] >= 0) && (idx[plyV] >= 0)); }
+
+    bool
+    hasColors() const
+    {return ((idx[plyRed] >= 0) && (idx[plyGreen] >= 0) && (idx[plyBlue] >= 0)); }
+
+    uchar
+    toColor(double val) const
+    {
+        if (colorsFloat)
+            val *= 255.0;
+        return uchar(fgClip(val + (colorsFloat ? 0.5 : 0.0),0.0,255.0));
+    }
+
+    // Store the attributes from 'vals', indexed by attribute:
+    void
+    store(const double * vals,size_t vv,FgVerts & verts,FgVect2Fs & uvs,vector<FgRgbaUB> & colors) const
+    {
+        verts[vv] = FgVect3F(float(vals[plyX]),float(vals[plyY]),float(vals[plyZ]));
+        if (hasUvs())
+            uvs[vv] = FgVect2F(float(vals[plyU]),float(vals[plyV]));
+        if (hasColors())
+            colors[vv] = FgRgbaUB(toColor(vals[plyRed]),toColor(vals[plyGreen]),toColor(vals[plyBlue]),
+                (idx[plyAlpha] >= 0) ? toColor(vals[plyAlpha]) : 255);
+    }
+};
+
+// Binary vertex data has a fixed stride so ranges can be decoded concurrently:
+void
+plyVertRange(
+    const PlyVertLayout *   layout,
+    const char *            data,
+    size_t                  chunkSize,
+    FgVerts *               verts,
+    FgVect2Fs *             uvs,
+    vector<FgRgbaUB> *      colors,
+    size_t                  chunk)
+{
+    const PlyVertLayout &   lay = *layout;
+    size_t                  begin = chunk * chunkSize,
+                            end = std::min(begin+chunkSize,verts->size());
+    // Bulk copy when the positions are consecutive native floats (the common case):
+    bool                    bulk =
+        !lay.swap &&
+        (lay.type[plyX] == plyFloat32) && (lay.type[plyY] == plyFloat32) && (lay.type[plyZ] == plyFloat32) &&
+        (lay.offset[plyY] == lay.offset[plyX]+4) && (lay.offset[plyZ] == lay.offset[plyX]+8);
+    double                  vals[plyNumVertAttrs];
+    for (size_t vv=begin; vv<end; ++vv) {
+        const char *        ptr = data + vv * lay.stride;
+        if (bulk && !lay.hasUvs() && !lay.hasColors()) {
+            memcpy(&(*verts)[vv][0],ptr+lay.offset[plyX],12);
+            continue;
+        }
+        for (uint aa=0; aa<plyNumVertAttrs; ++aa)
+            if (lay.idx[aa] >= 0)
+                vals[aa] = plyBinary(ptr+lay.offset[aa],lay.type[aa],lay.swap);
+        lay.store(vals,vv,*verts,*uvs,*colors);
+    }
+}
+
+// Polygon corner lists are converted to tris and quads, one surface per 'texnumber':
+struct  PlySurf
+{
+    vector<FgVect3UI>   tris,
+                        triUvs;
+    vector<FgVect4UI>   quads,
+                        quadUvs;
+};
+
+void
+plyAddPoly(
+    const vector<uint> &    vertInds,
+    const vector<uint> &    uvInds,     // Empty if none
+    PlySurf &               surf)
+{
+    size_t          num = vertInds.size();
+    bool            uvs = !uvInds.empty();
+    if (num == 4) {
+        surf.quads.push_back(FgVect4UI(vertInds[0],vertInds[1],vertInds[2],vertInds[3]));
+        if (uvs)
+            surf.quadUvs.push_back(FgVect4UI(uvInds[0],uvInds[1],uvInds[2],uvInds[3]));
+        return;
+    }
+    for (size_t ii=2; ii<num; ++ii) {           // Fan for tris and larger polygons
+        surf.tris.push_back(FgVect3UI(vertInds[0],vertInds[ii-1],vertInds[ii]));
+        if (uvs)
+            surf.triUvs.push_back(FgVect3UI(uvInds[0],uvInds[ii-1],uvInds[ii]));
+    }
+}
+
+}
+
+Fg3dMesh
+fgLoadPly(const FgString & fname,vector<FgRgbaUB> & vertColors,uint numThreads)
+{
+    FG_PROFILE_SCOPE("fgLoadPly");
+    FgFileMap           file(fname);
+    const char *        data = reinterpret_cast<const char *>(file.data),
+               *        dataEnd = data + file.size;
+    // Header:
+    static const string endHeader = "end_header";
+    const char *        hdrEnd = std::search(data,dataEnd,endHeader.begin(),endHeader.end());
+    if ((file.size < 3) || (memcmp(data,"ply",3) != 0) || (hdrEnd == dataEnd))
+        fgThrow("Not a valid PLY file",fname);
+    const char *        dataStart = std::find(hdrEnd,dataEnd,'\n');
+    if (dataStart < dataEnd)
+        ++dataStart;
+    vector<string>      lines = fgSplitLines(string(data,hdrEnd));
+    string              format;
+    vector<string>      texFiles;
+    vector<PlyElem>     elems;
+    for (size_t ll=1; ll<lines.size(); ++ll) {
+        vector<string>      toks = fgWhiteBreak(lines[ll]);
+        if (toks.empty())
+            continue;
+        if (toks[0] == "format") {
+            FGASSERT(toks.size() > 1);
+            format = toks[1];
+        }
+        else if ((toks[0] == "comment") && (toks.size() > 2) && (toks[1] == "TextureFile"))
+            texFiles.push_back(toks[2]);
+        else if (toks[0] == "element") {
+            if (toks.size() != 3)
+                fgThrow("PLY invalid element",lines[ll]);
+            PlyElem         elem;
+            elem.name = toks[1];
+            elem.count = fgFromString<size_t>(toks[2]);
+            elems.push_back(elem);
+        }
+        else if (toks[0] == "property") {
+            if (elems.empty())
+                fgThrow("PLY property before element",lines[ll]);
+            PlyProp         prop;
+            if ((toks.size() == 5) && (toks[1] == "list")) {
+                prop.isList = true;
+                prop.countType = plyType(toks[2]);
+                prop.type = plyType(toks[3]);
+                prop.name = toks[4];
+            }
+            else if (toks.size() == 3) {
+                prop.isList = false;
+                prop.countType = plyUint8;
+                prop.type = plyType(toks[1]);
+                prop.name = toks[2];
+            }
+            else
+                fgThrow("PLY invalid property",lines[ll]);
+            elems.back().props.push_back(prop);
+        }
+    }
+    PlyReader           rdr;
+    rdr.ptr = dataStart;
+    rdr.end = dataEnd;
+    rdr.ascii = (format == "ascii");
+    rdr.swap = (format == "binary_big_endian");
+    if (!rdr.ascii && !rdr.swap && (format != "binary_little_endian"))
+        fgThrow("PLY unsupported format",format);
+    Fg3dMesh            ret;
+    bool                vertUvs = false;
+    map<int,PlySurf>    surfs;
+    vector<uint>        polyVerts,
+                        polyUvs;
+    vertColors.clear();
+    for (size_t ee=0; ee<elems.size(); ++ee) {
+        const PlyElem &     elem = elems[ee];
+        size_t              fixedSize = elem.fixedSize();
+        if (elem.name == "vertex") {
+            PlyVertLayout       lay(elem,rdr.swap);
+            ret.verts.resize(elem.count);
+            vertUvs = lay.hasUvs();
+            if (vertUvs)
+                ret.uvs.resize(elem.count);
+            if (lay.hasColors())
+                vertColors.resize(elem.count);
+            if (!rdr.ascii && (fixedSize > 0)) {
+                if (size_t(rdr.end-rdr.ptr) < fixedSize*elem.count)
+                    fgThrow("PLY file data truncated",fname);
+                const size_t    chunkSize = 1 << 16;
+                fgParallelFor((elem.count+chunkSize-1)/chunkSize,
+                    boost::bind(plyVertRange,&lay,rdr.ptr,chunkSize,&ret.verts,&ret.uvs,&vertColors,_1),
+                    numThreads);
+                rdr.ptr += fixedSize * elem.count;
+            }
             else {
-                FgVect3UI   uvInds = tris.uvInds[ii];
-                for (uint vv=0; vv<3; ++vv) {
-                    FgVect2F    uv = mesh.uvs[uvInds[vv]];
-                    ofs << uv[0] << " " << uv[1] << " ";
+                double              vals[plyNumVertAttrs];
+                vector<int>         propToAttr(elem.props.size(),-1);
+                for (uint aa=0; aa<plyNumVertAttrs; ++aa)
+                    if (lay.idx[aa] >= 0)
+                        propToAttr[lay.idx[aa]] = int(aa);
+                for (size_t vv=0; vv<elem.count; ++vv) {
+                    for (size_t pp=0; pp<elem.props.size(); ++pp) {
+                        if (propToAttr[pp] >= 0)
+                            vals[propToAttr[pp]] = rdr.read(elem.props[pp].type);
+                        else
+                            rdr.skip(elem.props[pp]);
+                    }
+                    lay.store(vals,vv,ret.verts,ret.uvs,vertColors);
                 }
             }
-            ofs << imgCnt << endl;
         }
-        if (mesh.surfaces[ss].albedoMap)
-            ++imgCnt;
+        else if (elem.name == "face") {
+            int         vertsIdx = elem.propIdx("vertex_indices"),
+                        uvsIdx = elem.propIdx("texcoord"),
+                        texIdx = elem.propIdx("texnumber");
+            if (vertsIdx < 0)
+                vertsIdx = elem.propIdx("vertex_index");
+            if (vertsIdx < 0)
+                fgThrow("PLY face element has no vertex_indices",fname);
+            const PlyProp & vertsProp = elem.props[vertsIdx];
+            uint        numVerts = uint(ret.verts.size());
+            // The usual scanner output of only binary tri indices is read directly:
+            if (!rdr.ascii && (elem.props.size() == 1) && (vertsProp.countType == plyUint8) &&
+                ((vertsProp.type == plyInt32) || (vertsProp.type == plyUint32))) {
+                PlySurf &       surf = surfs[0];
+                surf.tris.reserve(elem.count);
+                for (size_t ff=0; ff<elem.count; ++ff) {
+                    if (rdr.ptr >= rdr.end)
+                        fgThrow("PLY file data truncated",fname);
+                    uint            num = uchar(*rdr.ptr++);
+                    if ((num == 3) && (rdr.ptr+12 <= rdr.end)) {
+                        FgVect3UI       tri;
+                        for (uint ii=0; ii<3; ++ii)
+                            tri[ii] = uint(plyBinary(rdr.ptr+ii*4,plyUint32,rdr.swap));
+                        rdr.ptr += 12;
+                        if (fgMaxElem(tri) >= numVerts)
+                            fgThrow("PLY vertex index out of range",fname);
+                        surf.tris.push_back(tri);
+                    }
+                    else {
+                        polyVerts.resize(num);
+                        for (uint ii=0; ii<num; ++ii) {
+                            size_t          vi = rdr.readIndex(vertsProp.type);
+                            if (vi >= numVerts)
+                                fgThrow("PLY vertex index out of range",fname);
+                            polyVerts[ii] = uint(vi);
+                        }
+                        plyAddPoly(polyVerts,vector<uint>(),surf);
+                    }
+                }
+                if (vertUvs) {
+                    surf.triUvs = surf.tris;
+                    surf.quadUvs = surf.quads;
+                }
+                continue;
+            }
+            for (size_t ff=0; ff<elem.count; ++ff) {
+                int             texNum = 0;
+                polyVerts.clear();
+                polyUvs.clear();
+                for (size_t pp=0; pp<elem.props.size(); ++pp) {
+                    const PlyProp & prop = elem.props[pp];
+                    if (int(pp) == vertsIdx) {
+                        size_t          num = rdr.readIndex(prop.countType);
+                        for (size_t ii=0; ii<num; ++ii) {
+                            size_t          vi = rdr.readIndex(prop.type);
+                            if (vi >= numVerts)
+                                fgThrow("PLY vertex index out of range",fname);
+                            polyVerts.push_back(uint(vi));
+                        }
+                    }
+                    else if ((int(pp) == uvsIdx) && prop.isList) {
+                        size_t          num = rdr.readIndex(prop.countType);
+                        for (size_t ii=0; ii+1<num; ii+=2) {
+                            float           u = float(rdr.read(prop.type)),
+                                            v = float(rdr.read(prop.type));
+                            polyUvs.push_back(uint(ret.uvs.size()));
+                            ret.uvs.push_back(FgVect2F(u,v));
+                        }
+                        if (num % 2 == 1)
+                            rdr.read(prop.type);
+                    }
+                    else if (int(pp) == texIdx)
+                        texNum = int(rdr.read(prop.type));
+                    else
+                        rdr.skip(prop);
+                }
+                if (polyUvs.size() != polyVerts.size())
+                    polyUvs.clear();
+                // Per-vertex UVs are indexed the same as the verts:
+                if (vertUvs && polyUvs.empty())
+                    polyUvs = polyVerts;
+                if (polyVerts.size() >= 3)
+                    plyAddPoly(polyVerts,polyUvs,surfs[texNum]);
+            }
+        }
+        else {
+            if (!rdr.ascii && (fixedSize > 0))
+                rdr.ptr += fixedSize * elem.count;
+            else
+                for (size_t ii=0; ii<elem.count; ++ii)
+                    for (size_t pp=0; pp<elem.props.size(); ++pp)
+                        rdr.skip(elem.props[pp]);
+            if (rdr.ptr > rdr.end)
+                fgThrow("PLY file data truncated",fname);
+        }
+    }
+    FgPath              path(fname);
+    for (map<int,PlySurf>::const_iterator it=surfs.begin(); it!=surfs.end(); ++it) {
+        const PlySurf &     ps = it->second;
+        Fg3dSurface         surf;
+        surf.tris.vertInds = ps.tris;
+        surf.quads.vertInds = ps.quads;
+        // Only keep UVs if every facet in the surface has them:
+        if ((ps.triUvs.size() == ps.tris.size()) && (ps.quadUvs.size() == ps.quads.size()) &&
+            (ps.tris.size() + ps.quads.size() > 0)) {
+            surf.tris.uvInds = ps.triUvs;
+            surf.quads.uvInds = ps.quadUvs;
+        }
+        if ((it->first >= 0) && (size_t(it->first) < texFiles.size())) {
+            FgString        texFile = path.dir() + texFiles[it->first];
+            if (fgExists(texFile))
+                surf.setAlbedoMap(fgLoadImgAnyFormat(texFile));
+        }
+        ret.surfaces.push_back(surf);
+    }
+    return ret;
+}
+
+Fg3dMesh
+fgLoadPly(const FgString & fname,uint numThreads)
+{
+    vector<FgRgbaUB>    vertColors;
+    return fgLoadPly(fname,vertColors,numThreads);
+}
+
+template<class T>
+static
+void
+plyAppend(string & out,T val,bool bigEndian)
+{
+    char        buf[sizeof(T)];
+    memcpy(buf,&val,sizeof(T));
+    if (bigEndian)
+        std::reverse(buf,buf+sizeof(T));
+    out.append(buf,sizeof(T));
+}
+
+// Vertex colours and UVs, tris, a quad, a pentagon and an ignored element. Big endian
+// files also have a 'texnumber' alternating between tris:
+static
+void
+plySaveBinary(
+    const FgString &            fname,
+    const Fg3dMesh &            mesh,
+    const vector<FgRgbaUB> &    colors,
+    bool                        bigEndian)
+{
+    const vector<FgVect3UI> &   tris = mesh.surfaces[0].tris.vertInds;
+    string                      out =
+        string("ply\nformat ") + (bigEndian ? "binary_big_endian" : "binary_little_endian") + " 1.0\n"
+        "comment test\n"
+        "element vertex " + fgToString(mesh.verts.size()) + "\n"
+        "property float x\nproperty\tfloat  y\nproperty float z \n"     // Irregular whitespace is valid
+        "property uchar red\nproperty uchar green\nproperty uchar blue\n"
+        "property float u\nproperty float v\n"
+        "element face " + fgToString(tris.size()+2) + "\n"
+        "property list uchar int vertex_indices\n";
+    if (bigEndian)
+        out += "property int texnumber\n";
+    out += "element edge 1\nproperty int vertex1\nproperty int vertex2\nend_header\n";
+    for (size_t vv=0; vv<mesh.verts.size(); ++vv) {
+        for (uint ii=0; ii<3; ++ii)
+            plyAppend(out,mesh.verts[vv][ii],bigEndian);
+        for (uint ii=0; ii<3; ++ii)
+            out.push_back(char(colors[vv].m_c[ii]));
+        for (uint ii=0; ii<2; ++ii)
+            plyAppend(out,mesh.uvs[vv][ii],bigEndian);
+    }
+    for (size_t ff=0; ff<tris.size()+2; ++ff) {
+        uint        num = (ff < tris.size()) ? 3 : uint(ff - tris.size() + 4);
+        out.push_back(char(num));
+        for (uint ii=0; ii<num; ++ii)
+            plyAppend(out,int32((ff < tris.size()) ? tris[ff][ii] : ii),bigEndian);
+        if (bigEndian)
+            plyAppend(out,int32(ff%2),bigEndian);
+    }
+    plyAppend(out,int32(0),bigEndian);
+    plyAppend(out,int32(1),bigEndian);
+    FgOfstream      ofs(fname);
+    ofs.write(out.data(),out.size());
+}
+
+void
+fgLoadPlyTest(const FgArgs & args)
+{
+    FGTESTDIR
+    // ASCII round trip of positions and per-corner UVs:
+    Fg3dMesh            mesh = fgLoadTri(fgDataDir()+"base/Jane.tri");
+    fgSavePly("loadPly",fgSvec(mesh));
+    Fg3dMesh            ascii = fgLoadPly("loadPly.ply");
+    FGASSERT(ascii.verts == mesh.verts);
+    FGASSERT(ascii.surfaces.size() == 1);
+    FgFacetInds<3>      triEquivs = mesh.surfaces[0].getTriEquivs();
+    const FgFacetInds<3> & tris = ascii.surfaces[0].tris;
+    FGASSERT(tris.vertInds == triEquivs.vertInds);
+    for (size_t tt=0; tt<tris.vertInds.size(); ++tt)
+        for (uint ii=0; ii<3; ++ii)
+            FGASSERT(ascii.uvs[tris.uvInds[tt][ii]] == mesh.uvs[triEquivs.uvInds[tt][ii]]);
+    // Binary in both byte orders:
+    mesh.surfaces[0] = mesh.surfaces[0].convertToTris();
+    mesh = fgSubdivide(mesh);
+    mesh.uvs.resize(mesh.verts.size());
+    vector<FgRgbaUB>    colors(mesh.verts.size());
+    fgRandSeedRepeatable();
+    for (size_t vv=0; vv<mesh.verts.size(); ++vv) {
+        mesh.uvs[vv] = FgVect2F(float(fgRandUniform(0,1)),float(fgRandUniform(0,1)));
+        colors[vv] = FgRgbaUB(uchar(fgRandUint(256)),uchar(fgRandUint(256)),uchar(fgRandUint(256)),255);
+    }
+    const vector<FgVect3UI> &   trisOrig = mesh.surfaces[0].tris.vertInds;
+    for (uint be=0; be<2; ++be) {
+        plySaveBinary("loadPly.ply",mesh,colors,(be == 1));
+        size_t              fileSize = fgSlurp("loadPly.ply").size();
+        vector<FgRgbaUB>    cols;
+        FgTimer             timer;
+        Fg3dMesh            bin = fgLoadPly("loadPly.ply",cols);
+        double              time = timer.read();
+        fgout << fgnl << (be ? "Big" : "Little") << " endian binary PLY load: "
+            << fileSize/(time*1.0e6) << " MB/s";
+        FGASSERT(bin.verts == mesh.verts);
+        FGASSERT(bin.uvs == mesh.uvs);
+        FGASSERT(cols == colors);
+        FGASSERT(bin.surfaces.size() == 1+be);
+        vector<FgVect3UI>   binTris,
+                            binUvs;
+        size_t              numQuads = 0;
+        for (size_t ss=0; ss<bin.surfaces.size(); ++ss) {
+            const Fg3dSurface & surf = bin.surfaces[ss];
+            fgAppend(binTris,surf.tris.vertInds);
+            fgAppend(binUvs,surf.tris.uvInds);
+            numQuads += surf.quads.vertInds.size();
+            FGASSERT(surf.quads.uvInds == surf.quads.vertInds);
+        }
+        FGASSERT(numQuads == 1);
+        FGASSERT(binTris.size() == trisOrig.size() + 3);        // Pentagon is split into 3 tris
+        FGASSERT(binUvs == binTris);                            // Per-vertex UVs
+        if (be == 0)
+            FGASSERT(fgHead(binTris,trisOrig.size()) == trisOrig);
+    }
+    // ASCII ending without a newline, and a negative index which must be rejected:
+    const string        hdr =
+        "ply\nformat ascii 1.0\nelement vertex 3\nproperty float x\nproperty float y\nproperty float z\n"
+        "element face 1\nproperty list uchar int vertex_indices\nend_header\n0 0 0\n1 0 0\n0 1 0\n";
+    fgDump(hdr+"3 0 1 2","loadPlyAscii.ply");
+    Fg3dMesh            tri = fgLoadPly("loadPlyAscii.ply");
+    FGASSERT(tri.surfaces[0].tris.vertInds == vector<FgVect3UI>(1,FgVect3UI(0,1,2)));
+    fgDump(hdr+"3 0 1 -1","loadPlyAscii.ply");
+    bool                rejected = false;
+    try {
+        fgLoadPly("loadPlyAscii.ply");
+    }
+    catch (const FgException &) {
+        rejected = true;
     }
+    FGASSERT(rejected);
 }
 
 void
@@ -9,9 +9,15 @@
 
 #include "stdafx.h"
 #include "Fg3dMeshIo.hpp"
+#include "FgProfile.hpp"
 #include "FgFileSystem.hpp"
 #include "FgException.hpp"
+#include "FgParse.hpp"
 #include "Fg3dNormals.hpp"
+#include "FgThread.hpp"
+#include "FgTime.hpp"
+#include "FgCommand.hpp"
+#include "FgTestUtils.hpp"
 
 using namespace std;
 
@@ -71,3 +77,264 @@ fgSaveStl(const FgString & fname,const vector<Fg3dMesh> & meshes)
     for (size_t ii=0; ii<meshes.size(); ++ii)
         saveStl(ff,meshes[ii]);
 }
+
+// Binary STL records are 50 bytes: normal, 3 vertices (all float32) and a 16 bit attribute:
+static
+void
+stlCopyRange(
+    const char *        data,       // Start of first record
+    size_t              chunkSize,
+    FgVerts *           corners,
+    size_t              chunk)
+{
+    size_t      numTris = corners->size() / 3,
+                begin = chunk * chunkSize,
+                end = std::min(begin+chunkSize,numTris);
+    for (size_t tt=begin; tt<end; ++tt)
+        memcpy(&(*corners)[tt*3][0],data+tt*50+12,36);
+}
+
+// Positive and negative zero are the same vertex:
+static inline
+uint32
+stlBits(float val)
+{
+    uint32      bits;
+    memcpy(&bits,&val,4);
+    return (bits == 0x80000000U) ? 0U : bits;
+}
+
+static inline
+uint64
+stlHash(const FgVect3F & vert)
+{
+    uint64      hh = 0;
+    for (uint ii=0; ii<3; ++ii) {
+        hh ^= stlBits(vert[ii]);
+        hh *= 0x9E3779B97F4A7C15ULL;
+        hh ^= hh >> 29;
+    }
+    return hh;
+}
+
+static inline
+bool
+stlSame(const FgVect3F & v0,const FgVect3F & v1)
+{
+    return ((stlBits(v0[0]) == stlBits(v1[0])) &&
+            (stlBits(v0[1]) == stlBits(v1[1])) &&
+            (stlBits(v0[2]) == stlBits(v1[2])));
+}
+
+namespace {
+
+// Corners are partitioned by the top hash bits into buckets which are welded concurrently:
+struct  StlWeld
+{
+    static const uint       bucketBits = 8;
+    static const size_t     numBuckets = size_t(1) << bucketBits;
+
+    const FgVerts &         corners;
+    vector<uint64>          hashes;
+    size_t                  chunkSize;
+    vector<vector<uint> >   chunkCounts;        // [chunk][bucket]
+    vector<uint>            bucketOffsets;      // numBuckets+1
+    vector<uint>            order;              // Corner indices sorted by bucket, stable
+    vector<uint>            rep;                // First corner with the same position
+
+    StlWeld(const FgVerts & c,uint numThreads) : corners(c)
+    {
+        size_t          num = corners.size();
+        hashes.resize(num);
+        chunkSize = std::max(size_t(1) << 16,(num + 63) / 64);
+        size_t          numChunks = (num + chunkSize - 1) / chunkSize;
+        chunkCounts.resize(numChunks,vector<uint>(numBuckets,0));
+        fgParallelFor(numChunks,boost::bind(&StlWeld::hashChunk,this,_1),numThreads);
+        bucketOffsets.resize(numBuckets+1);
+        uint            acc = 0;
+        for (size_t bb=0; bb<numBuckets; ++bb) {
+            bucketOffsets[bb] = acc;
+            for (size_t cc=0; cc<numChunks; ++cc) {
+                uint        cnt = chunkCounts[cc][bb];
+                chunkCounts[cc][bb] = acc;          // Now the scatter offset for this chunk
+                acc += cnt;
+            }
+        }
+        bucketOffsets[numBuckets] = acc;
+        order.resize(num);
+        fgParallelFor(numChunks,boost::bind(&StlWeld::scatterChunk,this,_1),numThreads);
+        rep.resize(num);
+        fgParallelFor(numBuckets,boost::bind(&StlWeld::weldBucket,this,_1),numThreads);
+    }
+
+    size_t
+    bucket(uint64 hash) const
+    {return size_t(hash >> (64 - bucketBits)); }
+
+    void
+    hashChunk(size_t chunk)
+    {
+        size_t          end = std::min((chunk+1)*chunkSize,corners.size());
+        vector<uint> &  counts = chunkCounts[chunk];
+        for (size_t ii=chunk*chunkSize; ii<end; ++ii) {
+            hashes[ii] = stlHash(corners[ii]);
+            ++counts[bucket(hashes[ii])];
+        }
+    }
+
+    void
+    scatterChunk(size_t chunk)
+    {
+        size_t          end = std::min((chunk+1)*chunkSize,corners.size());
+        vector<uint> &  offsets = chunkCounts[chunk];
+        for (size_t ii=chunk*chunkSize; ii<end; ++ii)
+            order[offsets[bucket(hashes[ii])]++] = uint(ii);
+    }
+
+    // Corners within a bucket are in increasing order so the first inserted is the first appearance:
+    void
+    weldBucket(size_t bb)
+    {
+        uint            begin = bucketOffsets[bb],
+                        end = bucketOffsets[bb+1];
+        if (begin == end)
+            return;
+        size_t          tableSize = 1;
+        while (tableSize < 2*size_t(end-begin))
+            tableSize *= 2;
+        const uint      empty = numeric_limits<uint>::max();
+        vector<uint>    table(tableSize,empty);
+        for (uint ii=begin; ii<end; ++ii) {
+            uint            cc = order[ii];
+            size_t          slot = size_t(hashes[cc]) & (tableSize-1);
+            for (;;) {
+                uint            tc = table[slot];
+                if (tc == empty) {
+                    table[slot] = cc;
+                    rep[cc] = cc;
+                    break;
+                }
+                if ((hashes[tc] == hashes[cc]) && stlSame(corners[tc],corners[cc])) {
+                    rep[cc] = tc;
+                    break;
+                }
+                slot = (slot + 1) & (tableSize-1);
+            }
+        }
+    }
+};
+
+}
+
+static
+Fg3dMesh
+stlWeld(const FgVerts & corners,uint numThreads)
+{
+    if (corners.size() >= numeric_limits<uint>::max())
+        fgThrow("STL file has too many triangles",fgToString(corners.size()/3));
+    StlWeld             weld(corners,numThreads);
+    Fg3dMesh            ret;
+    vector<uint>        vertInds(corners.size());
+    for (size_t cc=0; cc<corners.size(); ++cc) {
+        uint            rr = weld.rep[cc];
+        if (rr == cc) {
+            vertInds[cc] = uint(ret.verts.size());
+            ret.verts.push_back(corners[cc]);
+        }
+        else
+            vertInds[cc] = vertInds[rr];    // rr < cc so already assigned
+    }
+    vector<FgVect3UI>   tris(corners.size()/3);
+    for (size_t tt=0; tt<tris.size(); ++tt)
+        tris[tt] = FgVect3UI(vertInds[tt*3],vertInds[tt*3+1],vertInds[tt*3+2]);
+    ret.surfaces.push_back(Fg3dSurface(tris));
+    return ret;
+}
+
+Fg3dMesh
+fgLoadStl(const FgString & fname,uint numThreads)
+{
+    FG_PROFILE_SCOPE("fgLoadStl");
+    FgFileMap           file(fname);
+    const char *        data = reinterpret_cast<const char *>(file.data),
+               *        dataEnd = data + file.size;
+    FgVerts             corners;
+    uint32              numTris = 0;
+    if (file.size >= 84)
+        memcpy(&numTris,data+80,4);         // Little-endian assumed
+    if ((file.size >= 84) && (file.size == 84 + 50 * size_t(numTris))) {
+        corners.resize(size_t(numTris)*3);
+        const size_t        chunkSize = 1 << 16;
+        fgParallelFor((size_t(numTris)+chunkSize-1)/chunkSize,
+            boost::bind(stlCopyRange,data+84,chunkSize,&corners,_1),numThreads);
+    }
+    else if ((file.size >= 5) && (memcmp(data,"solid",5) == 0)) {
+        static const string vertex = "vertex";
+        const char *        ptr = std::find(data,dataEnd,'\n');
+        while ((ptr = std::search(ptr,dataEnd,vertex.begin(),vertex.end())) != dataEnd) {
+            ptr += vertex.size();
+            FgVect3F            vert;
+            for (uint ii=0; ii<3; ++ii) {
+                double              val;
+                if (!fgParseDouble(ptr,dataEnd,val))
+                    fgThrow("STL invalid ASCII vertex",fname);
+                vert[ii] = float(val);
+            }
+            corners.push_back(vert);
+        }
+        if (corners.size() % 3 != 0)
+            fgThrow("STL ASCII facets must have 3 vertices",fname);
+    }
+    else
+        fgThrow("Not a valid STL file",fname);
+    return stlWeld(corners,numThreads);
+}
+
+void
+fgLoadStlTest(const FgArgs & args)
+{
+    FGTESTDIR
+    Fg3dMesh            mesh = fgLoadTri(fgDataDir()+"base/Jane.tri");
+    mesh.surfaces[0] = mesh.surfaces[0].convertToTris();
+    mesh = fgSubdivide(mesh);
+    fgSaveStl("loadStl.stl",fgSvec(mesh));
+    FgTimer             timer;
+    Fg3dMesh            stl = fgLoadStl("loadStl.stl");
+    double              time = timer.read();
+    fgout << fgnl << "Binary STL load: " << (84+50*mesh.numTris())/(time*1.0e6) << " MB/s";
+    // Same triangle positions:
+    vector<FgVect3UI>   trisOrig = fgMergeSurfaces(mesh.surfaces).tris.vertInds;
+    FGASSERT(stl.surfaces.size() == 1);
+    const vector<FgVect3UI> & tris = stl.surfaces[0].tris.vertInds;
+    FGASSERT(tris.size() == trisOrig.size());
+    FgVerts             corners;
+    for (size_t tt=0; tt<tris.size(); ++tt) {
+        for (uint ii=0; ii<3; ++ii) {
+            FGASSERT(stl.verts[tris[tt][ii]] == mesh.verts[trisOrig[tt][ii]]);
+            corners.push_back(stl.verts[tris[tt][ii]]);
+        }
+    }
+    // Weld must match a simple map-based weld in first-appearance order:
+    map<FgVect3F,uint>  refMap;
+    for (size_t cc=0; cc<corners.size(); ++cc) {
+        map<FgVect3F,uint>::const_iterator  it = refMap.find(corners[cc]);
+        uint            idx = uint(refMap.size());
+        if (it == refMap.end())
+            refMap[corners[cc]] = idx;
+        else
+            idx = it->second;
+        FGASSERT(tris[cc/3][cc%3] == idx);
+    }
+    FGASSERT(refMap.size() == stl.verts.size());
+    // ASCII STL with a signed zero:
+    FgOfstream          ofs("loadStlAscii.stl");
+    ofs <<
+        "solid test\n"
+        "facet normal 0 0 1\n outer loop\n  vertex 0 0 0\n  vertex 1 0 0\n  vertex 0 1 0\n endloop\nendfacet\n"
+        "facet normal 0 0 1\n outer loop\n  vertex 1 0 0\n  vertex 1 1 0\n  vertex -0 1 0\n endloop\nendfacet\n"
+        "endsolid test\n";
+    ofs.close();
+    Fg3dMesh            ascii = fgLoadStl("loadStlAscii.stl");
+    FGASSERT(ascii.verts.size() == 4);
+    FGASSERT(ascii.surfaces[0].tris.vertInds[1] == FgVect3UI(1,3,2));
+}
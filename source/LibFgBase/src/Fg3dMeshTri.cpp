@@ -14,6 +14,7 @@
 #include "FgStdStream.hpp"
 #include "FgBounds.hpp"
 #include "FgFileSystem.hpp"
+#include "FgProfile.hpp"
 
 using namespace std;
 
@@ -46,6 +47,7 @@ readString(istream & istr,bool wchar)
 Fg3dMesh
 fgLoadTri(istream & istr)
 {
+    FG_PROFILE_SCOPE("fgLoadTri");
     Fg3dMesh            mesh;
     // Check for file type identifier
     char                cdata[9];
@@ -11,6 +11,7 @@
 
 #include "Fg3dMeshIo.hpp"
 #include "FgStdStream.hpp"
+#include "FgTextBuf.hpp"
 #include "FgFileSystem.hpp"
 #include "FgTokenizer.hpp"
 
@@ -19,7 +20,7 @@ using namespace std;
 template<uint dim>
 void
 writePoint(
-    FgOfstream &            ofs,
+    FgTextBuf &             ofs,
     FgMatrixC<float,dim,1>  pnt)
 {
     ofs << "               ";
@@ -27,21 +28,32 @@ writePoint(
         ofs << " " << pnt[kk];
 }
 
+template<uint dim>
+void
+writePointRange(
+    const vector<FgMatrixC<float,dim,1> > * pts,
+    size_t                                  begin,
+    size_t                                  end,
+    FgTextBuf &                             ofs)
+{
+    for (size_t jj=begin; jj<end; ++jj)
+    {
+        if (jj > 0)
+            ofs << ",\n";
+        writePoint(ofs,(*pts)[jj]);
+    }
+}
+
 template<uint dim>
 void
 writePoints(
-    FgOfstream &                            ofs,
+    FgTextBuf &                             ofs,
     const vector<FgMatrixC<float,dim,1> > & pts)
 {
     ofs <<
         "            point\n"
         "            [\n";
-    writePoint(ofs,pts[0]);
-    for (size_t jj=1; jj<pts.size(); ++jj)
-    {
-        ofs << ",\n";
-        writePoint(ofs,pts[jj]);
-    }
+    fgTextRanges(ofs,pts.size(),boost::bind(writePointRange<dim>,&pts,_1,_2,_3));
     ofs << 
         "\n            ]\n";
 }
@@ -49,7 +61,7 @@ writePoints(
 template<uint dim>
 void
 writeIdx(
-    FgOfstream &          ofs,
+    FgTextBuf &           ofs,
     FgMatrixC<uint,dim,1> idx)
 {
     ofs << "            ";
@@ -60,19 +72,29 @@ writeIdx(
 
 template<uint dim>
 void
-writeIndices(
-    FgOfstream &                            ofs,
-    const vector<FgMatrixC<uint,dim,1> > &  inds)
+writeIndexRange(
+    const vector<FgMatrixC<uint,dim,1> > *  inds,
+    size_t                                  begin,
+    size_t                                  end,
+    FgTextBuf &                             ofs)
 {
-    if (inds.size() == 0) return;
-    writeIdx(ofs,inds[0]);
-    for (size_t ii=1; ii<inds.size(); ++ii)
+    for (size_t ii=begin; ii<end; ++ii)
     {
-        ofs << ",\n";
-        writeIdx(ofs,inds[ii]);
+        if (ii > 0)
+            ofs << ",\n";
+        writeIdx(ofs,(*inds)[ii]);
     }
 }
 
+template<uint dim>
+void
+writeIndices(
+    FgTextBuf &                             ofs,
+    const vector<FgMatrixC<uint,dim,1> > &  inds)
+{
+    fgTextRanges(ofs,inds.size(),boost::bind(writeIndexRange<dim>,&inds,_1,_2,_3));
+}
+
 void
 fgSaveVrml(
     const FgString &            filename,
@@ -80,8 +102,7 @@ fgSaveVrml(
     string                      imgFormat)
 {
     FGASSERT(meshes.size() > 0);
-    FgOfstream  ofs(filename);
-    ofs.precision(7);
+    FgTextBuf   ofs(1 << 20);
     ofs <<
         "#VRML V2.0 utf8\n"
         "# Copyright 2015 Singular Inversions Inc. (facegen.com)\n"
@@ -180,6 +201,7 @@ fgSaveVrml(
             "    }\n"
             "}\n";
     }
+    fgDump(ofs,filename);
 }
 
 // */
@@ -10,6 +10,7 @@
 #include "stdafx.h"
 #include "Fg3dMeshLegacy.hpp"
 #include "FgStdStream.hpp"
+#include "FgTextBuf.hpp"
 #include "FgImage.hpp"
 #include "FgFileSystem.hpp"
 #include "Fg3dMeshOps.hpp"
@@ -37,7 +38,14 @@ static FgVect3F calQuadNormals(
         const vector<FgVect3F>        &vtxList,
         const vector<FgVect4UI>        &quadList,
         unsigned long                   quad);
-static string floatToString(float val);
+static FgTextFixed xsiFloat(float val);
+static void writeMorphShape(
+        const FffMultiObjectC           &model,
+        const vector<FffMultiObjectC>   &morphTargets,
+        unsigned long                   xx,
+        bool                            writeUvs,
+        size_t                          mm,
+        FgTextBuf                       &ofs);
 
 
 //****************************************************************************
@@ -81,11 +89,7 @@ static bool saveXsiFile(
 
     FgPath      path(fname);
     path.ext = "xsi";
-    FgOfstream ofs(path.str());
-    if (!ofs)
-    {
-        return false;
-    }
+    FgTextBuf   ofs(1 << 20);
 
     //
     // Get object's bounding box (for camera and lighting info)
@@ -130,7 +134,7 @@ static bool saveXsiFile(
     //
     // Write (version 3.0) file header
     //
-    ofs << "xsi 0300txt 0032\n\n" << flush;
+    ofs << "xsi 0300txt 0032\n\n";
 
     //
     // Output some standard info
@@ -171,28 +175,28 @@ static bool saveXsiFile(
     ofs << "SI_Camera camera1\n";
     ofs << "{\n";
                 // Position
-    ofs << "   " << floatToString(camPos[0]) << "; " 
-                 << floatToString(camPos[1]) << "; " 
-                 << floatToString(camPos[2]) << ";;\n";
+    ofs << "   " << xsiFloat(camPos[0]) << "; " 
+                 << xsiFloat(camPos[1]) << "; " 
+                 << xsiFloat(camPos[2]) << ";;\n";
                 // Point of interest (camera direction)
-    ofs << "   " << floatToString(centroid[0]) << "; "
-                 << floatToString(centroid[1]) << "; "
-                 << floatToString(centroid[2]) << ";;\n";
+    ofs << "   " << xsiFloat(centroid[0]) << "; "
+                 << xsiFloat(centroid[1]) << "; "
+                 << xsiFloat(centroid[2]) << ";;\n";
                 // Roll
     ofs << "   0.0;\n";
                 // Field of view
     ofs << "   55.0;\n";
                 // Near plane units
-    ofs << "   " << floatToString(camNearPlane) << ";\n";
+    ofs << "   " << xsiFloat(camNearPlane) << ";\n";
                 // Far plane units
-    ofs << "   " << floatToString(camFarPlane) << ";\n";
+    ofs << "   " << xsiFloat(camFarPlane) << ";\n";
     ofs << "}\n";
-    ofs << "\n" << flush;
+    ofs << "\n";
     ofs << "SI_Ambience\n";
     ofs << "{\n";
     ofs << "   0.2; 0.2; 0.2;;\n";
     ofs << "}\n";
-    ofs << "\n" << flush;
+    ofs << "\n";
     ofs << "SI_Light light1\n";
     ofs << "{\n";
                 // Type
@@ -200,11 +204,11 @@ static bool saveXsiFile(
                 // Colour of light
     ofs << "   1.0; 1.0; 1.0;;\n";
                 // Position of light (above the camera)
-    ofs << "   " << floatToString(camPos[0]) << "; "
-                 << floatToString(hiBound[1]) << "; "
-                 << floatToString(camPos[2]) << ";;\n";
+    ofs << "   " << xsiFloat(camPos[0]) << "; "
+                 << xsiFloat(hiBound[1]) << "; "
+                 << xsiFloat(camPos[2]) << ";;\n";
     ofs << "}\n";
-    ofs << "\n" << flush;
+    ofs << "\n";
 
 
     //
@@ -272,10 +276,10 @@ static bool saveXsiFile(
             ofs << "      }\n";
         }
 
-        ofs << "   }\n" << flush;
+        ofs << "   }\n";
     }
     ofs << "}\n";
-    ofs << "\n" << flush;
+    ofs << "\n";
 
     //
     // Now we output the models
@@ -307,9 +311,9 @@ static bool saveXsiFile(
         normList.resize(vtxList.size());
 
         // Output the current model
-        ofs << "SI_Model MDL-" << objName << endl;
+        ofs << "SI_Model MDL-" << objName << "\n";
         ofs << "{\n";
-        ofs << "   SI_Transform SRT-" << objName << endl;
+        ofs << "   SI_Transform SRT-" << objName << "\n";
         ofs << "   {\n";
         ofs << "      1.0, 1.0, 1.0, \n";
         ofs << "      0.0, 0.0, 0.0, \n";
@@ -327,7 +331,7 @@ static bool saveXsiFile(
         ofs << "      1, \n";
         ofs << "   }\n";
         ofs << "\n";
-        ofs << "   SI_Mesh MSH-" << objName << endl;
+        ofs << "   SI_Mesh MSH-" << objName << "\n";
         ofs << "   {\n";
 
             // Coordinates (position, normal, and UV)
@@ -345,9 +349,9 @@ static bool saveXsiFile(
         for (pt=0; pt<vtxList.size(); ++pt)
         {
             ofs << "         "
-                << floatToString(vtxList[pt][0]) << ", "
-                << floatToString(vtxList[pt][1]) << ", "
-                << floatToString(vtxList[pt][2]) << ",\n";
+                << xsiFloat(vtxList[pt][0]) << ", "
+                << xsiFloat(vtxList[pt][1]) << ", "
+                << xsiFloat(vtxList[pt][2]) << ",\n";
 
             // Initialize the normal list to zero.
             normList[pt] = FgVect3F(0);
@@ -376,9 +380,9 @@ static bool saveXsiFile(
             float ln = normList[pt].length();
             if (ln > 0.0f) normList[pt] /= ln;
             ofs << "         "
-                << floatToString(normList[pt][0]) << ", "
-                << floatToString(normList[pt][1]) << ", "
-                << floatToString(normList[pt][2]) << ",\n";
+                << xsiFloat(normList[pt][0]) << ", "
+                << xsiFloat(normList[pt][1]) << ", "
+                << xsiFloat(normList[pt][2]) << ",\n";
         }
         if (perVertex || perFacet)
         {
@@ -388,11 +392,11 @@ static bool saveXsiFile(
             for (pt=0; pt<txtList.size(); ++pt)
             {
                 ofs << "         "
-                    << floatToString(txtList[pt][0]) << ", "
-                    << floatToString(txtList[pt][1]) << ", \n";
+                    << xsiFloat(txtList[pt][0]) << ", "
+                    << xsiFloat(txtList[pt][1]) << ", \n";
             }
         }
-        ofs << "      }\n" << flush;
+        ofs << "      }\n";
 
             //
             // Facets
@@ -453,7 +457,7 @@ static bool saveXsiFile(
                         << txtTriList[tri][2] << ", \n";
                 }
             }
-            ofs << "      }\n" << flush;
+            ofs << "      }\n";
         }
 
         if (quadList.size())
@@ -521,7 +525,7 @@ static bool saveXsiFile(
                         << txtQuadList[qu][3] << ", \n";
                 }
             }
-            ofs << "      }\n" << flush;
+            ofs << "      }\n";
         }
 
         // Output morph targets as animations
@@ -531,90 +535,14 @@ static bool saveXsiFile(
             if (numMorphs)
             {
                 ofs << "\n";
-                ofs << "      SI_ShapeAnimation SHPANIM-" << objName << endl;
+                ofs << "      SI_ShapeAnimation SHPANIM-" << objName << "\n";
                 ofs << "      {\n";
                 ofs << "         \"LINEAR\",\n";
                 ofs << "         " << numMorphs+1 << ",\n";
-                for (unsigned long mm=0; mm<numMorphs+1; ++mm)
-                {
-                    const vector<FgVect3F> *mvtxList = &vtxList;
-                    if (mm > 0)
-                        mvtxList = &((*morphTargets)[mm-1].getPtList(xx));
-
-                    normList.resize( mvtxList->size() );
-
-                    ofs << "\n";
-                    ofs << "         SI_Shape SHP-" << objName 
-                                                    << "-" << mm << "\n";
-                    ofs << "         {\n";
-                    if (perVertex || perFacet)
-                        ofs << "            3,\n";
-                    else
-                        ofs << "            2,\n";
-                    ofs << "            \"INDEXED\",\n";
- 
-                    // New vertex list.
-                    ofs << "\n";
-                    ofs << "            " << mvtxList->size() << ",\n";
-                    ofs << "            \"POSITION\",\n";
-                    for (pt=0; pt<mvtxList->size(); ++pt)
-                    {
-                        ofs << "            " << pt << ", "
-                            << floatToString((*mvtxList)[pt][0]) << ", "
-                            << floatToString((*mvtxList)[pt][1]) << ", "
-                            << floatToString((*mvtxList)[pt][2]) << ",\n";
-
-                        // Initialize the normal list to zero.
-                        normList[pt] = FgVect3F(0.0f);
-                    }
-
-                    // New normal list.
-                    size_t  tt;
-                    for (tt=0; tt<triList.size(); ++tt)
-                    {
-                        FgVect3F norm=calTriNormals(*mvtxList,triList,ulong(tt));
-                        normList[ triList[tt][0] ] += norm;
-                        normList[ triList[tt][1] ] += norm;
-                        normList[ triList[tt][2] ] += norm;
-                    }
-                    size_t  qq;
-                    for (qq=0; qq<quadList.size(); ++qq)
-                    {
-                        FgVect3F norm=calQuadNormals(*mvtxList,quadList,ulong(qq));
-                        normList[ quadList[qq][0] ] += norm;
-                        normList[ quadList[qq][1] ] += norm;
-                        normList[ quadList[qq][2] ] += norm;
-                        normList[ quadList[qq][3] ] += norm;
-                    }
-                    ofs << "\n";
-                    ofs << "            " << normList.size() << ",\n";
-                    ofs << "            \"NORMAL\",\n";
-                    for (pt=0; pt<normList.size(); ++pt)
-                    {
-                        float ln = normList[pt].length();
-                        if (ln > 0.0f) normList[pt] /= ln;
-                        ofs << "            " << pt << ", "
-                            << floatToString(normList[pt][0]) << ", "
-                            << floatToString(normList[pt][1]) << ", "
-                            << floatToString(normList[pt][2]) << ",\n";
-                    }
-
-                    // Texture UV
-                    if (perVertex || perFacet)
-                    {
-                        ofs << "\n";
-                        ofs << "            " << txtList.size() << ",\n";
-                        ofs << "            \"TEX_COORD_UV\",\n";
-                        for (pt=0; pt<txtList.size(); ++pt)
-                        {
-                            ofs << "            " << pt << ", "
-                                << floatToString(txtList[pt][0]) << ", "
-                                << floatToString(txtList[pt][1]) << ", \n";
-                        }
-                    }
-
-                    ofs << "         }\n" << flush;
-                }
+                // Each shape is independent so format concurrently:
+                fgTextBlocks(ofs,numMorphs+1,
+                    boost::bind(writeMorphShape,boost::cref(model),boost::cref(*morphTargets),
+                                xx,perVertex||perFacet,_1,_2));
                 ofs << "\n";
                 ofs << "         SI_FCurve " << objName << "-SHPANIM-1\n";
                 ofs << "         {\n";
@@ -629,7 +557,7 @@ static bool saveXsiFile(
                     ofs << "            " << mm+1 << ", " << mm << ".0,\n";
                 }
                 ofs << "         }\n";
-                ofs << "      }\n" << flush;
+                ofs << "      }\n";
             }
         }
 
@@ -640,22 +568,108 @@ static bool saveXsiFile(
         ofs << "}\n";
 
         // End of current model
-        ofs << "\n" << flush;
+        ofs << "\n";
     }
 
-    //
-    // Done.
-    //
-    if (ofs.fail())
+    fgDump(ofs,path.str());
+    return true;
+}
+
+
+//****************************************************************************
+//                              writeMorphShape
+//****************************************************************************
+static void writeMorphShape(
+
+    const FffMultiObjectC           &model,
+    const vector<FffMultiObjectC>   &morphTargets,
+    unsigned long                   xx,
+    bool                            writeUvs,
+    size_t                          mm,
+    FgTextBuf                       &ofs)
+{
+    string objName = model.getModelName(xx);
+    const vector<FgVect3UI>    &triList = model.getTriList(xx);
+    const vector<FgVect4UI>    &quadList = model.getQuadList(xx);
+    const vector<FgVect2F>    &txtList = model.getTextCoord(xx);
+    const vector<FgVect3F> *mvtxList = &model.getPtList(xx);
+    if (mm > 0)
+        mvtxList = &(morphTargets[mm-1].getPtList(xx));
+
+    vector<FgVect3F> normList(mvtxList->size());
+    unsigned long pt;
+
+    ofs << "\n";
+    ofs << "         SI_Shape SHP-" << objName 
+                                    << "-" << mm << "\n";
+    ofs << "         {\n";
+    if (writeUvs)
+        ofs << "            3,\n";
+    else
+        ofs << "            2,\n";
+    ofs << "            \"INDEXED\",\n";
+
+    // New vertex list.
+    ofs << "\n";
+    ofs << "            " << mvtxList->size() << ",\n";
+    ofs << "            \"POSITION\",\n";
+    for (pt=0; pt<mvtxList->size(); ++pt)
     {
-        ofs.close();
-        return false;
+        ofs << "            " << pt << ", "
+            << xsiFloat((*mvtxList)[pt][0]) << ", "
+            << xsiFloat((*mvtxList)[pt][1]) << ", "
+            << xsiFloat((*mvtxList)[pt][2]) << ",\n";
+
+        // Initialize the normal list to zero.
+        normList[pt] = FgVect3F(0.0f);
     }
-    else
+
+    // New normal list.
+    size_t  tt;
+    for (tt=0; tt<triList.size(); ++tt)
     {
-        ofs.close();
-        return true;
+        FgVect3F norm=calTriNormals(*mvtxList,triList,ulong(tt));
+        normList[ triList[tt][0] ] += norm;
+        normList[ triList[tt][1] ] += norm;
+        normList[ triList[tt][2] ] += norm;
     }
+    size_t  qq;
+    for (qq=0; qq<quadList.size(); ++qq)
+    {
+        FgVect3F norm=calQuadNormals(*mvtxList,quadList,ulong(qq));
+        normList[ quadList[qq][0] ] += norm;
+        normList[ quadList[qq][1] ] += norm;
+        normList[ quadList[qq][2] ] += norm;
+        normList[ quadList[qq][3] ] += norm;
+    }
+    ofs << "\n";
+    ofs << "            " << normList.size() << ",\n";
+    ofs << "            \"NORMAL\",\n";
+    for (pt=0; pt<normList.size(); ++pt)
+    {
+        float ln = normList[pt].length();
+        if (ln > 0.0f) normList[pt] /= ln;
+        ofs << "            " << pt << ", "
+            << xsiFloat(normList[pt][0]) << ", "
+            << xsiFloat(normList[pt][1]) << ", "
+            << xsiFloat(normList[pt][2]) << ",\n";
+    }
+
+    // Texture UV
+    if (writeUvs)
+    {
+        ofs << "\n";
+        ofs << "            " << txtList.size() << ",\n";
+        ofs << "            \"TEX_COORD_UV\",\n";
+        for (pt=0; pt<txtList.size(); ++pt)
+        {
+            ofs << "            " << pt << ", "
+                << xsiFloat(txtList[pt][0]) << ", "
+                << xsiFloat(txtList[pt][1]) << ", \n";
+        }
+    }
+
+    ofs << "         }\n";
 }
 
 
@@ -734,22 +748,10 @@ static FgVect3F calQuadNormals(
 // Softimage|3D has a very old parser and requires all floating point output
 // to be printed as x.xxx even if the number doesn't have any decimal values.
 //
-static string floatToString(float val)
+// XSI requires a decimal point in all float values:
+static FgTextFixed xsiFloat(float val)
 {
-    char str[48];
-
-    sprintf(str,"%#f",val);
-    size_t len=strlen(str);
-    if (len)
-    {
-        if (str[len-1] == '.')
-        {
-            str[len] = '0';
-            str[len+1] = 0;
-        }
-    }
-
-    return string(str);
+    return FgTextFixed(val,6);
 }
 
 void
@@ -10,9 +10,65 @@
 #include "stdafx.h"
 
 #include "Fg3dNormals.hpp"
+#include "Fg3dMeshIo.hpp"
+#include "FgThread.hpp"
+#include "FgCommand.hpp"
+#include "FgTime.hpp"
+#include "FgRandom.hpp"
 
 using namespace std;
 
+static
+FgVect3F
+triNorm(const FgVerts & verts,FgVect3UI tri)
+{
+    FgVect3F    v0 = verts[tri[0]],
+                v1 = verts[tri[1]],
+                v2 = verts[tri[2]];
+    FgVect3F    cross = fgCrossProduct((v1-v0),(v2-v0));    // CC winding
+    float       crossMag = cross.length();
+    if (crossMag == 0.0f)
+        return FgVect3F(0.0f);
+    return cross * (1.0f / crossMag);
+}
+
+// This least squares surface normal is taken from [Mantyla 87]:
+static
+FgVect3F
+quadNorm(const FgVerts & verts,FgVect4UI quad)
+{
+    FgVect3F    v0 = verts[quad[0]],
+                v1 = verts[quad[1]],
+                v2 = verts[quad[2]],
+                v3 = verts[quad[3]];
+    FgVect3F    cross;
+    cross[0] =  (v0[1]-v1[1]) * (v0[2]+v1[2]) +
+                (v1[1]-v2[1]) * (v1[2]+v2[2]) +
+                (v2[1]-v3[1]) * (v2[2]+v3[2]) +
+                (v3[1]-v0[1]) * (v3[2]+v0[2]);
+    cross[1] =  (v0[2]-v1[2]) * (v0[0]+v1[0]) +
+                (v1[2]-v2[2]) * (v1[0]+v2[0]) +
+                (v2[2]-v3[2]) * (v2[0]+v3[0]) +
+                (v3[2]-v0[2]) * (v3[0]+v0[0]);
+    cross[2] =  (v0[0]-v1[0]) * (v0[1]+v1[1]) +
+                (v1[0]-v2[0]) * (v1[1]+v2[1]) +
+                (v2[0]-v3[0]) * (v2[1]+v3[1]) +
+                (v3[0]-v0[0]) * (v3[1]+v0[1]);
+    float       crossMag = cross.length();
+    if (crossMag == 0.0f)
+        return FgVect3F(0.0f);
+    return cross * (1.0f / crossMag);
+}
+
+static
+void
+normalizeVertNorm(FgVect3F & norm)
+{
+    float       val = norm.length();
+    if(val > 0.0f)
+        norm *= (1.0f / val);
+}
+
 // Vertex normals are just approximated by a simple average of the facet normals of all
 // facets containing the vertex:
 void
@@ -32,52 +88,17 @@ fgCalcNormals(
         Fg3dFacetNormals &      fnorms(norms.facet[ss]);
         fnorms.tri.resize(surf.numTris());
         fnorms.quad.resize(surf.numQuads());
-
-        // TRIs
         for (uint ii=0; ii<surf.numTris(); ii++) {
             FgVect3UI   tri = surf.getTri(ii);
-            FgVect3F    v0 = verts[tri[0]],
-                        v1 = verts[tri[1]],
-                        v2 = verts[tri[2]];
-            FgVect3F    cross = fgCrossProduct((v1-v0),(v2-v0)),    // CC winding
-                        norm;
-            float       crossMag = cross.length();
-            if (crossMag == 0.0f)
-                norm = zero;
-            else
-                norm = cross * (1.0f / crossMag);
+            FgVect3F    norm = triNorm(verts,tri);
             fnorms.tri[ii] = norm;
             norms.vert[tri[0]] += norm;
             norms.vert[tri[1]] += norm;
             norms.vert[tri[2]] += norm;
         }
-
-        // QUADs
-        // This least squares surface normal is taken from [Mantyla 87]:
         for (uint ii=0; ii<surf.numQuads(); ii++) {
             FgVect4UI   quad = surf.getQuad(ii);
-            FgVect3F    v0 = verts[quad[0]],
-                        v1 = verts[quad[1]],
-                        v2 = verts[quad[2]],
-                        v3 = verts[quad[3]];
-            FgVect3F   cross,norm;
-            cross[0] =  (v0[1]-v1[1]) * (v0[2]+v1[2]) +
-                        (v1[1]-v2[1]) * (v1[2]+v2[2]) +
-                        (v2[1]-v3[1]) * (v2[2]+v3[2]) +
-                        (v3[1]-v0[1]) * (v3[2]+v0[2]);
-            cross[1] =  (v0[2]-v1[2]) * (v0[0]+v1[0]) +
-                        (v1[2]-v2[2]) * (v1[0]+v2[0]) +
-                        (v2[2]-v3[2]) * (v2[0]+v3[0]) +
-                        (v3[2]-v0[2]) * (v3[0]+v0[0]);
-            cross[2] =  (v0[0]-v1[0]) * (v0[1]+v1[1]) +
-                        (v1[0]-v2[0]) * (v1[1]+v2[1]) +
-                        (v2[0]-v3[0]) * (v2[1]+v3[1]) +
-                        (v3[0]-v0[0]) * (v3[1]+v0[1]);
-            float       crossMag = cross.length();
-            if (crossMag == 0.0f)
-                norm = zero;
-            else
-                norm = cross * (1.0f / crossMag);
+            FgVect3F    norm = quadNorm(verts,quad);
             fnorms.quad[ii] = norm;
             norms.vert[quad[0]] += norm;
             norms.vert[quad[1]] += norm;
@@ -85,13 +106,212 @@ fgCalcNormals(
             norms.vert[quad[3]] += norm;
         }
     }
+    for (size_t ii=0; ii<norms.vert.size(); ++ii)
+        normalizeVertNorm(norms.vert[ii]);
+}
 
-    // Normalize vertex normals:
-    for (size_t ii=0; ii<norms.vert.size(); ++ii) {
-        float       val = norms.vert[ii].length();
-        if(val > 0.0f)
-            norms.vert[ii] *= (1.0f / val);
+Fg3dNormalsCalc::Fg3dNormalsCalc(const vector<Fg3dSurface> & surfs,size_t numVerts)
+    : m_numVerts(numVerts)
+{
+    FGASSERT(numVerts < noVert);
+    for (size_t ss=0; ss<surfs.size(); ++ss) {
+        const Fg3dSurface & surf = surfs[ss];
+        m_surfTris.push_back(surf.numTris());
+        m_surfQuads.push_back(surf.numQuads());
+        m_surfFacetOffsets.push_back(uint(m_facetVerts.size()));
+        for (uint ii=0; ii<surf.numTris(); ++ii) {
+            FgVect3UI       tri = surf.getTri(ii);
+            m_facetVerts.push_back(FgVect4UI(tri[0],tri[1],tri[2],noVert));
+        }
+        for (uint ii=0; ii<surf.numQuads(); ++ii)
+            m_facetVerts.push_back(surf.getQuad(ii));
+        m_facetSurf.resize(m_facetVerts.size(),uint(ss));
+        FGASSERT(m_facetVerts.size() < noVert);
+    }
+    vector<uint>        counts(numVerts,0);
+    for (size_t ff=0; ff<m_facetVerts.size(); ++ff) {
+        for (uint ii=0; ii<4; ++ii) {
+            uint            vv = m_facetVerts[ff][ii];
+            if (vv != noVert) {
+                FGASSERT(vv < numVerts);
+                ++counts[vv];
+            }
+        }
+    }
+    m_vertFacetOffsets.resize(numVerts+1);
+    uint                acc = 0;
+    for (size_t vv=0; vv<numVerts; ++vv) {
+        m_vertFacetOffsets[vv] = acc;
+        acc += counts[vv];
     }
+    m_vertFacetOffsets[numVerts] = acc;
+    // Filling in facet order keeps each vertex's list in increasing order. A facet which uses
+    // the same vertex twice is listed twice, as it is accumulated twice by 'fgCalcNormals':
+    m_vertFacetInds.resize(acc);
+    vector<uint>        pos(m_vertFacetOffsets.begin(),m_vertFacetOffsets.end()-1);
+    for (size_t ff=0; ff<m_facetVerts.size(); ++ff)
+        for (uint ii=0; ii<4; ++ii)
+            if (m_facetVerts[ff][ii] != noVert)
+                m_vertFacetInds[pos[m_facetVerts[ff][ii]]++] = uint(ff);
+    m_facetFlags.resize(m_facetVerts.size(),0);
+    m_vertFlags.resize(numVerts,0);
+}
+
+FgVect3F
+Fg3dNormalsCalc::facetNorm(const FgVerts & verts,size_t facet) const
+{
+    const FgVect4UI &   fv = m_facetVerts[facet];
+    if (fv[3] == noVert)
+        return triNorm(verts,FgVect3UI(fv[0],fv[1],fv[2]));
+    return quadNorm(verts,fv);
+}
+
+FgVect3F
+Fg3dNormalsCalc::vertNorm(size_t vert) const
+{
+    FgVect3F            acc(0.0f);
+    for (uint ii=m_vertFacetOffsets[vert]; ii<m_vertFacetOffsets[vert+1]; ++ii)
+        acc += m_facetNorms[m_vertFacetInds[ii]];
+    normalizeVertNorm(acc);
+    return acc;
+}
 
-    return;
+void
+Fg3dNormalsCalc::calcFacets(const FgVerts * verts,size_t blockSize,size_t block)
+{
+    size_t              end = std::min((block+1)*blockSize,m_facetVerts.size());
+    for (size_t ff=block*blockSize; ff<end; ++ff)
+        m_facetNorms[ff] = facetNorm(*verts,ff);
+}
+
+void
+Fg3dNormalsCalc::calcVerts(FgVect3F * vertNorms,size_t blockSize,size_t block) const
+{
+    size_t              end = std::min((block+1)*blockSize,m_numVerts);
+    for (size_t vv=block*blockSize; vv<end; ++vv)
+        vertNorms[vv] = vertNorm(vv);
+}
+
+void
+Fg3dNormalsCalc::calc(const FgVerts & verts,Fg3dNormals & norms,uint numThreads)
+{
+    FGASSERT(verts.size() == m_numVerts);
+    m_facetNorms.resize(m_facetVerts.size());
+    const size_t        blockSize = 1 << 14;
+    fgParallelFor((m_facetVerts.size()+blockSize-1)/blockSize,
+        boost::bind(&Fg3dNormalsCalc::calcFacets,this,&verts,blockSize,_1),numThreads);
+    norms.vert.resize(m_numVerts);
+    if (m_numVerts > 0)
+        fgParallelFor((m_numVerts+blockSize-1)/blockSize,
+            boost::bind(&Fg3dNormalsCalc::calcVerts,this,&norms.vert[0],blockSize,_1),numThreads);
+    norms.facet.resize(m_surfTris.size());
+    for (size_t ss=0; ss<m_surfTris.size(); ++ss) {
+        vector<FgVect3F>::const_iterator    it = m_facetNorms.begin() + m_surfFacetOffsets[ss];
+        norms.facet[ss].tri.assign(it,it+m_surfTris[ss]);
+        norms.facet[ss].quad.assign(it+m_surfTris[ss],it+m_surfTris[ss]+m_surfQuads[ss]);
+    }
+}
+
+void
+Fg3dNormalsCalc::update(const FgVerts & verts,const FgUints & movedVerts,Fg3dNormals & norms)
+{
+    FGASSERT(verts.size() == m_numVerts);
+    FGASSERT(m_facetNorms.size() == m_facetVerts.size());       // 'calc' must be called first
+    FGASSERT((norms.vert.size() == m_numVerts) && (norms.facet.size() == m_surfTris.size()));
+    // Flags are used to avoid duplicates and are reset afterwards so the cost is independent
+    // of the mesh size:
+    vector<uint>        facets,
+                        vertInds;
+    for (size_t ii=0; ii<movedVerts.size(); ++ii) {
+        uint            vv = movedVerts[ii];
+        FGASSERT(vv < m_numVerts);
+        for (uint jj=m_vertFacetOffsets[vv]; jj<m_vertFacetOffsets[vv+1]; ++jj) {
+            uint            ff = m_vertFacetInds[jj];
+            if (m_facetFlags[ff] == 0) {
+                m_facetFlags[ff] = 1;
+                facets.push_back(ff);
+            }
+        }
+    }
+    for (size_t ii=0; ii<facets.size(); ++ii) {
+        uint            ff = facets[ii];
+        m_facetFlags[ff] = 0;
+        FgVect3F        norm = facetNorm(verts,ff);
+        m_facetNorms[ff] = norm;
+        uint            ss = m_facetSurf[ff],
+                        local = ff - m_surfFacetOffsets[ss];
+        if (local < m_surfTris[ss])
+            norms.facet[ss].tri[local] = norm;
+        else
+            norms.facet[ss].quad[local-m_surfTris[ss]] = norm;
+        for (uint jj=0; jj<4; ++jj) {
+            uint            vv = m_facetVerts[ff][jj];
+            if ((vv != noVert) && (m_vertFlags[vv] == 0)) {
+                m_vertFlags[vv] = 1;
+                vertInds.push_back(vv);
+            }
+        }
+    }
+    for (size_t ii=0; ii<vertInds.size(); ++ii) {
+        m_vertFlags[vertInds[ii]] = 0;
+        norms.vert[vertInds[ii]] = vertNorm(vertInds[ii]);
+    }
+}
+
+// The same sums may be compiled differently in each context (-ffast-math) so allow for rounding:
+static
+void
+checkNormals(const Fg3dNormals & norms,const Fg3dNormals & ref)
+{
+    FGASSERT(norms.vert.size() == ref.vert.size());
+    for (size_t ii=0; ii<norms.vert.size(); ++ii)
+        FGASSERT((norms.vert[ii]-ref.vert[ii]).length() < 1.0e-5f);
+    FGASSERT(norms.facet.size() == ref.facet.size());
+    for (size_t ss=0; ss<norms.facet.size(); ++ss) {
+        const Fg3dFacetNormals &    fn = norms.facet[ss],
+                                    fr = ref.facet[ss];
+        FGASSERT((fn.tri.size() == fr.tri.size()) && (fn.quad.size() == fr.quad.size()));
+        for (size_t ii=0; ii<fn.tri.size(); ++ii)
+            FGASSERT((fn.tri[ii]-fr.tri[ii]).length() < 1.0e-5f);
+        for (size_t ii=0; ii<fn.quad.size(); ++ii)
+            FGASSERT((fn.quad[ii]-fr.quad[ii]).length() < 1.0e-5f);
+    }
+}
+
+void
+fg3dNormalsTest(const FgArgs &)
+{
+    Fg3dMesh            mesh = fgLoadTri(fgDataDir()+"base/Jane.tri");
+    Fg3dSurface         quadSurf(mesh.surfaces[0].quads.vertInds);
+    mesh.surfaces[0] = mesh.surfaces[0].convertToTris();
+    for (uint ii=0; ii<3; ++ii)
+        mesh = fgSubdivide(mesh,false);
+    // Add back the original quads (indices remain valid) and a degenerate tri which uses the
+    // same vertex twice:
+    quadSurf.tris.vertInds.push_back(FgVect3UI(0,0,1));
+    mesh.surfaces.push_back(quadSurf);
+    Fg3dNormalsCalc     normsCalc(mesh.surfaces,mesh.verts.size());
+    FgTimer             timer;
+    Fg3dNormals         normsRef = fgNormals(mesh);
+    double              timeRef = timer.read();
+    Fg3dNormals         norms = normsCalc.calc(mesh.verts,4);
+    checkNormals(norms,normsRef);
+    timer.start();
+    normsCalc.calc(mesh.verts,norms,4);         // Re-use of allocations as in an interactive loop
+    double              timeCalc = timer.read();
+    // Sparse morph of about 1% of the vertices, scattered over the mesh as a worst case:
+    fgRandSeedRepeatable();
+    FgUints             moved;
+    for (size_t ii=0; ii<mesh.verts.size()/100; ++ii) {
+        uint            vv = fgRandUint(uint(mesh.verts.size()));
+        moved.push_back(vv);
+        mesh.verts[vv] += FgVect3F(fgRandUniform(-1,1),fgRandUniform(-1,1),fgRandUniform(-1,1));
+    }
+    timer.start();
+    for (uint ii=0; ii<10; ++ii)                // Repeat for timer resolution
+        normsCalc.update(mesh.verts,moved,norms);
+    double              timeUpdate = timer.read() / 10.0;
+    checkNormals(norms,fgNormals(mesh));
+    fgout << fgnl << mesh.verts.size() << " verts: serial " << timeRef << "s, calc " << timeCalc
+        << "s, update " << moved.size() << " verts " << timeUpdate << "s";
 }
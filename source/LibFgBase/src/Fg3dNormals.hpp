@@ -50,4 +50,59 @@ Fg3dNormals
 fgNormals(const Fg3dMesh & mesh)
 {return fgNormals(mesh.surfaces,mesh.verts); }
 
+// Normals for repeated evaluation on a mesh whose topology does not change (eg. while morphing).
+// The vertex to facet adjacency is built once on construction. Results are the same as
+// 'fgCalcNormals' up to rounding. Keeps state between calls so use one object per thread:
+struct  Fg3dNormalsCalc
+{
+    Fg3dNormalsCalc(const vector<Fg3dSurface> & surfs,size_t numVerts);
+
+    // Calculate all normals. Facets then vertices are split into blocks computed concurrently,
+    // each vertex normal being gathered from its adjacent facets so there are no write races:
+    void
+    calc(const FgVerts & verts,Fg3dNormals & norms,uint numThreads=0);
+
+    Fg3dNormals
+    calc(const FgVerts & verts,uint numThreads=0)
+    {
+        Fg3dNormals     ret;
+        calc(verts,ret,numThreads);
+        return ret;
+    }
+
+    // Update 'norms', as last calculated or updated by this object, when only the vertices
+    // 'movedVerts' have changed position (eg. 'FgIndexedMorph::baseInds'). Only the facets
+    // adjacent to those vertices and the vertices of those facets are recalculated:
+    void
+    update(const FgVerts & verts,const FgUints & movedVerts,Fg3dNormals & norms);
+
+private:
+    size_t                  m_numVerts;
+    vector<uint>            m_surfTris;         // Number of tris in each surface
+    vector<uint>            m_surfQuads;        // Number of quads in each surface
+    // Facet index order is all tris then all quads for each surface in turn:
+    vector<uint>            m_surfFacetOffsets;
+    vector<uint>            m_facetSurf;
+    vector<FgVect4UI>       m_facetVerts;       // Last index is 'noVert' for tris
+    vector<uint>            m_vertFacetOffsets; // Adjacent facets of vertex v are in
+    vector<uint>            m_vertFacetInds;    // [offsets[v],offsets[v+1]) in increasing order
+    vector<FgVect3F>        m_facetNorms;       // From the last 'calc' or 'update'
+    vector<uchar>           m_facetFlags;       // Scratch for 'update', always left zero
+    vector<uchar>           m_vertFlags;        // "
+
+    static const uint       noVert = 0xFFFFFFFF;
+
+    FgVect3F
+    facetNorm(const FgVerts & verts,size_t facet) const;
+
+    FgVect3F
+    vertNorm(size_t vert) const;
+
+    void
+    calcFacets(const FgVerts * verts,size_t blockSize,size_t block);
+
+    void
+    calcVerts(FgVect3F * vertNorms,size_t blockSize,size_t block) const;
+};
+
 #endif
@@ -0,0 +1,378 @@
+//
+// Copyright (c) 2015 Singular Inversions Inc. (facegen.com)
+// Use, modification and distribution is subject to the MIT License,
+// see accompanying file LICENSE.txt or facegen.com/base_library_license.txt
+//
+
+#include "stdafx.h"
+
+#include "Fg3dSubdivision.hpp"
+#include "Fg3dTopology.hpp"
+#include "Fg3dMeshOps.hpp"
+#include "Fg3dMeshIo.hpp"
+#include "FgThread.hpp"
+#include "FgBounds.hpp"
+#include "FgCommand.hpp"
+#include "FgTime.hpp"
+#include "FgRandom.hpp"
+
+using namespace std;
+
+namespace {
+
+// Sparse matrix in compressed sparse row form, weights kept in double until the final result:
+struct  Stencils
+{
+    vector<uint>        offsets;
+    vector<uint>        cols;
+    vector<double>      wgts;
+
+    Stencils() : offsets(1,0) {}
+
+    size_t
+    numRows() const
+    {return offsets.size()-1; }
+
+    void
+    add(uint col,double wgt)
+    {
+        cols.push_back(col);
+        wgts.push_back(wgt);
+    }
+
+    void
+    endRow()
+    {offsets.push_back(uint(cols.size())); }
+};
+
+Stencils
+identity(size_t num)
+{
+    Stencils        ret;
+    for (size_t ii=0; ii<num; ++ii) {
+        ret.add(uint(ii),1.0);
+        ret.endRow();
+    }
+    return ret;
+}
+
+// The stencils of one level of subdivision, in the same vertex order as 'fgSubdivide'
+// (all the original "even" vertices then one "odd" vertex per edge) and with the same weights:
+Stencils
+levelStencils(const Fg3dMesh & mesh,bool loop)
+{
+    vector<FgVect3UI>   allTris;
+    for (size_t ss=0; ss<mesh.surfaces.size(); ++ss)
+        fgAppend(allTris,mesh.surfaces[ss].tris.vertInds);
+    Fg3dTopology        topo(mesh.verts,allTris);
+    Stencils            ret;
+    for (uint vv=0; vv<mesh.verts.size(); ++vv) {
+        if (!loop)
+            ret.add(vv,1.0);
+        else if (topo.vertOnBoundary(vv)) {
+            vector<uint>        inds = topo.vertBoundaryNeighbours(vv);
+            if (inds.size() != 2)
+                fgThrow("Cannot subdivide non-manifold mesh at vert index",fgToString(vv));
+            ret.add(vv,0.75);
+            ret.add(inds[0],0.125);
+            ret.add(inds[1],0.125);
+        }
+        else {
+            const vector<uint> &    neighbours = topo.vertNeighbours(vv);
+            size_t                  num = neighbours.size();
+            double                  self = 0.625,
+                                    other = (num > 0) ? 0.375 / double(num) : 0.0;
+            if (num == 0)           // Unused vertex
+                self = 1.0;
+            else if (num == 3) {
+                self = 0.4375;
+                other = 0.1875;
+            }
+            else if (num == 4) {
+                self = 0.515625;
+                other = 0.12109375;
+            }
+            else if (num == 5) {
+                self = 0.579534;
+                other = 0.0840932;
+            }
+            ret.add(vv,self);
+            for (size_t ii=0; ii<num; ++ii)
+                ret.add(neighbours[ii],other);
+        }
+        ret.endRow();
+    }
+    for (uint ee=0; ee<topo.m_edges.size(); ++ee) {
+        FgVect2UI           inds0 = topo.m_edges[ee].vertInds;
+        if (!loop || (topo.m_edges[ee].triInds.size() == 1)) {
+            ret.add(inds0[0],0.5);
+            ret.add(inds0[1],0.5);
+        }
+        else {
+            FgVect2UI           inds1 = topo.edgeFacingVertInds(ee);
+            ret.add(inds0[0],0.375);
+            ret.add(inds0[1],0.375);
+            ret.add(inds1[0],0.125);
+            ret.add(inds1[1],0.125);
+        }
+        ret.endRow();
+    }
+    return ret;
+}
+
+// Returns the sparse product 'lhs * rhs' where 'rhs' has 'numCols' columns. Each result row has
+// its columns in increasing order so evaluation reads the base vertices in memory order:
+Stencils
+compose(const Stencils & lhs,const Stencils & rhs,size_t numCols)
+{
+    Stencils            ret;
+    vector<double>      acc(numCols,0.0);
+    vector<uchar>       used(numCols,0);
+    vector<uint>        cols;
+    for (size_t rr=0; rr<lhs.numRows(); ++rr) {
+        for (uint ii=lhs.offsets[rr]; ii<lhs.offsets[rr+1]; ++ii) {
+            uint                kk = lhs.cols[ii];
+            double              wgt = lhs.wgts[ii];
+            for (uint jj=rhs.offsets[kk]; jj<rhs.offsets[kk+1]; ++jj) {
+                uint                cc = rhs.cols[jj];
+                if (used[cc] == 0) {
+                    used[cc] = 1;
+                    cols.push_back(cc);
+                }
+                acc[cc] += wgt * rhs.wgts[jj];
+            }
+        }
+        std::sort(cols.begin(),cols.end());
+        for (size_t ii=0; ii<cols.size(); ++ii) {
+            uint                cc = cols[ii];
+            ret.add(cc,acc[cc]);
+            acc[cc] = 0.0;
+            used[cc] = 0;
+        }
+        cols.clear();
+        ret.endRow();
+    }
+    return ret;
+}
+
+// Linear subdivision of the UVs of 'in' to match the facets of 'out' = fgSubdivide(in),
+// which splits each tri into 4 in a fixed order using the edge midpoints:
+void
+subdivideUvs(const Fg3dMesh & in,Fg3dMesh & out)
+{
+    out.uvs = in.uvs;
+    map<FgVect2UI,uint>     midInds;
+    for (size_t ss=0; ss<in.surfaces.size(); ++ss) {
+        const FgFacetInds<3> &  tris = in.surfaces[ss].tris;
+        if (tris.uvInds.size() != tris.vertInds.size())
+            continue;
+        vector<FgVect3UI> &     uvInds = out.surfaces[ss].tris.uvInds;
+        uvInds.clear();
+        for (size_t tt=0; tt<tris.uvInds.size(); ++tt) {
+            FgVect3UI           uv = tris.uvInds[tt],
+                                mid;
+            for (uint ii=0; ii<3; ++ii) {
+                uint                u0 = uv[ii],
+                                    u1 = uv[(ii+1)%3];
+                FgVect2UI           key(std::min(u0,u1),std::max(u0,u1));
+                map<FgVect2UI,uint>::const_iterator it = midInds.find(key);
+                if (it == midInds.end()) {
+                    mid[ii] = uint(out.uvs.size());
+                    midInds[key] = mid[ii];
+                    out.uvs.push_back((in.uvs[u0] + in.uvs[u1]) * 0.5f);
+                }
+                else
+                    mid[ii] = it->second;
+            }
+            uvInds.push_back(FgVect3UI(uv[0],mid[0],mid[2]));
+            uvInds.push_back(FgVect3UI(uv[1],mid[1],mid[0]));
+            uvInds.push_back(FgVect3UI(uv[2],mid[2],mid[1]));
+            uvInds.push_back(FgVect3UI(mid[0],mid[1],mid[2]));
+        }
+    }
+}
+
+}
+
+Fg3dSubdivision::Fg3dSubdivision(const Fg3dMesh & mesh,uint levels,bool loop)
+    : m_numBaseVerts(mesh.verts.size())
+{
+    Fg3dMesh            level(mesh.verts);
+    level.uvs = mesh.uvs;
+    for (size_t ss=0; ss<mesh.surfaces.size(); ++ss)
+        level.surfaces.push_back(mesh.surfaces[ss].convertToTris());
+    Stencils            stencils = identity(m_numBaseVerts);
+    for (uint ll=0; ll<levels; ++ll) {
+        stencils = compose(levelStencils(level,loop),stencils,m_numBaseVerts);
+        Fg3dMesh            next = fgSubdivide(level,loop);
+        subdivideUvs(level,next);
+        // 'fgSubdivide' does not keep surface point labels:
+        for (size_t ss=0; ss<next.surfaces.size(); ++ss)
+            for (size_t ii=0; ii<next.surfaces[ss].surfPoints.size(); ++ii)
+                next.surfaces[ss].surfPoints[ii].label = level.surfaces[ss].surfPoints[ii].label;
+        level = next;
+    }
+    FGASSERT(stencils.cols.size() < numeric_limits<uint>::max());
+    m_rowOffsets = stencils.offsets;
+    m_cols = stencils.cols;
+    m_weights.resize(stencils.wgts.size());
+    for (size_t ii=0; ii<m_weights.size(); ++ii)
+        m_weights[ii] = float(stencils.wgts[ii]);
+    m_mesh.name = mesh.name;
+    m_mesh.material = mesh.material;
+    m_mesh.uvs = level.uvs;
+    m_mesh.surfaces = level.surfaces;
+    for (size_t ss=0; ss<mesh.surfaces.size(); ++ss) {
+        m_mesh.surfaces[ss].name = mesh.surfaces[ss].name;
+        m_mesh.surfaces[ss].albedoMap = mesh.surfaces[ss].albedoMap;
+    }
+}
+
+void
+Fg3dSubdivision::subdivideRows(const FgVerts * baseVerts,FgVerts * verts,size_t blockSize,size_t block) const
+{
+    size_t              end = std::min((block+1)*blockSize,numVerts());
+    const FgVect3F *    base = &(*baseVerts)[0];
+    for (size_t vv=block*blockSize; vv<end; ++vv) {
+        FgVect3F            acc(0.0f);
+        for (uint ii=m_rowOffsets[vv]; ii<m_rowOffsets[vv+1]; ++ii)
+            acc += base[m_cols[ii]] * m_weights[ii];
+        (*verts)[vv] = acc;
+    }
+}
+
+void
+Fg3dSubdivision::subdivideVerts(const FgVerts & baseVerts,FgVerts & verts,uint numThreads) const
+{
+    FGASSERT(baseVerts.size() == m_numBaseVerts);
+    verts.resize(numVerts());
+    if (m_numBaseVerts == 0)
+        return;
+    const size_t        blockSize = 1 << 13;
+    fgParallelFor((verts.size()+blockSize-1)/blockSize,
+        boost::bind(&Fg3dSubdivision::subdivideRows,this,&baseVerts,&verts,blockSize,_1),numThreads);
+}
+
+Fg3dMesh
+Fg3dSubdivision::subdivide(const FgVerts & baseVerts,uint numThreads) const
+{
+    Fg3dMesh            ret = m_mesh;
+    subdivideVerts(baseVerts,ret.verts,numThreads);
+    return ret;
+}
+
+static
+Fg3dMesh
+subdivideN(Fg3dMesh mesh,uint levels,bool loop)
+{
+    for (uint ll=0; ll<levels; ++ll)
+        mesh = fgSubdivide(mesh,loop);
+    return mesh;
+}
+
+static
+void
+checkSubdivision(const Fg3dMesh & mesh,uint levels,bool loop)
+{
+    Fg3dSubdivision     subd(mesh,levels,loop);
+    Fg3dMesh            ref = subdivideN(mesh,levels,loop),
+                        tst = subd.subdivide(mesh.verts,4);
+    FGASSERT(tst.verts.size() == ref.verts.size());
+    FGASSERT(tst.surfaces.size() == ref.surfaces.size());
+    for (size_t ss=0; ss<ref.surfaces.size(); ++ss) {
+        const Fg3dSurface & rs = ref.surfaces[ss],
+                        &   ts = tst.surfaces[ss];
+        FGASSERT(ts.tris.vertInds == rs.tris.vertInds);
+        FGASSERT(ts.surfPoints.size() == rs.surfPoints.size());
+        for (size_t ii=0; ii<rs.surfPoints.size(); ++ii) {
+            FGASSERT(ts.surfPoints[ii].triEquivIdx == rs.surfPoints[ii].triEquivIdx);
+            FGASSERT(ts.surfPoints[ii].weights == rs.surfPoints[ii].weights);
+        }
+    }
+    // Weights are applied in a different order:
+    float               tol = fgMaxElem(fgDims(ref.verts)) * 1.0e-5f;
+    for (size_t ii=0; ii<ref.verts.size(); ++ii)
+        FGASSERT((tst.verts[ii]-ref.verts[ii]).length() < tol);
+}
+
+void
+fg3dSubdivisionTest(const FgArgs &)
+{
+    Fg3dMesh            mesh = fgLoadTri(fgDataDir()+"base/Jane.tri");
+    mesh.surfaces[0] = mesh.surfaces[0].convertToTris();
+    for (uint ll=1; ll<3; ++ll) {
+        checkSubdivision(mesh,ll,true);
+        checkSubdivision(mesh,ll,false);
+    }
+    // Morphed base verts:
+    fgRandSeedRepeatable();
+    Fg3dSubdivision     subd(mesh,2);
+    for (size_t ii=0; ii<mesh.verts.size(); ++ii)
+        mesh.verts[ii] += FgVect3F(float(fgRandNormal()),float(fgRandNormal()),float(fgRandNormal()));
+    Fg3dMesh            ref = subdivideN(mesh,2,true);
+    FgVerts             verts = subd.subdivideVerts(mesh.verts);
+    float               tol = fgMaxElem(fgDims(ref.verts)) * 1.0e-5f;
+    for (size_t ii=0; ii<ref.verts.size(); ++ii)
+        FGASSERT((verts[ii]-ref.verts[ii]).length() < tol);
+    // A planar grid with UVs equal to the XY coordinates must keep that relation under flat
+    // subdivision:
+    Fg3dMesh            grid;
+    const uint          dim = 5;
+    for (uint yy=0; yy<dim; ++yy) {
+        for (uint xx=0; xx<dim; ++xx) {
+            grid.verts.push_back(FgVect3F(float(xx),float(yy),0.0f));
+            grid.uvs.push_back(FgVect2F(float(xx),float(yy)));
+        }
+    }
+    vector<FgVect4UI>   quads;
+    for (uint yy=0; yy+1<dim; ++yy)
+        for (uint xx=0; xx+1<dim; ++xx)
+            quads.push_back(FgVect4UI(yy*dim+xx,yy*dim+xx+1,(yy+1)*dim+xx+1,(yy+1)*dim+xx));
+    grid.surfaces.push_back(Fg3dSurface(quads,quads));
+    Fg3dMesh            gridSub = Fg3dSubdivision(grid,2,false).subdivide(grid.verts);
+    const FgFacetInds<3> &  tris = gridSub.surfaces[0].tris;
+    FGASSERT(tris.uvInds.size() == tris.vertInds.size());
+    for (size_t tt=0; tt<tris.vertInds.size(); ++tt) {
+        for (uint ii=0; ii<3; ++ii) {
+            FgVect3F            pos = gridSub.verts[tris.vertInds[tt][ii]];
+            FGASSERT(gridSub.uvs[tris.uvInds[tt][ii]] == FgVect2F(pos[0],pos[1]));
+        }
+    }
+}
+
+// Per-frame cost of subdividing a morphing mesh:
+void
+fg3dSubdivisionBench(const FgArgs &)
+{
+    Fg3dMesh            mesh = fgLoadTri(fgDataDir()+"base/Jane.tri");
+    mesh.surfaces[0] = mesh.surfaces[0].convertToTris();
+    mesh = fgSubdivide(mesh);
+    fgRandSeedRepeatable();
+    FgVerts             deltas(mesh.verts.size());
+    for (size_t ii=0; ii<deltas.size(); ++ii)
+        deltas[ii] = FgVect3F(float(fgRandNormal()),float(fgRandNormal()),float(fgRandNormal()));
+    const uint          numFrames = 20;
+    for (uint levels=1; levels<3; ++levels) {
+        FgTimer             timer;
+        Fg3dSubdivision     subd(mesh,levels);
+        double              timeSetup = timer.read();
+        Fg3dMesh            frame = mesh;
+        timer.start();
+        for (uint ff=0; ff<numFrames; ++ff) {
+            for (size_t ii=0; ii<mesh.verts.size(); ++ii)
+                frame.verts[ii] = mesh.verts[ii] + deltas[ii] * float(ff) * 0.01f;
+            subdivideN(frame,levels,true);
+        }
+        double              timeOrig = timer.read() / numFrames;
+        FgVerts             verts;
+        timer.start();
+        for (uint ff=0; ff<numFrames; ++ff) {
+            for (size_t ii=0; ii<mesh.verts.size(); ++ii)
+                frame.verts[ii] = mesh.verts[ii] + deltas[ii] * float(ff) * 0.01f;
+            subd.subdivideVerts(frame.verts,verts,1);      // Single threaded to compare with fgSubdivide
+        }
+        double              timeCached = timer.read() / numFrames;
+        fgout << fgnl << levels << " levels to " << subd.numVerts() << " verts: setup " << timeSetup
+            << "s, per frame on one thread fgSubdivide " << timeOrig << "s, cached stencils " << timeCached << "s";
+    }
+}
@@ -0,0 +1,67 @@
+//
+// Copyright (c) 2015 Singular Inversions Inc. (facegen.com)
+// Use, modification and distribution is subject to the MIT License,
+// see accompanying file LICENSE.txt or facegen.com/base_library_license.txt
+//
+// Repeated subdivision of a mesh whose shape changes but whose connectivity does not (eg. a
+// morphing face rendered every frame).
+//
+// Each subdivided vertex is a fixed linear combination (stencil) of the base vertices, so the
+// stencils for all levels are composed once on construction into a single sparse matrix. Each
+// evaluation is then just a (parallel) sparse matrix times vertices product. The subdivided
+// connectivity, UVs and surface points do not depend on the vertex positions so are also
+// computed once.
+//
+
+#ifndef FG3DSUBDIVISION_HPP
+#define FG3DSUBDIVISION_HPP
+
+#include "FgStdLibs.hpp"
+#include "Fg3dMesh.hpp"
+
+struct  Fg3dSubdivision
+{
+    // Quads are converted to tris. The result has the same vertex order, facets and surface
+    // points as 'levels' applications of 'fgSubdivide' to the converted mesh, and additionally
+    // carries over UVs (by linear subdivision), surface names and albedo maps:
+    Fg3dSubdivision(const Fg3dMesh & mesh,uint levels=1,bool loop=true);
+
+    size_t
+    numBaseVerts() const
+    {return m_numBaseVerts; }
+
+    size_t
+    numVerts() const
+    {return m_rowOffsets.size()-1; }
+
+    // Subdivided vertex positions for the given base vertex positions (which must be of the
+    // same size as the construction mesh verts):
+    void
+    subdivideVerts(const FgVerts & baseVerts,FgVerts & verts,uint numThreads=0) const;
+
+    FgVerts
+    subdivideVerts(const FgVerts & baseVerts,uint numThreads=0) const
+    {
+        FgVerts     ret;
+        subdivideVerts(baseVerts,ret,numThreads);
+        return ret;
+    }
+
+    // The full subdivided mesh (no morphs or marked verts):
+    Fg3dMesh
+    subdivide(const FgVerts & baseVerts,uint numThreads=0) const;
+
+private:
+    size_t                  m_numBaseVerts;
+    Fg3dMesh                m_mesh;         // Subdivided mesh without verts
+    // Stencil matrix in compressed sparse row form. Subdivided vertex 'vv' is the sum over
+    // ii in [m_rowOffsets[vv],m_rowOffsets[vv+1]) of base vertex m_cols[ii] * m_weights[ii]:
+    vector<uint>            m_rowOffsets;
+    vector<uint>            m_cols;
+    vector<float>           m_weights;
+
+    void
+    subdivideRows(const FgVerts * baseVerts,FgVerts * verts,size_t blockSize,size_t block) const;
+};
+
+#endif
@@ -18,6 +18,7 @@
 #include "FgCommand.hpp"
 #include "Fg3dTopology.hpp"
 #include "FgAffine1.hpp"
+#include "FgTime.hpp"
 
 using namespace std;
 
@@ -153,6 +154,70 @@ edgeDist(const FgArgs &)
     fgViewMesh(mesh);
 }
 
+// Check the compact topology against independently computed results (including the original
+// iterative seam and distance algorithms which are retained by Fg3dTopology):
+static
+void
+checkTopoCsr(const FgVerts & verts,const vector<FgVect3UI> & trisIn)
+{
+    FgTimer             timer;
+    Fg3dTopoCsr         csr(verts,trisIn);
+    double              timeCsr = timer.read();
+    Fg3dTopology        topo(csr);
+    // Edges and their tris from a node-based map:
+    std::map<FgVect2UI,vector<uint> >   edgeTris;
+    for (size_t tt=0; tt<csr.tris.size(); ++tt) {
+        for (uint jj=0; jj<3; ++jj) {
+            uint        v0 = csr.tris[tt][jj],
+                        v1 = csr.tris[tt][(jj+1)%3];
+            edgeTris[FgVect2UI(std::min(v0,v1),std::max(v0,v1))].push_back(uint(tt));
+        }
+    }
+    FGASSERT(edgeTris.size() == csr.numEdges());
+    uint                ee = 0;
+    for (std::map<FgVect2UI,vector<uint> >::const_iterator it=edgeTris.begin(); it!=edgeTris.end(); ++it,++ee) {
+        FGASSERT(csr.edgeVerts[ee] == it->first);
+        FGASSERT(csr.edgeNumTris(ee) == it->second.size());
+        for (uint ii=0; ii<csr.edgeNumTris(ee); ++ii)
+            FGASSERT(csr.edgeTriInds[csr.edgeTriOffsets[ee]+ii] == it->second[ii]);
+    }
+    for (size_t tt=0; tt<csr.tris.size(); ++tt) {
+        for (uint jj=0; jj<3; ++jj) {
+            uint        v0 = csr.tris[tt][jj],
+                        v1 = csr.tris[tt][(jj+1)%3];
+            FGASSERT(csr.edgeVerts[csr.triEdges[tt][jj]] == FgVect2UI(std::min(v0,v1),std::max(v0,v1)));
+        }
+    }
+    for (uint vv=0; vv<csr.numVerts(); ++vv)
+        FGASSERT(csr.vertNeighbours(vv) == topo.vertNeighbours(vv));
+    FGASSERT(csr.isManifold() == topo.isManifold());
+    FGASSERT(csr.seams() == topo.seams());
+    vector<float>       distCsr = csr.edgeDistanceMap(verts,0),
+                        distTopo = topo.edgeDistanceMap(verts,0);
+    for (size_t ii=0; ii<distCsr.size(); ++ii)
+        FGASSERT(fgApproxEqualRel(distCsr[ii],distTopo[ii],1.0e-5));
+    fgout << fgnl << csr.tris.size() << " tris: " << timeCsr << "s";
+}
+
+void
+fg3dTopoCsrTest(const FgArgs &)
+{
+    Fg3dMesh            mesh = fgLoadTri(fgDataDir()+"base/Jane.tri");
+    mesh.surfaces[0] = mesh.surfaces[0].convertToTris();
+    vector<FgVect3UI>   tris = fgMergeSurfaces(mesh.surfaces).tris.vertInds;
+    // Add a null and some duplicates (in both windings) which should be discarded:
+    size_t              numTris = tris.size();
+    tris.push_back(FgVect3UI(0,0,1));
+    tris.push_back(tris[3]);
+    tris.push_back(FgVect3UI(tris[5][2],tris[5][1],tris[5][0]));
+    Fg3dTopoCsr         csr(mesh.verts,tris);
+    FGASSERT(csr.tris.size() == numTris);
+    FGASSERT(vector<FgVect3UI>(tris.begin(),tris.begin()+numTris) == csr.tris);
+    checkTopoCsr(mesh.verts,tris);
+    mesh = fgSubdivide(fgSubdivide(mesh));
+    checkTopoCsr(mesh.verts,fgMergeSurfaces(mesh.surfaces).tris.vertInds);
+}
+
 void
 fg3dTest(const FgArgs & args)
 {
@@ -160,6 +225,15 @@ fg3dTest(const FgArgs & args)
     FGADDCMD(fgSave3dsTest,"3ds",".3DS file format export");
     FGADDCMD(fgSaveLwoTest,"lwo","Lightwve object file format export");
     FGADDCMD(fgSaveMaTest,"ma","Maya ASCII file format export");
+    FGADDCMD(fgLoadWobjTest,"obj","Wavefront OBJ file format import");
+    FGADDCMD(fgLoadPlyTest,"loadPly","PLY file format import (ASCII and binary)");
+    FGADDCMD(fgLoadStlTest,"loadStl","STL file format import and vertex welding");
+    FGADDCMD(fg3dTopoCsrTest,"topoCsr","Compact CSR mesh topology");
+    FGADDCMD(fg3dGeodesicTest,"geodesic","Fast marching geodesic distances");
+    FGADDCMD(fg3dNormalsTest,"normals","Parallel and incremental vertex normals");
+    FGADDCMD(fg3dSubdivisionTest,"subdivCached","Cached stencil subdivision");
+    FGADDCMD(fg3dAabbTreeTest,"aabbTree","Closest point on mesh by AABB tree");
+    FGADDCMD(fg3dIcpTest,"icp","Iterative closest point alignment");
     fgMenu(args,cmds,true,false,true);
 }
 
@@ -168,7 +242,9 @@ fg3dTestMan(const FgArgs & args)
 {
     vector<FgCmd>   cmds;
     cmds.push_back(FgCmd(edgeDist,"edgeDist"));
+    FGADDCMD(fg3dGeodesicBench,"geodesicBench","Geodesic distance timing on large meshes");
     cmds.push_back(FgCmd(test3dMeshSubdivision,"subdivision"));
+    FGADDCMD(fg3dSubdivisionBench,"subdivBench","Per-frame subdivision timing with cached stencils");
     FGADDCMD(fgSaveFbxTest,"fbx",".FBX file format export");
     FGADDCMD(fgSaveFgmeshTest,"fgmesh","FaceGen mesh file format export");
     FGADDCMD(fgSavePlyTest,"ply",".PLY file format export");    // Precision differences with gcc & clang
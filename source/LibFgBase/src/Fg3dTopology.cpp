@@ -13,6 +13,7 @@
 #include "Fg3dTopology.hpp"
 #include "FgOpt.hpp"
 #include "FgStdVector.hpp"
+#include "FgThread.hpp"
 
 using namespace std;
 
@@ -42,141 +43,461 @@ Fg3dTopology::Edge::otherVertIdx(uint vertIdx) const
     return 0;       // make compiler happy
 }
 
-struct  EdgeVerts
+namespace {
+
+// Number of bits needed to represent values up to 'maxVal':
+uint
+numBits(uint64 maxVal)
+{
+    uint        ret = 0;
+    while (maxVal > 0) {
+        ++ret;
+        maxVal >>= 1;
+    }
+    return ret;
+}
+
+// Stable LSD radix sort of (key,val) pairs. Each pass histograms and scatters
+// contiguous chunks concurrently, with chunk offsets laid out so the result is stable:
+struct  RadixSort
 {
-    uint        loIdx;
-    uint        hiIdx;
+    static const uint       digitBits = 11,
+                            numBuckets = 1 << digitBits;
+    vector<uint64> &        keys;
+    vector<uint> &          vals;
+    vector<uint64>          keysOut;
+    vector<uint>            valsOut;
+    size_t                  chunkSize;
+    vector<size_t>          hist;           // By chunk then bucket
+    uint                    shift;
+
+    RadixSort(vector<uint64> & k,vector<uint> & v) : keys(k), vals(v) {}
 
-    EdgeVerts(uint i0,uint i1)
+    void
+    count(size_t chunk)
     {
-        if (i0 < i1) {
-            loIdx = i0;
-            hiIdx = i1;
-        }
-        else {
-            loIdx = i1;
-            hiIdx = i0;
-        }
-        FGASSERT(i0 != i1);
+        size_t *    hh = &hist[chunk*numBuckets];
+        size_t      end = std::min(keys.size(),(chunk+1)*chunkSize);
+        for (size_t ii=chunk*chunkSize; ii<end; ++ii)
+            ++hh[(keys[ii] >> shift) & (numBuckets-1)];
     }
 
-    // Comparison operator to use as a key for std::map:
-    bool operator<(const EdgeVerts & rhs) const
+    void
+    scatter(size_t chunk)
     {
-        if (loIdx < rhs.loIdx)
-            return true;
-        else if (loIdx == rhs.loIdx)
-            return (hiIdx < rhs.hiIdx);
-        else
-            return false;
+        size_t *    hh = &hist[chunk*numBuckets];
+        size_t      end = std::min(keys.size(),(chunk+1)*chunkSize);
+        for (size_t ii=chunk*chunkSize; ii<end; ++ii) {
+            size_t      dst = hh[(keys[ii] >> shift) & (numBuckets-1)]++;
+            keysOut[dst] = keys[ii];
+            valsOut[dst] = vals[ii];
+        }
     }
 
-    bool
-    contains(uint idx) const
-    {return ((idx == loIdx) || (idx == hiIdx)); }
+    void
+    sort(uint keyBits,uint numThreads)
+    {
+        size_t      num = keys.size();
+        // Threads aren't worthwhile for small meshes:
+        size_t      numChunks = (num < (1 << 16)) ? 1 : fgNumThreads(numThreads);
+        chunkSize = (num + numChunks - 1) / numChunks;
+        keysOut.resize(num);
+        valsOut.resize(num);
+        for (shift=0; shift<keyBits; shift+=digitBits) {
+            hist.assign(numChunks*numBuckets,0);
+            fgParallelFor(numChunks,boost::bind(&RadixSort::count,this,_1),numThreads);
+            size_t      sum = 0;
+            for (size_t bb=0; bb<numBuckets; ++bb) {
+                for (size_t cc=0; cc<numChunks; ++cc) {
+                    size_t &    hh = hist[cc*numBuckets+bb];
+                    size_t      cnt = hh;
+                    hh = sum;
+                    sum += cnt;
+                }
+            }
+            fgParallelFor(numChunks,boost::bind(&RadixSort::scatter,this,_1),numThreads);
+            keys.swap(keysOut);
+            vals.swap(valsOut);
+        }
+    }
 };
 
-struct  TriVerts
+void
+radixSort(vector<uint64> & keys,vector<uint> & vals,uint keyBits,uint numThreads)
 {
-    FgVect3UI   inds;
+    RadixSort       rs(keys,vals);
+    rs.sort(keyBits,numThreads);
+}
 
-    TriVerts(FgVect3UI i)
-    {
-        if (i[1] < i[0])
-            std::swap(i[0],i[1]);
-        if (i[2] < i[1])
-            std::swap(i[1],i[2]);
-        if (i[1] < i[0])
-            std::swap(i[0],i[1]);
-        inds = i;
+// Fills CSR offsets from per-element counts:
+void
+countsToOffsets(vector<uint> & offsets)
+{
+    uint        sum = 0;
+    for (size_t ii=0; ii<offsets.size(); ++ii) {
+        uint        cnt = offsets[ii];
+        offsets[ii] = sum;
+        sum += cnt;
     }
+}
 
-    bool operator<(const TriVerts & rhs) const
-    {
-        for (uint ii=0; ii<3; ++ii) {
-            if (inds[ii] < rhs.inds[ii])
-                return true;
-            else if (inds[ii] == rhs.inds[ii])
-                continue;
-            else
-                return false;
-        }
-        return false;
+uint
+findRoot(vector<uint> & parent,uint idx)
+{
+    while (parent[idx] != idx) {
+        parent[idx] = parent[parent[idx]];      // Path halving
+        idx = parent[idx];
     }
-};
+    return idx;
+}
 
-Fg3dTopology::Fg3dTopology(
+}
+
+Fg3dTopoCsr::Fg3dTopoCsr(
     const FgVerts &             verts,
-    const vector<FgVect3UI> &   tris)
+    const vector<FgVect3UI> &   trisIn,
+    uint                        numThreads)
 {
-    // Detect null or duplicate tris:
-    uint                    duplicates = 0,
-                            nulls = 0;
-    set<TriVerts>           vset;
-    for (size_t ii=0; ii<tris.size(); ++ii) {
-        FgVect3UI           vis = tris[ii];
+    uint64                  nv = verts.size();
+    FGASSERT(nv < std::numeric_limits<uint>::max());
+    // Detect null or duplicate tris by sorting on their sorted vertex indices. The sort is stable
+    // so the first of any duplicates (in the original order) is the one kept:
+    uint                    nulls = 0,
+                            duplicates = 0;
+    vector<FgVect3UI>       sorted(trisIn.size());
+    vector<uint64>          keys;
+    vector<uint>            triInds;
+    keys.reserve(trisIn.size());
+    triInds.reserve(trisIn.size());
+    for (size_t ii=0; ii<trisIn.size(); ++ii) {
+        FgVect3UI           vis = trisIn[ii];
+        FGASSERT(fgMaxElem(vis) < nv);
         if ((vis[0] == vis[1]) || (vis[1] == vis[2]) || (vis[2] == vis[0]))
             ++nulls;
         else {
-            TriVerts            tv(vis);
-            if (vset.find(tv) == vset.end()) {
-                vset.insert(tv);
-                Tri             tri;
-                tri.vertInds = vis;
-                m_tris.push_back(tri);
-            }
-            else
-                ++duplicates;
+            if (vis[1] < vis[0])
+                std::swap(vis[0],vis[1]);
+            if (vis[2] < vis[1])
+                std::swap(vis[1],vis[2]);
+            if (vis[1] < vis[0])
+                std::swap(vis[0],vis[1]);
+            sorted[ii] = vis;
+            keys.push_back(vis[2]);
+            triInds.push_back(uint(ii));
         }
     }
+    radixSort(keys,triInds,numBits(nv),numThreads);
+    for (size_t ii=0; ii<keys.size(); ++ii) {
+        FgVect3UI           vis = sorted[triInds[ii]];
+        keys[ii] = uint64(vis[0]) * nv + vis[1];
+    }
+    radixSort(keys,triInds,numBits(nv*nv),numThreads);
+    vector<FgBool>          keep(trisIn.size(),false);
+    for (size_t ii=0; ii<triInds.size(); ++ii) {
+        if ((ii > 0) && (sorted[triInds[ii]] == sorted[triInds[ii-1]]))
+            ++duplicates;
+        else
+            keep[triInds[ii]] = true;
+    }
     if (duplicates > 0)
         fgout << fgnl << "WARNING: Duplicate tris: " << duplicates;
     if (nulls > 0)
         fgout << fgnl << "WARNING: Null tris: " << nulls;
-    m_verts.resize(verts.size());
-    std::map<EdgeVerts,vector<uint> >    edgesToTris;
-    for (size_t ii=0; ii<m_tris.size(); ++ii) {
-        FgVect3UI       vertInds = m_tris[ii].vertInds;
-        m_tris[ii].edgeInds = FgVect3UI(std::numeric_limits<uint>::max());
+    tris.reserve(trisIn.size()-nulls-duplicates);
+    for (size_t ii=0; ii<trisIn.size(); ++ii)
+        if (keep[ii])
+            tris.push_back(trisIn[ii]);
+    // Edges. Sort the half-edges (tri corners) by their packed edge key. Stability keeps
+    // the tris of each edge in ascending order:
+    size_t                  numHalf = tris.size() * 3;
+    keys.resize(numHalf);
+    vector<uint>            halfInds(numHalf);
+    for (size_t tt=0; tt<tris.size(); ++tt) {
+        FgVect3UI           vis = tris[tt];
         for (uint jj=0; jj<3; ++jj) {
-            m_verts[vertInds[jj]].triInds.push_back(uint(ii));
-            EdgeVerts        edge(vertInds[jj],vertInds[(jj+1)%3]);
-            edgesToTris[edge].push_back(uint(ii));
+            uint            v0 = vis[jj],
+                            v1 = vis[(jj+1)%3];
+            if (v1 < v0)
+                std::swap(v0,v1);
+            keys[tt*3+jj] = uint64(v0) * nv + v1;
+            halfInds[tt*3+jj] = uint(tt*3+jj);
         }
     }
-    for (map<EdgeVerts,vector<uint> >::const_iterator it=edgesToTris.begin(); it!=edgesToTris.end(); ++it) {
-        EdgeVerts       edgeVerts = it->first;
-        Edge            edge;
-        edge.vertInds = FgVect2UI(edgeVerts.loIdx,edgeVerts.hiIdx);
-        edge.triInds = it->second;
-        m_edges.push_back(edge);
+    radixSort(keys,halfInds,numBits(nv*nv),numThreads);
+    triEdges.resize(tris.size());
+    edgeTriOffsets.reserve(numHalf/2+2);
+    edgeTriInds.resize(numHalf);
+    for (size_t ii=0; ii<numHalf; ++ii) {
+        if ((ii == 0) || (keys[ii] != keys[ii-1])) {
+            edgeTriOffsets.push_back(uint(ii));
+            edgeVerts.push_back(FgVect2UI(uint(keys[ii] / nv),uint(keys[ii] % nv)));
+        }
+        uint                half = halfInds[ii];
+        edgeTriInds[ii] = half / 3;
+        triEdges[half/3][half%3] = uint(edgeVerts.size()-1);
     }
-    for (size_t ii=0; ii<m_edges.size(); ++ii) {
-        FgVect2UI               vts = m_edges[ii].vertInds;
-        m_verts[vts[0]].edgeInds.push_back(uint(ii));
-        m_verts[vts[1]].edgeInds.push_back(uint(ii));
-        EdgeVerts               edge(vts[0],vts[1]);
-        const vector<uint> &    triInds = edgesToTris.find(edge)->second;
-        for (size_t jj=0; jj<triInds.size(); ++jj) {
-            uint                triIdx = triInds[jj];
-            FgVect3UI           tri = m_tris[triIdx].vertInds;
-            for (uint ee=0; ee<3; ++ee)
-                if ((edge.contains(tri[ee]) && edge.contains(tri[(ee+1)%3])))
-                    m_tris[triIdx].edgeInds[ee] = uint(ii);
+    edgeTriOffsets.push_back(uint(numHalf));
+    // Vertex adjacencies by counting sort, filled in ascending element order:
+    vertEdgeOffsets.assign(nv+1,0);
+    for (size_t ee=0; ee<edgeVerts.size(); ++ee) {
+        ++vertEdgeOffsets[edgeVerts[ee][0]];
+        ++vertEdgeOffsets[edgeVerts[ee][1]];
+    }
+    countsToOffsets(vertEdgeOffsets);
+    vertEdgeInds.resize(vertEdgeOffsets.back());
+    vector<uint>            pos(vertEdgeOffsets.begin(),vertEdgeOffsets.end()-1);
+    for (size_t ee=0; ee<edgeVerts.size(); ++ee) {
+        vertEdgeInds[pos[edgeVerts[ee][0]]++] = uint(ee);
+        vertEdgeInds[pos[edgeVerts[ee][1]]++] = uint(ee);
+    }
+    vertTriOffsets.assign(nv+1,0);
+    for (size_t tt=0; tt<tris.size(); ++tt)
+        for (uint jj=0; jj<3; ++jj)
+            ++vertTriOffsets[tris[tt][jj]];
+    countsToOffsets(vertTriOffsets);
+    vertTriInds.resize(vertTriOffsets.back());
+    pos.assign(vertTriOffsets.begin(),vertTriOffsets.end()-1);
+    for (size_t tt=0; tt<tris.size(); ++tt)
+        for (uint jj=0; jj<3; ++jj)
+            vertTriInds[pos[tris[tt][jj]]++] = uint(tt);
+}
+
+uint
+Fg3dTopoCsr::edgeOtherVert(uint edgeIdx,uint vertIdx) const
+{
+    FgVect2UI       vis = edgeVerts[edgeIdx];
+    if (vertIdx == vis[0])
+        return vis[1];
+    FGASSERT(vertIdx == vis[1]);
+    return vis[0];
+}
+
+FgVect2UI
+Fg3dTopoCsr::edgeFacingVertInds(uint edgeIdx) const
+{
+    FGASSERT(edgeNumTris(edgeIdx) == 2);
+    const uint *    tis = &edgeTriInds[edgeTriOffsets[edgeIdx]];
+    return FgVect2UI(oppositeVert(tis[0],edgeIdx),oppositeVert(tis[1],edgeIdx));
+}
+
+bool
+Fg3dTopoCsr::vertOnBoundary(uint vertIdx) const
+{
+    for (uint ii=vertEdgeOffsets[vertIdx]; ii<vertEdgeOffsets[vertIdx+1]; ++ii)
+        if (edgeNumTris(vertEdgeInds[ii]) == 1)
+            return true;
+    return false;
+}
+
+vector<uint>
+Fg3dTopoCsr::vertBoundaryNeighbours(uint vertIdx) const
+{
+    vector<uint>    ret;
+    for (uint ii=vertEdgeOffsets[vertIdx]; ii<vertEdgeOffsets[vertIdx+1]; ++ii)
+        if (edgeNumTris(vertEdgeInds[ii]) == 1)
+            ret.push_back(edgeOtherVert(vertEdgeInds[ii],vertIdx));
+    return ret;
+}
+
+vector<uint>
+Fg3dTopoCsr::vertNeighbours(uint vertIdx) const
+{
+    vector<uint>    ret;
+    ret.reserve(vertEdgeOffsets[vertIdx+1]-vertEdgeOffsets[vertIdx]);
+    for (uint ii=vertEdgeOffsets[vertIdx]; ii<vertEdgeOffsets[vertIdx+1]; ++ii)
+        ret.push_back(edgeOtherVert(vertEdgeInds[ii],vertIdx));
+    return ret;
+}
+
+vector<set<uint> >
+Fg3dTopoCsr::seams() const
+{
+    // Union-find over boundary edges:
+    const uint          none = std::numeric_limits<uint>::max();
+    vector<uint>        parent(numVerts(),none);
+    for (size_t ee=0; ee<edgeVerts.size(); ++ee) {
+        if (edgeNumTris(uint(ee)) == 1) {
+            uint        v0 = edgeVerts[ee][0],
+                        v1 = edgeVerts[ee][1];
+            if (parent[v0] == none)
+                parent[v0] = v0;
+            if (parent[v1] == none)
+                parent[v1] = v1;
+            uint        r0 = findRoot(parent,v0),
+                        r1 = findRoot(parent,v1);
+            if (r0 != r1)
+                parent[std::max(r0,r1)] = std::min(r0,r1);
+        }
+    }
+    // Seams are ordered by their lowest vertex index:
+    vector<set<uint> >  ret;
+    vector<uint>        rootToSeam(numVerts(),none);
+    for (size_t ii=0; ii<parent.size(); ++ii) {
+        if (parent[ii] != none) {
+            uint        root = findRoot(parent,uint(ii));
+            if (rootToSeam[root] == none) {
+                rootToSeam[root] = uint(ret.size());
+                ret.push_back(set<uint>());
+            }
+            ret[rootToSeam[root]].insert(uint(ii));
         }
     }
-    // validate:
+    return ret;
+}
+
+set<uint>
+Fg3dTopoCsr::seamContaining(uint vertIdx) const
+{
+    vector<set<uint> >  sms = seams();
+    for (size_t ii=0; ii<sms.size(); ++ii)
+        if (sms[ii].find(vertIdx) != sms[ii].end())
+            return sms[ii];
+    return set<uint>();
+}
+
+set<uint>
+Fg3dTopoCsr::traceFold(
+    const Fg3dNormals & norms,
+    vector<FgBool> &    done,
+    uint                vertIdx)
+    const
+{
+    // Explicit stack rather than recursion since folds on scan data can be very long:
+    set<uint>           ret;
+    vector<uint>        todo(1,vertIdx);
+    const Fg3dFacetNormals &    facetNorms = norms.facet[0];
+    while (!todo.empty()) {
+        uint            vv = todo.back();
+        todo.pop_back();
+        if (done[vv])
+            continue;
+        done[vv] = true;
+        for (uint ii=vertEdgeOffsets[vv]; ii<vertEdgeOffsets[vv+1]; ++ii) {
+            uint        edgeIdx = vertEdgeInds[ii];
+            if (edgeNumTris(edgeIdx) == 2) {    // Can not be part of a fold otherwise
+                const uint *    tis = &edgeTriInds[edgeTriOffsets[edgeIdx]];
+                float           dot = fgDot(facetNorms.tri[tis[0]],facetNorms.tri[tis[1]]);
+                if (dot < 0.5f) {               // > 60 degrees
+                    ret.insert(vv);
+                    todo.push_back(edgeOtherVert(edgeIdx,vv));
+                }
+            }
+        }
+    }
+    return ret;
+}
+
+FgVect3UI
+Fg3dTopoCsr::isManifold() const
+{
+    FgVect3UI       ret(0);
+    for (size_t ee=0; ee<edgeVerts.size(); ++ee) {
+        uint            numTris = edgeNumTris(uint(ee));
+        if (numTris == 1)
+            ++ret[0];
+        else if (numTris > 2)
+            ++ret[1];
+        else {
+            // Check that winding directions of the two facets are opposite on this edge:
+            const uint *    tis = &edgeTriInds[edgeTriOffsets[ee]];
+            FgVect3UI       tri0 = tris[tis[0]],
+                            tri1 = tris[tis[1]];
+            uint            idx0 = fgFindFirstIdx(triEdges[tis[0]],uint(ee)),
+                            idx1 = fgFindFirstIdx(triEdges[tis[1]],uint(ee));
+            if ((tri0[idx0] == tri1[idx1]) && (tri0[(idx0+1)%3] == tri1[(idx1+1)%3]))
+                ++ret[2];
+        }
+    }
+    return ret;
+}
+
+size_t
+Fg3dTopoCsr::unusedVerts() const
+{
+    size_t      ret = 0;
+    for (size_t ii=0; ii<numVerts(); ++ii)
+        if (vertTriOffsets[ii] == vertTriOffsets[ii+1])
+            ++ret;
+    return ret;
+}
+
+vector<float>
+Fg3dTopoCsr::edgeDistanceMap(const FgVerts & verts,size_t vertIdx) const
+{
+    vector<float>       ret(verts.size(),std::numeric_limits<float>::max());
+    FGASSERT(vertIdx < verts.size());
+    ret[vertIdx] = 0;
+    edgeDistanceMap(verts,ret);
+    return ret;
+}
+
+void
+Fg3dTopoCsr::edgeDistanceMap(const FgVerts & verts,vector<float> & vertDists) const
+{
+    FGASSERT(verts.size() == numVerts());
+    FGASSERT(vertDists.size() == verts.size());
+    typedef std::pair<float,uint>   DistVert;
+    std::priority_queue<DistVert,vector<DistVert>,std::greater<DistVert> >  heap;
+    for (size_t vv=0; vv<vertDists.size(); ++vv)
+        if (vertDists[vv] < std::numeric_limits<float>::max())
+            heap.push(DistVert(vertDists[vv],uint(vv)));
+    while (!heap.empty()) {
+        DistVert        dv = heap.top();
+        heap.pop();
+        uint            vv = dv.second;
+        if (dv.first > vertDists[vv])           // Stale entry
+            continue;
+        for (uint ii=vertEdgeOffsets[vv]; ii<vertEdgeOffsets[vv+1]; ++ii) {
+            uint            neighIdx = edgeOtherVert(vertEdgeInds[ii],vv);
+            float           neighDist = vertDists[vv] + (verts[neighIdx]-verts[vv]).length();
+            if (neighDist < vertDists[neighIdx]) {
+                vertDists[neighIdx] = neighDist;
+                heap.push(DistVert(neighDist,neighIdx));
+            }
+        }
+    }
+}
+
+uint
+Fg3dTopoCsr::oppositeVert(uint triIdx,uint edgeIdx) const
+{
+    FgVect3UI       tri = tris[triIdx];
+    FgVect2UI       vertInds = edgeVerts[edgeIdx];
+    for (uint ii=0; ii<3; ++ii)
+        if ((tri[ii] != vertInds[0]) && (tri[ii] != vertInds[1]))
+            return tri[ii];
+    FGASSERT_FALSE;
+    return 0;
+}
+
+Fg3dTopology::Fg3dTopology(
+    const FgVerts &             verts,
+    const vector<FgVect3UI> &   tris)
+{*this = Fg3dTopology(Fg3dTopoCsr(verts,tris)); }
+
+Fg3dTopology::Fg3dTopology(const Fg3dTopoCsr & csr)
+{
+    m_tris.resize(csr.tris.size());
+    for (size_t ii=0; ii<m_tris.size(); ++ii) {
+        m_tris[ii].vertInds = csr.tris[ii];
+        m_tris[ii].edgeInds = csr.triEdges[ii];
+    }
+    m_edges.resize(csr.numEdges());
+    for (size_t ii=0; ii<m_edges.size(); ++ii) {
+        m_edges[ii].vertInds = csr.edgeVerts[ii];
+        m_edges[ii].triInds.assign(
+            csr.edgeTriInds.begin()+csr.edgeTriOffsets[ii],
+            csr.edgeTriInds.begin()+csr.edgeTriOffsets[ii+1]);
+    }
+    m_verts.resize(csr.numVerts());
     for (size_t ii=0; ii<m_verts.size(); ++ii) {
-        const vector<uint> &    edgeInds = m_verts[ii].edgeInds;
-        if (edgeInds.size() > 1)
-            for (size_t jj=0; jj<edgeInds.size(); ++jj)
-                m_edges[edgeInds[jj]].otherVertIdx(uint(ii));   // throws if index ii not found in edge verts
+        m_verts[ii].edgeInds.assign(
+            csr.vertEdgeInds.begin()+csr.vertEdgeOffsets[ii],
+            csr.vertEdgeInds.begin()+csr.vertEdgeOffsets[ii+1]);
+        m_verts[ii].triInds.assign(
+            csr.vertTriInds.begin()+csr.vertTriOffsets[ii],
+            csr.vertTriInds.begin()+csr.vertTriOffsets[ii+1]);
     }
-    for (size_t ii=0; ii<m_tris.size(); ++ii)
-        for (uint jj=0; jj<3; ++jj)
-            FGASSERT(m_tris[ii].edgeInds[jj] != std::numeric_limits<uint>::max());
-    for (size_t ii=0; ii<m_edges.size(); ++ii)
-        FGASSERT(m_edges[ii].triInds.size() > 0);
 }
 
 FgVect2UI
@@ -19,6 +19,87 @@
 #include "FgOpt.hpp"
 #include "Fg3dNormals.hpp"
 
+// Compact topology using flat CSR (compressed sparse row) adjacency arrays instead of per-element
+// vectors. It is built by radix sorting packed vertex index keys (in parallel for large meshes)
+// so avoids the millions of small allocations and tree lookups of a node-based construction.
+// Tri, edge and vertex indices, and the order of adjacency lists, are the same as Fg3dTopology:
+struct Fg3dTopoCsr
+{
+    vector<FgVect3UI>       tris;               // Non-null, non-duplicate tris in original order
+    vector<FgVect3UI>       triEdges;           // In same order as verts (0-1,1-2,2-0)
+    vector<FgVect2UI>       edgeVerts;          // Lower index first. Sorted.
+    // Elements adjacent to element 'ii' are given by inds[offsets[ii]] to inds[offsets[ii+1]-1]:
+    vector<uint>            edgeTriOffsets;     // Size numEdges+1
+    vector<uint>            edgeTriInds;        // Ascending for each edge
+    vector<uint>            vertEdgeOffsets;    // Size numVerts+1
+    vector<uint>            vertEdgeInds;       // Ascending for each vert
+    vector<uint>            vertTriOffsets;     // Size numVerts+1
+    vector<uint>            vertTriInds;        // Ascending for each vert
+
+    Fg3dTopoCsr(
+        const FgVerts &             verts,
+        const vector<FgVect3UI> &   tris,
+        uint                        numThreads=0);
+
+    size_t
+    numVerts() const
+    {return vertEdgeOffsets.size()-1; }
+
+    size_t
+    numEdges() const
+    {return edgeVerts.size(); }
+
+    uint
+    edgeNumTris(uint edgeIdx) const
+    {return edgeTriOffsets[edgeIdx+1] - edgeTriOffsets[edgeIdx]; }
+
+    uint
+    edgeOtherVert(uint edgeIdx,uint vertIdx) const;
+
+    // The remaining functions are as for Fg3dTopology:
+
+    FgVect2UI
+    edgeFacingVertInds(uint edgeIdx) const;
+
+    bool
+    vertOnBoundary(uint vertIdx) const;
+
+    vector<uint>
+    vertBoundaryNeighbours(uint vertIdx) const;
+
+    vector<uint>
+    vertNeighbours(uint vertIdx) const;
+
+    vector<std::set<uint> >
+    seams() const;
+
+    std::set<uint>
+    seamContaining(uint vertIdx) const;
+
+    std::set<uint>
+    traceFold(
+        const Fg3dNormals & norms,
+        vector<FgBool> &    done,
+        uint                vertIdx) const;
+
+    FgVect3UI
+    isManifold() const;
+
+    size_t
+    unusedVerts() const;
+
+    // Uses Dijkstra's algorithm so the cost is O(E log V) rather than iterating to convergence:
+    vector<float>
+    edgeDistanceMap(const FgVerts & verts,size_t vertIdx) const;
+
+    void
+    edgeDistanceMap(const FgVerts & verts,vector<float> & init) const;
+
+private:
+    uint
+    oppositeVert(uint triIdx,uint edgeIdx) const;
+};
+
 struct Fg3dTopology
 {
     struct      Tri
@@ -50,6 +131,9 @@ struct Fg3dTopology
         const FgVerts &            verts,
         const vector<FgVect3UI> &  tris);
 
+    explicit
+    Fg3dTopology(const Fg3dTopoCsr & csr);
+
     FgVect2UI
     edgeFacingVertInds(uint edgeIdx) const;
 
@@ -0,0 +1,211 @@
+//
+// Copyright (c) 2015 Singular Inversions Inc. (facegen.com)
+// Use, modification and distribution is subject to the MIT License,
+// see accompanying file LICENSE.txt or facegen.com/base_library_license.txt
+//
+
+#include "stdafx.h"
+
+#include "FgAssetCache.hpp"
+#include "FgThread.hpp"
+#include "Fg3dMeshIo.hpp"
+#include "FgImageIo.hpp"
+
+using namespace std;
+
+namespace {
+
+template<class T>
+size_t
+vecBytes(const vector<T> & v)
+{return v.size() * sizeof(T); }
+
+size_t
+imgBytes(const FgImgRgbaUb & img)
+{return sizeof(img) + vecBytes(img.m_data); }
+
+size_t
+meshBytes(const Fg3dMesh & mesh)
+{
+    size_t          ret = sizeof(mesh) + vecBytes(mesh.verts) + vecBytes(mesh.uvs) + vecBytes(mesh.markedVerts);
+    for (size_t ii=0; ii<mesh.surfaces.size(); ++ii) {
+        const Fg3dSurface & surf = mesh.surfaces[ii];
+        ret += sizeof(surf) + vecBytes(surf.tris.vertInds) + vecBytes(surf.tris.uvInds) +
+            vecBytes(surf.quads.vertInds) + vecBytes(surf.quads.uvInds) + vecBytes(surf.surfPoints);
+        if (surf.albedoMap)
+            ret += imgBytes(*surf.albedoMap);
+    }
+    for (size_t ii=0; ii<mesh.deltaMorphs.size(); ++ii)
+        ret += sizeof(FgMorph) + vecBytes(mesh.deltaMorphs[ii].verts);
+    for (size_t ii=0; ii<mesh.targetMorphs.size(); ++ii)
+        ret += sizeof(FgIndexedMorph) + vecBytes(mesh.targetMorphs[ii].baseInds) + vecBytes(mesh.targetMorphs[ii].verts);
+    return ret;
+}
+
+boost::shared_ptr<const void>
+loadMesh(const FgString & fname,size_t & bytes)
+{
+    boost::shared_ptr<const Fg3dMesh>   ret = boost::make_shared<const Fg3dMesh>(fgLoadMeshAnyFormat(fname));
+    bytes = meshBytes(*ret);
+    return ret;
+}
+
+boost::shared_ptr<const void>
+loadTri(const FgString & fname,size_t & bytes)
+{
+    boost::shared_ptr<const Fg3dMesh>   ret = boost::make_shared<const Fg3dMesh>(fgLoadTri(fname));
+    bytes = meshBytes(*ret);
+    return ret;
+}
+
+boost::shared_ptr<const void>
+loadImg(const FgString & fname,size_t & bytes)
+{
+    boost::shared_ptr<FgImgRgbaUb>      ret = boost::make_shared<FgImgRgbaUb>();
+    fgLoadImgAnyFormat(fname,*ret);
+    bytes = imgBytes(*ret);
+    return ret;
+}
+
+FgOnce              s_assetCacheOnce = FG_ONCE_INIT;
+FgAssetCache *      s_assetCache = NULL;        // Never destroyed so it outlives all users
+
+void
+createAssetCache()
+{s_assetCache = new FgAssetCache; }
+
+}
+
+std::ostream &
+operator<<(std::ostream & os,const FgAssetCacheStats & s)
+{
+    return os << "hits: " << s.hits << " (" << s.waits << " waited) misses: " << s.misses
+        << " (" << s.reloads << " reloads) evictions: " << s.evictions << " entries: " << s.entries
+        << " MB: " << (s.bytes >> 20) << " / " << (s.budget >> 20);
+}
+
+FgAssetCache::FgAssetCache(size_t budgetBytes)
+{m_stats.budget = budgetBytes; }
+
+FgMeshCPtr
+FgAssetCache::mesh(const FgString & fname)
+{return boost::static_pointer_cast<const Fg3dMesh>(get("mesh:"+fname.m_str,fname,boost::bind(loadMesh,fname,_1))); }
+
+FgMeshCPtr
+FgAssetCache::tri(const FgString & fname)
+{return boost::static_pointer_cast<const Fg3dMesh>(get("tri:"+fname.m_str,fname,boost::bind(loadTri,fname,_1))); }
+
+FgImgCPtr
+FgAssetCache::image(const FgString & fname)
+{return boost::static_pointer_cast<const FgImgRgbaUb>(get("image:"+fname.m_str,fname,boost::bind(loadImg,fname,_1))); }
+
+FgAssetCacheStats
+FgAssetCache::stats() const
+{
+    boost::lock_guard<boost::mutex>     lock(m_mtx);
+    return m_stats;
+}
+
+void
+FgAssetCache::setBudget(size_t bytes)
+{
+    boost::lock_guard<boost::mutex>     lock(m_mtx);
+    m_stats.budget = bytes;
+    evict();
+}
+
+void
+FgAssetCache::clear()
+{
+    boost::lock_guard<boost::mutex>     lock(m_mtx);
+    while (!m_lru.empty())
+        remove(m_entries.find(m_lru.back()));
+}
+
+FgAssetCache::Ptr
+FgAssetCache::get(const string & key,const FgString & fname,const Loader & load)
+{
+    Stamp               stamp;
+    boost::system::error_code   ec0,ec1;
+    stamp.size = boost::filesystem::file_size(fname.ns(),ec0);
+    stamp.writeTime = boost::filesystem::last_write_time(fname.ns(),ec1);
+    size_t              bytes = 0;
+    if (ec0 || ec1)                     // Leave the loader to report the error
+        return load(bytes);
+    boost::unique_lock<boost::mutex>    lock(m_mtx);
+    bool                waited = false;
+    for (;;) {
+        Entries::iterator   it = m_entries.find(key);
+        if (it == m_entries.end())
+            break;
+        Entry &             entry = it->second;
+        if (entry.loading) {
+            waited = true;
+            m_cvLoaded.wait(lock);
+            continue;
+        }
+        if (entry.stamp == stamp) {
+            ++m_stats.hits;
+            if (waited)
+                ++m_stats.waits;
+            m_lru.splice(m_lru.begin(),m_lru,entry.lru);
+            return entry.ptr;
+        }
+        ++m_stats.reloads;
+        remove(it);
+        break;
+    }
+    ++m_stats.misses;
+    m_entries[key].stamp = stamp;       // Marks the load in progress
+    lock.unlock();
+    Ptr                 ptr;
+    try {
+        ptr = load(bytes);
+    }
+    catch (...) {
+        // Waiting requests retry the load themselves:
+        lock.lock();
+        m_entries.erase(key);
+        m_cvLoaded.notify_all();
+        throw;
+    }
+    lock.lock();
+    Entry &             entry = m_entries[key];     // Loading entries are only removed by their loader
+    entry.loading = false;
+    entry.ptr = ptr;
+    entry.bytes = bytes;
+    m_lru.push_front(key);
+    entry.lru = m_lru.begin();
+    m_stats.bytes += bytes;
+    ++m_stats.entries;
+    evict();
+    m_cvLoaded.notify_all();
+    return ptr;
+}
+
+void
+FgAssetCache::remove(Entries::iterator it)
+{
+    FGASSERT(!it->second.loading);
+    m_stats.bytes -= it->second.bytes;
+    --m_stats.entries;
+    m_lru.erase(it->second.lru);
+    m_entries.erase(it);
+}
+
+void
+FgAssetCache::evict()
+{
+    // An entry larger than the budget is evicted as soon as it is loaded:
+    while ((m_stats.bytes > m_stats.budget) && !m_lru.empty()) {
+        remove(m_entries.find(m_lru.back()));
+        ++m_stats.evictions;
+    }
+}
+
+FgAssetCache &
+fgAssetCache()
+{
+    fgRunOnce(s_assetCacheOnce,createAssetCache);
+    return *s_assetCache;
+}
@@ -0,0 +1,136 @@
+//
+// Copyright (c) 2015 Singular Inversions Inc. (facegen.com)
+// Use, modification and distribution is subject to the MIT License,
+// see accompanying file LICENSE.txt or facegen.com/base_library_license.txt
+//
+// Thread-safe cache of meshes and images loaded from files, handed out as shared immutable
+// handles so repeated loads of the same file (eg. by render requests) skip reading and decoding.
+//
+// Entries are keyed by file path (as given) and validated against the file's size and last write
+// time on every request, so a changed file is reloaded. Write times have one second resolution
+// on some file systems, so a same-size rewrite within the same second is not detected.
+// Least recently used entries are evicted when the estimated memory of the cached entries
+// exceeds the budget; handles already given out remain valid. Concurrent requests for an asset
+// which is being loaded wait for that load rather than loading it again.
+// Files which cannot be found (eg. mesh names without an extension) are loaded uncached.
+//
+
+#ifndef FGASSETCACHE_HPP
+#define FGASSETCACHE_HPP
+
+#include "FgStdLibs.hpp"
+#include "FgBoostLibs.hpp"
+#include "FgNonCopyable.hpp"
+#include "FgString.hpp"
+#include "Fg3dMesh.hpp"
+#include "FgImageBase.hpp"
+
+typedef boost::shared_ptr<const Fg3dMesh>       FgMeshCPtr;
+typedef boost::shared_ptr<const FgImgRgbaUb>    FgImgCPtr;
+
+struct  FgAssetCacheStats
+{
+    uint64          hits;           // Requests served from the cache
+    uint64          waits;          // Hits which waited for a load in progress on another thread
+    uint64          misses;         // Requests which loaded the file
+    uint64          reloads;        // Misses due to a changed file
+    uint64          evictions;      // Entries removed to stay within the budget
+    size_t          entries;
+    size_t          bytes;          // Estimated memory of the cached entries
+    size_t          budget;
+
+    FgAssetCacheStats() : hits(0), waits(0), misses(0), reloads(0), evictions(0), entries(0), bytes(0), budget(0) {}
+};
+
+std::ostream &
+operator<<(std::ostream &,const FgAssetCacheStats &);
+
+struct  FgAssetCache : FgNonCopyable
+{
+    explicit
+    FgAssetCache(size_t budgetBytes=size_t(512) << 20);
+
+    // As 'fgLoadMeshAnyFormat' and 'fgLoadImgAnyFormat', including their exceptions. MT safe:
+    FgMeshCPtr
+    mesh(const FgString & fname);
+
+    // As 'fgLoadTri' (TRI format only, whatever the extension). Cached separately from 'mesh':
+    FgMeshCPtr
+    tri(const FgString & fname);
+
+    FgImgCPtr
+    image(const FgString & fname);
+
+    FgAssetCacheStats
+    stats() const;
+
+    // Evicts as required:
+    void
+    setBudget(size_t bytes);
+
+    // Removes all loaded entries. Statistics are kept:
+    void
+    clear();
+
+private:
+    typedef boost::shared_ptr<const void>           Ptr;
+    typedef boost::function<Ptr(size_t &)>          Loader;     // Sets the estimated bytes
+
+    struct  Stamp
+    {
+        uintmax_t       size;
+        std::time_t     writeTime;
+
+        bool
+        operator==(const Stamp & rhs) const
+        {return ((size == rhs.size) && (writeTime == rhs.writeTime)); }
+    };
+
+    struct  Entry
+    {
+        bool                            loading;
+        Stamp                           stamp;
+        Ptr                             ptr;
+        size_t                          bytes;
+        std::list<std::string>::iterator lru;
+
+        Entry() : loading(true), bytes(0) {}
+    };
+    typedef std::map<std::string,Entry>     Entries;
+
+    mutable boost::mutex        m_mtx;          // Guards all members below
+    boost::condition_variable   m_cvLoaded;
+    Entries                     m_entries;      // Loaded and loading
+    std::list<std::string>      m_lru;          // Keys of loaded entries, most recently used first
+    FgAssetCacheStats           m_stats;
+
+    Ptr
+    get(const std::string & key,const FgString & fname,const Loader & load);
+
+    // Must hold lock:
+    void
+    remove(Entries::iterator it);
+    void
+    evict();
+};
+
+// Process-wide cache:
+FgAssetCache &
+fgAssetCache();
+
+inline
+FgMeshCPtr
+fgCachedMesh(const FgString & fname)
+{return fgAssetCache().mesh(fname); }
+
+inline
+FgMeshCPtr
+fgCachedTri(const FgString & fname)
+{return fgAssetCache().tri(fname); }
+
+inline
+FgImgCPtr
+fgCachedImg(const FgString & fname)
+{return fgAssetCache().image(fname); }
+
+#endif
@@ -0,0 +1,99 @@
+//
+// Copyright (c) 2015 Singular Inversions Inc. (facegen.com)
+// Use, modification and distribution is subject to the MIT License,
+// see accompanying file LICENSE.txt or facegen.com/base_library_license.txt
+//
+
+#include "stdafx.h"
+
+#include "FgAssetCache.hpp"
+#include "Fg3dMeshIo.hpp"
+#include "FgImgFormats.hpp"
+#include "FgThread.hpp"
+#include "FgFileSystem.hpp"
+#include "FgCommand.hpp"
+#include "FgTestUtils.hpp"
+
+using namespace std;
+
+static
+void
+request(FgAssetCache * cache,const FgString & fname,vector<FgImgCPtr> * handles,size_t idx)
+{(*handles)[idx] = cache->image(fname); }
+
+void
+fgAssetCacheTest(const FgArgs & args)
+{
+    FGTESTDIR
+    FgAssetCache        cache;
+    FgImgRgbaUb         img0(16,8,FgRgbaUB(1,2,3,255)),
+                        img1(8,8,FgRgbaUB(4,5,6,255));
+    fgSavePnm("img.ppm",img0);
+    FgImgCPtr           h0 = cache.image("img.ppm"),
+                        h1 = cache.image("img.ppm");
+    FGASSERT(h0->m_data == img0.m_data);
+    FGASSERT(h0 == h1);
+    FgAssetCacheStats   stats = cache.stats();
+    FGASSERT((stats.misses == 1) && (stats.hits == 1) && (stats.entries == 1));
+    // A changed file is reloaded and existing handles are unaffected:
+    fgSavePnm("img.ppm",img1);
+    h1 = cache.image("img.ppm");
+    FGASSERT(h1->m_data == img1.m_data);
+    FGASSERT(h0->m_data == img0.m_data);
+    stats = cache.stats();
+    FGASSERT((stats.misses == 2) && (stats.reloads == 1) && (stats.entries == 1));
+    // Meshes:
+    FgString            tri = fgDataDir() + "base/Glasses.tri";
+    FgMeshCPtr          m0 = cache.mesh(tri),
+                        m1 = cache.mesh(tri);
+    FGASSERT(m0 == m1);
+    FGASSERT(m0->verts == fgLoadMeshAnyFormat(tri).verts);
+    stats = cache.stats();
+    FGASSERT((stats.entries == 2) && (stats.hits == 2));
+    // LRU eviction under the budget. The image was used most recently so is kept:
+    h1 = cache.image("img.ppm");
+    cache.setBudget(stats.bytes - 1);
+    stats = cache.stats();
+    FGASSERT((stats.entries == 1) && (stats.evictions == 1) && (stats.bytes <= stats.budget));
+    FGASSERT(cache.image("img.ppm") == h1);
+    FGASSERT(cache.mesh(tri) != m0);
+    FGASSERT(m0->verts.size() > 0);
+    cache.setBudget(size_t(64) << 20);
+    // TRI-only loads are separate entries and ignore the extension:
+    FgMeshCPtr          t0 = cache.tri(tri);
+    FGASSERT(t0 != cache.mesh(tri));
+    FGASSERT(t0->verts == m0->verts);
+    FGASSERT(cache.tri(tri) == t0);
+    fgCopyFile(tri,"glasses.obj",true);
+    FGASSERT(cache.tri("glasses.obj")->verts == m0->verts);
+    bool                threw = false;
+    try {
+        cache.tri("img.ppm");
+    }
+    catch (FgException &) {
+        threw = true;
+    }
+    FGASSERT(threw);
+    // Concurrent requests for the same file load it once:
+    cache.clear();
+    stats = cache.stats();
+    fgSavePnm("par.ppm",img0);
+    vector<FgImgCPtr>   handles(32);
+    fgParallelFor(handles.size(),boost::bind(request,&cache,FgString("par.ppm"),&handles,_1),4);
+    FgAssetCacheStats   par = cache.stats();
+    FGASSERT(par.misses == stats.misses+1);
+    FGASSERT(par.hits == stats.hits+handles.size()-1);
+    for (size_t ii=1; ii<handles.size(); ++ii)
+        FGASSERT(handles[ii] == handles[0]);
+    fgout << fgnl << par;
+    // Load errors propagate and are not cached:
+    threw = false;
+    try {
+        cache.image("missing.ppm");
+    }
+    catch (FgException &) {
+        threw = true;
+    }
+    FGASSERT(threw);
+    FGASSERT(cache.stats().entries == par.entries);
+}
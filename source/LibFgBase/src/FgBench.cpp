@@ -0,0 +1,169 @@
+//
+// Copyright (c) 2015 Singular Inversions Inc. (facegen.com)
+// Use, modification and distribution is subject to the MIT License,
+// see accompanying file LICENSE.txt or facegen.com/base_library_license.txt
+//
+
+#include "stdafx.h"
+
+#include "FgBench.hpp"
+#include "FgTime.hpp"
+#include "FgMath.hpp"
+#include "FgStdString.hpp"
+#include "FgDiagnostics.hpp"
+#include "FgCommand.hpp"
+
+using namespace std;
+
+FgBenchResult
+fgBenchRun(const FgBench & bench,const FgBenchOptions & opts)
+{
+    FGASSERT(opts.reps > 0);
+    FgFunc              func = bench.setup();
+    // Calibrate with the fastest warmup run:
+    uint64              warmNs = numeric_limits<uint64>::max();
+    for (uint ii=0; ii<opts.warmup; ++ii) {
+        uint64          start = fgTimeNs();
+        func();
+        warmNs = std::min(warmNs,fgTimeNs()-start);
+    }
+    FgBenchResult       ret;
+    ret.name = bench.name;
+    ret.reps = opts.reps;
+    ret.iters = 1;
+    if ((opts.warmup > 0) && (warmNs < opts.minRepNs))
+        ret.iters = opts.minRepNs / std::max(warmNs,uint64(1));
+    vector<double>      times(opts.reps);
+    for (uint rr=0; rr<opts.reps; ++rr) {
+        uint64          start = fgTimeNs();
+        for (uint64 ii=0; ii<ret.iters; ++ii)
+            func();
+        times[rr] = double(fgTimeNs()-start) / double(ret.iters);
+    }
+    ret.median = fgMedian(times);
+    ret.mad = fgMedianAbsDev(times,ret.median);
+    ret.min = *std::min_element(times.begin(),times.end());
+    ret.max = *std::max_element(times.begin(),times.end());
+    return ret;
+}
+
+string
+fgBenchToJson(const FgBenchResults & results)
+{
+    ostringstream       oss;
+    oss << "{\n\"benchmarks\":[";
+    for (size_t ii=0; ii<results.size(); ++ii) {
+        const FgBenchResult &   rr = results[ii];
+        FGASSERT(rr.name.find_first_of("\"\\") == string::npos);
+        oss << ((ii == 0) ? "\n" : ",\n")
+            << "{\"name\":\"" << rr.name << "\""
+            << ",\"reps\":" << rr.reps
+            << ",\"iters\":" << rr.iters
+            << ",\"median_ns\":" << fgToFixed(rr.median,1)
+            << ",\"mad_ns\":" << fgToFixed(rr.mad,1)
+            << ",\"min_ns\":" << fgToFixed(rr.min,1)
+            << ",\"max_ns\":" << fgToFixed(rr.max,1) << "}";
+    }
+    oss << "\n]\n}\n";
+    return oss.str();
+}
+
+static
+double
+jsonNumber(const string & obj,const string & key)
+{
+    size_t              pos = obj.find("\""+key+"\":");
+    if (pos == string::npos)
+        fgThrow("Benchmark JSON missing field",key);
+    return std::atof(obj.c_str()+pos+key.size()+3);
+}
+
+FgBenchResults
+fgBenchFromJson(const string & json)
+{
+    FgBenchResults      ret;
+    size_t              pos = json.find("{\"name\":\"");
+    while (pos != string::npos) {
+        size_t          end = json.find('}',pos);
+        if (end == string::npos)
+            fgThrow("Benchmark JSON unterminated object");
+        string          obj = json.substr(pos,end-pos);
+        size_t          nameEnd = obj.find('"',9);
+        FgBenchResult   rr;
+        rr.name = obj.substr(9,nameEnd-9);
+        rr.reps = uint(jsonNumber(obj,"reps"));
+        rr.iters = uint64(jsonNumber(obj,"iters"));
+        rr.median = jsonNumber(obj,"median_ns");
+        rr.mad = jsonNumber(obj,"mad_ns");
+        rr.min = jsonNumber(obj,"min_ns");
+        rr.max = jsonNumber(obj,"max_ns");
+        ret.push_back(rr);
+        pos = json.find("{\"name\":\"",end);
+    }
+    return ret;
+}
+
+bool
+fgBenchRegression(const FgBenchResult & curr,const FgBenchResult & base,double threshold)
+{
+    double              diff = curr.median - base.median;
+    return ((diff > base.median * threshold) && (diff > 3.0 * std::max(curr.mad,base.mad)));
+}
+
+static
+void
+spinMs(uint64 ms)
+{
+    uint64              end = fgTimeNs() + ms * 1000000;
+    while (fgTimeNs() < end)
+        ;
+}
+
+static
+FgFunc
+spinSetup(uint64 ms)
+{return FgFunc(boost::bind(spinMs,ms)); }
+
+void
+fgBenchTest(const FgArgs &)
+{
+    // Timing and calibration:
+    FgBenchOptions      opts;
+    opts.reps = 3;
+    opts.warmup = 1;
+    opts.minRepNs = 5000000;
+    FgBenchResult       res = fgBenchRun(FgBench("spin","",boost::bind(spinSetup,2)),opts);
+    FGASSERT((res.iters >= 1) && (res.iters <= 2));
+    FGASSERT(res.median >= 2.0e6);
+    FGASSERT(res.min <= res.median);
+    FGASSERT(res.median <= res.max);
+    // JSON round trip:
+    FgBenchResults      results(1,res);
+    results.push_back(res);
+    results.back().name = "other";
+    results.back().median *= 2.0;
+    FgBenchResults      loaded = fgBenchFromJson(fgBenchToJson(results));
+    FGASSERT(loaded.size() == 2);
+    for (size_t ii=0; ii<loaded.size(); ++ii) {
+        FGASSERT(loaded[ii].name == results[ii].name);
+        FGASSERT(loaded[ii].reps == results[ii].reps);
+        FGASSERT(loaded[ii].iters == results[ii].iters);
+        FGASSERT(std::abs(loaded[ii].median-results[ii].median) <= 0.05);
+        FGASSERT(std::abs(loaded[ii].mad-results[ii].mad) <= 0.05);
+    }
+    // Regression detection:
+    FgBenchResult       base;
+    base.median = 100;
+    base.mad = 2;
+    FgBenchResult       curr = base;
+    curr.median = 104;
+    FGASSERT(!fgBenchRegression(curr,base,0.05));   // Within threshold
+    curr.median = 110;
+    FGASSERT(fgBenchRegression(curr,base,0.05));
+    curr.mad = 5;
+    FGASSERT(!fgBenchRegression(curr,base,0.05));   // Within noise
+    curr.median = 90;
+    FGASSERT(!fgBenchRegression(curr,base,0.05));   // Faster
+}
+
+// */
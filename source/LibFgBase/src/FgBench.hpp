@@ -0,0 +1,84 @@
+//
+// Copyright (c) 2015 Singular Inversions Inc. (facegen.com)
+// Use, modification and distribution is subject to the MIT License,
+// see accompanying file LICENSE.txt or facegen.com/base_library_license.txt
+//
+// Benchmark timing, robust statistics and baseline comparison (see 'fgbl bench').
+//
+// The setup of each benchmark (eg. loading data) is not timed. After the warmup runs, the number
+// of iterations per repetition is chosen so that each repetition is long enough to time reliably.
+// Statistics are then taken over the per-iteration time of each repetition, using the median and
+// median absolute deviation (MAD) since timings have a long upper tail (interrupts, page faults
+// etc.) which makes the mean and standard deviation unreliable.
+//
+
+#ifndef FGBENCH_HPP
+#define FGBENCH_HPP
+
+#include "FgStdLibs.hpp"
+#include "FgTypes.hpp"
+#include "FgStdFunction.hpp"
+#include "FgStdVector.hpp"
+#include "FgStdString.hpp"
+
+struct  FgBench
+{
+    string                      name;
+    string                      description;
+    // Does any setup and returns the function to be timed, which must keep any state it needs:
+    boost::function<FgFunc()>   setup;
+
+    FgBench() {}
+
+    FgBench(const string & n,const string & d,const boost::function<FgFunc()> & s)
+    : name(n), description(d), setup(s)
+    {}
+};
+
+typedef vector<FgBench>     FgBenches;
+
+// Benchmarks of core operations using the 'data/base' assets:
+FgBenches
+fgBenchDefaults();
+
+struct  FgBenchOptions
+{
+    uint            reps;           // Timed repetitions
+    uint            warmup;         // Untimed runs before the repetitions
+    uint64          minRepNs;       // Minimum duration of each repetition
+
+    FgBenchOptions() : reps(10), warmup(2), minRepNs(10000000) {}
+};
+
+struct  FgBenchResult
+{
+    string          name;
+    uint            reps;
+    uint64          iters;          // Iterations per repetition
+    // Nanoseconds per iteration over the repetitions:
+    double          median;
+    double          mad;
+    double          min;
+    double          max;
+
+    FgBenchResult() : reps(0), iters(0), median(0), mad(0), min(0), max(0) {}
+};
+
+typedef vector<FgBenchResult>   FgBenchResults;
+
+FgBenchResult
+fgBenchRun(const FgBench & bench,const FgBenchOptions & options=FgBenchOptions());
+
+string
+fgBenchToJson(const FgBenchResults & results);
+
+// Parses the output of 'fgBenchToJson' (not general JSON):
+FgBenchResults
+fgBenchFromJson(const string & json);
+
+// True if 'curr' is slower than 'base' by more than the fraction 'threshold' and by more than
+// the timing noise (3 times the larger MAD):
+bool
+fgBenchRegression(const FgBenchResult & curr,const FgBenchResult & base,double threshold);
+
+#endif
@@ -12,6 +12,7 @@
 
 #include "FgCommand.hpp"
 
+FgCmd   fgCmdBenchInfo();
 FgCmd   fgCmdImgopsInfo();
 FgCmd   fgCmdMeshopsInfo();
 FgCmd   fgCmdMorphInfo();
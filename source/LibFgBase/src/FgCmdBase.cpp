@@ -29,6 +29,8 @@ fgCmdBaseTests()
     vector<FgCmd>   cmds;
     //FGADDCMD1(fgApproxFuncTest,"approxFunc");
     FGADDCMD1(fg3dTest,"3d");
+    FGADDCMD1(fgAssetCacheTest,"assetCache");
+    FGADDCMD1(fgBenchTest,"bench");
     FGADDCMD1(fgBoostSerializationTest,"boostSerialization");
     FGADDCMD1(fgClusterTest,"cluster");
     FGADDCMD1(fgDepGraphTest,"depGraph");
@@ -42,15 +44,21 @@ fgCmdBaseTests()
     FGADDCMD1(fgMatrixCTest,"matrixC");
     FGADDCMD1(fgMetaFormatTest,"metaFormat");
     FGADDCMD1(fgMorphTest,"morph");
+    FGADDCMD1(fgOutTest,"out");
     FGADDCMD1(fgPathTest,"path");
+    FGADDCMD1(fgProfileTest,"profile");
     FGADDCMD1(fgQuaternionTest,"quaternion");
+    FGADDCMD1(fgRandGenTest,"randGen");
     FGADDCMD1(fgRenderTest,"render");
+    FGADDCMD1(fgRenderBatchTest,"renderBatch");
     FGADDCMD1(fgSerializeTest,"serialize");
+    FGADDCMD1(fgSerializeFastTest,"serializeFast");
     FGADDCMD1(fgSharedPtrTest,"sharedPtr");
     FGADDCMD1(fgSimilarityTest,"similarity");
     FGADDCMD1(fgSimilarityApproxTest,"similarityApprox");
     FGADDCMD1(fgStringTest,"string");
     FGADDCMD1(fgTensorTest,"tensor");
+    FGADDCMD1(fgTextBufTest,"textBuf");
     FGADDCMD1(fgVariantTest,"variant");
     return cmds;
 }
@@ -84,6 +92,7 @@ fgCmdBaseTestms()
     FGADDCMD(fgCmdTestmCpp,"cpp","C++ behaviour tests");
     FGADDCMD1(fg3dReadWobjTest,"readWobj");
     FGADDCMD1(fgRandomTest,"random");
+    FGADDCMD1(fgRenderServerTest,"renderServer");
     FGADDCMD1(fgGeometryManTest,"geometry");
     FGADDCMD1(fgSubdivisionTest,"subdivision");
     FGADDCMD1(fgTextureImageMappingRenderTest,"texturemap");
@@ -110,6 +119,7 @@ fgCmdFgbl(const FgArgs & args)
     if (args.size() == 1)
         fgout << fgnl << "FaceGen Base Library CLI " << fgVersion(".") << " (" << fgCurrentBuildDescription() << ")"; 
     vector<FgCmd>   cmds;
+    cmds.push_back(fgCmdBenchInfo());
     cmds.push_back(fgCmdImgopsInfo());
     cmds.push_back(fgCmdMeshopsInfo());
     cmds.push_back(fgCmdMorphInfo());
@@ -0,0 +1,737 @@
+//
+// Copyright (c) 2015 Singular Inversions Inc. (facegen.com)
+// Use, modification and distribution is subject to the MIT License,
+// see accompanying file LICENSE.txt or facegen.com/base_library_license.txt
+//
+// Benchmarks of core library operations using the 'data/base' assets.
+//
+
+#include "stdafx.h"
+
+#include "FgCmd.hpp"
+#include "FgBench.hpp"
+#include "FgSyntax.hpp"
+#include "FgFileSystem.hpp"
+#include "FgStdStream.hpp"
+#include "FgSerializeFast.hpp"
+#include "FgAssetCache.hpp"
+#include "Fg3dMeshIo.hpp"
+#include "Fg3dCamera.hpp"
+#include "Fg3dTopology.hpp"
+#include "FgSoftRender.hpp"
+#include "FgImageIo.hpp"
+#include "FgImgFormats.hpp"
+#include "FgImgMetrics.hpp"
+#include "FgImgPyramid.hpp"
+#include "FgImgResample.hpp"
+#include "FgImgWarp.hpp"
+#include "FgMatrixV.hpp"
+#include "FgMatrixSolver.hpp"
+#include "FgTensor.hpp"
+#include "FgParse.hpp"
+
+using namespace std;
+
+namespace {
+
+// Each benchmark's state is constructed (untimed) by 'setup' and the 'run' member is timed:
+template<class T>
+FgFunc
+setup()
+{
+    boost::shared_ptr<T>    state(new T);
+    return FgFunc(boost::bind(&T::run,state));
+}
+
+Fg3dMesh
+loadJane()
+{return fgLoadTri(fgDataDir()+"base/Jane.tri",fgDataDir()+"base/Jane.jpg"); }
+
+FgImgRgbaUb
+loadLenna()
+{return fgLoadImgAnyFormat(fgDataDir()+"base/Lenna512.png"); }
+
+struct  Render
+{
+    vector<Fg3dMesh>    meshes;
+    FgVect2UI           pixelSize;
+    Fg3dCamera          cam;
+    FgImgRgbaUb         img;
+
+    Render() : meshes(1,loadJane()), pixelSize(512,512)
+    {cam = Fg3dCameraParams(fgF2D(fgBounds(meshes))).camera(pixelSize); }
+
+    void
+    run()
+    {img = fgSoftRender(pixelSize,meshes,FgLighting(),cam.modelview,cam.itcsToIucs,FgRgbaF(0,0,0,255)); }
+};
+
+struct  LoadTri
+{
+    string              data;
+    Fg3dMesh            mesh;
+
+    LoadTri() : data(fgSlurp(fgDataDir()+"base/Jane.tri")) {}
+
+    void
+    run()
+    {
+        istringstream   iss(data);
+        mesh = fgLoadTri(iss);
+    }
+};
+
+// Cache hit and copy, as when a render request reuses a model:
+struct  LoadTriCached
+{
+    FgAssetCache        cache;
+    Fg3dMesh            mesh;
+
+    void
+    run()
+    {mesh = *cache.mesh(fgDataDir()+"base/Jane.tri"); }
+};
+
+struct  LoadObj
+{
+    FgTestDir           dir;
+    Fg3dMesh            mesh;
+
+    LoadObj() : dir("bench_obj")
+    {
+        Fg3dMesh        jane = fgLoadTri(fgDataDir()+"base/Jane.tri");
+        jane.deltaMorphs.clear();       // Not supported by OBJ
+        jane.targetMorphs.clear();
+        fgSaveObj("Jane.obj",fgSvec(jane));
+    }
+
+    void
+    run()
+    {mesh = fgLoadWobj("Jane.obj"); }
+};
+
+struct  ImgResize
+{
+    FgImgRgbaUb         src;
+    FgImgRgbaUb         dst;
+
+    ImgResize() : src(loadLenna()), dst(300,300) {}
+
+    void
+    run()
+    {fgImgResize(src,dst); }
+};
+
+struct  ImgResample : ImgResize
+{
+    FgImgResampler      resampler;
+
+    explicit
+    ImgResample(FgResampleFilter filter) : resampler(src.dims(),dst.dims(),filter) {}
+
+    void
+    run()
+    {resampler.apply(src,dst); }
+};
+
+struct  ResampleBox : ImgResample
+{
+    ResampleBox() : ImgResample(FgResampleFilter::box) {}
+};
+
+struct  ResampleLanczos : ImgResample
+{
+    ResampleLanczos() : ImgResample(FgResampleFilter::lanczos) {}
+};
+
+struct  ResampleSimple : ImgResize
+{
+    void
+    run()
+    {fgResampleSimple(src,dst); }
+};
+
+// Rotate Lenna about its centre:
+struct  WarpBlerp
+{
+    FgImgRgbaUb         src;
+    FgImgRgbaUb         dst;
+    FgAffine2F          rot;
+
+    WarpBlerp() : src(loadLenna()), dst(src.dims())
+    {
+        FgMat22F        mat = fgMatRotate(0.3f);
+        FgVect2F        ctr = FgVect2F(src.dims()) * 0.5f;
+        rot = FgAffine2F(mat,ctr-mat*ctr);
+    }
+
+    void
+    run()
+    {
+        for (FgIter2UI it(dst.dims()); it.valid(); it.next())
+            fgRound(fgBlerpClipIpcs(src,rot*(FgVect2F(it())+FgVect2F(0.5f))),dst[it()]);
+    }
+};
+
+struct  WarpBilinear : WarpBlerp
+{
+    void
+    run()
+    {fgImgWarp(src,FgWarpMap(dst.dims(),rot),dst); }
+};
+
+struct  WarpBicubic : WarpBlerp
+{
+    void
+    run()
+    {fgImgWarp(src,FgWarpMap(dst.dims(),rot),dst,FgWarpInterp::bicubic); }
+};
+
+struct  WarpPlan : WarpBlerp
+{
+    FgWarpPlan          plan;
+
+    WarpPlan() : plan(src.dims(),FgWarpMap(dst.dims(),rot)) {}
+
+    void
+    run()
+    {plan.apply(src,dst); }
+};
+
+struct  ImgSmooth
+{
+    FgImg3F             src;
+    FgImg3F             dst;
+
+    ImgSmooth() : src(fgImgToF3(loadLenna())) {}
+
+    void
+    run()
+    {fgSmoothFloat(src,dst,1); }
+};
+
+struct  ImgPyramid
+{
+    FgImgRgbaUb         src;
+    FgImgs              pyr;
+
+    ImgPyramid() : src(loadLenna()) {}
+
+    void
+    run()
+    {pyr = fgImgPyramid(src,FgImgPyrFilter::box); }
+};
+
+struct  ImgPyrGauss : ImgPyramid
+{
+    void
+    run()
+    {pyr = fgImgPyramid(src,FgImgPyrFilter::gauss); }
+};
+
+struct  ImgLaplacian
+{
+    FgImg3F             src;
+    FgImg3Fs            lap;
+
+    ImgLaplacian() : src(fgImgToF3(loadLenna())) {}
+
+    void
+    run()
+    {lap = fgImgLaplacian(src); }
+};
+
+// Load Lenna512 RGBA from a TGA file written in setup:
+struct  TgaNative
+{
+    FgTestDir           dir;
+    FgImgRgbaUb         img;
+
+    TgaNative() : dir("bench_tga")
+    {
+        fgSaveTga("Lenna.tga",loadLenna());
+        fgSavePnm("Lenna.ppm",loadLenna());
+    }
+
+    void
+    run()
+    {fgLoadImgAnyFormat("Lenna.tga",img); }
+};
+
+struct  TgaMagick : TgaNative
+{
+    void
+    run()
+    {fgLoadImgMagick("Lenna.tga",img); }
+};
+
+struct  PpmNative : TgaNative
+{
+    void
+    run()
+    {fgLoadImgAnyFormat("Lenna.ppm",img); }
+};
+
+struct  PpmMagick : TgaNative
+{
+    void
+    run()
+    {fgLoadImgMagick("Lenna.ppm",img); }
+};
+
+struct  TgaSave : TgaNative
+{
+    FgImgRgbaUb         src;
+
+    TgaSave() : src(loadLenna()) {}
+
+    void
+    run()
+    {fgSaveImgAnyFormat("save.tga",src); }
+};
+
+struct  TgaSaveMagick : TgaSave
+{
+    void
+    run()
+    {fgSaveImgMagick("save.tga",src); }
+};
+
+// Jane's 2048x2048 texture to a 256x256 preview:
+struct  JpegShrink
+{
+    vector<uchar>       data;
+    FgImgRgbaUb         img;
+
+    JpegShrink()
+    {
+        string          file = fgSlurp(fgDataDir()+"base/Jane.jpg");
+        data.assign(file.begin(),file.end());
+    }
+
+    void
+    run()
+    {
+        fgImgLoadJfif(data,img);
+        for (uint ii=0; ii<3; ++ii)
+            img = fgImgShrink2(img);
+    }
+};
+
+struct  JpegScaled : JpegShrink
+{
+    void
+    run()
+    {fgImgLoadJfif(data,img,8); }
+};
+
+struct  JpegFit : JpegShrink
+{
+    void
+    run()
+    {img = fgImgLoadJfifFit(data,FgVect2UI(200,200)); }
+};
+
+// Lenna against its mirror image:
+struct  ImgDiff
+{
+    FgImgRgbaUb         im0;
+    FgImgRgbaUb         im1;
+    double              rmsd;
+
+    ImgDiff() : im0(loadLenna()), im1(fgFlipHoriz(im0)), rmsd(0) {}
+
+    void
+    run()
+    {rmsd = fgImgDiff(im0,im1).rmsd(); }
+};
+
+struct  ImgDiffScalar : ImgDiff
+{
+    void
+    run()
+    {rmsd = std::sqrt(fgImgSsd(fgImgView(im0),fgImgView(im1)) / double(im0.numPixels())); }
+};
+
+struct  ImgSsim : ImgDiff
+{
+    FgVect4D            ssim;
+
+    void
+    run()
+    {ssim = fgImgSsim(im0,im1); }
+};
+
+struct  ImgHistogram : ImgDiff
+{
+    vector<FgHistogram> hists;
+
+    void
+    run()
+    {hists = fgImgHistogram(im0); }
+};
+
+struct  HistScalar : ImgHistogram
+{
+    void
+    run()
+    {
+        hists.assign(4,FgHistogram(FgVectD2(0,256),256));
+        for (size_t ii=0; ii<im0.numPixels(); ++ii)
+            for (uint cc=0; cc<4; ++cc)
+                hists[cc].addSample(im0[ii].m_c[cc]);
+    }
+};
+
+struct  MatMul
+{
+    FgMatrixD           lhs;
+    FgMatrixD           rhs;
+    FgMatrixD           res;
+
+    MatMul() : lhs(fgMatRandNormal<double>(200,200)), rhs(fgMatRandNormal<double>(200,200)) {}
+
+    void
+    run()
+    {res = lhs * rhs; }
+};
+
+// Rank 4 float tensor of 3.2M elements (13MB) with its axes reversed:
+struct  TensorReorder
+{
+    FgTensor4F          ten;
+    FgTensor4F          res;
+
+    TensorReorder()
+    {
+        ten.m_dims = FgVect4UI(40,50,40,40);
+        ten.m_data.resize(ten.m_dims.volume());
+        for (size_t ii=0; ii<ten.m_data.size(); ++ii)
+            ten.m_data[ii] = float(ii);
+    }
+
+    void
+    run()
+    {res = ten.reorder(FgVect4UI(3,2,1,0)); }
+};
+
+struct  TensorReorderSimple : TensorReorder
+{
+    void
+    run()
+    {res = ten.reorderSimple(FgVect4UI(3,2,1,0)); }
+};
+
+// A multilinear (identity x expression x vertex coordinate) model tensor projected onto new
+// identity axes:
+struct  TensorModeProduct
+{
+    FgTensor3D          ten;
+    FgMatrixD           mat;
+    FgTensor3D          res;
+
+    TensorModeProduct() : mat(fgMatRandNormal<double>(40,80))
+    {
+        ten.m_dims = FgVect3UI(80,30,3000);
+        ten.m_data = fgRandNormals(ten.m_dims.volume());
+    }
+
+    void
+    run()
+    {res = fgModeProduct(ten,0,mat); }
+};
+
+// As above with an element-wise loop:
+struct  TensorModeProductSimple : TensorModeProduct
+{
+    void
+    run()
+    {
+        res.m_dims = FgVect3UI(mat.nrows,ten.m_dims[1],ten.m_dims[2]);
+        res.m_data.assign(res.m_dims.volume(),0.0);
+        for (FgIter3UI it(ten.m_dims); it.valid(); it.next()) {
+            FgVect3UI       crd = it();
+            double          val = ten[crd];
+            for (uint jj=0; jj<mat.nrows; ++jj) {
+                crd[0] = jj;
+                res[crd] += mat.rc(jj,it()[0]) * val;
+            }
+        }
+    }
+};
+
+struct  SymmEigs
+{
+    FgMatrixD           rsm;
+    FgRealEigs          eigs;
+
+    SymmEigs()
+    {
+        FgMatrixD       mat = fgMatRandNormal<double>(100,100);
+        rsm = mat * mat.transpose();
+    }
+
+    void
+    run()
+    {eigs = fgSymmEigs(rsm); }
+};
+
+struct  Topology
+{
+    Fg3dMesh            mesh;
+    vector<FgVect3UI>   tris;
+
+    Topology() : mesh(loadJane()), tris(mesh.getTriEquivs().vertInds) {}
+
+    void
+    run()
+    {Fg3dTopology(mesh.verts,tris); }
+};
+
+struct  TopoCsr
+{
+    Fg3dMesh            mesh;
+    vector<FgVect3UI>   tris;
+
+    TopoCsr() : mesh(loadJane()), tris(mesh.getTriEquivs().vertInds) {}
+
+    void
+    run()
+    {Fg3dTopoCsr(mesh.verts,tris); }
+};
+
+struct  MeshData
+{
+    FgVerts             verts;
+    vector<FgVect3UI>   tris;
+    FgVect2Fs           uvs;
+
+    FG_SERIALIZE3(verts,tris,uvs)
+};
+
+struct  Serialize
+{
+    MeshData            data;
+    MeshData            copy;
+
+    Serialize()
+    {
+        Fg3dMesh        mesh = loadJane();
+        data.verts = mesh.verts;
+        data.tris = mesh.getTriEquivs().vertInds;
+        data.uvs = mesh.uvs;
+    }
+
+    void
+    run()
+    {fgDeserialize(fgSerialize(data),copy); }
+};
+
+struct  SerializeFast : Serialize
+{
+    string              buf;
+
+    void
+    run()
+    {
+        fgSerializeFast(data,buf);
+        fgDeserializeFast(buf,copy);
+    }
+};
+
+// A typical small message (eg. a cluster work request):
+struct  Message
+{
+    string              name;
+    vector<string>      args;
+    uint64              id;
+    FgVect3D            pos;
+
+    FG_SERIALIZE4(name,args,id,pos)
+};
+
+struct  MsgBoost
+{
+    Message             msg;
+    Message             copy;
+
+    MsgBoost()
+    {
+        msg.name = "render";
+        msg.args = fgSplitChar("render batch batch_test 16");
+        msg.id = 12345;
+        msg.pos = FgVect3D(1,2,3);
+    }
+
+    void
+    run()
+    {fgDeserialize(fgSerialize(msg),copy); }
+};
+
+struct  MsgFast : MsgBoost
+{
+    string              buf;
+
+    void
+    run()
+    {
+        fgSerializeFast(msg,buf);
+        fgDeserializeFast(buf,copy);
+    }
+};
+
+}
+
+FgBenches
+fgBenchDefaults()
+{
+    FgBenches           ret;
+    ret.push_back(FgBench("render","Software render textured Jane at 512x512",setup<Render>));
+    ret.push_back(FgBench("loadTri","Parse Jane.tri from memory",setup<LoadTri>));
+    ret.push_back(FgBench("loadTriCached","Jane.tri from FgAssetCache (hit) and copy",setup<LoadTriCached>));
+    ret.push_back(FgBench("loadObj","Load Jane from an OBJ file",setup<LoadObj>));
+    ret.push_back(FgBench("imgResize","Resize Lenna512 RGBA to 300x300",setup<ImgResize>));
+    ret.push_back(FgBench("resampleBox","As imgResize with FgImgResampler box filter",setup<ResampleBox>));
+    ret.push_back(FgBench("resampleLanczos","As imgResize with FgImgResampler Lanczos filter",setup<ResampleLanczos>));
+    ret.push_back(FgBench("resampleSimple","As imgResize with fgResampleSimple",setup<ResampleSimple>));
+    ret.push_back(FgBench("warpBlerp","Rotate Lenna512 RGBA with fgBlerpClipIpcs per pixel",setup<WarpBlerp>));
+    ret.push_back(FgBench("warpBilinear","As above with fgImgWarp bilinear",setup<WarpBilinear>));
+    ret.push_back(FgBench("warpBicubic","As above with fgImgWarp bicubic",setup<WarpBicubic>));
+    ret.push_back(FgBench("warpPlan","As warpBilinear with a precomputed FgWarpPlan",setup<WarpPlan>));
+    ret.push_back(FgBench("imgSmooth","Smooth Lenna512 as 3 channel float",setup<ImgSmooth>));
+    ret.push_back(FgBench("imgPyramid","Box filter pyramid of Lenna512 RGBA",setup<ImgPyramid>));
+    ret.push_back(FgBench("imgPyrGauss","Gaussian pyramid of Lenna512 RGBA",setup<ImgPyrGauss>));
+    ret.push_back(FgBench("imgLaplacian","Laplacian pyramid of Lenna512 as 3 channel float",setup<ImgLaplacian>));
+    ret.push_back(FgBench("tgaLoad","Load Lenna512 RGBA TGA with the native codec",setup<TgaNative>));
+    ret.push_back(FgBench("tgaMagick","As above with ImageMagick",setup<TgaMagick>));
+    ret.push_back(FgBench("ppmLoad","Load Lenna512 PPM with the native codec",setup<PpmNative>));
+    ret.push_back(FgBench("ppmMagick","As above with ImageMagick",setup<PpmMagick>));
+    ret.push_back(FgBench("tgaSave","Save Lenna512 RGBA TGA with the native codec",setup<TgaSave>));
+    ret.push_back(FgBench("tgaSaveMagick","As above with ImageMagick",setup<TgaSaveMagick>));
+    ret.push_back(FgBench("jpegShrink","Decode Jane.jpg (2048x2048) and shrink to 256x256",setup<JpegShrink>));
+    ret.push_back(FgBench("jpegScaled","As above with 1/8 DCT scaled decoding",setup<JpegScaled>));
+    ret.push_back(FgBench("jpegFit","Decode Jane.jpg to fit 200x200",setup<JpegFit>));
+    ret.push_back(FgBench("imgDiff","Per-channel SSD and SAD of Lenna512 RGBA and its mirror",setup<ImgDiff>));
+    ret.push_back(FgBench("imgDiffScalar","As above with the fgImgSsd template",setup<ImgDiffScalar>));
+    ret.push_back(FgBench("imgSsim","Per-channel SSIM of Lenna512 RGBA and its mirror",setup<ImgSsim>));
+    ret.push_back(FgBench("imgHistogram","Per-channel histograms of Lenna512 RGBA",setup<ImgHistogram>));
+    ret.push_back(FgBench("histScalar","As above with FgHistogram::addSample",setup<HistScalar>));
+    ret.push_back(FgBench("matMul","Multiply 200x200 double matrices",setup<MatMul>));
+    ret.push_back(FgBench("tensorReorder","Reverse the axes of a 40x50x40x40 float tensor",setup<TensorReorder>));
+    ret.push_back(FgBench("tensorReorderSimple","As above element-wise",setup<TensorReorderSimple>));
+    ret.push_back(FgBench("tensorModeProduct","Mode 0 product of an 80x30x3000 double tensor with a 40x80 matrix",setup<TensorModeProduct>));
+    ret.push_back(FgBench("tensorModeProductSimple","As above element-wise",setup<TensorModeProductSimple>));
+    ret.push_back(FgBench("symmEigs","Eigensolve 100x100 real symmetric matrix",setup<SymmEigs>));
+    ret.push_back(FgBench("topology","Build Fg3dTopology of Jane",setup<Topology>));
+    ret.push_back(FgBench("topoCsr","Build Fg3dTopoCsr of Jane",setup<TopoCsr>));
+    ret.push_back(FgBench("serialize","Boost binary serialize and deserialize Jane geometry",setup<Serialize>));
+    ret.push_back(FgBench("serializeFast","As above with fgSerializeFast",setup<SerializeFast>));
+    ret.push_back(FgBench("msgBoost","Boost binary serialize and deserialize a small message",setup<MsgBoost>));
+    ret.push_back(FgBench("msgFast","As above with fgSerializeFast",setup<MsgFast>));
+    return ret;
+}
+
+static
+string
+toDuration(double ns)
+{
+    if (ns >= 1.0e6)
+        return fgToFixed(ns * 1.0e-6,3) + " ms";
+    return fgToFixed(ns * 1.0e-3,3) + " us";
+}
+
+static
+void
+bench(const FgArgs & args)
+{
+    FgSyntax            syntax(args,
+        "[-r <reps>] [-w <warmup>] [-o <results>.json] [-b <baseline>.json] [-t <percent>] (all | list | <name>+)\n"
+        "    -r     - Timed repetitions of each benchmark (default 10)\n"
+        "    -w     - Untimed warmup runs of each benchmark (default 2)\n"
+        "    -o     - Save the results in JSON format\n"
+        "    -b     - Compare with results saved by -o and fail if there are any regressions\n"
+        "    -t     - Slowdown (percent) flagged as a regression, if also beyond the timing noise (default 5)\n"
+        "    all    - Run all benchmarks\n"
+        "    list   - List the benchmarks");
+    FgBenchOptions      opts;
+    FgString            outFile,
+                        baseFile;
+    double              threshold = 0.05;
+    while (syntax.peekNext()[0] == '-') {
+        if (syntax.next() == "-r")
+            opts.reps = syntax.nextAs<uint>();
+        else if (syntax.curr() == "-w")
+            opts.warmup = syntax.nextAs<uint>();
+        else if (syntax.curr() == "-o")
+            outFile = syntax.next();
+        else if (syntax.curr() == "-b")
+            baseFile = syntax.next();
+        else if (syntax.curr() == "-t")
+            threshold = syntax.nextAs<uint>() * 0.01;
+        else
+            syntax.error("Unrecognized option",syntax.curr());
+    }
+    if (opts.reps == 0)
+        syntax.error("Repetitions must be at least 1");
+    FgBenches           all = fgBenchDefaults(),
+                        benches;
+    if (syntax.peekNext() == "list") {
+        syntax.next();
+        for (size_t ii=0; ii<all.size(); ++ii)
+            fgout << fgnl << std::left << setw(16) << all[ii].name << all[ii].description;
+        return;
+    }
+    if (syntax.peekNext() == "all") {
+        syntax.next();
+        benches = all;
+    }
+    else {
+        while (syntax.more()) {
+            string          name = syntax.next();
+            size_t          idx = 0;
+            while ((idx < all.size()) && (all[idx].name != name))
+                ++idx;
+            if (idx == all.size())
+                syntax.error("Unknown benchmark",name);
+            benches.push_back(all[idx]);
+        }
+    }
+    FgBenchResults      bases;
+    if (!baseFile.empty())
+        bases = fgBenchFromJson(fgSlurp(baseFile));
+    FgBenchResults      results;
+    vector<string>      regressions;
+    fgout << fgnl << std::left << setw(16) << "Benchmark" << std::right << setw(12) << "iters"
+        << setw(16) << "median" << setw(10) << "MAD %";
+    if (!baseFile.empty())
+        fgout << setw(16) << "baseline" << setw(10) << "change %";
+    for (size_t ii=0; ii<benches.size(); ++ii) {
+        FgBenchResult   res = fgBenchRun(benches[ii],opts);
+        results.push_back(res);
+        fgout << fgnl << std::left << setw(16) << res.name << std::right << setw(12) << res.iters
+            << setw(16) << toDuration(res.median)
+            << setw(10) << fgToFixed(100.0 * res.mad / res.median,1);
+        for (size_t jj=0; jj<bases.size(); ++jj) {
+            if (bases[jj].name == res.name) {
+                fgout << setw(16) << toDuration(bases[jj].median)
+                    << setw(10) << fgToFixed(100.0 * (res.median / bases[jj].median - 1.0),1);
+                if (fgBenchRegression(res,bases[jj],threshold)) {
+                    fgout << "  REGRESSION";
+                    regressions.push_back(res.name);
+                }
+            }
+        }
+    }
+    if (!outFile.empty()) {
+        FgOfstream      ofs(outFile);
+        ofs << fgBenchToJson(results);
+    }
+    if (!regressions.empty())
+        fgThrow("Benchmark regressions",fgCat(regressions," "));
+}
+
+FgCmd
+fgCmdBenchInfo()
+{return FgCmd(bench,"bench","Time library operations with statistics and baseline comparison"); }
+
+// */
@@ -12,6 +12,7 @@
 #include "stdafx.h"
 
 #include "FgCommand.hpp"
+#include "FgAssetCache.hpp"
 #include "FgFileSystem.hpp"
 #include "Fg3dMeshIo.hpp"
 #include "Fg3dCamera.hpp"
@@ -22,6 +23,12 @@
 #include "FgImgDisplay.hpp"
 #include "FgParse.hpp"
 #include "FgTestUtils.hpp"
+#include "FgThread.hpp"
+#include "FgTcp.hpp"
+#include "FgImgFormats.hpp"
+#include "FgRandom.hpp"
+#include "FgPath.hpp"
+#include "FgHex.hpp"
 
 using namespace std;
 
@@ -77,6 +84,514 @@ struct  RenderArgs
     FG_SERIALIZE9(models,cam,lighting,backgroundColor,imagePixelSize,antiAliasBitDepth,showSurfPoints,saveSurfPointFile,outputFile)
 };
 
+struct  RenderView
+{
+    Camera                  cam;
+    FgLighting              lighting;
+    string                  outputFile;
+
+    // Start with no lights since the boost 1.58 XML deserialization bug (see below) appends
+    // to rather than overwrites the lights of each default-constructed element:
+    RenderView()
+    {lighting.m_lights.clear(); }
+
+    FG_SERIALIZE3(cam,lighting,outputFile)
+};
+
+// Many views of the same models. Models are loaded and their normals computed once, then the
+// views are rendered concurrently:
+struct  RenderBatchArgs
+{
+    vector<ModelFiles>      models;
+    vector<RenderView>      views;
+    FgRgbaF                 backgroundColor;
+    FgVect2UI               imagePixelSize;
+    uint                    antiAliasBitDepth;
+    uint                    numThreads;         // 0: one per hardware thread
+
+    RenderBatchArgs() :
+        imagePixelSize(512,512),
+        antiAliasBitDepth(3),
+        numThreads(0)
+    {}
+
+    FG_SERIALIZE6(models,views,backgroundColor,imagePixelSize,antiAliasBitDepth,numThreads)
+};
+
+// Reply of the render server (see 'RenderServer'):
+struct  RenderReply
+{
+    string                  error;      // Empty on success
+    string                  format;     // Extension for the encoded image; "jpg" or "tga"
+    string                  image;      // Encoded image file contents
+
+    FG_SERIALIZE3(error,format,image)
+};
+
+static
+Fg3dMesh
+loadModel(const ModelFiles & mf,const FgMeshCPtr & meshPtr,const FgImgCPtr & imgPtr)
+{
+    Fg3dMesh            mesh = *meshPtr;
+    if (imgPtr)
+        mesh.surfaces[0].setAlbedoMap(*imgPtr);
+    mesh.material.shiny = mf.shiny;
+    return mesh;
+}
+
+static
+vector<Fg3dMesh>
+loadModels(const vector<ModelFiles> & models)
+{
+    vector<Fg3dMesh>    meshes(models.size());
+    for (size_t ii=0; ii<meshes.size(); ++ii) {
+        const ModelFiles &  mf = models[ii];
+        meshes[ii] = loadModel(mf,fgCachedTri(mf.triFilename),
+            mf.imgFilename.empty() ? FgImgCPtr() : fgCachedImg(mf.imgFilename));
+    }
+    return meshes;
+}
+
+// 'bounds' are those of the models after the 'rotateToHcs' rotation:
+static
+Fg3dCamera
+calcCamera(const Camera & cam,FgMat32F bounds,FgVect2UI imagePixelSize)
+{
+    Fg3dCameraParams    cps(fgF2D(bounds));
+    cps.pose =
+        fgRotateY(cam.panRadians) *
+        fgRotateX(cam.tiltRadians) *
+        fgRotateZ(cam.rollRadians);
+    cps.relTrans = cam.relTrans;
+    cps.logRelScale = std::log(cam.relScale);
+    cps.fovMaxDeg = cam.fovMaxDeg;
+    return cps.camera(imagePixelSize);
+}
+
+// 'rot' is applied to the meshes before 'toIpcs':
+static
+void
+paintSurfPoints(FgImgRgbaUb & image,const vector<Fg3dMesh> & meshes,FgMat44F toIpcs,FgMat33F rot)
+{
+    for (size_t mm=0; mm<meshes.size(); ++mm) {
+        const Fg3dMesh &    mesh = meshes[mm];
+        for (size_t ii=0; ii<mesh.surfPointNum(); ++ii) {
+            FgVect4F    p0 = toIpcs * fgAsHomogVec(rot * mesh.surfPointPos(ii));
+            FgVect2F    p1(p0[0]/p0[3],p0[1]/p0[3]);
+            image.paint(FgVect2I(fgFloor(p1)),FgRgbaUB(255,0,0,255));
+        }
+    }
+}
+
+static
+void
+saveImg(const string & fname,const FgImgRgbaUb & img)
+{fgSaveImgAnyFormat(FgString(fname),img); }
+
+static
+void
+queueSave(
+    FgAsyncWorker &                 saver,
+    const vector<RenderView> &      views,
+    size_t                          idx,
+    const FgImgRgbaUb &             img)
+{saver.submit(boost::bind(saveImg,views[idx].outputFile,img)); }
+
+static
+void
+renderBatch(const RenderBatchArgs & args)
+{
+    vector<Fg3dMesh>            meshes = loadModels(args.models);
+    if (meshes.empty())
+        fgThrow("render batch: no models specified");
+    FgSoftRenderMeshes          rms(meshes);
+    vector<FgSoftRenderView>    views;
+    views.reserve(args.views.size());
+    for (size_t vv=0; vv<args.views.size(); ++vv) {
+        const RenderView &      rv = args.views[vv];
+        if (rv.outputFile.empty())
+            fgThrow("render batch: missing output file for view",fgToString(vv));
+        FgQuaternionD           rotQ = rv.cam.rotateToHcs;
+        if (!rotQ.normalize())
+            fgThrow("rotateToHcs: quaternion cannot be zero magnitude",fgToString(vv));
+        // Rather than transforming the meshes for each view, the rotation is put into the
+        // modelview. Only the bounds (for automatic framing) need the rotated vertices:
+        FgMat33F                rot = FgMat33F(rotQ.asMatrix());
+        FgMat32F                bounds = fgBounds(rot * meshes[0].verts);
+        for (size_t mm=1; mm<meshes.size(); ++mm)
+            bounds = fgBounds(bounds,fgBounds(rot * meshes[mm].verts));
+        Fg3dCamera              cam = calcCamera(rv.cam,bounds,args.imagePixelSize);
+        views.push_back(FgSoftRenderView(
+            cam.modelview * FgAffine3D(rotQ.asMatrix()),
+            cam.itcsToIucs,
+            rv.lighting));
+    }
+    FgTimer                     timer;
+    FgAsyncWorker               saver;
+    fgSoftRenderBatch(
+        args.imagePixelSize,
+        rms,
+        views,
+        args.backgroundColor,
+        args.antiAliasBitDepth,
+        boost::bind(queueSave,boost::ref(saver),boost::cref(args.views),_1,_2),
+        args.numThreads);
+    saver.finish();
+    fgout << fgnl << "Rendered and saved " << views.size() << " views in " << timer.read() << "s ";
+}
+
+static
+void
+cmdRenderBatch(FgSyntax & syntax)
+{
+    string          renderName = syntax.next();
+    RenderBatchArgs args;
+    if (syntax.more()) {
+        uint        numViews = syntax.nextAs<uint>();
+        if (numViews == 0)
+            syntax.error("<numViews> must be at least 1");
+        while (syntax.more()) {
+            ModelFiles  mf;
+            mf.triFilename = syntax.next();
+            if (syntax.more())
+                mf.imgFilename = syntax.next();
+            args.models.push_back(mf);
+        }
+        // Default to a turntable of views covering a half circle centred on the front:
+        for (uint vv=0; vv<numViews; ++vv) {
+            RenderView  rv;
+            if (numViews > 1)
+                rv.cam.panRadians = (double(vv)/double(numViews-1) - 0.5) * fgPi();
+            rv.lighting = FgLighting();
+            rv.outputFile = renderName + "_" + fgToStringDigits(vv,3) + ".png";
+            args.views.push_back(rv);
+        }
+        fgSaveXml(renderName+".xml",args);
+    }
+    else {
+        // boost 1.58 XML deserialization bug on older compilers; see 'fgCmdRender':
+        args.views.clear();
+        fgLoadXml(renderName+".xml",args);
+    }
+    renderBatch(args);
+}
+
+// Persistent render service. Each request is a serialized 'RenderArgs' and is answered with a
+// serialized 'RenderReply' holding the image encoded as JFIF if 'outputFile' has a JPEG extension,
+// or as lossless TGA otherwise. Model and image file names are relative to 'root' and can't lead
+// outside it. 'saveSurfPointFile' is ignored. Requests are rendered concurrently.
+// Meshes and images stay loaded in the asset cache, and the most recently used model sets are
+// kept with their normals and triangulation computed. The ray caster acceleration structure
+// depends on the view so is still built for each request:
+struct  RenderServer
+{
+    struct  Models
+    {
+        vector<FgMeshCPtr>      meshPtrs;   // The cached assets these were made from
+        vector<FgImgCPtr>       imgPtrs;
+        vector<Fg3dMesh>        meshes;
+        FgSoftRenderMeshes      rms;        // Refers to 'meshes'
+    };
+    typedef boost::shared_ptr<const Models>         ModelsCPtr;
+    typedef list<pair<string,ModelsCPtr> >          ModelsList;
+
+    boost::mutex            mtx;            // Guards 'models'
+    ModelsList              models;         // Keyed by serialized 'ModelFiles', most recent first
+    size_t                  maxModels;
+    string                  root;           // Directory, ends with a delimiter
+    // Must accompany a stop request so that clients can't stop the server for each other.
+    // Only the process running the server knows it, unless it's given out (eg. 'render serve'
+    // prints it):
+    string                  stopToken;
+
+    explicit
+    RenderServer(const string & rootDir);
+
+    // Returns true if 'request' is a stop request. Throws if its token is wrong:
+    bool
+    isStop(const string & request) const;
+
+    // Returns the serialized reply. MT safe:
+    string
+    render(const string & request);
+
+private:
+    ModelsCPtr
+    getModels(const vector<ModelFiles> & mfs);
+};
+
+// Sent in place of a serialized 'RenderArgs', followed by the stop token, to stop the server:
+static const string renderServerStop = "FG_RENDER_SERVER_STOP ";
+
+RenderServer::RenderServer(const string & rootDir) : maxModels(8), root(fgAsDirectory(rootDir))
+{
+    // Unpredictable rather than repeatable so the global generator isn't used:
+    FgRandGen           gen(fgTimeNs(),uint64(size_t(this)));
+    for (uint ii=0; ii<2; ++ii)
+        stopToken += fgAsHex(gen.uint64_());
+}
+
+bool
+RenderServer::isStop(const string & request) const
+{
+    if (!fgStartsWith(request,renderServerStop))
+        return false;
+    if (request.substr(renderServerStop.size()) != stopToken)
+        fgThrow("render server: invalid stop token");
+    return true;
+}
+
+// Returns the path of 'name' in the server root directory. Absolute names and names with '..'
+// are rejected so requests can only load files within the root:
+static
+string
+rootedPath(const string & root,const string & name)
+{
+    FgPath              path(name);
+    if (name.empty() || path.root || !path.drive.empty() || (name.find(':') != string::npos))
+        fgThrow("render server: file name must be relative to the server root",name);
+    FgStrs              parts = fgSplitChar(fgReplace(name,'\\','/'),'/');
+    for (size_t ii=0; ii<parts.size(); ++ii)
+        if (parts[ii] == "..")
+            fgThrow("render server: file name must be within the server root",name);
+    return root + name;
+}
+
+RenderServer::ModelsCPtr
+RenderServer::getModels(const vector<ModelFiles> & mfs)
+{
+    // Asset cache hits are cheap and tell us whether any of the files have changed:
+    vector<FgMeshCPtr>      meshPtrs(mfs.size());
+    vector<FgImgCPtr>       imgPtrs(mfs.size());
+    for (size_t ii=0; ii<mfs.size(); ++ii) {
+        meshPtrs[ii] = fgCachedTri(mfs[ii].triFilename);
+        if (!mfs[ii].imgFilename.empty())
+            imgPtrs[ii] = fgCachedImg(mfs[ii].imgFilename);
+    }
+    string                  key = fgSerialize(mfs);
+    {
+        boost::lock_guard<boost::mutex>     lock(mtx);
+        for (ModelsList::iterator it=models.begin(); it!=models.end(); ++it) {
+            if (it->first == key) {
+                if ((it->second->meshPtrs == meshPtrs) && (it->second->imgPtrs == imgPtrs)) {
+                    models.splice(models.begin(),models,it);
+                    return it->second;
+                }
+                models.erase(it);
+                break;
+            }
+        }
+    }
+    // Prepare without holding the lock so other requests aren't held up. Concurrent first
+    // requests for the same models each prepare them:
+    boost::shared_ptr<Models>   ret = boost::make_shared<Models>();
+    ret->meshPtrs = meshPtrs;
+    ret->imgPtrs = imgPtrs;
+    ret->meshes.resize(mfs.size());
+    for (size_t ii=0; ii<mfs.size(); ++ii)
+        ret->meshes[ii] = loadModel(mfs[ii],meshPtrs[ii],imgPtrs[ii]);
+    ret->rms = FgSoftRenderMeshes(ret->meshes);
+    boost::lock_guard<boost::mutex>     lock(mtx);
+    models.push_front(make_pair(key,ret));
+    if (models.size() > maxModels)
+        models.pop_back();
+    return ret;
+}
+
+string
+RenderServer::render(const string & request)
+{
+    RenderReply             reply;
+    try {
+        RenderArgs          args;
+        args.lighting.m_lights.clear();     // See 'fgCmdRender'
+        fgDeserialize(request,args);
+        if (args.models.empty())
+            fgThrow("render server: no models specified");
+        for (size_t ii=0; ii<args.models.size(); ++ii) {
+            ModelFiles &    mf = args.models[ii];
+            mf.triFilename = rootedPath(root,mf.triFilename);
+            if (!mf.imgFilename.empty())
+                mf.imgFilename = rootedPath(root,mf.imgFilename);
+        }
+        FgQuaternionD       rotQ = args.cam.rotateToHcs;
+        if (!rotQ.normalize())
+            fgThrow("rotateToHcs: quaternion cannot be zero magnitude");
+        ModelsCPtr          mdls = getModels(args.models);
+        const vector<Fg3dMesh> & meshes = mdls->meshes;
+        // As for 'renderBatch' the rotation is put into the modelview:
+        FgMat33F            rot = FgMat33F(rotQ.asMatrix());
+        FgMat32F            bounds = fgBounds(rot * meshes[0].verts);
+        for (size_t mm=1; mm<meshes.size(); ++mm)
+            bounds = fgBounds(bounds,fgBounds(rot * meshes[mm].verts));
+        Fg3dCamera          cam = calcCamera(args.cam,bounds,args.imagePixelSize);
+        FgImgRgbaUb         image =
+            fgSoftRender(
+                args.imagePixelSize,
+                mdls->rms,
+                args.lighting,
+                cam.modelview * FgAffine3D(rotQ.asMatrix()),
+                cam.itcsToIucs,
+                args.backgroundColor,
+                args.antiAliasBitDepth);
+        if (args.showSurfPoints)
+            paintSurfPoints(image,meshes,FgMat44F(cam.toIpcsH(args.imagePixelSize)),rot);
+        vector<uchar>       encoded;
+        string              ext = fgToLower(fgPathToExt(args.outputFile));
+        if ((ext == "jpg") || (ext == "jpeg")) {
+            reply.format = "jpg";
+            fgImgSaveJfif(image,encoded);
+        }
+        else {
+            reply.format = "tga";
+            fgSaveTga(encoded,image,true);
+        }
+        reply.image.assign(encoded.begin(),encoded.end());
+    }
+    catch (FgException const & e) {
+        reply = RenderReply();
+        reply.error = e.no_tr_message().m_str;
+    }
+    catch (std::exception const & e) {
+        reply = RenderReply();
+        reply.error = e.what();
+    }
+    return fgSerialize(reply);
+}
+
+// Requests are small, this only guards against junk:
+static const size_t renderServerMaxRecvBytes = 1 << 20;
+
+// Renders of large models on a busy server can take well beyond the default TCP client timeout:
+static const uint renderClientTimeoutMs = 10 * 60 * 1000;
+
+static
+bool
+serveRender(RenderServer & server,const string &,const string & request,string & response)
+{
+    try {
+        if (server.isStop(request))
+            return false;
+    }
+    catch (FgException const & e) {
+        RenderReply         reply;
+        reply.error = e.no_tr_message().m_str;
+        response = fgSerialize(reply);
+        return true;
+    }
+    response = server.render(request);
+    return true;
+}
+
+static
+void
+runRenderServer(RenderServer & server,uint16 port,uint numThreads,bool external)
+{
+    fgTcpServerConcurrent(port,
+        boost::bind(serveRender,boost::ref(server),_1,_2,_3),
+        renderServerMaxRecvBytes,
+        numThreads,
+        external);
+}
+
+// Returns false if unable to connect to the server or the connection fails before the reply
+// is received. Server errors are returned in the reply:
+static
+bool
+requestRender(const string & host,uint16 port,const RenderArgs & args,RenderReply & reply)
+{
+    string              response;
+    if (!fgTcpClient(host,port,fgSerialize(args),response,renderClientTimeoutMs))
+        return false;
+    if (response.empty())
+        fgThrow("render client: no response from server",host+":"+fgToString(port));
+    fgDeserialize(response,reply);
+    return true;
+}
+
+static
+FgImgRgbaUb
+decodeReply(const RenderReply & reply)
+{
+    FgImgRgbaUb         img;
+    const uchar *       data = reinterpret_cast<const uchar *>(reply.image.data());
+    if (reply.format == "jpg")
+        fgImgLoadJfif(vector<uchar>(data,data+reply.image.size()),img);
+    else if ((reply.format != "tga") || !fgLoadTga(data,reply.image.size(),img))
+        fgThrow("render client: unsupported reply image format",reply.format);
+    return img;
+}
+
+static
+void
+cmdRenderServe(FgSyntax & syntax)
+{
+    bool                external = false;
+    string              root = fgGetCurrentDir().as_utf8_string();
+    while (syntax.peekNext()[0] == '-') {
+        if (syntax.next() == "-x")
+            external = true;
+        else if (syntax.curr() == "-r")
+            root = syntax.next();
+        else
+            syntax.error("Unrecognized option",syntax.curr());
+    }
+    if (!fgExists(root))
+        syntax.error("Root directory not found",root);
+    uint                port = syntax.nextAs<uint>(),
+                        numThreads = 0;
+    if ((port == 0) || (port > 65535))
+        syntax.error("Invalid <port>",fgToString(port));
+    if (syntax.more())
+        numThreads = syntax.nextAs<uint>();
+    RenderServer        server(root);
+    fgout << fgnl << "Render server stop token: " << server.stopToken
+        << fgnl << "Render server for " << server.root << " listening on "
+        << (external ? "all interfaces" : "loopback") << " port " << port << " with "
+        << fgNumThreads(numThreads) << " threads ... " << std::flush;
+    runRenderServer(server,uint16(port),numThreads,external);
+    fgout << fgnl << "Render server stopped. Asset cache " << fgAssetCache().stats();
+}
+
+static
+void
+cmdRenderClient(FgSyntax & syntax,bool stop)
+{
+    string              host = syntax.next();
+    uint                port = syntax.nextAs<uint>();
+    if ((port == 0) || (port > 65535))
+        syntax.error("Invalid <port>",fgToString(port));
+    if (stop) {
+        string          response;
+        if (!fgTcpClient(host,uint16(port),renderServerStop+syntax.next(),response))
+            fgThrow("render client: unable to connect to server",host+":"+fgToString(port));
+        // The server only responds if it's not stopping:
+        if (!response.empty()) {
+            RenderReply     reply;
+            fgDeserialize(response,reply);
+            fgThrow("render server error",reply.error);
+        }
+        return;
+    }
+    string              renderName = syntax.next();
+    RenderArgs          args;
+    args.lighting.m_lights.clear();     // See 'fgCmdRender'
+    fgLoadXml(renderName+".xml",args);
+    RenderReply         reply;
+    FgTimer             timer;
+    if (!requestRender(host,uint16(port),args,reply))
+        fgThrow("render client: connection to server failed",host+":"+fgToString(port));
+    if (!reply.error.empty())
+        fgThrow("render server error",reply.error);
+    fgout << fgnl << "Remote render time: " << timer.read() << "s ";
+    // Save the encoded image as is if it's already in the requested format:
+    string              ext = fgToLower(fgPathToExt(args.outputFile));
+    if ((ext == reply.format) || ((ext == "jpeg") && (reply.format == "jpg")))
+        fgDump(reply.image,args.outputFile);
+    else
+        fgSaveImgAnyFormat(FgString(args.outputFile),decodeReply(reply));
+}
+
 /**
    \ingroup Base_Commands
    Command to render a mesh and colour map to an image.
@@ -90,8 +605,39 @@ fgCmdRender(const FgArgs & args)
         "    Saves render arguments to <name>.xml and rendered image to <name>.png\n"
         "    <ext1>     - " + fgImgCommonFormatsDescription() + "\n"
         "render <name>\n"
-        "    Render using the arguments in <name>.xml (including the output image file name and type)");
+        "    Render using the arguments in <name>.xml (including the output image file name and type)\n"
+        "render batch <name> <numViews> (<mesh>.tri [<image>.<ext1>])+\n"
+        "    Render <numViews> views around the specified meshes [with texture images], rendering the views\n"
+        "    concurrently. Saves batch arguments to <name>.xml and rendered images to <name>_NNN.png\n"
+        "render batch <name>\n"
+        "    Render all views (cameras, lighting, output files) specified in <name>.xml\n"
+        "render serve [-x] [-r <dir>] <port> [<numThreads>]\n"
+        "    Run a render server which keeps models loaded between requests and renders requests\n"
+        "    concurrently (default one thread per hardware thread). File names in requests are\n"
+        "    relative to the server's root directory and can't lead outside it. Prints the token\n"
+        "    needed to stop the server\n"
+        "    -x         - Accept connections from other machines (default only from this machine)\n"
+        "    -r         - Root directory (default the working directory)\n"
+        "render client <host> <port> <name>\n"
+        "    Render using the arguments in <name>.xml on the given render server\n"
+        "render stop <host> <port> <token>\n"
+        "    Stop the given render server after it completes any requests in progress. <token> is\n"
+        "    the stop token printed by the server");
 
+    if (syntax.peekNext() == "batch") {
+        syntax.next();
+        cmdRenderBatch(syntax);
+        return;
+    }
+    if (syntax.peekNext() == "serve") {
+        syntax.next();
+        cmdRenderServe(syntax);
+        return;
+    }
+    if ((syntax.peekNext() == "client") || (syntax.peekNext() == "stop")) {
+        cmdRenderClient(syntax,(syntax.next() == "stop"));
+        return;
+    }
     string          renderName = syntax.next();
     RenderArgs      renderArgs;
     if (syntax.more()) {
@@ -116,28 +662,13 @@ fgCmdRender(const FgArgs & args)
     }
 
     //! Load data from files:
-    vector<Fg3dMesh>    meshes(renderArgs.models.size());
+    vector<Fg3dMesh>    meshes = loadModels(renderArgs.models);
     FgMat33F            rotMatrix = FgMat33F(renderArgs.cam.rotateToHcs.asMatrix());
-    for (size_t ii=0; ii<meshes.size(); ++ii) {
-        const ModelFiles &  mf = renderArgs.models[ii];
-        meshes[ii] = fgLoadTri(mf.triFilename);
-        if (!mf.imgFilename.empty())
-            fgLoadImgAnyFormat(FgString(mf.imgFilename),meshes[ii].surfaces[0].albedoMapRef());
+    for (size_t ii=0; ii<meshes.size(); ++ii)
         meshes[ii].transform(rotMatrix);
-        meshes[ii].material.shiny = mf.shiny;
-    }
 
     //! Calculate view transforms:
-    FgMat32F            bounds = fgBounds(meshes);
-    Fg3dCameraParams    cps(fgF2D(bounds));
-    cps.pose =
-        fgRotateY(renderArgs.cam.panRadians) *
-        fgRotateX(renderArgs.cam.tiltRadians) *
-        fgRotateZ(renderArgs.cam.rollRadians);
-    cps.relTrans = renderArgs.cam.relTrans;
-    cps.logRelScale = std::log(renderArgs.cam.relScale);
-    cps.fovMaxDeg = renderArgs.cam.fovMaxDeg;
-    Fg3dCamera          cam = cps.camera(renderArgs.imagePixelSize);
+    Fg3dCamera          cam = calcCamera(renderArgs.cam,fgBounds(meshes),renderArgs.imagePixelSize);
     FgAffine3F          mvm(cam.modelview);
 
     //! Render:
@@ -151,17 +682,8 @@ fgCmdRender(const FgArgs & args)
             cam.itcsToIucs,
             renderArgs.backgroundColor,
             renderArgs.antiAliasBitDepth);
-    if (renderArgs.showSurfPoints) {
-        FgMat44F     tt = FgMat44F(cam.toIpcsH(renderArgs.imagePixelSize));
-        for (size_t mm=0; mm<meshes.size(); ++mm) {
-            const Fg3dMesh &    mesh = meshes[mm];
-            for (size_t ii=0; ii<mesh.surfPointNum(); ++ii) {
-                FgVect4F    p0 = tt * fgAsHomogVec(mesh.surfPointPos(ii));
-                FgVect2F    p1(p0[0]/p0[3],p0[1]/p0[3]);
-                image.paint(FgVect2I(fgFloor(p1)),FgRgbaUB(255,0,0,255));
-            }
-        }
-    }
+    if (renderArgs.showSurfPoints)
+        paintSurfPoints(image,meshes,FgMat44F(cam.toIpcsH(renderArgs.imagePixelSize)),FgMat33F::identity());
     fgout << fgnl << "Render time: " << timer.read() << "s ";
     fgSaveImgAnyFormat(FgString(renderArgs.outputFile),image);
     if (renderArgs.saveSurfPointFile) {
@@ -241,3 +763,176 @@ fgRenderTest(const FgArgs & args)
         fgThrow("Render test regression failure");
     }
 }
+
+void
+fgRenderBatchTest(const FgArgs & args)
+{
+    FGTESTDIR
+    fgTestCopy("base/Jane.tri");
+    fgTestCopy("base/Jane.jpg");
+    ModelFiles          mf;
+    mf.triFilename = "Jane.tri";
+    mf.imgFilename = "Jane.jpg";
+    RenderBatchArgs     rba;
+    rba.models.push_back(mf);
+    rba.imagePixelSize = FgVect2UI(120,160);
+    rba.numThreads = 2;
+    for (uint vv=0; vv<3; ++vv) {
+        RenderView      rv;
+        rv.cam.panRadians = fgDegToRad(-40.0 + 40.0 * vv);
+        rv.lighting = FgLighting();
+        rv.outputFile = "batch_" + fgToString(vv) + ".png";
+        rba.views.push_back(rv);
+    }
+    // Exercise the modelview rotation path:
+    rba.views[2].cam.rotateToHcs = FgQuaternionD(0.3,1,0,0);
+    fgSaveXml("batch_test.xml",rba);
+    fgCmdRender(fgSplitChar("render batch batch_test"));
+    // Each batch view must match the equivalent single render:
+    for (size_t vv=0; vv<rba.views.size(); ++vv) {
+        RenderArgs      ra;
+        ra.models = rba.models;
+        ra.cam = rba.views[vv].cam;
+        ra.imagePixelSize = rba.imagePixelSize;
+        ra.outputFile = "single_" + fgToString(vv) + ".png";
+        fgSaveXml("single_test.xml",ra);
+        fgCmdRender(fgSplitChar("render single_test"));
+        FgImgRgbaUb     single,batch;
+        fgLoadImgAnyFormat(ra.outputFile,single);
+        fgLoadImgAnyFormat(rba.views[vv].outputFile,batch);
+        if (fgImgMad(single,batch) > 0.1)
+            fgThrow("Batch render differs from single render for view",fgToString(vv));
+    }
+}
+
+static
+void
+runTestServer(RenderServer & server,uint16 port,string & error)
+{
+    try {
+        runRenderServer(server,port,0,false);
+    }
+    catch (FgException const & e) {
+        error = e.no_tr_message().m_str;
+    }
+    catch (std::exception const & e) {
+        error = e.what();
+    }
+}
+
+// Stops the server and waits for it on scope exit, including on test failure:
+struct  TestRenderServer
+{
+    uint16              port;
+    string              error;
+    RenderServer        server;         // Root is the working directory
+    boost::thread       thread;
+
+    explicit
+    TestRenderServer(uint16 p) :
+        port(p),
+        server(fgGetCurrentDir().as_utf8_string()),
+        thread(boost::bind(runTestServer,boost::ref(server),p,boost::ref(error)))
+    {}
+
+    ~TestRenderServer()
+    {stop(); }
+
+    void
+    stop()
+    {
+        if (thread.joinable()) {
+            fgTcpClient("127.0.0.1",port,renderServerStop+server.stopToken);
+            thread.join();
+        }
+    }
+};
+
+static
+void
+requestTestRender(uint16 port,const vector<RenderArgs> & requests,vector<RenderReply> & replies,size_t idx)
+{
+    const RenderArgs &  args = requests[idx % requests.size()];
+    if (!requestRender("127.0.0.1",port,args,replies[idx]))
+        replies[idx].error = "unable to connect";
+}
+
+void
+fgRenderServerTest(const FgArgs & args)
+{
+    FGTESTDIR
+    fgTestCopy("base/Jane.tri");
+    fgTestCopy("base/Jane.jpg");
+    const uint16        port = fgTcpFreePort();
+    ModelFiles          mf;
+    mf.triFilename = "Jane.tri";
+    mf.imgFilename = "Jane.jpg";
+    vector<RenderArgs>  views(4);
+    for (size_t vv=0; vv<views.size(); ++vv) {
+        RenderArgs &    ra = views[vv];
+        ra.models.push_back(mf);
+        ra.imagePixelSize = FgVect2UI(120,160);
+        ra.cam.panRadians = fgDegToRad(-45.0 + 30.0 * vv);
+        ra.outputFile = "view_" + fgToString(vv) + ".png";
+    }
+    views[3].cam.rotateToHcs = FgQuaternionD(0.3,1,0,0);    // Exercise the modelview rotation
+    TestRenderServer    server(port);
+    // The server may not be listening yet:
+    RenderReply         reply;
+    FgTimer             timer;
+    while (!requestRender("127.0.0.1",port,views[0],reply)) {
+        if (timer.read() > 5.0)
+            fgThrow("render server test: unable to connect to server",server.error);
+        boost::this_thread::yield();
+    }
+    // Each view must match the equivalent local render:
+    for (size_t vv=0; vv<views.size(); ++vv) {
+        if (!requestRender("127.0.0.1",port,views[vv],reply) || !reply.error.empty())
+            fgThrow("render server test: request failed",reply.error);
+        fgSaveXml("single_test.xml",views[vv]);
+        fgCmdRender(fgSplitChar("render single_test"));
+        FgImgRgbaUb     local;
+        fgLoadImgAnyFormat(views[vv].outputFile,local);
+        if (fgImgMad(decodeReply(reply),local) > 0.1)
+            fgThrow("render server test: served render differs from local render for view",fgToString(vv));
+    }
+    // JPEG encoding and server side errors:
+    RenderArgs          ra = views[0];
+    ra.outputFile = "view.jpg";
+    if (!requestRender("127.0.0.1",port,ra,reply) || (reply.format != "jpg") ||
+        (decodeReply(reply).dims() != ra.imagePixelSize))
+        fgThrow("render server test: JPEG request failed",reply.error);
+    ra.models[0].triFilename = "Missing.tri";
+    if (!requestRender("127.0.0.1",port,ra,reply) || reply.error.empty())
+        fgThrow("render server test: missing model not reported");
+    // Files outside the server root:
+    const char *        outside[] = {"../Jane.tri","sub/../../Jane.tri","/etc/hosts","C:\\Jane.tri"};
+    for (size_t ii=0; ii<4; ++ii) {
+        ra.models[0].triFilename = outside[ii];
+        if (!requestRender("127.0.0.1",port,ra,reply) || reply.error.empty())
+            fgThrow("render server test: file outside root not rejected",outside[ii]);
+    }
+    // Stop requests without the right token are refused (the server is still used below):
+    string              response;
+    if (!fgTcpClient("127.0.0.1",port,renderServerStop+"0123",response) || response.empty())
+        fgThrow("render server test: stop request with wrong token not refused");
+    // Throughput with concurrent clients, each reply checked against the serial one:
+    vector<RenderReply> serial(views.size());
+    for (size_t vv=0; vv<views.size(); ++vv)
+        requestTestRender(port,views,serial,vv);
+    size_t              numRequests = 64;
+    vector<RenderReply> replies(numRequests);
+    timer.start();
+    fgParallelFor(numRequests,boost::bind(requestTestRender,port,boost::cref(views),boost::ref(replies),_1),8);
+    double              time = timer.read();
+    for (size_t ii=0; ii<numRequests; ++ii) {
+        const RenderReply & rr = replies[ii];
+        if (!rr.error.empty() || (rr.image != serial[ii % views.size()].image))
+            fgThrow("render server test: concurrent request failed",fgToString(ii)+": "+rr.error);
+    }
+    fgout << fgnl << numRequests << " concurrent loopback requests: " << numRequests / time
+        << " renders/s (" << 1000.0 * time / numRequests << "ms each)";
+    server.stop();
+    if (!server.error.empty())
+        fgThrow("render server test: server failed",server.error);
+}
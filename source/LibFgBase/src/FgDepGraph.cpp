@@ -12,6 +12,7 @@
 #include "FgStdString.hpp"
 #include "FgOut.hpp"
 #include "FgDepGraph.hpp"
+#include "FgProfile.hpp"
 #include "FgStdVector.hpp"
 #include "FgDefaultVal.hpp"
 #include "FgTime.hpp"
@@ -65,6 +66,7 @@ FgDepGraph::executeLink(
     uint    linkInd)
     const
 {
+    FG_PROFILE_SCOPE("FgDepGraph::executeLink");
     // We can only get here if the link is ready for calculation:
     const vector<uint> & sources = m_linkGraph.linkSources(linkInd);
     for (size_t ii=0; ii<sources.size(); ii++)
@@ -110,6 +112,7 @@ FgDepGraph::dirtyLink(uint linkInd)
 void
 FgDepGraph::updateNode(uint nodeIdx) const
 {
+    FG_PROFILE_SCOPE("FgDepGraph::updateNode");
     Update          update;
     vector<Sync>    linksSync(m_linkGraph.numLinks());
     // Traverse to find dirty leaves and set up scheduling on dirty non-leaves
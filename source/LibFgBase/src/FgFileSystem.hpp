@@ -168,6 +168,23 @@ fgFileReadable(const FgString & filename);
 std::string
 fgSlurp(FgString const & filename);
 
+// Read-only memory map of an entire file, for parsing large files without copying them:
+struct  FgFileMap
+{
+    const uchar *   data;       // NULL if the file is empty
+    size_t          size;       // Bytes
+
+    // Throws if the file cannot be opened or mapped:
+    explicit
+    FgFileMap(const FgString & fname);
+
+    ~FgFileMap();
+
+private:
+    FgFileMap(const FgFileMap &);               // Not copyable
+    void operator=(const FgFileMap &);
+};
+
 void
 fgDump(
     const std::string & data,
@@ -12,6 +12,7 @@
 #include "FgGeometry.hpp"
 #include "FgStdVector.hpp"
 #include "FgMatrixSolver.hpp"
+#include "FgBounds.hpp"
 
 using namespace std;
 
@@ -88,12 +89,18 @@ fgClosestPointInTri(
                 clipb0 = fgDot(clipn0,(p1ls > p0ls) ? v1 : v0),
                 clipb1 = fgDot(clipn1,(p2ls > p1ls) ? v2 : v1),
                 clipb2 = fgDot(clipn2,(p0ls > p2ls) ? v0 : v2);
-    if (clipb0 > 0.0)
-        return fgClosestPointInSegment(v0,v1);
-    if (clipb1 > 0.0)
-        return fgClosestPointInSegment(v1,v2);
-    if (clipb2 > 0.0)
-        return fgClosestPointInSegment(v2,v0);
+    // Outside the tri, the closest point may be on any edge (eg. outside two edges adjacent
+    // to an obtuse corner):
+    if ((clipb0 > 0.0) || (clipb1 > 0.0) || (clipb2 > 0.0)) {
+        FgVecMag    ret = fgClosestPointInSegment(v0,v1),
+                    r12 = fgClosestPointInSegment(v1,v2),
+                    r20 = fgClosestPointInSegment(v2,v0);
+        if (r12.mag < ret.mag)
+            ret = r12;
+        if (r20.mag < ret.mag)
+            ret = r20;
+        return ret;
+    }
     double      dot = fgDot(norm,v0),
                 dmag = dot / normLensqr;
     FgVecMag    ret;
@@ -102,6 +109,81 @@ fgClosestPointInTri(
     return ret;
 }
     
+// Parameter in [0,1] of the closest point to 'p' on segment 'a' to 'b':
+static
+double
+closestSegmentParam(FgVect3D p,FgVect3D a,FgVect3D b)
+{
+    FgVect3D    ab = b - a;
+    double      lenSqr = ab.mag();
+    if (lenSqr == 0.0)
+        return 0.0;
+    return fgClip(fgDot(p-a,ab) / lenSqr,0.0,1.0);
+}
+
+// Uses the Voronoi region tests from [Ericson 05] 5.1.5:
+FgVect3D
+fgClosestBarycentricInTri(
+    FgVect3D    p,
+    FgVect3D    a,
+    FgVect3D    b,
+    FgVect3D    c)
+{
+    FgVect3D    ab = b - a,
+                ac = c - a,
+                ap = p - a;
+    double      d1 = fgDot(ab,ap),
+                d2 = fgDot(ac,ap);
+    if ((d1 <= 0.0) && (d2 <= 0.0))
+        return FgVect3D(1,0,0);
+    FgVect3D    bp = p - b;
+    double      d3 = fgDot(ab,bp),
+                d4 = fgDot(ac,bp);
+    if ((d3 >= 0.0) && (d4 <= d3))
+        return FgVect3D(0,1,0);
+    double      vc = d1*d4 - d3*d2;
+    if ((vc <= 0.0) && (d1 >= 0.0) && (d3 <= 0.0)) {
+        double      v = d1 / (d1 - d3);
+        return FgVect3D(1.0-v,v,0);
+    }
+    FgVect3D    cp = p - c;
+    double      d5 = fgDot(ab,cp),
+                d6 = fgDot(ac,cp);
+    if ((d6 >= 0.0) && (d5 <= d6))
+        return FgVect3D(0,0,1);
+    double      vb = d5*d2 - d1*d6;
+    if ((vb <= 0.0) && (d2 >= 0.0) && (d6 <= 0.0)) {
+        double      w = d2 / (d2 - d6);
+        return FgVect3D(1.0-w,0,w);
+    }
+    double      va = d3*d6 - d5*d4;
+    if ((va <= 0.0) && ((d4-d3) >= 0.0) && ((d5-d6) >= 0.0)) {
+        double      w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+        return FgVect3D(0,1.0-w,w);
+    }
+    double      sum = va + vb + vc;
+    if (sum > 0.0) {
+        double      v = vb / sum,
+                    w = vc / sum;
+        return FgVect3D(1.0-v-w,v,w);
+    }
+    // Degenerate so take the closest of the edges:
+    double      tab = closestSegmentParam(p,a,b),
+                tbc = closestSegmentParam(p,b,c),
+                tca = closestSegmentParam(p,c,a);
+    FgVect3D    ret(1.0-tab,tab,0);
+    double      best = (a + ab*tab - p).mag(),
+                dbc = (b + (c-b)*tbc - p).mag(),
+                dca = (c + (a-c)*tca - p).mag();
+    if (dbc < best) {
+        best = dbc;
+        ret = FgVect3D(0,1.0-tbc,tbc);
+    }
+    if (dca < best)
+        ret = FgVect3D(tca,0,1.0-tca);
+    return ret;
+}
+
 FgOpt<FgVect3D>
 fgBarycentricCoords(
     FgVect2D            point,
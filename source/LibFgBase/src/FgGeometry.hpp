@@ -31,6 +31,11 @@ fgClosestPointInSegment(FgVect3D p0,FgVect3D p1);
 FgVecMag
 fgClosestPointInTri(FgVect3D point,FgVect3D vert0,FgVect3D vert1,FgVect3D vert2);
 
+// Returns the barycentric coord (relative to the vertices) of the point in the triangle closest
+// to 'point'. For degenerate triangles it is the closest point on the edges:
+FgVect3D
+fgClosestBarycentricInTri(FgVect3D point,FgVect3D vert0,FgVect3D vert1,FgVect3D vert2);
+
 // Returns the barycentric coord of point in triangle
 // (invalid if outside of triangle or triangle degenerate):
 FgOpt<FgVect3D>
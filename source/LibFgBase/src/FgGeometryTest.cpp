@@ -102,6 +102,25 @@ testPointToFacetDistSqr()
     }
 }
 
+static
+void
+testClosestBarycentric()
+{
+    fgRandSeedRepeatable();
+    for (uint ii=0; ii<1000; ++ii) {
+        FgVect3D    v0 = fgMatRandNormal<3,1>(),
+                    v1 = fgMatRandNormal<3,1>(),
+                    v2 = (ii%10 == 0) ? v0 + (v1-v0) * 2.0 : fgMatRandNormal<3,1>(),   // Some degenerate
+                    pt = fgMatRandNormal<3,1>() * 2.0;
+        FgVect3D    bc = fgClosestBarycentricInTri(pt,v0,v1,v2);
+        FGASSERT(fgApproxEqual(bc[0]+bc[1]+bc[2],1.0));
+        FGASSERT((fgMinElem(bc) >= 0.0) && (fgMaxElem(bc) <= 1.0));
+        double      mag = (v0*bc[0] + v1*bc[1] + v2*bc[2] - pt).mag(),
+                    ref = fgClosestPointInTri(pt,v0,v1,v2).mag;
+        FGASSERT(std::abs(mag-ref) < 1.0e-10 * std::max(ref,1.0));
+    }
+}
+
 static
 void
 testBarycentricCoords()
@@ -291,6 +310,7 @@ fgGeometryTest(const FgArgs &)
 {
     testOriginToSegmentDistSqr();
     testPointToFacetDistSqr();
+    testClosestBarycentric();
     testBarycentricCoords();
     testBarycentricCoords3D();
     testPlaneH();
@@ -198,7 +198,7 @@ FgGuiApi3d::markVertex(
         else if (vertMarkMode < 3) {
             const FgVerts & verts = vertss[pt.meshIdx];
             vector<FgVect3UI>   tris = mesh.getTriEquivs().vertInds;
-            Fg3dTopology        topo(verts,tris);
+            Fg3dTopoCsr         topo(verts,tris);
             set<uint>           seam;
             if (vertMarkMode == 1)
                 seam = topo.seamContaining(vertIdx);
@@ -10,9 +10,65 @@
 #include "stdafx.h"
 
 #include "FgHistogram.hpp"
+#include "FgThread.hpp"
 
 using namespace std;
 
+namespace {
+
+// Same as 'fgRound' of the scaled value followed by a range check, without the library call:
+inline
+bool
+binIndex(double val,double lo,double binsPerUnit,size_t numBins,size_t & bin)
+{
+    double      pos = (val-lo) * binsPerUnit + 0.5;
+    if ((pos >= 0.0) && (pos < double(numBins))) {
+        bin = size_t(pos);
+        return true;
+    }
+    return false;
+}
+
+template<class T>
+void
+countRange(const T * samples,size_t num,double lo,double binsPerUnit,size_t * bins,size_t numBins)
+{
+    size_t      bin;
+    for (size_t ii=0; ii<num; ++ii)
+        if (binIndex(samples[ii],lo,binsPerUnit,numBins,bin))
+            ++bins[bin];
+}
+
+template<class T>
+void
+countTask(const T * samples,size_t num,size_t numTasks,FgHistogram * hists,size_t task)
+{
+    size_t      beg = num * task / numTasks,
+                end = num * (task+1) / numTasks;
+    FgHistogram &   hist = hists[task];
+    countRange(samples+beg,end-beg,hist.bounds[0],hist.binsPerUnit,&hist.binCounts[0],hist.binCounts.size());
+}
+
+// Below this there is no benefit in starting threads:
+const size_t    minParallelSamples = 1 << 16;
+
+template<class T>
+void
+countSamples(FgHistogram & hist,const T * samples,size_t num,uint numThreads)
+{
+    size_t      numTasks = std::min(size_t(fgNumThreads(numThreads)),num / minParallelSamples);
+    if (numTasks < 2) {
+        countRange(samples,num,hist.bounds[0],hist.binsPerUnit,&hist.binCounts[0],hist.binCounts.size());
+        return;
+    }
+    vector<FgHistogram>     hists(numTasks,FgHistogram(hist.bounds,hist.binCounts.size()));
+    fgParallelFor(numTasks,boost::bind(countTask<T>,samples,num,numTasks,&hists[0],_1),uint(numTasks));
+    for (size_t ii=0; ii<hists.size(); ++ii)
+        hist.merge(hists[ii]);
+}
+
+}
+
 FgHistogram::FgHistogram(
     FgVectD2    bounds_,
     size_t      numBins)
@@ -21,6 +77,7 @@ FgHistogram::FgHistogram(
     FGASSERT(bounds[1] > bounds[0]);
     FGASSERT(numBins > 1);
     binCounts.resize(numBins,0);
+    binsPerUnit = double(numBins) / (bounds[1]-bounds[0]);
 }
 
 FgHistogram::FgHistogram(
@@ -33,26 +90,37 @@ FgHistogram::FgHistogram(
     FGASSERT(bounds[1] > bounds[0]);
     FGASSERT(numBins > 1);
     binCounts.resize(numBins,0);
-    double      fac = double(numBins) / (bounds[1]-bounds[0]);
-    for (uint ii=0; ii<samples.size(); ++ii) {
-        int     bin = fgRound((samples[ii]-bounds[0])*fac);
-        if ((bin >= 0) && (bin < int(numBins)))
-            ++(binCounts[bin]);
-    }
+    binsPerUnit = double(numBins) / (bounds[1]-bounds[0]);
+    addSamples(&samples[0],samples.size(),1);
 }
 
 bool
 FgHistogram::addSample(double val)
 {
-    double      fac = double(binCounts.size()) / (bounds[1]-bounds[0]);
-    int         bin = fgRound((val-bounds[0]) * fac);
-    if ((bin >= 0) && (bin < int(binCounts.size()))) {
+    size_t      bin;
+    if (binIndex(val,bounds[0],binsPerUnit,binCounts.size(),bin)) {
         ++(binCounts[bin]);
         return true;
     }
     return false;
 }
 
+void
+FgHistogram::addSamples(const double * samples,size_t num,uint numThreads)
+{countSamples(*this,samples,num,numThreads); }
+
+void
+FgHistogram::addSamples(const float * samples,size_t num,uint numThreads)
+{countSamples(*this,samples,num,numThreads); }
+
+void
+FgHistogram::merge(const FgHistogram & rhs)
+{
+    FGASSERT((rhs.bounds == bounds) && (rhs.binCounts.size() == binCounts.size()));
+    for (size_t ii=0; ii<binCounts.size(); ++ii)
+        binCounts[ii] += rhs.binCounts[ii];
+}
+
 size_t
 FgHistogram::numSamples() const
 {
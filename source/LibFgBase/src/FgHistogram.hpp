@@ -16,6 +16,7 @@ struct  FgHistogram
 {
     vector<size_t>          binCounts;
     FgVectD2                bounds;         // outer bounds of bin range. bounds[1] > bounds[0].
+    double                  binsPerUnit;    // Cached from 'bounds' and number of bins
 
     FgHistogram(
         FgVectD2            bounds,
@@ -29,6 +30,18 @@ struct  FgHistogram
     bool                                    // Returns true if sample falls into bounds
     addSample(double val);
 
+    // As 'addSample' for each value, with the samples split over up to 'numThreads' threads
+    // (0 means one per hardware thread), each counting into its own bins:
+    void
+    addSamples(const double * samples,size_t num,uint numThreads=0);
+
+    void
+    addSamples(const float * samples,size_t num,uint numThreads=0);
+
+    // Add the counts of a histogram with the same bounds and number of bins:
+    void
+    merge(const FgHistogram & rhs);
+
     size_t
     numSamples() const;
 
@@ -10,6 +10,7 @@
 #include "stdafx.h"
 
 #include "FgImage.hpp"
+#include "FgImgPyramid.hpp"
 #include "FgMath.hpp"
 
 using namespace std;
@@ -128,26 +129,8 @@ fgImgShrink2(
     const FgImgRgbaUb & src,
     FgImgRgbaUb &       dst)
 {
-    FGASSERT(!src.empty());
-    dst.resize(src.dims()/2);
-    const FgRgbaUB  * srcPtr1 = src.dataPtr(),
-                    * srcPtr2 = srcPtr1 + src.width();
-    FgRgbaUB        * dstPtr =  dst.dataPtr();
-    for (uint yd=0; yd<dst.height(); yd++) {
-        for (uint xd=0; xd<dst.width(); xd++) {
-            uint        xs1 = xd * 2,
-                        xs2 = xs1 + 1;
-            FgRgbaUS    acc = FgRgbaUS(srcPtr1[xs1]) +
-                              FgRgbaUS(srcPtr1[xs2]) +
-                              FgRgbaUS(srcPtr2[xs1]) +
-                              FgRgbaUS(srcPtr2[xs2]) +
-                              FgRgbaUS(1,1,1,1);        // Account for rounding bias
-            dstPtr[xd] = FgRgbaUB(acc/4);
-        }
-        dstPtr += dst.width();
-        srcPtr1 += 2 * src.width();
-        srcPtr2 += 2 * src.width();
-    }
+    // Single threaded as this is often called from within parallel tasks:
+    fgImgPyrReduce(src,dst,FgImgPyrFilter::box,1);
 }
 
 FgImgRgbaUb
@@ -439,19 +422,17 @@ fgPaintDot(FgImgRgbaUb & img,FgVect2F ipcs,FgVect4UC c,uint radius)
 vector<FgImgRgbaUb>
 fgOglMipMap(const FgImgRgbaUb & img)
 {
-    vector<FgImgRgbaUb>     ret(fgLog2Ceil(fgMaxElem(img.dims()))+1);
-    fgResizePow2Ceil(img,ret[0]);   // Just copies if already pow2 dims
-    fgImgFlipVertical(ret[0]);
-    for (size_t sl=1; sl<ret.size(); ++sl) {
-        const FgImgRgbaUb & src = ret[sl-1];
-        if (fgMinElem(src.dims()) > 1)
-            ret[sl] = fgImgShrink2(src);
-        else {
-            if (src.width() > 1)
-                ret[sl] = fgImgShrinkWid2(src);
-            else
-                ret[sl] = fgImgShrinkHgt2(src);
-        }
+    FgImgRgbaUb             top;
+    fgResizePow2Ceil(img,top);      // Just copies if already pow2 dims
+    fgImgFlipVertical(top);
+    vector<FgImgRgbaUb>     ret = fgImgPyramid(top,FgImgPyrFilter::box);
+    size_t                  num = fgLog2Ceil(fgMaxElem(img.dims()))+1;
+    while (ret.size() < num) {
+        const FgImgRgbaUb & src = ret.back();
+        if (src.width() > 1)
+            ret.push_back(fgImgShrinkWid2(src));
+        else
+            ret.push_back(fgImgShrinkHgt2(src));
     }
     return ret;
 }
@@ -475,7 +456,7 @@ fgSsi(const FgImg3F & img,uchar borderPolicy)
     for (size_t ii=0; ii<ret.size()-1; ++ii) {
         fgSmoothFloat(ret[ii],ret[ii],borderPolicy);
         fgSmoothFloat(ret[ii],ret[ii],borderPolicy);
-        fgShrink2Float(ret[ii],ret[ii+1]);
+        fgImgPyrReduce(ret[ii],ret[ii+1],FgImgPyrFilter::box);
     }
     return ret;
 }
@@ -17,6 +17,7 @@
 #include "FgAffineC.hpp"
 #include "FgAffineCwC.hpp"
 #include "FgArray.hpp"
+#include "FgImgMetrics.hpp"
 
 std::ostream &
 operator<<(std::ostream &,const FgImgRgbaUb &);
@@ -72,13 +73,13 @@ fgBlerpAlpha(const FgImgRgbaUb & img,FgVect2F coordIucs);
 // Bilinear interpolation on floating point channel images.
 // Clips sample point coordinates to image boundaries.
 template<class T>
-typename FgTraits<T>::Floating
+typename FgTraits<typename FgImgView<T>::PixelType>::Floating
 fgBlerpClipIpcs(
-    const FgImage<T> &  img,        // Must not be empty
+    FgImgView<T>        img,        // Must not be empty
     FgVect2F            coordIpcs)
 {
     FGASSERT(!img.empty());         // Required for algorithm below
-    typedef typename FgTraits<T>::Floating    Acc;
+    typedef typename FgTraits<typename FgImgView<T>::PixelType>::Floating    Acc;
     Acc                 acc(0.0);
     float               xf = coordIpcs[0] - 0.5f,     // to IRCS
                         yf = coordIpcs[1] - 0.5f;
@@ -106,8 +107,17 @@ fgBlerpClipIpcs(
 }
 template<class T>
 typename FgTraits<T>::Floating
-fgBlerpClipIucs(const FgImage<T> & img,FgVect2F coordIucs)
+fgBlerpClipIpcs(const FgImage<T> & img,FgVect2F coordIpcs)
+{return fgBlerpClipIpcs(FgImgView<const T>(img),coordIpcs); }
+
+template<class T>
+typename FgTraits<typename FgImgView<T>::PixelType>::Floating
+fgBlerpClipIucs(FgImgView<T> img,FgVect2F coordIucs)
 {return fgBlerpClipIpcs(img,fgMapMul(coordIucs,FgVect2F(img.dims()))); }
+template<class T>
+typename FgTraits<T>::Floating
+fgBlerpClipIucs(const FgImage<T> & img,FgVect2F coordIucs)
+{return fgBlerpClipIpcs(FgImgView<const T>(img),fgMapMul(coordIucs,FgVect2F(img.dims()))); }
 
 template<class T>
 FgMatrixC<T,2,2>
@@ -153,19 +163,25 @@ fgExpand2(const FgImgRgbaUb & src);
 template<typename T>
 void
 fgShrink2Float(
-    const FgImage<T> &  src,
-    FgImage<T> &        dst)    // Must be a different instance
+    FgImgView<T>                                    src,
+    FgImage<typename FgImgView<T>::PixelType> &     dst)    // Must not be the source image
 {
-    FGASSERT(src.dataPtr() != dst.dataPtr());
+    FGASSERT((src.empty()) || (src.m_data != dst.dataPtr()));
     dst.resize(src.dims()/2);
-    for (uint yy=0; yy<dst.height(); ++yy)
+    for (uint yy=0; yy<dst.height(); ++yy) {
+        const T     *s0 = src.rowPtr(2*yy),
+                    *s1 = src.rowPtr(2*yy+1);
+        typename FgImgView<T>::PixelType *d = dst.rowPtr(yy);
         for (uint xx=0; xx<dst.width(); ++xx)
-            dst.xy(xx,yy) = (
-                src.xy(2*xx,2*yy) +
-                src.xy(2*xx+1,2*yy) +
-                src.xy(2*xx+1,2*yy+1) +
-                src.xy(2*xx,2*yy+1)) / 4;
+            d[xx] = (s0[2*xx] + s0[2*xx+1] + s1[2*xx+1] + s1[2*xx]) / 4;
+    }
 }
+template<typename T>
+void
+fgShrink2Float(
+    const FgImage<T> &  src,
+    FgImage<T> &        dst)    // Must be a different instance
+{fgShrink2Float(FgImgView<const T>(src),dst); }
 
 template<class T>
 FgImage<T>
@@ -229,7 +245,7 @@ fgAnd(const FgImage<FgBool> &,const FgImage<FgBool> &);
 
 template<class T>
 void
-fgImgFlipVertical(FgImage<T> & img)
+fgImgFlipVertical(FgImgView<T> img)
 {
     uint    wid = img.width(),
             halfHgt = img.height()/2;
@@ -240,18 +256,27 @@ fgImgFlipVertical(FgImage<T> & img)
             std::swap(ptr1[col],ptr2[col]);
     }
 }
+template<class T>
+void
+fgImgFlipVertical(FgImage<T> & img)
+{fgImgFlipVertical(FgImgView<T>(img)); }
 
 template<class T>
-FgImage<T>
-fgFlipHoriz(const FgImage<T> & img)
+FgImage<typename FgImgView<T>::PixelType>
+fgFlipHoriz(FgImgView<T> img)
 {
-    FgImage<T>  ret(img.dims());
+    FgImage<typename FgImgView<T>::PixelType>  ret(img.dims());
     uint        xh = img.width()-1;
     for (uint yy=0; yy<img.height(); ++yy) {
+        const T *   src = img.rowPtr(yy);
         for (uint xx=0; xx<img.width(); ++xx)
-            ret.xy(xh-xx,yy) = img.xy(xx,yy); }
+            ret.xy(xh-xx,yy) = src[xx]; }
     return ret;
 }
+template<class T>
+FgImage<T>
+fgFlipHoriz(const FgImage<T> & img)
+{return fgFlipHoriz(FgImgView<const T>(img)); }
 
 template<class T>
 inline void
@@ -304,17 +329,18 @@ fgSmoothUint1D(
         dstPtr[ii] = Acc(srcPtr[ii-1]) + Acc(srcPtr[ii])*2 + Acc(srcPtr[ii+1]);
     dstPtr[num-1] = Acc(srcPtr[num-2]) + Acc(srcPtr[num-1])*(2+borderPolicy);
 }
+// The destination view can be the same as the source view:
 template<class T>
 void
 fgSmoothUint(
-    const FgImage<T> &  src,
-    FgImage<T> &        dst,
+    typename FgImgView<T>::ConstView    src,
+    FgImgView<T>                        dst,
     uchar               borderPolicy=1)     // 0 - zero border policy, 1 - replication border policy
 {
     typedef typename FgConvTraits<T>::Acc     Acc;
     FGASSERT((src.width() > 1) && (src.height() > 1));  // Algorithm not designed for dim < 2
     FGASSERT((borderPolicy == 0) || (borderPolicy == 1));
-    dst.resize(src.width(),src.height());
+    FGASSERT(src.dims() == dst.dims());
     FgImage<Acc> acc(src.width(),3);                  // Accumulator image
     T           *dstPtr = dst.rowPtr(0);
     Acc         *accPtr0,
@@ -341,6 +367,16 @@ fgSmoothUint(
     for (uint xx=0; xx<dst.width(); ++xx)
         dstPtr[xx] = T((accPtr1[xx] + accPtr2[xx]*(2+borderPolicy) + Acc(7)) / 16);
 }
+template<class T>
+void
+fgSmoothUint(
+    const FgImage<T> &  src,
+    FgImage<T> &        dst,
+    uchar               borderPolicy=1)
+{
+    dst.resize(src.dims());
+    fgSmoothUint(FgImgView<const T>(src),FgImgView<T>(dst),borderPolicy);
+}
 
 // Use of the __restrict keyword for the pointer args below made no speed difference here (msvc2012).
 // Perhaps the compiler is smart enough to look at the calling context:
@@ -357,54 +393,68 @@ fgSmoothFloat1D(
         dstPtr[ii] = srcPtr[ii-1] + srcPtr[ii]*2 + srcPtr[ii+1];
     dstPtr[wid-1] = srcPtr[wid-2] + srcPtr[wid-1]*(2+borderPolicy);
 }
+// Applies a [1 2 1] outer product 2D kernel smoothing to a floating point channel
+// image in a cache-friendly way.
+// The source and destination views can be the same, for in-place convolution.
 template<class T>
 void
-fgSmoothFloat2D(
-    const T *   srcPtr,
-    T *         dstPtr,         // Must not overlap with srcPtr
-    uint        wid,
-    uint        hgt,
-    uchar       borderPolicy,   // See below
-    float       fac=1.0f/4.0f)  // Per-axis kernel normalization factor
+fgSmoothFloat(
+    typename FgImgView<T>::ConstView    src,
+    FgImgView<T>                        dst,            // Can be same as src. Must be same dimensions.
+    uchar                               borderPolicy,   // 0 - zero border policy, 1 - replication border policy
+    float                               fac=1.0f/4.0f)  // Per-axis kernel normalization factor
 {
+    FGASSERT((src.width() > 1) && (src.height() > 1));  // Algorithm not designed for dim < 2
+    FGASSERT((borderPolicy == 0) || (borderPolicy == 1));
+    FGASSERT(src.dims() == dst.dims());
+    uint        wid = src.width(),
+                hgt = src.height();
     float       factor = fac*fac;
     FgImage<T>  acc(wid,3);
-    T           *accPtr0,
+    T           *dstPtr = dst.rowPtr(0),
+                *accPtr0,
                 *accPtr1 = acc.rowPtr(0),
                 *accPtr2 = acc.rowPtr(1);
-    fgSmoothFloat1D(srcPtr,accPtr1,wid,borderPolicy);
-    srcPtr += wid;
-    fgSmoothFloat1D(srcPtr,accPtr2,wid,borderPolicy);
+    fgSmoothFloat1D(src.rowPtr(0),accPtr1,wid,borderPolicy);
+    fgSmoothFloat1D(src.rowPtr(1),accPtr2,wid,borderPolicy);
     for (uint xx=0; xx<wid; ++xx)
         dstPtr[xx] = (accPtr1[xx]*(2+borderPolicy) + accPtr2[xx]) * factor;
     for (uint yy=1; yy<hgt-1; ++yy) {
-        dstPtr += wid;
-        srcPtr += wid;
+        dstPtr = dst.rowPtr(yy);
         accPtr0 = acc.rowPtr((yy-1)%3);
         accPtr1 = acc.rowPtr(yy%3);
         accPtr2 = acc.rowPtr((yy+1)%3);
-        fgSmoothFloat1D(srcPtr,accPtr2,wid,borderPolicy);
+        fgSmoothFloat1D(src.rowPtr(yy+1),accPtr2,wid,borderPolicy);
         for (uint xx=0; xx<wid; ++xx)
             dstPtr[xx] = (accPtr0[xx] + accPtr1[xx] * 2 + accPtr2[xx]) * factor;
     }
-    dstPtr += wid;
+    dstPtr = dst.rowPtr(hgt-1);
     for (uint xx=0; xx<wid; ++xx)
         dstPtr[xx] = (accPtr1[xx] + accPtr2[xx]*(2+borderPolicy)) * factor;
 }
-// Applies a [1 2 1] outer product 2D kernel smoothing to a floating point channel
-// image in a cache-friendly way.
-// The Source and destination images can be the same, for in-place convolution.
 template<class T>
 void
 fgSmoothFloat(
     const FgImage<T> &  src,
     FgImage<T> &        dst,                // Can be same as src
-    uchar               borderPolicy)       // 0 - zero border policy, 1 - replication border policy
+    uchar               borderPolicy)
 {
-    FGASSERT((src.width() > 1) && (src.height() > 1));  // Algorithm not designed for dim < 2
-    FGASSERT((borderPolicy == 0) || (borderPolicy == 1));
     dst.resize(src.dims());
-    fgSmoothFloat2D(src.dataPtr(),dst.dataPtr(),src.width(),src.height(),borderPolicy);
+    fgSmoothFloat(FgImgView<const T>(src),FgImgView<T>(dst),borderPolicy);
+}
+// Tightly packed rows version of the above:
+template<class T>
+void
+fgSmoothFloat2D(
+    const T *   srcPtr,
+    T *         dstPtr,         // Can be same as srcPtr
+    uint        wid,
+    uint        hgt,
+    uchar       borderPolicy,
+    float       fac=1.0f/4.0f)
+{
+    FgVect2UI   dims(wid,hgt);
+    fgSmoothFloat(FgImgView<const T>(srcPtr,dims,wid),FgImgView<T>(dstPtr,dims,wid),borderPolicy,fac);
 }
 
 // Applies a 3x3 non-separable kernel to a floating-point channel image. (technically a correlation
@@ -438,15 +488,15 @@ fgConvolveFloatHoriz(
 template<class Pixel>
 void
 fgConvolveFloat(
-    const FgImage<Pixel> &  src,
-    const FgMat33F &     krn,                // The kernel to be correlated
-    FgImage<Pixel> &        dst,                // Must be different from src
+    typename FgImgView<Pixel>::ConstView    src,
+    const FgMat33F &                        krn,            // The kernel to be correlated
+    FgImgView<Pixel>                        dst,            // Must not overlap src. Must be same dimensions.
     uchar                   borderPolicy)       // 0 - zero border policy, 1 - replication border policy
 {
     FGASSERT((src.width() > 1) && (src.height() > 1));  // Algorithm not designed for dim < 2
     FGASSERT((borderPolicy == 0) || (borderPolicy == 1));
-    dst.resize(src.dims());
-    FGASSERT(src.dataPtr() != dst.dataPtr());
+    FGASSERT(src.dims() == dst.dims());
+    FGASSERT(src.m_data != dst.m_data);
     uint                    wid = src.width();
     vector<Pixel>           boundaryRow(wid,Pixel(0));
     const Pixel *           srcPtrs[3];
@@ -469,13 +519,25 @@ fgConvolveFloat(
         srcPtrs[2] = &boundaryRow[0];
     fgConvolveFloatHoriz(srcPtrs,krn,dst.rowPtr(dst.height()-1),wid,borderPolicy);
 }
+template<class Pixel>
+void
+fgConvolveFloat(
+    const FgImage<Pixel> &  src,
+    const FgMat33F &        krn,
+    FgImage<Pixel> &        dst,                // Must be different from src
+    uchar                   borderPolicy)
+{
+    FGASSERT(&src != &dst);
+    dst.resize(src.dims());
+    fgConvolveFloat(FgImgView<const Pixel>(src),krn,FgImgView<Pixel>(dst),borderPolicy);
+}
 
 // Resample 'in' at the centre of each pixel in 'out' (assuming images are spatially 1-1):
-template<class T>
+template<class T,class U>
 void
 fgResampleSimple(
-    const FgImage<T> &  in,
-    FgImage<T> &        out)
+    FgImgView<T>        in,
+    FgImgView<U>        out)
 {
     FGASSERT(fgMinElem(in.dims()) > 0);
     FGASSERT(fgMinElem(out.dims()) > 0);
@@ -490,6 +552,12 @@ fgResampleSimple(
     }
 }
 template<class T>
+void
+fgResampleSimple(
+    const FgImage<T> &  in,
+    FgImage<T> &        out)
+{fgResampleSimple(FgImgView<const T>(in),FgImgView<T>(out)); }
+template<class T>
 FgImage<T>
 fgResampleSimple(const FgImage<T> & in,FgVect2UI dims)
 {
@@ -512,11 +580,11 @@ fgResizePow2Ceil(
         out = in;
 }
 
-template<class T>
+template<class T,class U>
 double
 fgImgSsd(
-    const FgImage<FgRgba<T> > & im0,
-    const FgImage<FgRgba<T> > & im1)
+    FgImgView<T>    im0,
+    FgImgView<U>    im1)
 {
     FGASSERT(im0.dims() == im1.dims());
     double      acc = 0.0;
@@ -529,6 +597,12 @@ fgImgSsd(
     }
     return acc;
 }
+template<class T>
+double
+fgImgSsd(
+    const FgImage<FgRgba<T> > & im0,
+    const FgImage<FgRgba<T> > & im1)
+{return fgImgSsd(FgImgView<const FgRgba<T> >(im0),FgImgView<const FgRgba<T> >(im1)); }
 
 template<class T>
 double
@@ -539,11 +613,11 @@ fgImgRmsd(
     return sqrt(fgImgSsd(im0,im1) / double(im0.numPixels()));
 }
 
-template<class T>
+template<class T,class U>
 double
 fgImgSad(
-    const FgImage<FgRgba<T> > & im0,
-    const FgImage<FgRgba<T> > & im1)
+    FgImgView<T>    im0,
+    FgImgView<U>    im1)
 {
     FGASSERT(im0.dims() == im1.dims());
     double      acc = 0.0;
@@ -560,6 +634,12 @@ fgImgSad(
     }
     return acc;
 }
+template<class T>
+double
+fgImgSad(
+    const FgImage<FgRgba<T> > & im0,
+    const FgImage<FgRgba<T> > & im1)
+{return fgImgSad(FgImgView<const FgRgba<T> >(im0),FgImgView<const FgRgba<T> >(im1)); }
 
 template<class T>
 double
@@ -582,12 +662,8 @@ fgConcatHoriz(const FgImage<T> & l,const FgImage<T> & r)
     else {
         FGASSERT(l.height() == r.height());
         ret.resize(l.width()+r.width(),l.height());
-        FgVect2UI       off;
-        for (FgIter2UI it(l.dims()); it.valid(); it.next())
-            ret[it()] = l[it()];
-        off[0] += l.dims()[0];
-        for (FgIter2UI it(r.dims()); it.valid(); it.next())
-            ret[it()+off] = r[it()];
+        fgImgCopy(fgImgView(l),fgSubImage(ret,FgVect2UI(0),l.dims()));
+        fgImgCopy(fgImgView(r),fgSubImage(ret,FgVect2UI(l.width(),0),r.dims()));
     }
     return ret;
 }
@@ -606,15 +682,9 @@ fgConcatHoriz(const FgImage<T> & l,const FgImage<T> & c,const FgImage<T> & r)
     else {
         FGASSERT((l.height() == c.height()) && (c.height() == r.height()));
         ret.resize(l.width()+c.width()+r.width(),l.height());
-        FgVect2UI   off;
-        for (FgIter2UI it(l.dims()); it.valid(); it.next())
-            ret[it()] = l[it()];
-        off[0] += l.dims()[0];
-        for (FgIter2UI it(c.dims()); it.valid(); it.next())
-            ret[it()+off] = c[it()];
-        off[0] += c.dims()[0];
-        for (FgIter2UI it(r.dims()); it.valid(); it.next())
-            ret[it()+off] = r[it()];
+        fgImgCopy(fgImgView(l),fgSubImage(ret,FgVect2UI(0),l.dims()));
+        fgImgCopy(fgImgView(c),fgSubImage(ret,FgVect2UI(l.width(),0),c.dims()));
+        fgImgCopy(fgImgView(r),fgSubImage(ret,FgVect2UI(l.width()+c.width(),0),r.dims()));
     }
     return ret;
 }
@@ -631,12 +701,8 @@ fgConcatVert(const FgImage<T> & t,const FgImage<T> & b)
     else {
         FGASSERT(t.width() == b.width());
         ret.resize(t.width(),t.height()+b.height());
-        FgVect2UI   off;
-        for (FgIter2UI it(t.dims()); it.valid(); it.next())
-            ret[it()] = t[it()];
-        off[1] += t.dims()[1];
-        for (FgIter2UI it(b.dims()); it.valid(); it.next())
-            ret[it()+off] = b[it()];
+        fgImgCopy(fgImgView(t),fgSubImage(ret,FgVect2UI(0),t.dims()));
+        fgImgCopy(fgImgView(b),fgSubImage(ret,FgVect2UI(0,t.height()),b.dims()));
     }
     return ret;
 }
@@ -651,6 +717,28 @@ fgConcatVert(const std::vector<FgImage<T> > & v)
     return ret;
 }
 
+// Returns an image of dimensions 'dims' whose pixel P is src[P+offset], or 'fill' where that is
+// outside 'src'. For cropping without a copy use 'fgSubImage' or 'FgImgView::sub':
+template<class T>
+FgImage<typename FgImgView<T>::PixelType>
+fgCropPad(
+    FgImgView<T>                        src,
+    FgVect2UI                           dims,
+    FgVect2I                            offset = FgVect2I(0),
+    typename FgImgView<T>::PixelType    fill = typename FgImgView<T>::PixelType())
+{
+    FgImage<typename FgImgView<T>::PixelType>   ret(dims,fill);
+    FgVect2I        lo,hi;                      // Overlap in 'ret' IRCS (exclusive upper)
+    for (uint dd=0; dd<2; ++dd) {
+        lo[dd] = std::max(0,-offset[dd]);
+        hi[dd] = std::min(int(dims[dd]),int(src.dims()[dd])-offset[dd]);
+    }
+    if ((lo[0] < hi[0]) && (lo[1] < hi[1])) {
+        FgVect2UI       sz(hi-lo);
+        fgImgCopy(src.sub(FgVect2UI(lo+offset),sz),fgSubImage(ret,FgVect2UI(lo),sz));
+    }
+    return ret;
+}
 template<class T>
 FgImage<T>
 fgCropPad(
@@ -658,17 +746,7 @@ fgCropPad(
     FgVect2UI           dims,
     FgVect2I            offset = FgVect2I(0),
     T                   fill = T())
-{
-    FgImage<T>      ret(dims,fill);
-    if (!src.empty()) {
-        FgMat22I        srcBnds = FgMat22I(fgRangeToBounds(src.dims())),
-                        dstBnds = FgMat22I(fgRangeToBounds(dims)),
-                        range = fgBoundsIntersection(srcBnds-fgConcatHoriz(offset,offset),dstBnds);
-        for (FgIter2I it(fgInclToExcl(range)); it.valid(); it.next())
-            ret[FgVect2UI(it())] = src[FgVect2UI(it()+offset)];
-    }
-    return ret;
-}
+{return fgCropPad(FgImgView<const T>(src),dims,offset,fill); }
 
 // Requires alpha-weighted color values:
 template<class T>
@@ -693,9 +771,9 @@ fgResample(
 template<class T>
 void
 fgRotate90(
-    bool                clockwise,
-    const FgImage<T> &  in,
-    FgImage<T> &        out)
+    bool                                            clockwise,
+    FgImgView<T>                                    in,
+    FgImage<typename FgImgView<T>::PixelType> &     out)
 {
     FgVect2UI       dims(in.dims());
     std::swap(dims[0],dims[1]);
@@ -708,6 +786,13 @@ fgRotate90(
         for (uint xx=0; xx<dims[0]; ++xx)
             out.xy(xx,yy) = in.xy(size_t(yh+ys*yy),size_t(xh+xs*xx));
 }
+template<class T>
+void
+fgRotate90(
+    bool                clockwise,
+    const FgImage<T> &  in,
+    FgImage<T> &        out)
+{fgRotate90(clockwise,FgImgView<const T>(in),out); }
 
 // Alpha-weight the pixels (assuming they are initially NOT):
 inline
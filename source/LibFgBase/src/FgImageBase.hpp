@@ -7,6 +7,7 @@
 // Created:     Aug 27, 2004
 //
 // Simple left-to-right, top-to-bottom (row major), tightly-packed, unaligned image templated by pixel type.
+// See FgImgView.hpp for strided sub-image views and row-aligned storage.
 // 
 // INVARIANTS:
 //
@@ -42,6 +43,7 @@
 #include "FgIter.hpp"
 #include "FgStdStream.hpp"
 #include "FgAffineCwC.hpp"
+#include "FgImgView.hpp"
 
 template<typename T>
 struct  FgImage
@@ -80,6 +82,12 @@ struct  FgImage
     : m_dims(dims), m_data(pixels,pixels+dims[0]*dims[1])
     {}
 
+    // Tightly packed copy of a (possibly strided) view:
+    explicit
+    FgImage(FgImgView<const T> view)
+    : m_dims(view.dims()), m_data(view.numPixels())
+    {fgImgCopy(view,FgImgView<T>(*this)); }
+
     void
     clear()
     {m_data.clear(); m_dims = FgVect2UI(0); }
@@ -216,7 +224,9 @@ typedef FgImage<FgVect4UC>  FgImg4UC;
 
 typedef vector<FgImgRgbaUb> FgImgs;
 typedef vector<FgImgs>      FgImgss;
+typedef vector<FgImgF>      FgImgFs;
 typedef vector<FgImg3F>     FgImg3Fs;
+typedef vector<FgImg4F>     FgImg4Fs;
 
 template<class T>
 std::ostream &
@@ -8,6 +8,7 @@
 
 #include "stdafx.h"
 #include "FgImageIo.hpp"
+#include "FgImgFormats.hpp"
 #include "FgThread.hpp"
 #include "FgFileSystem.hpp"
 #include "FgScopeGuard.hpp"
@@ -44,6 +45,15 @@ fgLoadImgAnyFormat(
 {
     if (!fgFileReadable(fname))
         fgThrow("Unable to read file",fname);
+    if (!fgImgLoadNative(fname,img))
+        fgLoadImgMagick(fname,img);
+}
+
+void
+fgLoadImgMagick(
+    const FgString &    fname,
+    FgImgRgbaUb &       img)
+{
     fgEnsureMagick();
     FgScopePtr<ExceptionInfo>   exception(AcquireExceptionInfo(),DestroyExceptionInfo);
     FgScopePtr<ImageInfo>       image_info(CloneImageInfo(0),DestroyImageInfo);
@@ -80,32 +90,10 @@ fgLoadImgAnyFormat(const FgString & fname,FgImgUC & ret)
 FgImg4UC
 fgLoadImg4UC(const FgString & fname)
 {
-    FgImg4UC        ret;
-    if (!fgFileReadable(fname))
-        fgThrow("Unable to read file",fname);
-    fgEnsureMagick();
-    FgScopePtr<ExceptionInfo>   exception(AcquireExceptionInfo(),DestroyExceptionInfo);
-    FgScopePtr<ImageInfo>       image_info(CloneImageInfo(0),DestroyImageInfo);
-    (void) strcpy(image_info->filename,fname.as_utf8_string().c_str());
-    // TODO: Do we need to convert into a specific colourspace?
-    Image *imgPtr = ReadImage(image_info.get(),exception.get());
-    if (imgPtr == 0)
-        // exception.description is NULL. exception->reason includes the filename:
-        fgThrow("Unable to read image file",exception->reason);
-    FgScopeGuard                sg0(boost::bind(DestroyImage,imgPtr));
-    FgScopePtr<CacheView>       view(AcquireCacheView(imgPtr),DestroyCacheView);
-    ret.resize(uint(imgPtr->columns),uint(imgPtr->rows));
-    for(uint row= 0; row < imgPtr->rows; ++row) {
-        for(uint column = 0; column < imgPtr->columns; ++column) {
-            PixelPacket pixel;
-            FGASSERT(MagickTrue == 
-                    GetOneCacheViewAuthenticPixel(view.get(),column,row,&pixel,exception.get()));
-            ret.xy(column,row)[0] = uchar(pixel.red);
-            ret.xy(column,row)[1] = uchar(pixel.green);
-            ret.xy(column,row)[2] = uchar(pixel.blue);
-            ret.xy(column,row)[3] =  255 - uchar(pixel.opacity);
-        }
-    }
+    FgImgRgbaUb     img = fgLoadImgAnyFormat(fname);
+    FgImg4UC        ret(img.dims());
+    for (size_t ii=0; ii<ret.numPixels(); ++ii)
+        ret[ii] = img[ii].m_c;
     return ret;
 }
 
@@ -116,6 +104,8 @@ fgLoadImgAnyFormat(
 {
     if (!fgFileReadable(fname))
         fgThrow("Unable to read file",fname);
+    if (fgImgLoadNative(fname,img))
+        return;
     fgEnsureMagick();
     FgScopePtr<ExceptionInfo>   exception(AcquireExceptionInfo(),DestroyExceptionInfo);
     FgScopePtr<ImageInfo>       image_info(CloneImageInfo(0),DestroyImageInfo);
@@ -142,6 +132,16 @@ void
 fgSaveImgAnyFormat(
     const FgString &    fname,
     const FgImgRgbaUb & img)
+{
+    FGASSERT(fname.length() > 0);
+    if (!fgImgSaveNative(fname,img))
+        fgSaveImgMagick(fname,img);
+}
+
+void
+fgSaveImgMagick(
+    const FgString &    fname,
+    const FgImgRgbaUb & img)
 {
     FGASSERT(fname.length() > 0);
     fgEnsureMagick();
@@ -170,6 +170,10 @@ fgImgSupportedFormats()
     for(size_t ii=0; ii<number_formats; ++ii)
         ret.push_back(string(*(formats.get()+ii)));
     ret.push_back("TIF");       // TIFF is supported but this abbreviation is not in the list
+    const char *                natives[] = {"TGA","PPM","PGM","PNM","PFM","FGRAW"};
+    for (size_t ii=0; ii<sizeof(natives)/sizeof(natives[0]); ++ii)
+        if (std::find(ret.begin(),ret.end(),natives[ii]) == ret.end())
+            ret.push_back(natives[ii]);
     return ret;
 }
 
@@ -18,6 +18,8 @@
 #include "FgImage.hpp"
 #include "FgMatrixV.hpp"
 
+// TGA, PPM/PGM, PFM and FGRAW files are handled by the native codecs of FgImgFormats.hpp and
+// all other formats by ImageMagick:
 void
 fgLoadImgAnyFormat(const FgString & fname,FgImgRgbaUb & img);
 void
@@ -41,6 +43,12 @@ fgSaveImgAnyFormat(
     const FgString &    fname,
     const FgImgRgbaUb & img);
 
+// The ImageMagick paths, bypassing the native codecs of FgImgFormats.hpp:
+void
+fgLoadImgMagick(const FgString & fname,FgImgRgbaUb & img);
+void
+fgSaveImgMagick(const FgString & fname,const FgImgRgbaUb & img);
+
 // List of all supported image file format extensions in capitals:
 std::vector<std::string>
 fgImgSupportedFormats();
@@ -87,4 +95,41 @@ fgImgLoadJfif(
     const std::vector<uchar> &  fileContents,
     FgImgRgbaUb &           img);
 
+// Decode at 1/'scaleDenom' (1, 2, 4 or 8) of full resolution with dimensions rounded up.
+// The reduction is done in the inverse DCT so it is much faster than decoding at full resolution
+// and shrinking:
+void
+fgImgLoadJfif(
+    const FgString &        fname,
+    FgImgRgbaUb &           img,
+    uint                    scaleDenom);
+
+void
+fgImgLoadJfif(
+    const std::vector<uchar> &  fileContents,
+    FgImgRgbaUb &           img,
+    uint                    scaleDenom);
+
+// Full resolution dimensions, reading only the header:
+FgVect2UI
+fgImgJfifDims(const std::vector<uchar> & fileContents);
+
+// Largest dimensions with the aspect ratio of 'dims' which fit within 'maxDims'. Never enlarges:
+FgVect2UI
+fgImgFitDims(FgVect2UI dims,FgVect2UI maxDims);
+
+// Decode to 'fgImgFitDims' of the image dimensions, for thumbnails and previews. Decodes at the
+// smallest DCT scale covering those dimensions then box filters down the remainder:
+FgImgRgbaUb
+fgImgLoadJfifFit(
+    const FgString &        fname,
+    FgVect2UI               maxDims,
+    uint                    numThreads=0);
+
+FgImgRgbaUb
+fgImgLoadJfifFit(
+    const std::vector<uchar> &  fileContents,
+    FgVect2UI               maxDims,
+    uint                    numThreads=0);
+
 #endif
@@ -10,12 +10,19 @@
 #include "stdafx.h"
 
 #include "FgImage.hpp"
+#include "FgImgFormats.hpp"
+#include "FgImgMetrics.hpp"
+#include "FgImgPyramid.hpp"
+#include "FgImgResample.hpp"
+#include "FgImgWarp.hpp"
+#include "FgImageIo.hpp"
 #include "FgTime.hpp"
 #include "FgImgDisplay.hpp"
 #include "FgImage.hpp"
 #include "FgTestUtils.hpp"
 #include "FgApproxEqual.hpp"
 #include "FgCommand.hpp"
+#include "FgRandom.hpp"
 
 using namespace std;
 
@@ -90,6 +97,681 @@ testConvolve(const FgArgs &)
     FGASSERT(fgApproxEqual(i0.m_data,i1.m_data));
 }
 
+// Original scalar implementation of 'fgImgShrink2':
+static
+FgImgRgbaUb
+shrink2Ref(const FgImgRgbaUb & src)
+{
+    FgImgRgbaUb     ret(src.dims()/2);
+    for (FgIter2UI it(ret.dims()); it.valid(); it.next()) {
+        FgVect2UI   s = it() * 2U;
+        FgRgbaUS    acc = FgRgbaUS(src[s]) +
+                          FgRgbaUS(src[s+FgVect2UI(1,0)]) +
+                          FgRgbaUS(src[s+FgVect2UI(0,1)]) +
+                          FgRgbaUS(src[s+FgVect2UI(1,1)]) +
+                          FgRgbaUS(1,1,1,1);
+        ret[it()] = FgRgbaUB(acc/4);
+    }
+    return ret;
+}
+
+static
+FgImg4F
+toF4(const FgImgRgbaUb & img)
+{
+    FgImg4F         ret(img.dims());
+    for (size_t ii=0; ii<ret.numPixels(); ++ii)
+        ret[ii] = FgVect4F(img[ii].m_c);
+    return ret;
+}
+
+static
+void
+testPyramid(const FgArgs &)
+{
+    fgRandSeedRepeatable();
+    // Odd dimensions and large enough to be computed in parallel bands:
+    FgImgRgbaUb         img(601,517);
+    for (size_t ii=0; ii<img.numPixels(); ++ii)
+        for (uint cc=0; cc<4; ++cc)
+            img[ii].m_c[cc] = uchar(fgRandUint(256));
+    for (uint ff=0; ff<2; ++ff) {
+        FgImgPyrFilter  filter = (ff == 0) ? FgImgPyrFilter::box : FgImgPyrFilter::gauss;
+        FgImgs          pyr = fgImgPyramid(img,filter,0,4),
+                        pyr1 = fgImgPyramid(img,filter,0,1);
+        FgImg4Fs        pyrF = fgImgPyramid(toF4(img),filter,0,4);
+        FGASSERT(pyr.size() == ((filter == FgImgPyrFilter::box) ? 10U : 11U));
+        FGASSERT(pyrF.size() == pyr.size());
+        FGASSERT(fgMinElem(pyr.back().dims()) == 1);
+        for (size_t ll=1; ll<pyr.size(); ++ll) {
+            FGASSERT(pyr[ll].dims() == fgImgPyrReduceDims(pyr[ll-1].dims(),filter));
+            FGASSERT(pyr[ll].m_data == pyr1[ll].m_data);
+            if (filter == FgImgPyrFilter::box)
+                FGASSERT(pyr[ll].m_data == shrink2Ref(pyr[ll-1]).m_data);
+            else {
+                // The 8-bit result must be the rounded float result:
+                FgImgRgbaUb     src = pyr[ll-1];
+                FgImg4F         ref;
+                fgImgPyrReduce(toF4(src),ref,filter,1);
+                for (size_t ii=0; ii<ref.numPixels(); ++ii)
+                    for (uint cc=0; cc<4; ++cc)
+                        FGASSERT(std::abs(float(pyr[ll][ii].m_c[cc]) - ref[ii][cc]) <= 0.5001f);
+            }
+        }
+    }
+    {
+        FgImg3F         img3 = fgImgToF3(img);
+        FgImg3Fs        pyr = fgImgPyramid(img3,FgImgPyrFilter::box,3);
+        FGASSERT(pyr.size() == 3);
+        FGASSERT(fgApproxEqual(pyr[1].m_data,fgShrink2Float(img3).m_data));
+        FGASSERT(fgApproxEqual(pyr[2].m_data,fgShrink2Float(pyr[1]).m_data));
+        FgImgF          img1(img.dims());
+        for (size_t ii=0; ii<img1.numPixels(); ++ii)
+            img1[ii] = img3[ii][1];
+        FGASSERT(fgApproxEqual(fgImgPyramid(img1,FgImgPyrFilter::box,2)[1].m_data,fgShrink2Float(img1).m_data));
+        // Gaussian leaves a constant image unchanged:
+        FgImgF          cnst(img.dims(),0.25f);
+        FgImgFs         pyrC = fgImgPyramid(cnst,FgImgPyrFilter::gauss);
+        for (size_t ll=0; ll<pyrC.size(); ++ll)
+            for (size_t ii=0; ii<pyrC[ll].numPixels(); ++ii)
+                FGASSERT(std::abs(pyrC[ll][ii]-0.25f) < 1.0e-6f);
+        // Laplacian reconstruction:
+        FgImg3Fs        lap = fgImgLaplacian(img3);
+        FGASSERT(lap.size() == 11);
+        FgImg3F         rec = fgImgLaplacianReconstruct(lap);
+        FGASSERT(rec.dims() == img3.dims());
+        for (size_t ii=0; ii<rec.numPixels(); ++ii)
+            FGASSERT((rec[ii]-img3[ii]).mag() < 1.0e-6f);
+        FgImg4Fs        lap4 = fgImgLaplacian(img,4);
+        FGASSERT(lap4.size() == 4);
+        FgImg4F         rec4 = fgImgLaplacianReconstruct(lap4),
+                        img4 = toF4(img);
+        for (size_t ii=0; ii<rec4.numPixels(); ++ii)
+            FGASSERT((rec4[ii]-img4[ii]).mag() < 1.0e-6f);
+    }
+}
+
+// Smooth test pattern in IUCS with values in [28,228]:
+static
+float
+pattern(double uu,double vv,double freq)
+{return float(128.0 + 100.0 * std::sin(2.0*fgPi()*freq*(uu+0.7*vv)) * std::cos(2.0*fgPi()*0.37*freq*vv)); }
+
+// As 8-bit grey RGBA since the existing functions support that type:
+static
+FgImgRgbaUb
+patternImg(FgVect2UI dims,double freq)
+{
+    FgImgRgbaUb     ret(dims);
+    for (FgIter2UI it(dims); it.valid(); it.next()) {
+        uchar       val = uchar(fgRound(pattern((it()[0]+0.5)/dims[0],(it()[1]+0.5)/dims[1],freq)));
+        ret[it()] = FgRgbaUB(val,val,val,255);
+    }
+    return ret;
+}
+
+// RMS difference of the red channel from the exact pattern (or its mean if 'freq' is 0):
+static
+double
+rmsDiff(const FgImgRgbaUb & img,double freq)
+{
+    FgVect2UI       dims = img.dims();
+    double          acc = 0.0;
+    for (FgIter2UI it(dims); it.valid(); it.next()) {
+        double      ref = (freq == 0.0) ? 128.0 : pattern((it()[0]+0.5)/dims[0],(it()[1]+0.5)/dims[1],freq);
+        acc += fgSqr(double(img[it()].red())-ref);
+    }
+    return std::sqrt(acc / img.numPixels());
+}
+
+static
+void
+testResample(const FgArgs &)
+{
+    // Box filter matches 'fgImgResize' for both shrinking and expanding:
+    FgImgRgbaUb         lenna = fgLoadImgAnyFormat(fgDataDir()+"base/Lenna512.png");
+    FgVect2UI           sizes[] = {FgVect2UI(300,300),FgVect2UI(700,611),FgVect2UI(131,777)};
+    for (uint ss=0; ss<3; ++ss) {
+        FgImgRgbaUb     ref(sizes[ss]),
+                        box = fgImgResample(lenna,sizes[ss],FgResampleFilter::box,4);
+        fgImgResize(lenna,ref);
+        FGASSERT(box.dims() == ref.dims());
+        for (size_t ii=0; ii<box.numPixels(); ++ii)
+            for (uint cc=0; cc<4; ++cc)
+                FGASSERT(std::abs(int(box[ii].m_c[cc])-int(ref[ii].m_c[cc])) <= 1);
+        FGASSERT(box.m_data == fgImgResample(lenna,sizes[ss],FgResampleFilter::box,1).m_data);
+    }
+    // Quality comparison on an analytic pattern, both for interpolation and for the aliasing of
+    // a pattern above the destination Nyquist frequency (whose ideal result is its mean of 128):
+    FgVect2UI           srcUp(61,53),
+                        dstUp(256,240),
+                        srcDn(600,560),
+                        dstDn(100,90);
+    FgImgRgbaUb         lo = patternImg(srcUp,3.0),
+                        fine = patternImg(srcDn,230.0),
+                        tmp(dstUp);
+    fgImgResize(lo,tmp);
+    double              upResize = rmsDiff(tmp,3.0),
+                        upSimple = rmsDiff(fgResampleSimple(lo,dstUp),3.0);
+    tmp.resize(dstDn);
+    fgImgResize(fine,tmp);
+    double              dnResize = rmsDiff(tmp,0.0),
+                        dnSimple = rmsDiff(fgResampleSimple(fine,dstDn),0.0);
+    fgout << fgnl << "RMS error (expand 61x53 to 256x240, shrink aliasing 600x560 to 100x90):"
+        << fgnl << "fgImgResize       " << fgToFixed(upResize,3) << "  " << fgToFixed(dnResize,3)
+        << fgnl << "fgResampleSimple  " << fgToFixed(upSimple,3) << "  " << fgToFixed(dnSimple,3);
+    const char *        names[] = {"box","linear","mitchell","lanczos"};
+    double              up[4],
+                        dn[4];
+    for (uint ff=0; ff<4; ++ff) {
+        FgResampleFilter    filter = FgResampleFilter(ff);
+        up[ff] = rmsDiff(fgImgResample(lo,dstUp,filter),3.0);
+        dn[ff] = rmsDiff(fgImgResample(fine,dstDn,filter),0.0);
+        fgout << fgnl << std::left << setw(18) << names[ff] << fgToFixed(up[ff],3) << "  " << fgToFixed(dn[ff],3);
+    }
+    FGASSERT(std::abs(up[0]-upResize) < 0.01 * upResize);
+    FGASSERT(std::abs(up[1]-upSimple) < 0.01 * upSimple);  // Both bilinear when expanding
+    FGASSERT(up[2] < up[1]);
+    FGASSERT(up[3] < up[2]);
+    for (uint ff=0; ff<4; ++ff)
+        FGASSERT(dn[ff] < 0.1 * dnSimple);
+    // Constant images are unchanged for all pixel types:
+    FgVect2UI           dims(37,23),
+                        dst(90,11);
+    for (uint ff=0; ff<4; ++ff) {
+        FgResampleFilter    filter = FgResampleFilter(ff);
+        FgImgResampler      rs(dims,dst,filter);
+        FgImgUC             iuc(dims,uchar(200)),
+                            ouc;
+        rs.apply(iuc,ouc);
+        FGASSERT(ouc.m_data == vector<uchar>(ouc.numPixels(),uchar(200)));
+        FgImgD              id(dims,0.3),
+                            od;
+        rs.apply(id,od);
+        for (size_t ii=0; ii<od.numPixels(); ++ii)
+            FGASSERT(std::abs(od[ii]-0.3) < 1.0e-6);
+        FgImg3F             i3(dims,FgVect3F(1,2,3)),
+                            o3;
+        rs.apply(i3,o3);
+        for (size_t ii=0; ii<o3.numPixels(); ++ii)
+            FGASSERT((o3[ii]-FgVect3F(1,2,3)).mag() < 1.0e-8f);
+        FgImgRgbaF          i4(dims,FgRgbaF(1,2,3,4)),
+                            o4;
+        rs.apply(i4,o4);
+        for (size_t ii=0; ii<o4.numPixels(); ++ii)
+            FGASSERT((o4[ii].m_c-FgVect4F(1,2,3,4)).mag() < 1.0e-8f);
+    }
+}
+
+// Rotation of 'dims' about its centre, mapping output IPCS to source IPCS:
+static
+FgAffine2F
+rotation(FgVect2UI dims,float radians)
+{
+    FgMat22F        rot = fgMatRotate(radians);
+    FgVect2F        ctr = FgVect2F(dims) * 0.5f;
+    return FgAffine2F(rot,ctr-rot*ctr);
+}
+
+static
+void
+testWarp(const FgArgs &)
+{
+    fgRandSeedRepeatable();
+    FgImgRgbaUb         img(203,157);
+    for (size_t ii=0; ii<img.numPixels(); ++ii)
+        for (uint cc=0; cc<4; ++cc)
+            img[ii].m_c[cc] = uchar(fgRandUint(256));
+    FgImg3F             img3 = fgImgToF3(img);
+    // Identity is exact for both interpolations:
+    FgWarpMap           ident(img.dims(),FgAffine2F());
+    for (uint ii=0; ii<2; ++ii) {
+        FgWarpInterp    interp = (ii == 0) ? FgWarpInterp::bilinear : FgWarpInterp::bicubic;
+        FgImgRgbaUb     out;
+        fgImgWarp(img,ident,out,interp);
+        FGASSERT(out.m_data == img.m_data);
+    }
+    // Bilinear with clamped border matches 'fgBlerpClipIpcs':
+    FgVect2UI           dims(240,190);
+    FgAffine2F          rot = rotation(dims,0.3f);
+    FgWarpMap           map(dims,rot);
+    FgImg3F             out3;
+    fgImgWarp(img3,map,out3);
+    for (FgIter2UI it(dims); it.valid(); it.next()) {
+        FgVect3F        ref(fgBlerpClipIpcs(img3,rot*(FgVect2F(it())+FgVect2F(0.5f))));
+        FGASSERT((out3[it()]-ref).mag() < 1.0e-3f);     // Coordinates differ by float rounding
+    }
+    // Dense, affine and projective maps of the same transform agree:
+    FgImage<FgVect2F>   dense(dims);
+    for (FgIter2UI it(dims); it.valid(); it.next())
+        dense[it()] = rot * (FgVect2F(it())+FgVect2F(0.5f));
+    FgMat33F            homog(
+        rot.linear.rc(0,0),rot.linear.rc(0,1),rot.translation[0],
+        rot.linear.rc(1,0),rot.linear.rc(1,1),rot.translation[1],
+        0,0,1);
+    homog *= 2.0f;                      // Homogeneous scale has no effect
+    FgImgRgbaUb         outA,outD,outP,outP1,outPlan;
+    fgImgWarp(img,map,outA,FgWarpInterp::bicubic,FgWarpBorder::zero,4);
+    fgImgWarp(img,FgWarpMap(dense),outD,FgWarpInterp::bicubic,FgWarpBorder::zero,4);
+    fgImgWarp(img,FgWarpMap(dims,homog),outP,FgWarpInterp::bicubic,FgWarpBorder::zero,4);
+    fgImgWarp(img,FgWarpMap(dims,homog),outP1,FgWarpInterp::bicubic,FgWarpBorder::zero,1);
+    FGASSERT(outP.m_data == outP1.m_data);
+    for (size_t ii=0; ii<outA.numPixels(); ++ii) {
+        for (uint cc=0; cc<4; ++cc) {
+            FGASSERT(std::abs(int(outA[ii].m_c[cc])-int(outD[ii].m_c[cc])) <= 1);
+            FGASSERT(std::abs(int(outA[ii].m_c[cc])-int(outP[ii].m_c[cc])) <= 1);
+        }
+    }
+    // Zero border makes the corners (outside the rotated source) transparent:
+    FGASSERT(outA.xy(0,0) == FgRgbaUB(0,0,0,0));
+    FGASSERT(outA.xy(dims[0]-1,dims[1]-1) == FgRgbaUB(0,0,0,0));
+    // A plan gives identical results for all pixel types:
+    FgWarpPlan          plan(img.dims(),map,FgWarpInterp::bicubic,FgWarpBorder::zero);
+    plan.apply(img,outPlan);
+    FGASSERT(outPlan.m_data == outA.m_data);
+    for (uint ii=0; ii<2; ++ii) {
+        FgWarpBorder    border = (ii == 0) ? FgWarpBorder::clamp : FgWarpBorder::zero;
+        FgWarpPlan      plan3(img.dims(),map,FgWarpInterp::bilinear,border);
+        FgImg3F         w3,p3;
+        fgImgWarp(img3,map,w3,FgWarpInterp::bilinear,border);
+        plan3.apply(img3,p3);
+        FGASSERT(w3.m_data == p3.m_data);
+        FgImgUC         grey(img.dims()),wg,pg;
+        for (size_t pp=0; pp<grey.numPixels(); ++pp)
+            grey[pp] = img[pp].red();
+        fgImgWarp(grey,map,wg,FgWarpInterp::bilinear,border);
+        plan3.apply(grey,pg);
+        FGASSERT(wg.m_data == pg.m_data);
+    }
+    // Bicubic reproduces a linear ramp away from the borders:
+    FgImgF              ramp(64,64);
+    for (FgIter2UI it(ramp.dims()); it.valid(); it.next())
+        ramp[it()] = 2.0f * it()[0] + 3.0f * it()[1];
+    FgImgF              rampOut;
+    FgAffine2F          rrot = rotation(ramp.dims(),0.2f);
+    fgImgWarp(ramp,FgWarpMap(ramp.dims(),rrot),rampOut,FgWarpInterp::bicubic);
+    for (FgIter2UI it(FgVect2UI(24),FgVect2UI(40)); it.valid(); it.next()) {
+        FgVect2F        ircs = rrot * (FgVect2F(it())+FgVect2F(0.5f)) - FgVect2F(0.5f);
+        FGASSERT(std::abs(rampOut[it()] - (2.0f*ircs[0] + 3.0f*ircs[1])) < 1.0e-3f);
+    }
+}
+
+static
+void
+testView(const FgArgs &)
+{
+    // A const image only gives a const view:
+    FGASSERT((boost::is_convertible<const FgImgF &,FgImgView<const float> >::value));
+    FGASSERT((!boost::is_convertible<const FgImgF &,FgImgView<float> >::value));
+    FGASSERT((boost::is_convertible<FgImgF &,FgImgView<float> >::value));
+    fgRandSeedRepeatable();
+    FgImgF              img(37,29);
+    for (size_t ii=0; ii<img.numPixels(); ++ii)
+        img[ii] = float(fgRand());
+    FgVect2UI           roiPos(5,3),
+                        roiDims(20,16);
+    // In-place processing of a sub-image matches processing a copy and leaves the rest alone:
+    FgImgF              orig = img,
+                        crop = fgCropPad(img,roiDims,FgVect2I(roiPos)),
+                        ref;
+    FGASSERT(crop.m_data == FgImgF(fgSubImage(orig,roiPos,roiDims)).m_data);
+    fgSmoothFloat(crop,ref,1);
+    FgImgView<float>    roi = fgSubImage(img,roiPos,roiDims);
+    fgSmoothFloat(roi,roi,1);
+    FGASSERT(FgImgF(roi).m_data == ref.m_data);
+    for (FgIter2UI it(img.dims()); it.valid(); it.next()) {
+        FgVect2UI       rr = it() - roiPos;
+        if ((it()[0] < roiPos[0]) || (it()[1] < roiPos[1]) || (rr[0] >= roiDims[0]) || (rr[1] >= roiDims[1]))
+            FGASSERT(img[it()] == orig[it()]);
+    }
+    fgImgFlipVertical(roi);
+    fgImgFlipVertical(ref);
+    FGASSERT(FgImgF(roi).m_data == ref.m_data);
+    FgImgF              sh0,sh1;
+    fgShrink2Float(roi,sh0);
+    fgShrink2Float(ref,sh1);
+    FGASSERT(sh0.m_data == sh1.m_data);
+    // Crop with padding on both sides:
+    FgImgF              cp = fgCropPad(img,FgVect2UI(50,20),FgVect2I(-4,6),-1.0f);
+    for (FgIter2UI it(cp.dims()); it.valid(); it.next()) {
+        FgVect2I        sp = FgVect2I(it()) + FgVect2I(-4,6);
+        if ((sp[0] < 0) || (sp[1] < 0) || (sp[0] >= int(img.width())) || (sp[1] >= int(img.height())))
+            FGASSERT(cp[it()] == -1.0f);
+        else
+            FGASSERT(cp[it()] == img[FgVect2UI(sp)]);
+    }
+    // Aligned storage pads rows to 64 byte boundaries and gives the same results:
+    FgImg3F             img3(img.dims());
+    for (size_t ii=0; ii<img3.numPixels(); ++ii)
+        img3[ii] = FgVect3F(img[ii],2.0f*img[ii],3.0f);
+    FgImgAligned<FgVect3F> al(img3);
+    FGASSERT(al.stride() >= al.width());
+    FGASSERT((al.stride() * sizeof(FgVect3F)) % 64 == 0);
+    for (uint yy=0; yy<al.height(); ++yy)
+        FGASSERT(size_t(al.rowPtr(yy)) % 64 == 0);
+    FGASSERT(al.image().m_data == img3.m_data);
+    FgImg3F             c0;
+    FgMat33F            krn(1,2,1,2,4,2,1,2,1);
+    fgConvolveFloat(img3,krn,c0,0);
+    FgImgAligned<FgVect3F>  alOut(img3.dims());
+    fgConvolveFloat(al.view(),krn,alOut.view(),0);
+    FGASSERT(alOut.image().m_data == c0.m_data);
+    FGASSERT(fgBlerpClipIpcs(al.view(),FgVect2F(3.3f,7.9f)) == fgBlerpClipIpcs(img3,FgVect2F(3.3f,7.9f)));
+    // Concatenation:
+    FgImgF              cat = fgConcatHoriz(crop,ref);
+    FGASSERT(FgImgF(fgSubImage(cat,FgVect2UI(roiDims[0],0),roiDims)).m_data == ref.m_data);
+    cat = fgConcatVert(crop,ref);
+    FGASSERT(FgImgF(fgSubImage(cat,FgVect2UI(0,roiDims[1]),roiDims)).m_data == ref.m_data);
+}
+
+static
+void
+testFormats(const FgArgs & args)
+{
+    FGTESTDIR
+    // Native TGA matches ImageMagick:
+    FgString            glasses = fgDataDir()+"base/Glasses.tga";
+    FgImgRgbaUb         native,magick;
+    fgLoadImgAnyFormat(glasses,native);
+    fgLoadImgMagick(glasses,magick);
+    FGASSERT(native.dims() == FgVect2UI(128,128));
+    FGASSERT(native.m_data == magick.m_data);
+    // Test image with random alpha, and flat and noisy runs to exercise both RLE packet types:
+    fgRandSeedRepeatable();
+    FgImgRgbaUb         orig = fgLoadImgAnyFormat(fgDataDir()+"base/Lenna512.png");
+    orig = FgImgRgbaUb(fgSubImage(orig,FgVect2UI(0,0),FgVect2UI(301,203)));
+    for (size_t ii=0; ii<orig.numPixels(); ++ii)
+        orig[ii].alpha() = uchar(fgRandUint(256));
+    fgImgFill(fgSubImage(orig,FgVect2UI(10,20),FgVect2UI(250,30)),FgRgbaUB(1,2,3,4));
+    FgImgRgbaUb         opaque = orig,
+                        img;
+    for (size_t ii=0; ii<opaque.numPixels(); ++ii)
+        opaque[ii].alpha() = 255;
+    fgSaveTga("raw.tga",orig);
+    fgSaveTga("rle.tga",orig,true);
+    FGASSERT(fgSlurp("rle.tga").size() < fgSlurp("raw.tga").size());
+    for (uint ii=0; ii<2; ++ii) {
+        string          name = (ii == 0) ? "raw.tga" : "rle.tga";
+        fgLoadImgAnyFormat(name,img);
+        FGASSERT(img.m_data == orig.m_data);
+        fgLoadImgMagick(name,img);
+        FGASSERT(img.m_data == orig.m_data);
+    }
+    // ImageMagick output (bottom-up origin) reads natively:
+    fgSaveImgMagick("magick.tga",orig);
+    fgLoadImgAnyFormat("magick.tga",img);
+    FGASSERT(img.m_data == orig.m_data);
+    // PPM / PGM:
+    fgSaveImgAnyFormat("test.ppm",orig);
+    fgLoadImgAnyFormat("test.ppm",img);
+    FGASSERT(img.m_data == opaque.m_data);
+    fgLoadImgMagick("test.ppm",img);
+    FGASSERT(img.m_data == opaque.m_data);
+    fgSaveImgMagick("magick.ppm",orig);
+    fgLoadImgAnyFormat("magick.ppm",img);
+    FGASSERT(img.m_data == opaque.m_data);
+    fgSaveImgAnyFormat("test.pgm",orig);
+    fgLoadImgAnyFormat("test.pgm",img);
+    for (size_t ii=0; ii<img.numPixels(); ++ii)
+        FGASSERT(img[ii] == FgRgbaUB(orig[ii].rec709(),orig[ii].rec709(),orig[ii].rec709(),255));
+    // 16-bit PGM with a header comment:
+    string              pgm16 = "P5\n# comment\n2 1\n65535\n";
+    pgm16 += string("\x00\x00\xFF\xFF",4);
+    fgDump(pgm16,"16.pgm");
+    fgLoadImgAnyFormat("16.pgm",img);
+    FGASSERT((img.dims() == FgVect2UI(2,1)) && (img[0] == FgRgbaUB(0,0,0,255)) && (img[1] == FgRgbaUB(255,255,255,255)));
+    // PFM:
+    FgImg3F             img3(orig.dims()),
+                        img3b;
+    for (size_t ii=0; ii<img3.numPixels(); ++ii)
+        img3[ii] = FgVect3F(orig[ii].red(),orig[ii].green(),orig[ii].blue()) / 255.0f;
+    fgSavePfm("test.pfm",img3);
+    FgFileMap           pfm("test.pfm");
+    fgLoadPfm(pfm.data,pfm.size,img3b);
+    FGASSERT(img3b.m_data == img3.m_data);
+    fgLoadImgAnyFormat("test.pfm",img);
+    FGASSERT(img.m_data == opaque.m_data);
+    FgImgF              imgF(orig.dims()),
+                        imgFb;
+    for (size_t ii=0; ii<imgF.numPixels(); ++ii)
+        imgF[ii] = float(fgRand());
+    fgSavePfm("grey.pfm",imgF);
+    fgLoadImgAnyFormat("grey.pfm",imgFb);
+    FGASSERT(imgFb.m_data == imgF.m_data);
+    // FGRAW:
+    fgSaveImgAnyFormat("test.fgraw",orig);
+    fgLoadImgAnyFormat("test.fgraw",img);
+    FGASSERT(img.m_data == orig.m_data);
+    fgSaveImgRaw("grey.fgraw",imgF);
+    fgLoadImgAnyFormat("grey.fgraw",imgFb);
+    FGASSERT(imgFb.m_data == imgF.m_data);
+    fgSaveImgRaw("rgb.fgraw",img3);
+    FgFileMap           raw("rgb.fgraw");
+    fgLoadImgRaw(raw.data,raw.size,img3b);
+    FGASSERT(img3b.m_data == img3.m_data);
+    // Other FGRAW pixel types convert to RGBA:
+    fgLoadImgAnyFormat("rgb.fgraw",img);
+    FGASSERT(img.m_data == opaque.m_data);
+    FgImgUC             grey(orig.dims());
+    for (size_t ii=0; ii<grey.numPixels(); ++ii)
+        grey[ii] = orig[ii].red();
+    fgSaveImgRaw("grey8.fgraw",grey);
+    fgLoadImgAnyFormat("grey8.fgraw",img);
+    for (size_t ii=0; ii<img.numPixels(); ++ii)
+        FGASSERT(img[ii] == FgRgbaUB(grey[ii],grey[ii],grey[ii],255));
+    bool                threw = false;
+    try {
+        fgLoadImgRaw(raw.data,raw.size,imgFb);
+    }
+    catch (FgException &) {
+        threw = true;
+    }
+    FGASSERT(threw);
+}
+
+static
+void
+testJpeg(const FgArgs &)
+{
+    // Odd dimensions to check that reduced dimensions are rounded up:
+    FgImgRgbaUb         lenna = fgLoadImgAnyFormat(fgDataDir()+"base/Lenna512.png"),
+                        orig(fgSubImage(lenna,FgVect2UI(0,0),FgVect2UI(509,301)));
+    vector<uchar>       data;
+    fgImgSaveJfif(orig,data,90);
+    FGASSERT(fgImgJfifDims(data) == orig.dims());
+    FgImgRgbaUb         full,img;
+    fgImgLoadJfif(data,full);
+    FGASSERT(full.dims() == orig.dims());
+    fgImgLoadJfif(data,img,1);
+    FGASSERT(img.m_data == full.m_data);
+    // Reduced decodes are close to a box filtered full decode (whose odd dimensions are rounded down):
+    FgImgRgbaUb         shrunk = full;
+    for (uint denom=2; denom<=8; denom*=2) {
+        fgImgLoadJfif(data,img,denom);
+        FGASSERT(img.dims() == (orig.dims() + FgVect2UI(denom-1)) / denom);
+        shrunk = fgImgShrink2(shrunk);
+        double          rmsd = fgImgDiff(fgSubImage(img,FgVect2UI(0),shrunk.dims()),shrunk).rmsd();
+        fgout << fgnl << "1/" << denom << " " << img.dims() << " RMSD vs box filtered: " << rmsd;
+        FGASSERT(rmsd < 4.0);
+        for (size_t ii=0; ii<img.numPixels(); ++ii)
+            FGASSERT(img[ii].alpha() == 255);
+    }
+    // Decode to fit:
+    FGASSERT(fgImgFitDims(FgVect2UI(400,200),FgVect2UI(100,100)) == FgVect2UI(100,50));
+    FGASSERT(fgImgFitDims(FgVect2UI(40,20),FgVect2UI(100,100)) == FgVect2UI(40,20));
+    FGASSERT(fgImgFitDims(FgVect2UI(1000,1),FgVect2UI(10,10)) == FgVect2UI(10,1));
+    img = fgImgLoadJfifFit(data,FgVect2UI(128,128));
+    FGASSERT(img.dims() == fgImgFitDims(orig.dims(),FgVect2UI(128,128)));
+    FgImgRgbaUb         quarter;
+    fgImgLoadJfif(data,quarter,4);
+    FGASSERT(img.m_data == quarter.m_data);                 // 1/4 decode is exactly 128x76
+    img = fgImgLoadJfifFit(data,FgVect2UI(100,100));        // 1/4 decode box filtered down
+    FGASSERT(img.dims() == FgVect2UI(100,59));
+    FGASSERT(fgImgDiff(img,fgImgResample(quarter,img.dims(),FgResampleFilter::box)).rmsd() == 0.0);
+    img = fgImgLoadJfifFit(data,FgVect2UI(64,1000));        // Exactly 1/8 in width
+    FGASSERT(img.dims() == FgVect2UI(64,38));
+    img = fgImgLoadJfifFit(data,FgVect2UI(1000,1000));      // Never enlarged
+    FGASSERT(img.m_data == full.m_data);
+    // Grayscale source:
+    FgImgUC             grey;
+    fgImgConvert(orig,grey);
+    FgImgRgbaUb         greyRgba;
+    fgImgConvert(grey,greyRgba);
+    fgImgSaveJfif(greyRgba,data,90);
+    fgImgLoadJfif(data,img,4);
+    FGASSERT(img.dims() == (orig.dims() + FgVect2UI(3)) / 4);
+}
+
+// Direct evaluation of mean SSIM for comparison:
+static
+double
+ssimRef(const FgImgF & x,const FgImgF & y,double range)
+{
+    double          g[11],
+                    gs = 0.0;
+    for (int ii=0; ii<11; ++ii) {
+        g[ii] = std::exp(-double((ii-5)*(ii-5)) / (2.0*1.5*1.5));
+        gs += g[ii];
+    }
+    double          c1 = fgSqr(0.01*range),
+                    c2 = fgSqr(0.03*range),
+                    acc = 0.0;
+    FgVect2UI       dims = x.dims() - FgVect2UI(10);
+    for (FgIter2UI it(dims); it.valid(); it.next()) {
+        double      mx = 0,my = 0,sxx = 0,syy = 0,sxy = 0;
+        for (uint jj=0; jj<11; ++jj) {
+            for (uint ii=0; ii<11; ++ii) {
+                double      w = g[ii]*g[jj]/(gs*gs),
+                            xv = x.xy(it()[0]+ii,it()[1]+jj),
+                            yv = y.xy(it()[0]+ii,it()[1]+jj);
+                mx += w*xv;
+                my += w*yv;
+                sxx += w*xv*xv;
+                syy += w*yv*yv;
+                sxy += w*xv*yv;
+            }
+        }
+        acc += ((2*mx*my + c1) * (2*(sxy-mx*my) + c2)) /
+               ((mx*mx + my*my + c1) * (sxx-mx*mx + syy-my*my + c2));
+    }
+    return acc / double(dims[0]*dims[1]);
+}
+
+static
+void
+testMetrics(const FgArgs &)
+{
+    fgRandSeedRepeatable();
+    FgImgRgbaUb         a(203,157),
+                        b(a.dims());
+    FgImgUC             mask(a.dims());
+    for (size_t ii=0; ii<a.numPixels(); ++ii) {
+        for (uint cc=0; cc<4; ++cc) {
+            int         v = int(fgRandUint(256));
+            a[ii].m_c[cc] = uchar(v);
+            b[ii].m_c[cc] = uchar(fgClip(v + int(fgRandUint(41)) - 20,0,255));
+        }
+        mask[ii] = (fgRandUint(3) == 0) ? 0 : 255;
+    }
+    // 8-bit sums are exact so agree with the scalar templates for any number of threads:
+    FgImgDiff           d1 = fgImgDiff(a,b,1),
+                        d4 = fgImgDiff(a,b,4);
+    FGASSERT((d1.ssd == d4.ssd) && (d1.sad == d4.sad) && (d1.count == a.numPixels()));
+    FGASSERT(fgSumElems(d1.ssd) == fgImgSsd(fgImgView(a),fgImgView(b)));
+    FGASSERT(fgSumElems(d1.sad) == fgImgSad(fgImgView(a),fgImgView(b)));
+    FGASSERT(fgImgRmsd(a,b) == std::sqrt(fgImgSsd(fgImgView(a),fgImgView(b)) / double(a.numPixels())));
+    FgVect4D            ssdRef(0.0),
+                        sadRef(0.0);
+    size_t              cnt = 0;
+    for (size_t ii=0; ii<a.numPixels(); ++ii) {
+        if (mask[ii] == 0)
+            continue;
+        ++cnt;
+        for (uint cc=0; cc<4; ++cc) {
+            double      d = double(a[ii].m_c[cc]) - double(b[ii].m_c[cc]);
+            ssdRef[cc] += d*d;
+            sadRef[cc] += std::abs(d);
+        }
+    }
+    FgImgDiff           dm = fgImgDiff(a,b,mask,4);
+    FGASSERT((dm.ssd == ssdRef) && (dm.sad == sadRef) && (dm.count == cnt));
+    // Strided sub-images:
+    FgVect2UI           pos(3,5),
+                        sz(101,77);
+    FgImgDiff           ds = fgImgDiff(fgSubImage(a,pos,sz),fgSubImage(b,pos,sz));
+    FgImgRgbaUb         sa(fgSubImage(a,pos,sz)),
+                        sb(fgSubImage(b,pos,sz));
+    FGASSERT(ds.ssd == fgImgDiff(sa,sb).ssd);
+    // Float values here are integers whose row sums are exact:
+    FgImg3F             a3 = fgImgToF3(a),
+                        b3 = fgImgToF3(b);
+    FgImg4F             a4 = toF4(a),
+                        b4 = toF4(b);
+    FgImgDiff           d3 = fgImgDiff(a3,b3),
+                        d4f = fgImgDiff(a4,b4),
+                        d3m = fgImgDiff(a3,b3,mask);
+    FgImgUC             ga(a.dims()),
+                        gb(a.dims());
+    FgImgF              fa(a.dims()),
+                        fb(a.dims());
+    for (size_t ii=0; ii<a.numPixels(); ++ii) {
+        ga[ii] = a[ii].red();
+        gb[ii] = b[ii].red();
+        fa[ii] = a[ii].red();
+        fb[ii] = b[ii].red();
+    }
+    FgImgDiff           dg = fgImgDiff(ga,gb),
+                        df = fgImgDiff(fa,fb,mask);
+    for (uint cc=0; cc<3; ++cc) {
+        FGASSERT((d3.ssd[cc] == d1.ssd[cc]) && (d3.sad[cc] == d1.sad[cc]));
+        FGASSERT((d3m.ssd[cc] == dm.ssd[cc]) && (d3m.sad[cc] == dm.sad[cc]));
+    }
+    FGASSERT((d4f.ssd == d1.ssd) && (d4f.sad == d1.sad));
+    FGASSERT((dg.ssd[0] == d1.ssd[0]) && (dg.sad[0] == d1.sad[0]));
+    FGASSERT((df.ssd[0] == dm.ssd[0]) && (df.count == cnt));
+    // PSNR:
+    double              mse = (d1.ssd[0]+d1.ssd[1]+d1.ssd[2]) / (3.0*a.numPixels());
+    FGASSERT(fgApproxEqual(fgImgPsnr(a,b),10.0*std::log10(255.0*255.0/mse)));
+    FGASSERT(fgImgPsnr(a,a) == numeric_limits<double>::infinity());
+    // SSIM agrees with direct evaluation, is 1 for identical images and doesn't depend on threads:
+    FgImgF              xs(40,33),
+                        ys(xs.dims());
+    for (FgIter2UI it(xs.dims()); it.valid(); it.next()) {
+        xs[it()] = fa[it()] / 255.0f;
+        ys[it()] = fb[it()] / 255.0f;
+    }
+    FGASSERT(std::abs(fgImgSsim(xs,ys) - ssimRef(xs,ys,1.0)) < 1.0e-4);
+    FGASSERT(std::abs(fgImgSsim(xs,xs) - 1.0) < 1.0e-4);
+    FgVect4D            ss1 = fgImgSsim(a,b,1),
+                        ss4 = fgImgSsim(a,b,4);
+    FGASSERT(ss1 == ss4);
+    FGASSERT(std::abs(ss1[0] - fgImgSsim(ga,gb)) < 1.0e-6);
+    FGASSERT((ss1[0] > 0.0) && (ss1[0] < 1.0));
+    // Histograms:
+    vector<FgHistogram> hists = fgImgHistogram(a,4);
+    for (uint cc=0; cc<4; ++cc) {
+        FgHistogram     ref(FgVectD2(0,256),256);
+        for (size_t ii=0; ii<a.numPixels(); ++ii)
+            ref.addSample(a[ii].m_c[cc]);
+        FGASSERT(hists[cc].binCounts == ref.binCounts);
+    }
+    FgHistogram         hf = fgImgHistogram(xs,FgVectD2(0,1),20,4),
+                        hfRef(FgVectD2(0,1),20);
+    for (size_t ii=0; ii<xs.numPixels(); ++ii)
+        hfRef.addSample(xs[ii]);
+    FGASSERT(hf.binCounts == hfRef.binCounts);
+    vector<double>      samples(200000);
+    for (size_t ii=0; ii<samples.size(); ++ii)
+        samples[ii] = fgRand() * 3.0 - 1.0;
+    FgHistogram         hs(FgVectD2(-0.5,1.5),37),
+                        hsRef(hs.bounds,37);
+    hs.addSamples(&samples[0],samples.size(),4);
+    for (size_t ii=0; ii<samples.size(); ++ii)
+        hsRef.addSample(samples[ii]);
+    FGASSERT(hs.binCounts == hsRef.binCounts);
+    FGASSERT(FgHistogram(samples,hs.bounds,37).binCounts == hsRef.binCounts);
+}
+
 void    fgImgTestWrite(const FgArgs &);
 
 void
@@ -97,6 +779,13 @@ fgImageTest(const FgArgs & args)
 {
     vector<FgCmd>       cmds;
     cmds.push_back(FgCmd(testConvolve,"conv"));
+    cmds.push_back(FgCmd(testFormats,"formats"));
+    cmds.push_back(FgCmd(testJpeg,"jpeg"));
+    cmds.push_back(FgCmd(testMetrics,"metrics"));
+    cmds.push_back(FgCmd(testPyramid,"pyramid"));
+    cmds.push_back(FgCmd(testResample,"resample"));
+    cmds.push_back(FgCmd(testView,"view"));
+    cmds.push_back(FgCmd(testWarp,"warp"));
     cmds.push_back(FgCmd(fgImgTestWrite,"write"));
     fgMenu(args,cmds,true,false,true);
 }
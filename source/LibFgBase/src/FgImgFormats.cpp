@@ -0,0 +1,719 @@
+//
+// Copyright (c) 2015 Singular Inversions Inc. (facegen.com)
+// Use, modification and distribution is subject to the MIT License,
+// see accompanying file LICENSE.txt or facegen.com/base_library_license.txt
+//
+
+#include "stdafx.h"
+
+#include "FgImgFormats.hpp"
+#include "FgFileSystem.hpp"
+#include "FgStdStream.hpp"
+#include "FgStdString.hpp"
+#include "FgPath.hpp"
+
+using namespace std;
+
+namespace {
+
+// Limits the sizes computed from header dimensions well within size_t:
+const uint          maxDim = 1U << 24;
+
+inline
+uint
+le16(const uchar * p)
+{return uint(p[0]) | (uint(p[1]) << 8); }
+
+inline
+uint
+le32(const uchar * p)
+{return uint(p[0]) | (uint(p[1]) << 8) | (uint(p[2]) << 16) | (uint(p[3]) << 24); }
+
+inline
+void
+putLe16(uchar * p,uint val)
+{
+    p[0] = uchar(val);
+    p[1] = uchar(val >> 8);
+}
+
+inline
+void
+putLe32(uchar * p,uint val)
+{
+    putLe16(p,val);
+    putLe16(p+2,val >> 16);
+}
+
+void
+writeFile(const FgString & fname,const vector<uchar> & buf)
+{
+    FgOfstream      ofs(fname);
+    ofs.write(reinterpret_cast<const char*>(buf.data()),buf.size());
+    if (!ofs)
+        fgThrow("Unable to write image file",fname);
+}
+
+void
+checkDims(uint width,uint height)
+{
+    if ((width == 0) || (height == 0) || (width > maxDim) || (height > maxDim))
+        fgThrow("Invalid image dimensions",fgToString(width)+"x"+fgToString(height));
+}
+
+inline
+uchar
+unitToByte(float val)
+{return uchar((val > 0.0f) ? ((val < 1.0f) ? val*255.0f+0.5f : 255.0f) : 0.0f); }     // NaN to 0
+
+// The channel bytes of a run of RGBA pixels:
+inline
+uchar *
+rgbaBytes(FgRgbaUB * pix)
+{
+    FG_STATIC_ASSERT(sizeof(FgRgbaUB) == 4);
+    return reinterpret_cast<uchar*>(pix);
+}
+
+inline
+const uchar *
+rgbaBytes(const FgRgbaUB * pix)
+{
+    FG_STATIC_ASSERT(sizeof(FgRgbaUB) == 4);
+    return reinterpret_cast<const uchar*>(pix);
+}
+
+// Whitespace separated header fields of PNM and PFM, with '#' comments to the end of the line:
+struct  PnmHeader
+{
+    const uchar *   data;
+    size_t          size;
+    size_t          pos;
+
+    PnmHeader(const uchar * d,size_t s) : data(d), size(s), pos(2) {}   // After the magic number
+
+    static
+    bool
+    isSpace(uchar c)
+    {return ((c == ' ') || (c == '\t') || (c == '\n') || (c == '\r') || (c == '\v') || (c == '\f')); }
+
+    string
+    field()
+    {
+        for (;;) {
+            if (pos >= size)
+                fgThrow("Truncated image header");
+            if (data[pos] == '#')
+                while ((pos < size) && (data[pos] != '\n'))
+                    ++pos;
+            else if (isSpace(data[pos]))
+                ++pos;
+            else
+                break;
+        }
+        size_t          start = pos;
+        while ((pos < size) && !isSpace(data[pos]) && (data[pos] != '#'))
+            ++pos;
+        return string(data+start,data+pos);
+    }
+
+    uint
+    uintField()
+    {
+        string          str = field();
+        if (str.size() > 9)
+            fgThrow("Image header value out of range",str);
+        uint            ret = 0;
+        for (size_t ii=0; ii<str.size(); ++ii) {
+            if ((str[ii] < '0') || (str[ii] > '9'))
+                fgThrow("Invalid image header value",str);
+            ret = ret * 10 + uint(str[ii] - '0');
+        }
+        return ret;
+    }
+
+    // A single whitespace character separates the header from the binary data, which must
+    // contain at least 'bytes':
+    const uchar *
+    body(size_t bytes)
+    {
+        if ((pos >= size) || !isSpace(data[pos]))
+            fgThrow("Invalid image header termination");
+        ++pos;
+        if (size - pos < bytes)
+            fgThrow("Truncated image data");
+        return data + pos;
+    }
+};
+
+struct  Pfm
+{
+    FgVect2UI       dims;
+    uint            channels;
+    bool            bigEndian;
+    const uchar *   body;
+
+    Pfm(const uchar * data,size_t size)
+    {
+        if ((size < 2) || (data[0] != 'P') || ((data[1] != 'F') && (data[1] != 'f')))
+            fgThrow("Not a PFM file");
+        channels = (data[1] == 'F') ? 3 : 1;
+        PnmHeader       hdr(data,size);
+        dims[0] = hdr.uintField();
+        dims[1] = hdr.uintField();
+        checkDims(dims[0],dims[1]);
+        // Scale field: the sign gives the byte order and the magnitude is ignored:
+        bigEndian = (hdr.field()[0] != '-');
+        body = hdr.body(size_t(dims[0])*dims[1]*channels*4);
+    }
+
+    // Sample 'cc' of pixel 'xx' of image row 'yy' (file rows are stored bottom to top):
+    float
+    val(uint xx,uint yy,uint cc) const
+    {
+        const uchar *   p = body + ((size_t(dims[1]-1-yy)*dims[0] + xx)*channels + cc)*4;
+        uchar           bytes[4] = {p[0],p[1],p[2],p[3]};
+        if (bigEndian) {
+            std::swap(bytes[0],bytes[3]);
+            std::swap(bytes[1],bytes[2]);
+        }
+        float           ret;
+        memcpy(&ret,bytes,4);
+        return ret;
+    }
+};
+
+void
+tgaRows(
+    const uchar *   pix,            // Uncompressed pixels in file order
+    uint            bytesPP,
+    bool            topDown,
+    FgImgRgbaUb &   img)
+{
+    uint            wid = img.width(),
+                    hgt = img.height();
+    for (uint yy=0; yy<hgt; ++yy) {
+        const uchar *   s = pix + size_t(topDown ? yy : hgt-1-yy) * wid * bytesPP;
+        uchar *         d = rgbaBytes(img.dataPtr()+size_t(yy)*wid);
+        if (bytesPP == 4) {
+            for (uint xx=0; xx<wid; ++xx,s+=4,d+=4) {
+                d[0] = s[2];
+                d[1] = s[1];
+                d[2] = s[0];
+                d[3] = s[3];
+            }
+        }
+        else if (bytesPP == 3) {
+            for (uint xx=0; xx<wid; ++xx,s+=3,d+=4) {
+                d[0] = s[2];
+                d[1] = s[1];
+                d[2] = s[0];
+                d[3] = 255;
+            }
+        }
+        else {
+            for (uint xx=0; xx<wid; ++xx,++s,d+=4) {
+                d[0] = d[1] = d[2] = s[0];
+                d[3] = 255;
+            }
+        }
+    }
+}
+
+void
+tgaPixel(const FgRgbaUB & p,vector<uchar> & buf)
+{
+    buf.push_back(p.blue());
+    buf.push_back(p.green());
+    buf.push_back(p.red());
+    buf.push_back(p.alpha());
+}
+
+// Packets do not cross rows, as required by TGA 2.0:
+void
+tgaRleRow(const FgRgbaUB * row,uint wid,vector<uchar> & buf)
+{
+    uint            xx = 0;
+    while (xx < wid) {
+        uint            run = 1;
+        while ((xx+run < wid) && (run < 128) && (row[xx+run] == row[xx]))
+            ++run;
+        if (run > 1) {
+            buf.push_back(uchar(0x80 | (run-1)));
+            tgaPixel(row[xx],buf);
+            xx += run;
+        }
+        else {
+            uint        start = xx,
+                        cnt = 0;
+            do {
+                ++xx;
+                ++cnt;
+            } while ((xx < wid) && (cnt < 128) && !((xx+1 < wid) && (row[xx] == row[xx+1])));
+            buf.push_back(uchar(cnt-1));
+            for (uint ii=start; ii<xx; ++ii)
+                tgaPixel(row[ii],buf);
+        }
+    }
+}
+
+// Raw container pixel types:
+template<class T> struct RawType;
+template<> struct RawType<FgRgbaUB> {static const uint channels = 4, bytes = 1; };
+template<> struct RawType<uchar>    {static const uint channels = 1, bytes = 1; };
+template<> struct RawType<float>    {static const uint channels = 1, bytes = 4; };
+template<> struct RawType<FgVect3F> {static const uint channels = 3, bytes = 4; };
+template<> struct RawType<FgVect4F> {static const uint channels = 4, bytes = 4; };
+
+const size_t        rawHeaderSize = 16;
+
+struct  RawHeader
+{
+    FgVect2UI       dims;
+    uint            channels;
+    uint            bytes;          // Per channel
+    const uchar *   body;
+
+    RawHeader(const uchar * data,size_t size)
+    {
+        if ((size < rawHeaderSize) || (memcmp(data,"FGRW",4) != 0))
+            fgThrow("Not an FGRAW file");
+        dims = FgVect2UI(le32(data+4),le32(data+8));
+        channels = le16(data+12);
+        bytes = le16(data+14);
+        if ((dims[0] > maxDim) || (dims[1] > maxDim) || (channels < 1) || (channels > 4) ||
+            ((bytes != 1) && (bytes != 4)))
+            fgThrow("Invalid FGRAW header");
+        if (size - rawHeaderSize < size_t(dims[0])*dims[1]*channels*bytes)
+            fgThrow("Truncated FGRAW data");
+        body = data + rawHeaderSize;
+    }
+
+    // Channel 'cc' of pixel 'idx' as float:
+    float
+    val(size_t idx,uint cc) const
+    {
+        const uchar *   p = body + (idx*channels + cc)*bytes;
+        if (bytes == 1)
+            return float(*p);
+        float           ret;
+        memcpy(&ret,p,4);
+        return ret;
+    }
+};
+
+template<class T>
+void
+loadRaw(const uchar * data,size_t size,FgImage<T> & img)
+{
+    RawHeader           hdr(data,size);
+    if ((hdr.channels != RawType<T>::channels) || (hdr.bytes != RawType<T>::bytes))
+        fgThrow("FGRAW pixel type mismatch",fgToString(hdr.channels)+" channels of "+fgToString(hdr.bytes)+" bytes");
+    img.resize(hdr.dims);
+    if (img.numPixels() > 0)
+        memcpy(img.dataPtr(),hdr.body,img.numPixels()*sizeof(T));
+}
+
+// Any FGRAW file to RGBA. Float values are converted as for PFM, 1 and 2 channels are grey
+// (and alpha):
+void
+loadRawRgba(const uchar * data,size_t size,FgImgRgbaUb & img)
+{
+    RawHeader           hdr(data,size);
+    if ((hdr.channels == 4) && (hdr.bytes == 1)) {
+        loadRaw(data,size,img);
+        return;
+    }
+    img.resize(hdr.dims);
+    uchar *             d = rgbaBytes(img.dataPtr());
+    for (size_t ii=0; ii<img.numPixels(); ++ii,d+=4) {
+        uchar               vals[4] = {0,0,0,255};
+        for (uint cc=0; cc<hdr.channels; ++cc) {
+            float               val = hdr.val(ii,cc);
+            vals[cc] = (hdr.bytes == 1) ? uchar(val) : unitToByte(val);
+        }
+        if (hdr.channels < 3) {
+            vals[3] = (hdr.channels == 2) ? vals[1] : 255;
+            vals[1] = vals[2] = vals[0];
+        }
+        memcpy(d,vals,4);
+    }
+}
+
+template<class T>
+void
+saveRaw(const FgString & fname,const FgImage<T> & img)
+{
+    FG_STATIC_ASSERT(sizeof(T) == RawType<T>::channels * RawType<T>::bytes);
+    vector<uchar>       buf(rawHeaderSize + img.numPixels()*sizeof(T));
+    memcpy(&buf[0],"FGRW",4);
+    putLe32(&buf[4],img.width());
+    putLe32(&buf[8],img.height());
+    putLe16(&buf[12],RawType<T>::channels);
+    putLe16(&buf[14],RawType<T>::bytes);
+    if (img.numPixels() > 0)
+        memcpy(&buf[rawHeaderSize],img.dataPtr(),img.numPixels()*sizeof(T));
+    writeFile(fname,buf);
+}
+
+template<class T>
+void
+savePfm(const FgString & fname,const FgImage<T> & img,char type,uint channels)
+{
+    string              hdr = string("P") + type + "\n" + fgToString(img.width()) + " " +
+                            fgToString(img.height()) + "\n-1.0\n";
+    size_t              rowBytes = size_t(img.width()) * channels * 4;
+    vector<uchar>       buf(hdr.size() + rowBytes*img.height());
+    memcpy(&buf[0],hdr.data(),hdr.size());
+    for (uint yy=0; yy<img.height(); ++yy)
+        memcpy(&buf[hdr.size()+rowBytes*yy],img.dataPtr()+size_t(img.height()-1-yy)*img.width(),rowBytes);
+    writeFile(fname,buf);
+}
+
+string
+extLower(const FgString & fname)
+{return fgToLower(fgPathToExt(fname.m_str)); }
+
+}
+
+bool
+fgLoadTga(const uchar * data,size_t size,FgImgRgbaUb & img)
+{
+    if (size < 18)
+        fgThrow("Truncated TGA header");
+    uint            idLen = data[0],
+                    cmapType = data[1],
+                    type = data[2],
+                    cmapLen = le16(data+5),
+                    cmapBits = data[7],
+                    wid = le16(data+12),
+                    hgt = le16(data+14),
+                    bits = data[16],
+                    desc = data[17];
+    bool            trueColour = ((type == 2) || (type == 10)) && ((bits == 24) || (bits == 32)),
+                    grey = ((type == 3) || (type == 11)) && (bits == 8);
+    if ((!trueColour && !grey) || ((desc & 0xD0) != 0))     // Right-to-left or interleaved
+        return false;
+    checkDims(wid,hgt);
+    size_t          pos = 18 + idLen + ((cmapType != 0) ? cmapLen * ((cmapBits+7)/8) : 0);
+    uint            bytesPP = bits / 8;
+    size_t          total = size_t(wid) * hgt * bytesPP;
+    const uchar *   pix = data + pos;
+    vector<uchar>   unpacked;
+    if (type >= 9) {
+        unpacked.resize(total);
+        size_t          out = 0;
+        while (out < total) {
+            if (pos >= size)
+                fgThrow("Truncated TGA RLE data");
+            uint            packet = data[pos++];
+            size_t          bytes = ((packet & 0x7F) + 1) * bytesPP;
+            if (out + bytes > total)
+                fgThrow("TGA RLE data overruns image");
+            if (packet & 0x80) {
+                if (size - pos < bytesPP)
+                    fgThrow("Truncated TGA RLE data");
+                for (size_t ii=0; ii<bytes; ii+=bytesPP)
+                    memcpy(&unpacked[out+ii],data+pos,bytesPP);
+                pos += bytesPP;
+            }
+            else {
+                if (size - pos < bytes)
+                    fgThrow("Truncated TGA RLE data");
+                memcpy(&unpacked[out],data+pos,bytes);
+                pos += bytes;
+            }
+            out += bytes;
+        }
+        pix = &unpacked[0];
+    }
+    else if ((pos > size) || (size - pos < total))
+        fgThrow("Truncated TGA data");
+    img.resize(wid,hgt);
+    // As ImageMagick, 32-bit pixels always have alpha regardless of the descriptor alpha bits:
+    tgaRows(pix,bytesPP,(desc & 0x20) != 0,img);
+    return true;
+}
+
+bool
+fgLoadPnm(const uchar * data,size_t size,FgImgRgbaUb & img)
+{
+    if ((size < 2) || (data[0] != 'P') || ((data[1] != '5') && (data[1] != '6')))
+        return false;
+    PnmHeader       hdr(data,size);
+    uint            wid = hdr.uintField(),
+                    hgt = hdr.uintField(),
+                    maxVal = hdr.uintField(),
+                    channels = (data[1] == '6') ? 3 : 1,
+                    bytes = (maxVal < 256) ? 1 : 2;
+    checkDims(wid,hgt);
+    if ((maxVal == 0) || (maxVal > 65535))
+        fgThrow("Invalid PNM maximum value",fgToString(maxVal));
+    size_t          num = size_t(wid) * hgt;
+    const uchar *   s = hdr.body(num*channels*bytes);
+    img.resize(wid,hgt);
+    uchar *         d = rgbaBytes(img.dataPtr());
+    if ((maxVal == 255) && (channels == 3)) {
+        for (size_t ii=0; ii<num; ++ii,s+=3,d+=4) {
+            d[0] = s[0];
+            d[1] = s[1];
+            d[2] = s[2];
+            d[3] = 255;
+        }
+    }
+    else if ((maxVal == 255) && (channels == 1)) {
+        for (size_t ii=0; ii<num; ++ii,++s,d+=4) {
+            d[0] = d[1] = d[2] = s[0];
+            d[3] = 255;
+        }
+    }
+    else {
+        // Rescale to 8 bits by table. 16-bit samples are big-endian:
+        vector<uchar>   lut(maxVal+1);
+        for (uint ii=0; ii<=maxVal; ++ii)
+            lut[ii] = uchar((ii*255 + maxVal/2) / maxVal);
+        for (size_t ii=0; ii<num; ++ii,d+=4) {
+            for (uint cc=0; cc<channels; ++cc,s+=bytes) {
+                uint        val = (bytes == 1) ? s[0] : ((uint(s[0]) << 8) | s[1]);
+                d[cc] = lut[std::min(val,maxVal)];
+            }
+            if (channels == 1)
+                d[1] = d[2] = d[0];
+            d[3] = 255;
+        }
+    }
+    return true;
+}
+
+void
+fgLoadPfm(const uchar * data,size_t size,FgImgRgbaUb & img)
+{
+    Pfm             pfm(data,size);
+    img.resize(pfm.dims);
+    for (uint yy=0; yy<img.height(); ++yy) {
+        uchar *         d = rgbaBytes(img.dataPtr()+size_t(yy)*img.width());
+        for (uint xx=0; xx<img.width(); ++xx,d+=4) {
+            for (uint cc=0; cc<3; ++cc)
+                d[cc] = unitToByte(pfm.val(xx,yy,(pfm.channels == 3) ? cc : 0));
+            d[3] = 255;
+        }
+    }
+}
+
+void
+fgLoadPfm(const uchar * data,size_t size,FgImg3F & img)
+{
+    Pfm             pfm(data,size);
+    img.resize(pfm.dims);
+    if ((pfm.channels == 3) && !pfm.bigEndian) {
+        size_t          rowBytes = size_t(img.width()) * 12;
+        for (uint yy=0; yy<img.height(); ++yy)
+            memcpy(img.dataPtr()+size_t(yy)*img.width(),pfm.body+rowBytes*(img.height()-1-yy),rowBytes);
+        return;
+    }
+    for (uint yy=0; yy<img.height(); ++yy)
+        for (uint xx=0; xx<img.width(); ++xx)
+            for (uint cc=0; cc<3; ++cc)
+                img.xy(xx,yy)[cc] = pfm.val(xx,yy,(pfm.channels == 3) ? cc : 0);
+}
+
+void
+fgLoadImgRaw(const uchar * data,size_t size,FgImgRgbaUb & img)
+{loadRaw(data,size,img); }
+
+void
+fgLoadImgRaw(const uchar * data,size_t size,FgImgUC & img)
+{loadRaw(data,size,img); }
+
+void
+fgLoadImgRaw(const uchar * data,size_t size,FgImgF & img)
+{loadRaw(data,size,img); }
+
+void
+fgLoadImgRaw(const uchar * data,size_t size,FgImg3F & img)
+{loadRaw(data,size,img); }
+
+void
+fgLoadImgRaw(const uchar * data,size_t size,FgImg4F & img)
+{loadRaw(data,size,img); }
+
+void
+fgSaveTga(const FgString & fname,const FgImgRgbaUb & img,bool rle)
+{
+    vector<uchar>   buf;
+    fgSaveTga(buf,img,rle);
+    writeFile(fname,buf);
+}
+
+void
+fgSaveTga(vector<uchar> & buf,const FgImgRgbaUb & img,bool rle)
+{
+    uint            wid = img.width(),
+                    hgt = img.height();
+    if ((wid == 0) || (hgt == 0) || (wid > 65535) || (hgt > 65535))
+        fgThrow("Image dimensions not supported by TGA",fgToString(img.dims()));
+    buf.assign(18,0);
+    buf[2] = rle ? 10 : 2;
+    putLe16(&buf[12],wid);
+    putLe16(&buf[14],hgt);
+    buf[16] = 32;
+    buf[17] = 0x28;                     // 8 alpha bits, top-left origin
+    if (rle) {
+        buf.reserve(18 + img.numPixels()*4 + hgt*(wid/128+1));
+        for (uint yy=0; yy<hgt; ++yy)
+            tgaRleRow(img.dataPtr()+size_t(yy)*wid,wid,buf);
+    }
+    else {
+        buf.resize(18 + img.numPixels()*4);
+        const uchar *   s = rgbaBytes(img.dataPtr());
+        uchar *         d = &buf[18];
+        for (size_t ii=0; ii<img.numPixels(); ++ii,s+=4,d+=4) {
+            d[0] = s[2];
+            d[1] = s[1];
+            d[2] = s[0];
+            d[3] = s[3];
+        }
+    }
+}
+
+void
+fgSavePnm(const FgString & fname,const FgImgRgbaUb & img,bool grey)
+{
+    if (img.numPixels() == 0)
+        fgThrow("Cannot save empty image",fname);
+    uint            channels = grey ? 1 : 3;
+    string          hdr = string(grey ? "P5" : "P6") + "\n" + fgToString(img.width()) + " " +
+                        fgToString(img.height()) + "\n255\n";
+    vector<uchar>   buf(hdr.size() + img.numPixels()*channels);
+    memcpy(&buf[0],hdr.data(),hdr.size());
+    const FgRgbaUB *    s = img.dataPtr();
+    uchar *             d = &buf[hdr.size()];
+    for (size_t ii=0; ii<img.numPixels(); ++ii) {
+        if (grey)
+            *d++ = s[ii].rec709();
+        else {
+            *d++ = s[ii].red();
+            *d++ = s[ii].green();
+            *d++ = s[ii].blue();
+        }
+    }
+    writeFile(fname,buf);
+}
+
+void
+fgSavePfm(const FgString & fname,const FgImgF & img)
+{savePfm(fname,img,'f',1); }
+
+void
+fgSavePfm(const FgString & fname,const FgImg3F & img)
+{savePfm(fname,img,'F',3); }
+
+void
+fgSaveImgRaw(const FgString & fname,const FgImgRgbaUb & img)
+{saveRaw(fname,img); }
+
+void
+fgSaveImgRaw(const FgString & fname,const FgImgUC & img)
+{saveRaw(fname,img); }
+
+void
+fgSaveImgRaw(const FgString & fname,const FgImgF & img)
+{saveRaw(fname,img); }
+
+void
+fgSaveImgRaw(const FgString & fname,const FgImg3F & img)
+{saveRaw(fname,img); }
+
+void
+fgSaveImgRaw(const FgString & fname,const FgImg4F & img)
+{saveRaw(fname,img); }
+
+bool
+fgImgLoadNative(const FgString & fname,FgImgRgbaUb & img)
+{
+    string          ext = extLower(fname);
+    if ((ext != "tga") && (ext != "ppm") && (ext != "pgm") && (ext != "pnm") && (ext != "pfm") && (ext != "fgraw"))
+        return false;
+    FgFileMap       file(fname);
+    try {
+        if (ext == "tga")
+            return fgLoadTga(file.data,file.size,img);
+        if (ext == "pfm")
+            fgLoadPfm(file.data,file.size,img);
+        else if (ext == "fgraw")
+            loadRawRgba(file.data,file.size,img);
+        else
+            return fgLoadPnm(file.data,file.size,img);
+    }
+    catch (FgException & e) {
+        e.pushMsg("Reading image file",fname);
+        throw;
+    }
+    return true;
+}
+
+bool
+fgImgLoadNative(const FgString & fname,FgImgF & img)
+{
+    string          ext = extLower(fname);
+    if (ext == "pfm") {
+        FgFileMap       file(fname);
+        FgImg3F         tmp;
+        try {
+            fgLoadPfm(file.data,file.size,tmp);
+        }
+        catch (FgException & e) {
+            e.pushMsg("Reading image file",fname);
+            throw;
+        }
+        img.resize(tmp.dims());
+        for (size_t ii=0; ii<img.numPixels(); ++ii)
+            img[ii] = tmp[ii][0];
+        return true;
+    }
+    if (ext == "fgraw") {
+        FgFileMap       file(fname);
+        try {
+            RawHeader       hdr(file.data,file.size);
+            img.resize(hdr.dims);
+            for (size_t ii=0; ii<img.numPixels(); ++ii)
+                img[ii] = hdr.val(ii,0);
+        }
+        catch (FgException & e) {
+            e.pushMsg("Reading image file",fname);
+            throw;
+        }
+        return true;
+    }
+    FgImgRgbaUb     tmp;
+    if (!fgImgLoadNative(fname,tmp))
+        return false;
+    img.resize(tmp.dims());
+    for (size_t ii=0; ii<img.numPixels(); ++ii)
+        img[ii] = tmp[ii].red();
+    return true;
+}
+
+bool
+fgImgSaveNative(const FgString & fname,const FgImgRgbaUb & img)
+{
+    string          ext = extLower(fname);
+    if (ext == "tga")
+        fgSaveTga(fname,img);
+    else if ((ext == "ppm") || (ext == "pnm"))
+        fgSavePnm(fname,img);
+    else if (ext == "pgm")
+        fgSavePnm(fname,img,true);
+    else if (ext == "pfm") {
+        FgImg3F         tmp(img.dims());
+        for (size_t ii=0; ii<tmp.numPixels(); ++ii)
+            for (uint cc=0; cc<3; ++cc)
+                tmp[ii][cc] = img[ii].m_c[cc] / 255.0f;
+        fgSavePfm(fname,tmp);
+    }
+    else if (ext == "fgraw")
+        fgSaveImgRaw(fname,img);
+    else
+        return false;
+    return true;
+}
@@ -0,0 +1,86 @@
+//
+// Copyright (c) 2015 Singular Inversions Inc. (facegen.com)
+// Use, modification and distribution is subject to the MIT License,
+// see accompanying file LICENSE.txt or facegen.com/base_library_license.txt
+//
+// Native codecs for the simple formats used for textures and intermediate images, bypassing
+// ImageMagick. Files are read through a memory map and written with a single bulk write.
+//
+// TGA:     8-bit greyscale and 24/32-bit true colour, uncompressed or RLE, either vertical origin.
+//          Colour-mapped, 16-bit and right-to-left files are left to ImageMagick.
+// PPM/PGM: Binary (P6/P5) with maximum value up to 65535. ASCII variants are left to ImageMagick.
+// PFM:     RGB (PF) and greyscale (Pf) 32-bit float of either byte order.
+// FGRAW:   Raw container for 8-bit and float images of 1 to 4 channels: a 16 byte header
+//          ("FGRW", uint32 width, uint32 height, uint16 channels, uint16 bytes per channel,
+//          little-endian) then the pixels, tightly packed from the top row down.
+//
+// 'fgLoadImgAnyFormat' and 'fgSaveImgAnyFormat' use these by file extension (case insensitive).
+//
+
+#ifndef FGIMGFORMATS_HPP
+#define FGIMGFORMATS_HPP
+
+#include "FgStdLibs.hpp"
+#include "FgImageBase.hpp"
+#include "FgString.hpp"
+
+// Return false if the data is a variant not supported natively. Throw if the data is invalid:
+bool
+fgLoadTga(const uchar * data,size_t size,FgImgRgbaUb & img);
+bool
+fgLoadPnm(const uchar * data,size_t size,FgImgRgbaUb & img);
+
+// Float values are converted to 8-bit by clamping to [0,1] and scaling by 255:
+void
+fgLoadPfm(const uchar * data,size_t size,FgImgRgbaUb & img);
+void
+fgLoadPfm(const uchar * data,size_t size,FgImg3F & img);    // Greyscale is replicated
+
+// Pixel type must match the file's channels and type:
+void
+fgLoadImgRaw(const uchar * data,size_t size,FgImgRgbaUb & img);
+void
+fgLoadImgRaw(const uchar * data,size_t size,FgImgUC & img);
+void
+fgLoadImgRaw(const uchar * data,size_t size,FgImgF & img);
+void
+fgLoadImgRaw(const uchar * data,size_t size,FgImg3F & img);
+void
+fgLoadImgRaw(const uchar * data,size_t size,FgImg4F & img);
+
+// 32-bit with alpha:
+void
+fgSaveTga(const FgString & fname,const FgImgRgbaUb & img,bool rle=false);
+// Encode to memory rather than a file:
+void
+fgSaveTga(std::vector<uchar> & buffer,const FgImgRgbaUb & img,bool rle=false);
+// P6 (alpha is dropped) or P5 (Rec. 709 luminance):
+void
+fgSavePnm(const FgString & fname,const FgImgRgbaUb & img,bool grey=false);
+void
+fgSavePfm(const FgString & fname,const FgImgF & img);
+void
+fgSavePfm(const FgString & fname,const FgImg3F & img);
+void
+fgSaveImgRaw(const FgString & fname,const FgImgRgbaUb & img);
+void
+fgSaveImgRaw(const FgString & fname,const FgImgUC & img);
+void
+fgSaveImgRaw(const FgString & fname,const FgImgF & img);
+void
+fgSaveImgRaw(const FgString & fname,const FgImg3F & img);
+void
+fgSaveImgRaw(const FgString & fname,const FgImg4F & img);
+
+// Dispatch by extension. Return false if the format (or loaded variant) is not handled natively.
+// FGRAW files of any pixel type are converted (float values as for PFM):
+bool
+fgImgLoadNative(const FgString & fname,FgImgRgbaUb & img);
+// Single channel: 8-bit formats give values in [0,255] and colour formats give the red channel,
+// as the ImageMagick path. Float formats give their values:
+bool
+fgImgLoadNative(const FgString & fname,FgImgF & img);
+bool
+fgImgSaveNative(const FgString & fname,const FgImgRgbaUb & img);
+
+#endif
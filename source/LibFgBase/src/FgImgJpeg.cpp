@@ -11,6 +11,7 @@
 #include "FgException.hpp"
 #include "FgImage.hpp"
 #include "FgStdString.hpp"
+#include "FgImgResample.hpp"
 
 #ifdef _MSC_VER
 // _setjmp and C++ object destruction is non-portable.
@@ -50,11 +51,34 @@ fgIJGErrorExit(j_common_ptr cinfo)
 
 using namespace std;
 
+// Scanlines requested per 'jpeg_read_scanlines' call. The library returns fewer per call
+// (up to its own row group height) but converting a strip at a time keeps the loop tight:
+static const uint   jpegStripRows = 16;
+
+static
+void
+rgbToRgba(const uchar * src,FgRgbaUB * dst,size_t num)
+{
+    // Addressed as the bytes of the whole run of pixels:
+    FG_STATIC_ASSERT(sizeof(FgRgbaUB) == 4);
+    uchar *         d = reinterpret_cast<uchar*>(dst);
+    for (size_t ii=0; ii<num; ++ii) {
+        d[0] = src[0];
+        d[1] = src[1];
+        d[2] = src[2];
+        d[3] = 255;
+        src += 3;
+        d += 4;
+    }
+}
+
+// 'scaleDenom' must be 1, 2, 4 or 8:
 static
 bool
 loadJpeg(
     const vector<uchar> &   jpgBuffer,
-    FgImgRgbaUb &           img)
+    FgImgRgbaUb &           img,
+    uint                    scaleDenom=1)
 {
     jpeg_decompress_struct cinfo;
     IJGErrorManager jerr;
@@ -67,6 +91,7 @@ loadJpeg(
     FgVect2UI           allocErrorSz;
 
     vector<uchar>       buff;
+    JSAMPROW            rows[jpegStripRows];
 
     switch(setjmp(jerr.setjmp_buffer))
     {
@@ -94,11 +119,14 @@ loadJpeg(
             }
             // We always want RGB out
             cinfo.out_color_space = JCS_RGB;
+            // The scaling is done in the inverse DCT so the skipped resolution is never decoded:
+            cinfo.scale_num = 1;
+            cinfo.scale_denom = scaleDenom;
             jpeg_start_decompress(&cinfo);
             // Must try-catch C++ allocations to avoid memory leaks here:
             try {
                 img.resize(cinfo.output_width,cinfo.output_height);
-                buff.resize(img.width()*3);
+                buff.resize(size_t(img.width())*3*jpegStripRows);
             }
             catch(...)
             {
@@ -107,23 +135,15 @@ loadJpeg(
                 allocErrorSz = FgVect2UI(cinfo.output_width,cinfo.output_height);
                 goto cleanup;
             }
-            uchar*              buffer = &buff[0];
-            uint                row = 0;
+            for (uint ii=0; ii<jpegStripRows; ++ii)
+                rows[ii] = &buff[size_t(img.width())*3*ii];
             // Here we use the library's state variable cinfo.output_scanline as the
             // loop counter, so that we don't have to keep track ourselves:
             while (cinfo.output_scanline < cinfo.output_height) {
-                // jpeg_read_scanlines expects an array of pointers to scanlines.
-                // Here the array is only one element long, but you could ask for
-                // more than one scanline at a time if that's more convenient:
-                jpeg_read_scanlines(&cinfo,&buffer,1);
-                uchar         *ptr = buffer;
-                for (uint col=0; col<img.width(); col++) {
-                    img.xy(col,row).red() = *ptr++;
-                    img.xy(col,row).green() = *ptr++;
-                    img.xy(col,row).blue() = *ptr++;
-                    img.xy(col,row).alpha() = 255;
-                }
-                row++;
+                uint            row = cinfo.output_scanline,
+                                num = jpeg_read_scanlines(&cinfo,rows,jpegStripRows);
+                // The strip rows are contiguous so they are converted in one run:
+                rgbToRgba(&buff[0],img.dataPtr()+size_t(row)*img.width(),size_t(num)*img.width());
             }
             jpeg_finish_decompress(&cinfo);
             goto ok;
@@ -149,6 +169,56 @@ cleanup:
     return succeeded;
 }
 
+// Reads only the header:
+static
+bool
+readJpegDims(
+    const vector<uchar> &   jpgBuffer,
+    FgVect2UI &             dims)
+{
+    jpeg_decompress_struct cinfo;
+    IJGErrorManager jerr;
+
+    cinfo.err = jpeg_std_error(&jerr.pub);
+    jerr.pub.error_exit = fgIJGErrorExit;
+
+    bool                succeeded = false;
+
+    if (setjmp(jerr.setjmp_buffer) == 0) {
+        jpeg_create_decompress(&cinfo);
+        jpeg_mem_src(&cinfo,&jpgBuffer[0],jpgBuffer.size());
+        jpeg_read_header(&cinfo,TRUE);
+        dims = FgVect2UI(cinfo.image_width,cinfo.image_height);
+        succeeded = true;
+    }
+    jpeg_destroy_decompress(&cinfo);
+    return succeeded;
+}
+
+static
+vector<uchar>
+readFile(const FgString & fname)
+{
+    FgIfstream  ifs(fname);
+
+    ifs.seekg(0,std::ios::end);
+    std::streamsize size = ifs.tellg();
+    ifs.seekg(0,std::ios::beg);
+    
+    vector<uchar>       source;
+    source.resize(static_cast<std::size_t>(size));
+    ifs.read(reinterpret_cast<char*>(&source[0]),size);
+    return source;
+}
+
+static
+void
+checkScaleDenom(uint scaleDenom)
+{
+    if ((scaleDenom != 1) && (scaleDenom != 2) && (scaleDenom != 4) && (scaleDenom != 8))
+        fgThrow("JFIF decode scale denominator must be 1, 2, 4 or 8",fgToString(scaleDenom));
+}
+
 static
 bool
 saveJpeg(
@@ -262,17 +332,7 @@ fgImgLoadJfif(
     const FgString &    fname,
     FgImgRgbaUb &       img)
 {
-    FgIfstream  ifs(fname);
-
-    ifs.seekg(0,std::ios::end);
-    std::streamsize size = ifs.tellg();
-    ifs.seekg(0,std::ios::beg);
-    
-    vector<uchar>       source;
-    source.resize(static_cast<std::size_t>(size));
-    ifs.read(reinterpret_cast<char*>(&source[0]),size);
-    
-    if(!loadJpeg(source,img))
+    if(!loadJpeg(readFile(fname),img))
         fgThrow("Error processing JFIF data",fname);
 }
 
@@ -284,3 +344,83 @@ fgImgLoadJfif(
     if(!loadJpeg(data,img))
         fgThrow("Error processing JFIF data");
 }
+
+void
+fgImgLoadJfif(
+    const FgString &    fname,
+    FgImgRgbaUb &       img,
+    uint                scaleDenom)
+{
+    checkScaleDenom(scaleDenom);
+    if(!loadJpeg(readFile(fname),img,scaleDenom))
+        fgThrow("Error processing JFIF data",fname);
+}
+
+void
+fgImgLoadJfif(
+    const vector<uchar> &   data,
+    FgImgRgbaUb &           img,
+    uint                    scaleDenom)
+{
+    checkScaleDenom(scaleDenom);
+    if(!loadJpeg(data,img,scaleDenom))
+        fgThrow("Error processing JFIF data");
+}
+
+FgVect2UI
+fgImgJfifDims(const vector<uchar> & data)
+{
+    FgVect2UI           ret;
+    if (!readJpegDims(data,ret))
+        fgThrow("Error processing JFIF header");
+    return ret;
+}
+
+FgVect2UI
+fgImgFitDims(FgVect2UI dims,FgVect2UI maxDims)
+{
+    FGASSERT((maxDims[0] > 0) && (maxDims[1] > 0));
+    if ((dims[0] <= maxDims[0]) && (dims[1] <= maxDims[1]))
+        return dims;
+    double              scale = std::min(double(maxDims[0])/dims[0],double(maxDims[1])/dims[1]);
+    FgVect2UI           ret;
+    for (uint dd=0; dd<2; ++dd)
+        ret[dd] = fgClip(fgRoundU(dims[dd]*scale),1U,maxDims[dd]);
+    return ret;
+}
+
+FgImgRgbaUb
+fgImgLoadJfifFit(
+    const vector<uchar> &   data,
+    FgVect2UI               maxDims,
+    uint                    numThreads)
+{
+    FgVect2UI           dims = fgImgJfifDims(data),
+                        fit = fgImgFitDims(dims,maxDims);
+    // Largest IDCT reduction whose output (dimensions rounded up) still covers the fitted size:
+    uint                denom = 8;
+    while ((denom > 1) &&
+           (((dims[0]+denom-1)/denom < fit[0]) || ((dims[1]+denom-1)/denom < fit[1])))
+        denom /= 2;
+    FgImgRgbaUb         img;
+    if (!loadJpeg(data,img,denom))
+        fgThrow("Error processing JFIF data");
+    if (img.dims() == fit)
+        return img;
+    return fgImgResample(img,fit,FgResampleFilter::box,numThreads);
+}
+
+FgImgRgbaUb
+fgImgLoadJfifFit(
+    const FgString &    fname,
+    FgVect2UI           maxDims,
+    uint                numThreads)
+{
+    try {
+        return fgImgLoadJfifFit(readFile(fname),maxDims,numThreads);
+    }
+    catch (FgException & e) {
+        e.pushMsg("Loading JFIF",fname);
+        throw;
+    }
+}
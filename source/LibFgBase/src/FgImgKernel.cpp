@@ -0,0 +1,47 @@
+//
+// Copyright (c) 2015 Singular Inversions Inc. (facegen.com)
+// Use, modification and distribution is subject to the MIT License,
+// see accompanying file LICENSE.txt or facegen.com/base_library_license.txt
+//
+
+#include "stdafx.h"
+
+#include "FgImgKernel.hpp"
+#include "FgThread.hpp"
+#include "FgDiagnostics.hpp"
+
+using namespace std;
+
+// Bands smaller than this are not worth a task:
+static const uint   minBandRows = 16;
+
+void
+fgImgBandsFixed(const FgImgBandFunc & func,uint numRows,uint bandRows,uint numThreads)
+{
+    FGASSERT(bandRows > 0);
+    size_t          numBands = (size_t(numRows) + bandRows - 1) / bandRows;
+    if (numBands == 1)
+        func(bandRows,0);
+    else if (numBands > 1)
+        fgParallelFor(numBands,boost::bind(func,bandRows,_1),numThreads);
+}
+
+void
+fgImgBands(
+    const FgImgBandFunc &   func,
+    uint                    numRows,
+    size_t                  numPixels,
+    uint                    numThreads,
+    size_t                  minParallelPixels)
+{
+    numThreads = fgNumThreads(numThreads);
+    if ((numThreads == 1) || (numPixels < minParallelPixels)) {
+        func(std::max(numRows,1U),0);
+        return;
+    }
+    // Several bands per thread for load balancing:
+    uint            numBands = std::min(numThreads * 4,std::max(numRows/minBandRows,1U));
+    fgImgBandsFixed(func,numRows,(numRows + numBands - 1) / numBands,numThreads);
+}
+
+// */
@@ -0,0 +1,84 @@
+//
+// Copyright (c) 2015 Singular Inversions Inc. (facegen.com)
+// Use, modification and distribution is subject to the MIT License,
+// see accompanying file LICENSE.txt or facegen.com/base_library_license.txt
+//
+// Helpers shared by the image kernels (resampling, pyramids, warping, metrics): SIMD detection,
+// pixel channel traits and parallel execution over bands of rows.
+//
+
+#ifndef FGIMGKERNEL_HPP
+#define FGIMGKERNEL_HPP
+
+#include "FgStdLibs.hpp"
+#include "FgTypes.hpp"
+#include "FgStdFunction.hpp"
+#include "FgRgba.hpp"
+
+// SSE2 is always available on x64:
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define FG_IMG_SSE2
+#include <emmintrin.h>
+#endif
+
+// Scalar channel type, floating point accumulator type and number of channels. Other pixel
+// types are assumed to be made of floats:
+template<class T>
+struct  FgImgPix
+{
+    typedef float       Scalar;
+    typedef float       Acc;
+    static const uint   channels = sizeof(T) / sizeof(float);
+};
+
+template<>
+struct  FgImgPix<uchar>
+{
+    typedef uchar       Scalar;
+    typedef float       Acc;
+    static const uint   channels = 1;
+};
+
+template<>
+struct  FgImgPix<FgRgbaUB>
+{
+    typedef uchar       Scalar;
+    typedef float       Acc;
+    static const uint   channels = 4;
+};
+
+template<>
+struct  FgImgPix<double>
+{
+    typedef double      Scalar;
+    typedef double      Acc;
+    static const uint   channels = 1;
+};
+
+// Signature of a band kernel: (rows per band, band index). Band 'bb' covers rows
+// [bb*bandRows,min((bb+1)*bandRows,numRows)):
+typedef boost::function<void(uint,size_t)>  FgImgBandFunc;
+
+// Rows per band of about 'bandPixels' for images of the given width:
+inline
+uint
+fgImgFixedBandRows(uint width,size_t bandPixels=size_t(1) << 15)
+{return uint(std::max(bandPixels / std::max(width,1U),size_t(1))); }
+
+// Runs 'func' over bands of 'bandRows' rows each. Since the bands do not depend on the number
+// of threads, neither do results combined per band (eg. floating point sums):
+void
+fgImgBandsFixed(const FgImgBandFunc & func,uint numRows,uint bandRows,uint numThreads=0);
+
+// Runs 'func' over bands of the 'numRows' rows of an image of 'numPixels', sized for load
+// balancing. Images of less than 'minParallelPixels' are computed in a single band in the
+// calling thread:
+void
+fgImgBands(
+    const FgImgBandFunc &   func,
+    uint                    numRows,
+    size_t                  numPixels,
+    uint                    numThreads=0,
+    size_t                  minParallelPixels=size_t(1) << 16);
+
+#endif
@@ -0,0 +1,616 @@
+//
+// Copyright (c) 2015 Singular Inversions Inc. (facegen.com)
+// Use, modification and distribution is subject to the MIT License,
+// see accompanying file LICENSE.txt or facegen.com/base_library_license.txt
+//
+// The 8-bit difference kernels use SSE2 (always available on x64) with 32-bit lane sums flushed
+// to 64-bit totals before they can overflow. The float loops are written over flat channel
+// arrays in blocks that are a multiple of the SIMD width so they auto-vectorize.
+//
+// Bands have a fixed number of rows so the results do not depend on the number of threads.
+//
+
+#include "stdafx.h"
+
+#include "FgImgMetrics.hpp"
+#include "FgImgKernel.hpp"
+#include "FgMath.hpp"
+
+using namespace std;
+
+namespace {
+
+template<bool masked>
+size_t
+countMask(const uchar * mask,uint num)
+{
+    if (!masked)
+        return num;
+    size_t      ret = 0;
+    for (uint xx=0; xx<num; ++xx)
+        ret += (mask[xx] != 0) ? 1 : 0;
+    return ret;
+}
+
+// DIFFERENCES:
+
+template<bool masked>
+void
+diffRowUc(const uchar * a,const uchar * b,const uchar * mask,uint num,FgImgDiff & acc)
+{
+    uint64          sad = 0,
+                    ssd = 0;
+    uint            xx = 0;
+#ifdef FG_IMG_SSE2
+    const __m128i   zero = _mm_setzero_si128();
+    const uint      segment = 16 << 12;             // Pixels before the 32-bit square sums could overflow
+    uint            end16 = num & ~15U;
+    while (xx < end16) {
+        uint            segEnd = std::min(end16,xx+segment);
+        __m128i         accS = zero,
+                        accQ = zero;
+        for (; xx<segEnd; xx+=16) {
+            __m128i     va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a+xx)),
+                        vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b+xx)),
+                        d = _mm_or_si128(_mm_subs_epu8(va,vb),_mm_subs_epu8(vb,va));
+            if (masked) {
+                __m128i m = _mm_loadu_si128(reinterpret_cast<const __m128i*>(mask+xx));
+                d = _mm_andnot_si128(_mm_cmpeq_epi8(m,zero),d);
+            }
+            accS = _mm_add_epi64(accS,_mm_sad_epu8(d,zero));
+            __m128i     dl = _mm_unpacklo_epi8(d,zero),
+                        dh = _mm_unpackhi_epi8(d,zero);
+            accQ = _mm_add_epi32(accQ,_mm_add_epi32(_mm_madd_epi16(dl,dl),_mm_madd_epi16(dh,dh)));
+        }
+        uint64          s[2];
+        uint32          q[4];
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(s),accS);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(q),accQ);
+        sad += s[0] + s[1];
+        ssd += uint64(q[0]) + q[1] + q[2] + q[3];
+    }
+#endif
+    for (; xx<num; ++xx) {
+        if (masked && (mask[xx] == 0))
+            continue;
+        int         d = int(a[xx]) - int(b[xx]);
+        sad += uint64(std::abs(d));
+        ssd += uint64(d*d);
+    }
+    acc.sad[0] += double(sad);
+    acc.ssd[0] += double(ssd);
+    acc.count += countMask<masked>(mask,num);
+}
+
+template<bool masked>
+void
+diffRowRgba(const uchar * a,const uchar * b,const uchar * mask,uint num,FgImgDiff & acc)
+{
+    uint64          sad[4] = {0,0,0,0},
+                    ssd[4] = {0,0,0,0};
+    uint            xx = 0;
+#ifdef FG_IMG_SSE2
+    const __m128i   zero = _mm_setzero_si128();
+    const uint      segment = 4 << 12;              // Pixels before the 32-bit square sums could overflow
+    uint            end4 = num & ~3U;
+    while (xx < end4) {
+        uint            segEnd = std::min(end4,xx+segment);
+        __m128i         accS = zero,                // Per channel
+                        accQ = zero;
+        for (; xx<segEnd; xx+=4) {
+            __m128i     va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a+4*xx)),
+                        vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b+4*xx)),
+                        d = _mm_or_si128(_mm_subs_epu8(va,vb),_mm_subs_epu8(vb,va));
+            if (masked) {
+                int     m4;
+                memcpy(&m4,mask+xx,4);
+                __m128i m = _mm_cvtsi32_si128(m4);
+                m = _mm_unpacklo_epi8(m,m);         // Replicate each mask byte to its 4 channels
+                m = _mm_unpacklo_epi16(m,m);
+                d = _mm_andnot_si128(_mm_cmpeq_epi8(m,zero),d);
+            }
+            // 16-bit, 2 pixels per register:
+            __m128i     dl = _mm_unpacklo_epi8(d,zero),
+                        dh = _mm_unpackhi_epi8(d,zero),
+                        s = _mm_add_epi16(dl,dh),
+                        ql = _mm_mullo_epi16(dl,dl),     // Squares fit in unsigned 16 bits
+                        qh = _mm_mullo_epi16(dh,dh);
+            accS = _mm_add_epi32(accS,_mm_add_epi32(_mm_unpacklo_epi16(s,zero),_mm_unpackhi_epi16(s,zero)));
+            accQ = _mm_add_epi32(accQ,_mm_add_epi32(
+                _mm_add_epi32(_mm_unpacklo_epi16(ql,zero),_mm_unpackhi_epi16(ql,zero)),
+                _mm_add_epi32(_mm_unpacklo_epi16(qh,zero),_mm_unpackhi_epi16(qh,zero))));
+        }
+        uint32          s[4],
+                        q[4];
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(s),accS);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(q),accQ);
+        for (uint cc=0; cc<4; ++cc) {
+            sad[cc] += s[cc];
+            ssd[cc] += q[cc];
+        }
+    }
+#endif
+    for (; xx<num; ++xx) {
+        if (masked && (mask[xx] == 0))
+            continue;
+        for (uint cc=0; cc<4; ++cc) {
+            int     d = int(a[4*xx+cc]) - int(b[4*xx+cc]);
+            sad[cc] += uint64(std::abs(d));
+            ssd[cc] += uint64(d*d);
+        }
+    }
+    for (uint cc=0; cc<4; ++cc) {
+        acc.sad[cc] += double(sad[cc]);
+        acc.ssd[cc] += double(ssd[cc]);
+    }
+    acc.count += countMask<masked>(mask,num);
+}
+
+template<uint nc>
+void
+diffRowF(const float * a,const float * b,const uchar * mask,uint num,FgImgDiff & acc)
+{
+    const uint      block = (nc == 3) ? 12 : 4;     // A multiple of both 'nc' and the SIMD width
+    float           s[block],
+                    q[block];
+    for (uint kk=0; kk<block; ++kk)
+        s[kk] = q[kk] = 0.0f;
+    if (mask == NULL) {
+        uint            nf = num * nc,
+                        jj = 0;
+        for (; jj+block<=nf; jj+=block) {
+            for (uint kk=0; kk<block; ++kk) {
+                float       d = a[jj+kk] - b[jj+kk];
+                s[kk] += std::abs(d);
+                q[kk] += d*d;
+            }
+        }
+        for (; jj<nf; ++jj) {
+            float       d = a[jj] - b[jj];
+            s[jj%block] += std::abs(d);
+            q[jj%block] += d*d;
+        }
+    }
+    else {
+        for (uint xx=0; xx<num; ++xx) {
+            if (mask[xx] == 0)
+                continue;
+            for (uint cc=0; cc<nc; ++cc) {
+                float       d = a[xx*nc+cc] - b[xx*nc+cc];
+                s[cc] += std::abs(d);
+                q[cc] += d*d;
+            }
+        }
+    }
+    for (uint kk=0; kk<block; ++kk) {
+        acc.sad[kk%nc] += s[kk];
+        acc.ssd[kk%nc] += q[kk];
+    }
+    acc.count += (mask == NULL) ? countMask<false>(mask,num) : countMask<true>(mask,num);
+}
+
+template<bool masked>
+void
+diffRow(const uchar * a,const uchar * b,const uchar * mask,uint num,FgImgDiff & acc)
+{diffRowUc<masked>(a,b,mask,num,acc); }
+
+template<bool masked>
+void
+diffRow(const FgRgbaUB * a,const FgRgbaUB * b,const uchar * mask,uint num,FgImgDiff & acc)
+{diffRowRgba<masked>(&a->m_c[0],&b->m_c[0],mask,num,acc); }
+
+template<bool masked,class T>
+void
+diffRow(const T * a,const T * b,const uchar * mask,uint num,FgImgDiff & acc)
+{
+    diffRowF<FgImgPix<T>::channels>(reinterpret_cast<const float*>(a),reinterpret_cast<const float*>(b),
+                                  (masked ? mask : NULL),num,acc);
+}
+
+template<class T>
+struct  DiffJob
+{
+    FgImgView<const T>          im0;
+    FgImgView<const T>          im1;
+    FgImgView<const uchar>      mask;       // Empty if unmasked
+    uint                        rows;       // Per band
+    vector<FgImgDiff>           bands;
+};
+
+template<class T>
+void
+diffBand(DiffJob<T> * job,size_t band)
+{
+    uint            y0 = uint(band) * job->rows,
+                    y1 = std::min(y0+job->rows,job->im0.height()),
+                    wid = job->im0.width();
+    FgImgDiff &     acc = job->bands[band];
+    for (uint yy=y0; yy<y1; ++yy) {
+        if (job->mask.empty())
+            diffRow<false>(job->im0.rowPtr(yy),job->im1.rowPtr(yy),(const uchar*)NULL,wid,acc);
+        else
+            diffRow<true>(job->im0.rowPtr(yy),job->im1.rowPtr(yy),job->mask.rowPtr(yy),wid,acc);
+    }
+}
+
+template<class T>
+FgImgDiff
+diff(FgImgView<const T> im0,FgImgView<const T> im1,FgImgView<const uchar> mask,uint numThreads)
+{
+    FGASSERT(im0.dims() == im1.dims());
+    FGASSERT(mask.empty() || (mask.dims() == im0.dims()));
+    FgImgDiff       ret;
+    if (im0.empty())
+        return ret;
+    DiffJob<T>      job;
+    job.im0 = im0;
+    job.im1 = im1;
+    job.mask = mask;
+    job.rows = fgImgFixedBandRows(im0.width());
+    job.bands.resize((im0.height() + job.rows - 1) / job.rows);
+    fgImgBandsFixed(boost::bind(diffBand<T>,&job,_2),im0.height(),job.rows,numThreads);
+    for (size_t ii=0; ii<job.bands.size(); ++ii) {
+        ret.ssd += job.bands[ii].ssd;
+        ret.sad += job.bands[ii].sad;
+        ret.count += job.bands[ii].count;
+    }
+    return ret;
+}
+
+template<class T>
+FgImgDiff
+diffMasked(FgImgView<const T> im0,FgImgView<const T> im1,FgImgView<const uchar> mask,uint numThreads)
+{
+    FGASSERT(mask.dims() == im0.dims());
+    return diff(im0,im1,mask,numThreads);
+}
+
+// SSIM:
+
+const uint      ssimWin = 11;
+
+struct  SsimKernel
+{
+    float           w[ssimWin];
+
+    SsimKernel()
+    {
+        double      wgts[ssimWin],
+                    sum = 0.0;
+        for (uint ii=0; ii<ssimWin; ++ii) {
+            double      xx = double(ii) - double(ssimWin/2);
+            wgts[ii] = std::exp(-xx*xx / (2.0 * 1.5 * 1.5));
+            sum += wgts[ii];
+        }
+        for (uint ii=0; ii<ssimWin; ++ii)
+            w[ii] = float(wgts[ii] / sum);
+    }
+};
+
+inline
+void
+toFloat(const uchar * src,size_t num,float * dst)
+{
+    for (size_t ii=0; ii<num; ++ii)
+        dst[ii] = float(src[ii]);
+}
+
+inline
+void
+toFloat(const float * src,size_t num,float * dst)
+{std::copy(src,src+num,dst); }
+
+// Statistics of the window in each row are stored as 5 arrays in this order:
+enum { sX, sY, sXX, sYY, sXY, sNum };
+
+template<class T>
+struct  SsimJob
+{
+    FgImgView<const T>          im0;
+    FgImgView<const T>          im1;
+    float                       c1;
+    float                       c2;
+    uint                        rows;           // Output rows per band
+    SsimKernel                  kernel;
+    vector<FgVect4D>            bands;          // Per channel sums of SSIM over each band
+};
+
+template<class T>
+void
+ssimBand(SsimJob<T> * job,size_t band)
+{
+    typedef typename FgImgPix<T>::Scalar  S;
+    const uint          nc = FgImgPix<T>::channels;
+    uint                wid = job->im0.width(),
+                        outWid = wid - (ssimWin-1),
+                        outHgt = job->im0.height() - (ssimWin-1),
+                        y0 = uint(band) * job->rows,
+                        y1 = std::min(y0+job->rows,outHgt);
+    size_t              inLen = size_t(wid) * nc,
+                        len = size_t(outWid) * nc;
+    const float *       w = job->kernel.w;
+    vector<float>       xs(inLen),
+                        ys(inLen),
+                        ring(ssimWin*sNum*len),     // Horizontally filtered statistics of the last 11 rows
+                        vert(sNum*len),             // Window statistics of the output row
+                        vals(len);                  // SSIM of each window in the output row
+    FgVect4D            acc(0.0);
+    for (uint ry=y0; ry<y1+ssimWin-1; ++ry) {
+        toFloat(reinterpret_cast<const S*>(job->im0.rowPtr(ry)),inLen,&xs[0]);
+        toFloat(reinterpret_cast<const S*>(job->im1.rowPtr(ry)),inLen,&ys[0]);
+        // The window sums are accumulated in registers so the loops over 'jj' vectorize:
+        float           *h = &ring[(ry%ssimWin)*sNum*len];
+        const float     *xp = &xs[0],
+                        *yp = &ys[0];
+        for (size_t jj=0; jj<len; ++jj) {
+            float       sx = 0, sy = 0, sxx = 0, syy = 0, sxy = 0;
+            for (uint kk=0; kk<ssimWin; ++kk) {
+                float       wk = w[kk],
+                            x = xp[jj+kk*nc],
+                            y = yp[jj+kk*nc];
+                sx += wk * x;
+                sy += wk * y;
+                sxx += wk * x * x;
+                syy += wk * y * y;
+                sxy += wk * x * y;
+            }
+            h[sX*len+jj] = sx;
+            h[sY*len+jj] = sy;
+            h[sXX*len+jj] = sxx;
+            h[sYY*len+jj] = syy;
+            h[sXY*len+jj] = sxy;
+        }
+        if (ry < y0+ssimWin-1)
+            continue;
+        uint            oy = ry - (ssimWin-1);
+        const float *   hr[ssimWin];
+        for (uint kk=0; kk<ssimWin; ++kk)
+            hr[kk] = &ring[((oy+kk)%ssimWin)*sNum*len];
+        for (size_t jj=0; jj<sNum*len; ++jj) {
+            float       sum = 0;
+            for (uint kk=0; kk<ssimWin; ++kk)
+                sum += w[kk] * hr[kk][jj];
+            vert[jj] = sum;
+        }
+        float           c1 = job->c1,
+                        c2 = job->c2;
+        for (size_t jj=0; jj<len; ++jj) {
+            float       mx = vert[sX*len+jj],
+                        my = vert[sY*len+jj],
+                        vx = vert[sXX*len+jj] - mx*mx,
+                        vy = vert[sYY*len+jj] - my*my,
+                        cxy = vert[sXY*len+jj] - mx*my;
+            vals[jj] = ((2*mx*my + c1) * (2*cxy + c2)) / ((mx*mx + my*my + c1) * (vx + vy + c2));
+        }
+        float           rowAcc[4] = {0,0,0,0};
+        for (size_t jj=0; jj<len; jj+=nc)
+            for (uint cc=0; cc<nc; ++cc)
+                rowAcc[cc] += vals[jj+cc];
+        for (uint cc=0; cc<nc; ++cc)
+            acc[cc] += rowAcc[cc];
+    }
+    job->bands[band] = acc;
+}
+
+template<class T>
+FgVect4D
+ssim(FgImgView<const T> im0,FgImgView<const T> im1,float dynamicRange,uint numThreads)
+{
+    FGASSERT(im0.dims() == im1.dims());
+    FGASSERT((im0.width() >= ssimWin) && (im0.height() >= ssimWin));
+    SsimJob<T>      job;
+    job.im0 = im0;
+    job.im1 = im1;
+    job.c1 = fgSqr(0.01f * dynamicRange);
+    job.c2 = fgSqr(0.03f * dynamicRange);
+    job.rows = 64;
+    FgVect2UI       outDims = im0.dims() - FgVect2UI(ssimWin-1);
+    job.bands.resize((outDims[1] + job.rows - 1) / job.rows);
+    fgImgBandsFixed(boost::bind(ssimBand<T>,&job,_2),outDims[1],job.rows,numThreads);
+    FgVect4D        ret(0.0);
+    for (size_t ii=0; ii<job.bands.size(); ++ii)
+        ret += job.bands[ii];
+    return ret / (double(outDims[0]) * outDims[1]);
+}
+
+// HISTOGRAMS:
+
+template<class T>
+struct  HistJob
+{
+    FgImgView<const T>          img;
+    uint                        rows;
+    vector<FgHistogram>         bands;          // Channels for each band in order
+};
+
+void
+histRows(FgImgView<const uchar> img,uint y0,uint y1,FgHistogram * hists)
+{
+    size_t *        bins = &hists[0].binCounts[0];
+    for (uint yy=y0; yy<y1; ++yy) {
+        const uchar *   row = img.rowPtr(yy);
+        for (uint xx=0; xx<img.width(); ++xx)
+            ++bins[row[xx]];
+    }
+}
+
+void
+histRows(FgImgView<const FgRgbaUB> img,uint y0,uint y1,FgHistogram * hists)
+{
+    size_t          *b0 = &hists[0].binCounts[0],
+                    *b1 = &hists[1].binCounts[0],
+                    *b2 = &hists[2].binCounts[0],
+                    *b3 = &hists[3].binCounts[0];
+    for (uint yy=y0; yy<y1; ++yy) {
+        const uchar *   row = &img.rowPtr(yy)->m_c[0];
+        for (uint xx=0; xx<img.width(); ++xx) {
+            ++b0[row[4*xx]];
+            ++b1[row[4*xx+1]];
+            ++b2[row[4*xx+2]];
+            ++b3[row[4*xx+3]];
+        }
+    }
+}
+
+void
+histRows(FgImgView<const float> img,uint y0,uint y1,FgHistogram * hists)
+{
+    for (uint yy=y0; yy<y1; ++yy)
+        hists[0].addSamples(img.rowPtr(yy),img.width(),1);
+}
+
+template<class T>
+void
+histBand(HistJob<T> * job,size_t band)
+{
+    const uint      nc = FgImgPix<T>::channels;
+    uint            y0 = uint(band) * job->rows,
+                    y1 = std::min(y0+job->rows,job->img.height());
+    histRows(job->img,y0,y1,&job->bands[band*nc]);
+}
+
+template<class T>
+vector<FgHistogram>
+histogram(FgImgView<const T> img,FgVectD2 bounds,size_t numBins,uint numThreads)
+{
+    const uint      nc = FgImgPix<T>::channels;
+    HistJob<T>      job;
+    job.img = img;
+    job.rows = fgImgFixedBandRows(img.width());
+    size_t          numBands = (img.height() + job.rows - 1) / job.rows;
+    FgHistogram     empty(bounds,numBins);
+    job.bands.resize(numBands*nc,empty);
+    fgImgBandsFixed(boost::bind(histBand<T>,&job,_2),img.height(),job.rows,numThreads);
+    vector<FgHistogram> ret(nc,empty);
+    for (size_t bb=0; bb<numBands; ++bb)
+        for (uint cc=0; cc<nc; ++cc)
+            ret[cc].merge(job.bands[bb*nc+cc]);
+    return ret;
+}
+
+}
+
+FgVect4D
+FgImgDiff::rmsdPerChannel() const
+{
+    FgVect4D        ret(0.0);
+    if (count > 0)
+        for (uint cc=0; cc<4; ++cc)
+            ret[cc] = std::sqrt(ssd[cc] / double(count));
+    return ret;
+}
+
+FgVect4D
+FgImgDiff::madPerChannel() const
+{
+    FgVect4D        ret(0.0);
+    if (count > 0)
+        ret = sad / double(count);
+    return ret;
+}
+
+double
+FgImgDiff::psnr(double peak,uint numChannels) const
+{
+    FGASSERT((numChannels > 0) && (numChannels <= 4));
+    FGASSERT(count > 0);
+    double          sum = 0.0;
+    for (uint cc=0; cc<numChannels; ++cc)
+        sum += ssd[cc];
+    if (sum == 0.0)
+        return numeric_limits<double>::infinity();
+    double          mse = sum / (double(count) * numChannels);
+    return 10.0 * std::log10(peak * peak / mse);
+}
+
+FgImgDiff
+fgImgDiff(FgImgView<const uchar> im0,FgImgView<const uchar> im1,uint numThreads)
+{return diff(im0,im1,FgImgView<const uchar>(),numThreads); }
+
+FgImgDiff
+fgImgDiff(FgImgView<const FgRgbaUB> im0,FgImgView<const FgRgbaUB> im1,uint numThreads)
+{return diff(im0,im1,FgImgView<const uchar>(),numThreads); }
+
+FgImgDiff
+fgImgDiff(FgImgView<const float> im0,FgImgView<const float> im1,uint numThreads)
+{return diff(im0,im1,FgImgView<const uchar>(),numThreads); }
+
+FgImgDiff
+fgImgDiff(FgImgView<const FgVect3F> im0,FgImgView<const FgVect3F> im1,uint numThreads)
+{return diff(im0,im1,FgImgView<const uchar>(),numThreads); }
+
+FgImgDiff
+fgImgDiff(FgImgView<const FgVect4F> im0,FgImgView<const FgVect4F> im1,uint numThreads)
+{return diff(im0,im1,FgImgView<const uchar>(),numThreads); }
+
+FgImgDiff
+fgImgDiff(FgImgView<const FgRgbaF> im0,FgImgView<const FgRgbaF> im1,uint numThreads)
+{return diff(im0,im1,FgImgView<const uchar>(),numThreads); }
+
+FgImgDiff
+fgImgDiff(FgImgView<const uchar> im0,FgImgView<const uchar> im1,FgImgView<const uchar> mask,uint numThreads)
+{return diffMasked(im0,im1,mask,numThreads); }
+
+FgImgDiff
+fgImgDiff(FgImgView<const FgRgbaUB> im0,FgImgView<const FgRgbaUB> im1,FgImgView<const uchar> mask,uint numThreads)
+{return diffMasked(im0,im1,mask,numThreads); }
+
+FgImgDiff
+fgImgDiff(FgImgView<const float> im0,FgImgView<const float> im1,FgImgView<const uchar> mask,uint numThreads)
+{return diffMasked(im0,im1,mask,numThreads); }
+
+FgImgDiff
+fgImgDiff(FgImgView<const FgVect3F> im0,FgImgView<const FgVect3F> im1,FgImgView<const uchar> mask,uint numThreads)
+{return diffMasked(im0,im1,mask,numThreads); }
+
+FgImgDiff
+fgImgDiff(FgImgView<const FgVect4F> im0,FgImgView<const FgVect4F> im1,FgImgView<const uchar> mask,uint numThreads)
+{return diffMasked(im0,im1,mask,numThreads); }
+
+FgImgDiff
+fgImgDiff(FgImgView<const FgRgbaF> im0,FgImgView<const FgRgbaF> im1,FgImgView<const uchar> mask,uint numThreads)
+{return diffMasked(im0,im1,mask,numThreads); }
+
+double
+fgImgSsd(const FgImgRgbaUb & im0,const FgImgRgbaUb & im1)
+{return fgSumElems(fgImgDiff(im0,im1).ssd); }
+
+double
+fgImgRmsd(const FgImgRgbaUb & im0,const FgImgRgbaUb & im1)
+{return fgImgDiff(im0,im1).rmsd(); }
+
+double
+fgImgSad(const FgImgRgbaUb & im0,const FgImgRgbaUb & im1)
+{return fgSumElems(fgImgDiff(im0,im1).sad); }
+
+double
+fgImgMad(const FgImgRgbaUb & im0,const FgImgRgbaUb & im1)
+{return fgImgDiff(im0,im1).mad(); }
+
+double
+fgImgPsnr(FgImgView<const FgRgbaUB> im0,FgImgView<const FgRgbaUB> im1,uint numThreads)
+{return fgImgDiff(im0,im1,numThreads).psnr(255.0,3); }
+
+double
+fgImgSsim(FgImgView<const uchar> im0,FgImgView<const uchar> im1,uint numThreads)
+{return ssim(im0,im1,255.0f,numThreads)[0]; }
+
+double
+fgImgSsim(FgImgView<const float> im0,FgImgView<const float> im1,float dynamicRange,uint numThreads)
+{return ssim(im0,im1,dynamicRange,numThreads)[0]; }
+
+FgVect4D
+fgImgSsim(FgImgView<const FgRgbaUB> im0,FgImgView<const FgRgbaUB> im1,uint numThreads)
+{return ssim(im0,im1,255.0f,numThreads); }
+
+FgHistogram
+fgImgHistogram(FgImgView<const uchar> img,uint numThreads)
+{return histogram(img,FgVectD2(0,256),256,numThreads)[0]; }
+
+vector<FgHistogram>
+fgImgHistogram(FgImgView<const FgRgbaUB> img,uint numThreads)
+{return histogram(img,FgVectD2(0,256),256,numThreads); }
+
+FgHistogram
+fgImgHistogram(FgImgView<const float> img,FgVectD2 bounds,size_t numBins,uint numThreads)
+{return histogram(img,bounds,numBins,numThreads)[0]; }
@@ -0,0 +1,110 @@
+//
+// Copyright (c) 2015 Singular Inversions Inc. (facegen.com)
+// Use, modification and distribution is subject to the MIT License,
+// see accompanying file LICENSE.txt or facegen.com/base_library_license.txt
+//
+// Image comparison metrics (SSD, SAD, PSNR, SSIM) and pixel value histograms.
+//
+// Images are reduced in fixed bands of rows which are distributed over threads and whose
+// partial sums are combined in band order, so results do not depend on the number of threads.
+// 8-bit sums are exact. 'numThreads' of 0 means one per hardware thread.
+//
+
+#ifndef FGIMGMETRICS_HPP
+#define FGIMGMETRICS_HPP
+
+#include "FgStdLibs.hpp"
+#include "FgImageBase.hpp"
+#include "FgHistogram.hpp"
+
+// Per-channel sums of differences between two images over the compared pixels.
+// Channels beyond those of the pixel type are zero:
+struct  FgImgDiff
+{
+    FgVect4D        ssd;        // Sum of squared differences
+    FgVect4D        sad;        // Sum of absolute differences
+    size_t          count;      // Pixels compared
+
+    FgImgDiff() : ssd(0), sad(0), count(0) {}
+
+    // Over all channels, as 'fgImgRmsd' and 'fgImgMad':
+    double
+    rmsd() const
+    {return (count > 0) ? std::sqrt(fgSumElems(ssd) / double(count)) : 0.0; }
+
+    double
+    mad() const
+    {return (count > 0) ? fgSumElems(sad) / double(count) : 0.0; }
+
+    FgVect4D
+    rmsdPerChannel() const;
+
+    FgVect4D
+    madPerChannel() const;
+
+    // Peak signal to noise ratio in dB over the first 'numChannels' channels. Infinite if identical:
+    double
+    psnr(double peak,uint numChannels) const;
+};
+
+FgImgDiff
+fgImgDiff(FgImgView<const uchar> im0,FgImgView<const uchar> im1,uint numThreads=0);
+FgImgDiff
+fgImgDiff(FgImgView<const FgRgbaUB> im0,FgImgView<const FgRgbaUB> im1,uint numThreads=0);
+FgImgDiff
+fgImgDiff(FgImgView<const float> im0,FgImgView<const float> im1,uint numThreads=0);
+FgImgDiff
+fgImgDiff(FgImgView<const FgVect3F> im0,FgImgView<const FgVect3F> im1,uint numThreads=0);
+FgImgDiff
+fgImgDiff(FgImgView<const FgVect4F> im0,FgImgView<const FgVect4F> im1,uint numThreads=0);
+FgImgDiff
+fgImgDiff(FgImgView<const FgRgbaF> im0,FgImgView<const FgRgbaF> im1,uint numThreads=0);
+
+// Only pixels whose 'mask' value is non-zero are compared:
+FgImgDiff
+fgImgDiff(FgImgView<const uchar> im0,FgImgView<const uchar> im1,FgImgView<const uchar> mask,uint numThreads=0);
+FgImgDiff
+fgImgDiff(FgImgView<const FgRgbaUB> im0,FgImgView<const FgRgbaUB> im1,FgImgView<const uchar> mask,uint numThreads=0);
+FgImgDiff
+fgImgDiff(FgImgView<const float> im0,FgImgView<const float> im1,FgImgView<const uchar> mask,uint numThreads=0);
+FgImgDiff
+fgImgDiff(FgImgView<const FgVect3F> im0,FgImgView<const FgVect3F> im1,FgImgView<const uchar> mask,uint numThreads=0);
+FgImgDiff
+fgImgDiff(FgImgView<const FgVect4F> im0,FgImgView<const FgVect4F> im1,FgImgView<const uchar> mask,uint numThreads=0);
+FgImgDiff
+fgImgDiff(FgImgView<const FgRgbaF> im0,FgImgView<const FgRgbaF> im1,FgImgView<const uchar> mask,uint numThreads=0);
+
+// Faster equivalents of the FgImage.hpp templates for 8-bit RGBA:
+double
+fgImgSsd(const FgImgRgbaUb & im0,const FgImgRgbaUb & im1);
+double
+fgImgRmsd(const FgImgRgbaUb & im0,const FgImgRgbaUb & im1);
+double
+fgImgSad(const FgImgRgbaUb & im0,const FgImgRgbaUb & im1);
+double
+fgImgMad(const FgImgRgbaUb & im0,const FgImgRgbaUb & im1);
+
+// PSNR of the RGB channels with peak 255:
+double
+fgImgPsnr(FgImgView<const FgRgbaUB> im0,FgImgView<const FgRgbaUB> im1,uint numThreads=0);
+
+// Mean structural similarity index (Wang et al. 2004) using an 11x11 Gaussian window of
+// standard deviation 1.5 over the window positions fully inside the images (which must be
+// at least 11x11). 8-bit images have a dynamic range of 255:
+double
+fgImgSsim(FgImgView<const uchar> im0,FgImgView<const uchar> im1,uint numThreads=0);
+double
+fgImgSsim(FgImgView<const float> im0,FgImgView<const float> im1,float dynamicRange=1.0f,uint numThreads=0);
+FgVect4D                        // Per channel
+fgImgSsim(FgImgView<const FgRgbaUB> im0,FgImgView<const FgRgbaUB> im1,uint numThreads=0);
+
+// One bin per value, ie. bounds [0,256] with 256 bins:
+FgHistogram
+fgImgHistogram(FgImgView<const uchar> img,uint numThreads=0);
+vector<FgHistogram>             // Per channel
+fgImgHistogram(FgImgView<const FgRgbaUB> img,uint numThreads=0);
+
+FgHistogram
+fgImgHistogram(FgImgView<const float> img,FgVectD2 bounds,size_t numBins,uint numThreads=0);
+
+#endif
@@ -0,0 +1,469 @@
+//
+// Copyright (c) 2015 Singular Inversions Inc. (facegen.com)
+// Use, modification and distribution is subject to the MIT License,
+// see accompanying file LICENSE.txt or facegen.com/base_library_license.txt
+//
+// Pixels are processed as flat arrays of channels so the float loops auto-vectorize. The 8-bit
+// RGBA kernels use SSE2 (always available on x64) with 16-bit intermediates.
+//
+
+#include "stdafx.h"
+
+#include "FgImgPyramid.hpp"
+#include "FgImgKernel.hpp"
+#include "FgMath.hpp"
+
+using namespace std;
+
+namespace {
+
+// Intermediate (row filtered) type:
+template<class T>
+struct  PyrAcc
+{
+    typedef typename FgImgPix<T>::Acc   Type;
+};
+
+template<>
+struct  PyrAcc<FgRgbaUB>
+{
+    typedef ushort      Type;               // Max row filtered value is 16 * 255
+};
+
+inline
+uint
+clampIdx(int idx,uint size)
+{return (idx < 0) ? 0U : ((uint(idx) >= size) ? size-1 : uint(idx)); }
+
+// BOX:
+
+void
+boxRow(const float * r0,const float * r1,float * dst,uint dstWid,uint nc)
+{
+    for (uint xx=0; xx<dstWid; ++xx) {
+        const float *   p0 = r0 + 2*xx*nc,
+                    *   p1 = r1 + 2*xx*nc;
+        for (uint cc=0; cc<nc; ++cc)
+            dst[xx*nc+cc] = (p0[cc] + p0[cc+nc] + p1[cc+nc] + p1[cc]) / 4;
+    }
+}
+
+void
+boxRow(const uchar * r0,const uchar * r1,uchar * dst,uint dstWid,uint)
+{
+    uint            xx = 0;
+#ifdef FG_IMG_SSE2
+    const __m128i   zero = _mm_setzero_si128(),
+                    one = _mm_set1_epi16(1);
+    // 8 source pixels from each row to 4 destination pixels:
+    for (; xx+4<=dstWid; xx+=4) {
+        const uchar *   p0 = r0 + 8*xx,
+                    *   p1 = r1 + 8*xx;
+        __m128i         a0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p0)),
+                        a1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p0+16)),
+                        b0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p1)),
+                        b1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p1+16));
+        // Vertical sums, 2 pixels per register:
+        __m128i         s0 = _mm_add_epi16(_mm_unpacklo_epi8(a0,zero),_mm_unpacklo_epi8(b0,zero)),
+                        s1 = _mm_add_epi16(_mm_unpackhi_epi8(a0,zero),_mm_unpackhi_epi8(b0,zero)),
+                        s2 = _mm_add_epi16(_mm_unpacklo_epi8(a1,zero),_mm_unpacklo_epi8(b1,zero)),
+                        s3 = _mm_add_epi16(_mm_unpackhi_epi8(a1,zero),_mm_unpackhi_epi8(b1,zero));
+        // Horizontal sums of pixel pairs:
+        __m128i         d01 = _mm_add_epi16(_mm_unpacklo_epi64(s0,s1),_mm_unpackhi_epi64(s0,s1)),
+                        d23 = _mm_add_epi16(_mm_unpacklo_epi64(s2,s3),_mm_unpackhi_epi64(s2,s3));
+        d01 = _mm_srli_epi16(_mm_add_epi16(d01,one),2);
+        d23 = _mm_srli_epi16(_mm_add_epi16(d23,one),2);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst+4*xx),_mm_packus_epi16(d01,d23));
+    }
+#endif
+    for (; xx<dstWid; ++xx) {
+        const uchar *   p0 = r0 + 8*xx,
+                    *   p1 = r1 + 8*xx;
+        for (uint cc=0; cc<4; ++cc)         // Same rounding as 'fgImgShrink2':
+            dst[4*xx+cc] = uchar((uint(p0[cc]) + p0[cc+4] + p1[cc] + p1[cc+4] + 1) / 4);
+    }
+}
+
+template<class T>
+void
+boxBand(const FgImage<T> * src,FgImage<T> * dst,uint bandRows,size_t band)
+{
+    typedef typename FgImgPix<T>::Scalar  S;
+    const uint      nc = FgImgPix<T>::channels;
+    uint            y0 = uint(band) * bandRows,
+                    y1 = std::min(y0+bandRows,dst->height());
+    for (uint yy=y0; yy<y1; ++yy)
+        boxRow(reinterpret_cast<const S*>(src->rowPtr(2*yy)),
+               reinterpret_cast<const S*>(src->rowPtr(2*yy+1)),
+               reinterpret_cast<S*>(dst->rowPtr(yy)),
+               dst->width(),nc);
+}
+
+// GAUSSIAN:
+
+// Horizontal [1 4 6 4 1] filter at even source pixels with clamped borders, unnormalized:
+void
+gaussRow(const float * src,uint srcWid,float * dst,uint dstWid,uint nc)
+{
+    for (uint xx=0; xx<dstWid; ++xx) {
+        int             xs = 2 * int(xx);
+        const float *   p0 = src + clampIdx(xs-2,srcWid)*nc,
+                    *   p1 = src + clampIdx(xs-1,srcWid)*nc,
+                    *   p2 = src + clampIdx(xs,srcWid)*nc,
+                    *   p3 = src + clampIdx(xs+1,srcWid)*nc,
+                    *   p4 = src + clampIdx(xs+2,srcWid)*nc;
+        for (uint cc=0; cc<nc; ++cc)
+            dst[xx*nc+cc] = p0[cc] + 4*p1[cc] + 6*p2[cc] + 4*p3[cc] + p4[cc];
+    }
+}
+
+void
+gaussPixel(const uchar * src,uint srcWid,ushort * dst,uint xx)
+{
+    int             xs = 2 * int(xx);
+    const uchar *   p0 = src + 4*clampIdx(xs-2,srcWid),
+                *   p1 = src + 4*clampIdx(xs-1,srcWid),
+                *   p2 = src + 4*clampIdx(xs,srcWid),
+                *   p3 = src + 4*clampIdx(xs+1,srcWid),
+                *   p4 = src + 4*clampIdx(xs+2,srcWid);
+    for (uint cc=0; cc<4; ++cc)
+        dst[4*xx+cc] = ushort(p0[cc] + 4*p1[cc] + 6*p2[cc] + 4*p3[cc] + p4[cc]);
+}
+
+void
+gaussRow(const uchar * src,uint srcWid,ushort * dst,uint dstWid,uint)
+{
+    uint            xx = 0;
+#ifdef FG_IMG_SSE2
+    const __m128i   zero = _mm_setzero_si128();
+    // Interior destination pixel pairs [xx,xx+1] read source pixels [2xx-2,2xx+5]:
+    if (dstWid > 0)
+        gaussPixel(src,srcWid,dst,xx++);
+    for (; (xx+2<=dstWid) && (2*xx+6<=srcWid); xx+=2) {
+        const uchar *   ps = src + 4*(2*xx-2);
+        __m128i         v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ps)),
+                        w = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ps+16)),
+                        a0 = _mm_unpacklo_epi8(v,zero),     // Source pixels 2xx-2, 2xx-1
+                        a1 = _mm_unpackhi_epi8(v,zero),     // 2xx, 2xx+1
+                        a2 = _mm_unpacklo_epi8(w,zero),     // 2xx+2, 2xx+3
+                        a3 = _mm_unpackhi_epi8(w,zero),     // 2xx+4, 2xx+5
+                        // Tap k for both destination pixels:
+                        t0 = _mm_unpacklo_epi64(a0,a1),
+                        t1 = _mm_unpackhi_epi64(a0,a1),
+                        t2 = _mm_unpacklo_epi64(a1,a2),
+                        t3 = _mm_unpackhi_epi64(a1,a2),
+                        t4 = _mm_unpacklo_epi64(a2,a3),
+                        sum = _mm_add_epi16(_mm_add_epi16(t0,t4),_mm_slli_epi16(_mm_add_epi16(t1,t3),2));
+        sum = _mm_add_epi16(sum,_mm_add_epi16(_mm_slli_epi16(t2,2),_mm_slli_epi16(t2,1)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst+4*xx),sum);
+    }
+#endif
+    for (; xx<dstWid; ++xx)
+        gaussPixel(src,srcWid,dst,xx);
+}
+
+// Vertical [1 4 6 4 1] filter of row filtered values then normalization by 1/256:
+void
+gaussCol(const float * const * rows,float * dst,uint num)
+{
+    const float     *r0 = rows[0], *r1 = rows[1], *r2 = rows[2], *r3 = rows[3], *r4 = rows[4];
+    for (uint ii=0; ii<num; ++ii)
+        dst[ii] = (r0[ii] + 4*r1[ii] + 6*r2[ii] + 4*r3[ii] + r4[ii]) * (1.0f/256.0f);
+}
+
+void
+gaussCol(const ushort * const * rows,uchar * dst,uint num)
+{
+    const ushort    *r0 = rows[0], *r1 = rows[1], *r2 = rows[2], *r3 = rows[3], *r4 = rows[4];
+    uint            ii = 0;
+#ifdef FG_IMG_SSE2
+    // Max sum is 16 * 4080 + 128 < 2^16 so unsigned 16-bit arithmetic doesn't overflow:
+    const __m128i   half = _mm_set1_epi16(128);
+    __m128i         res[2];
+    for (; ii+16<=num; ii+=16) {
+        for (uint hh=0; hh<2; ++hh) {
+            uint        jj = ii + 8*hh;
+            __m128i     v0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(r0+jj)),
+                        v1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(r1+jj)),
+                        v2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(r2+jj)),
+                        v3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(r3+jj)),
+                        v4 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(r4+jj)),
+                        sum = _mm_add_epi16(_mm_add_epi16(v0,v4),_mm_slli_epi16(_mm_add_epi16(v1,v3),2));
+            sum = _mm_add_epi16(sum,_mm_add_epi16(_mm_slli_epi16(v2,2),_mm_slli_epi16(v2,1)));
+            res[hh] = _mm_srli_epi16(_mm_add_epi16(sum,half),8);
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst+ii),_mm_packus_epi16(res[0],res[1]));
+    }
+#endif
+    for (; ii<num; ++ii)
+        dst[ii] = uchar((uint(r0[ii]) + 4*r1[ii] + 6*r2[ii] + 4*r3[ii] + r4[ii] + 128) >> 8);
+}
+
+// Caches the filtered rows of the current window, which spans at most 'N' consecutive rows.
+// Clamped rows are only computed once:
+template<class A,uint N>
+struct  RowCache
+{
+    vector<A>       data;
+    size_t          stride;
+    int             rowIdx[N];
+
+    explicit
+    RowCache(size_t s) : data(s*N), stride(s)
+    {
+        for (uint ii=0; ii<N; ++ii)
+            rowIdx[ii] = -1;
+    }
+
+    // Returns NULL if 'row' needs to be computed into 'slot(row)':
+    const A *
+    find(uint row) const
+    {return (rowIdx[row%N] == int(row)) ? &data[(row%N)*stride] : NULL; }
+
+    A *
+    slot(uint row)
+    {
+        rowIdx[row%N] = int(row);
+        return &data[(row%N)*stride];
+    }
+};
+
+template<class T>
+void
+gaussBand(const FgImage<T> * src,FgImage<T> * dst,uint bandRows,size_t band)
+{
+    typedef typename FgImgPix<T>::Scalar  S;
+    typedef typename PyrAcc<T>::Type       A;
+    const uint      nc = FgImgPix<T>::channels;
+    uint            y0 = uint(band) * bandRows,
+                    y1 = std::min(y0+bandRows,dst->height()),
+                    rowSize = dst->width() * nc;
+    RowCache<A,5>   cache(rowSize);
+    const A *       rows[5];
+    for (uint yy=y0; yy<y1; ++yy) {
+        for (int kk=0; kk<5; ++kk) {
+            uint        ys = clampIdx(2*int(yy)+kk-2,src->height());
+            rows[kk] = cache.find(ys);
+            if (rows[kk] == NULL) {
+                A *     row = cache.slot(ys);
+                gaussRow(reinterpret_cast<const S*>(src->rowPtr(ys)),src->width(),row,dst->width(),nc);
+                rows[kk] = row;
+            }
+        }
+        gaussCol(rows,reinterpret_cast<S*>(dst->rowPtr(yy)),rowSize);
+    }
+}
+
+template<class T>
+void
+reduce(const FgImage<T> & src,FgImage<T> & dst,FgImgPyrFilter filter,uint numThreads)
+{
+    FGASSERT(!src.empty());
+    FGASSERT(src.dataPtr() != dst.dataPtr());
+    dst.resize(fgImgPyrReduceDims(src.dims(),filter));
+    if (filter == FgImgPyrFilter::box)
+        fgImgBands(boost::bind(boxBand<T>,&src,&dst,_1,_2),dst.height(),dst.numPixels(),numThreads);
+    else
+        fgImgBands(boost::bind(gaussBand<T>,&src,&dst,_1,_2),dst.height(),dst.numPixels(),numThreads);
+}
+
+template<class T>
+vector<FgImage<T> >
+pyramid(const FgImage<T> & img,FgImgPyrFilter filter,uint maxLevels,uint numThreads)
+{
+    FGASSERT(!img.empty());
+    vector<FgImage<T> >     ret(1,img);
+    while ((fgMinElem(ret.back().dims()) > 1) && ((maxLevels == 0) || (ret.size() < maxLevels))) {
+        ret.push_back(FgImage<T>());
+        reduce(ret[ret.size()-2],ret.back(),filter,numThreads);
+    }
+    return ret;
+}
+
+// EXPAND:
+
+// Horizontal expansion: even destination pixels are [1 6 1]/8, odd are [1 1]/2:
+void
+expandRow(const float * src,uint srcWid,float * dst,uint dstWid,uint nc)
+{
+    for (uint xx=0; xx<dstWid; ++xx) {
+        int             xs = int(xx / 2);
+        float *         pd = dst + xx*nc;
+        if (xx & 1) {
+            const float *   p0 = src + clampIdx(xs,srcWid)*nc,
+                        *   p1 = src + clampIdx(xs+1,srcWid)*nc;
+            for (uint cc=0; cc<nc; ++cc)
+                pd[cc] = (p0[cc] + p1[cc]) * 0.5f;
+        }
+        else {
+            const float *   p0 = src + clampIdx(xs-1,srcWid)*nc,
+                        *   p1 = src + clampIdx(xs,srcWid)*nc,
+                        *   p2 = src + clampIdx(xs+1,srcWid)*nc;
+            for (uint cc=0; cc<nc; ++cc)
+                pd[cc] = (p0[cc] + 6*p1[cc] + p2[cc]) * 0.125f;
+        }
+    }
+}
+
+// Adds 'add' to the expansion if non-null:
+template<class T>
+void
+expandBand(const FgImage<T> * src,FgImage<T> * dst,const FgImage<T> * add,uint bandRows,size_t band)
+{
+    const uint      nc = FgImgPix<T>::channels;
+    uint            y0 = uint(band) * bandRows,
+                    y1 = std::min(y0+bandRows,dst->height()),
+                    rowSize = dst->width() * nc;
+    RowCache<float,3>   cache(rowSize);
+    const float *   rows[3];
+    for (uint yy=y0; yy<y1; ++yy) {
+        int             ys = int(yy / 2);
+        uint            numRows = (yy & 1) ? 2 : 3;
+        for (uint kk=0; kk<numRows; ++kk) {
+            uint        yr = clampIdx(ys+int(kk)-((yy&1) ? 0 : 1),src->height());
+            rows[kk] = cache.find(yr);
+            if (rows[kk] == NULL) {
+                float * row = cache.slot(yr);
+                expandRow(reinterpret_cast<const float*>(src->rowPtr(yr)),src->width(),row,dst->width(),nc);
+                rows[kk] = row;
+            }
+        }
+        float *         pd = reinterpret_cast<float*>(dst->rowPtr(yy));
+        if (yy & 1)
+            for (uint ii=0; ii<rowSize; ++ii)
+                pd[ii] = (rows[0][ii] + rows[1][ii]) * 0.5f;
+        else
+            for (uint ii=0; ii<rowSize; ++ii)
+                pd[ii] = (rows[0][ii] + 6*rows[1][ii] + rows[2][ii]) * 0.125f;
+        if (add != NULL) {
+            const float *   pa = reinterpret_cast<const float*>(add->rowPtr(yy));
+            for (uint ii=0; ii<rowSize; ++ii)
+                pd[ii] += pa[ii];
+        }
+    }
+}
+
+template<class T>
+FgImage<T>
+expand(const FgImage<T> & src,FgVect2UI dims,const FgImage<T> * add,uint numThreads)
+{
+    FGASSERT(!src.empty());
+    if (fgImgPyrReduceDims(dims,FgImgPyrFilter::gauss) != src.dims())
+        fgThrow("fgImgPyrExpand incompatible dimensions",fgToString(src.dims())+" to "+fgToString(dims));
+    FgImage<T>      ret(dims);
+    fgImgBands(boost::bind(expandBand<T>,&src,&ret,add,_1,_2),ret.height(),ret.numPixels(),numThreads);
+    return ret;
+}
+
+template<class T>
+vector<FgImage<T> >
+laplacian(const FgImage<T> & img,uint maxLevels,uint numThreads)
+{
+    vector<FgImage<T> >     ret = pyramid(img,FgImgPyrFilter::gauss,maxLevels,numThreads);
+    for (size_t ll=0; ll+1<ret.size(); ++ll) {
+        FgImage<T>          exp = expand(ret[ll+1],ret[ll].dims(),(const FgImage<T>*)NULL,numThreads);
+        for (size_t ii=0; ii<exp.numPixels(); ++ii)
+            ret[ll][ii] -= exp[ii];
+    }
+    return ret;
+}
+
+template<class T>
+FgImage<T>
+reconstruct(const vector<FgImage<T> > & lap,uint numThreads)
+{
+    FGASSERT(!lap.empty());
+    FgImage<T>      ret = lap.back();
+    for (size_t ll=lap.size()-1; ll>0; --ll)
+        ret = expand(ret,lap[ll-1].dims(),&lap[ll-1],numThreads);
+    return ret;
+}
+
+}
+
+FgVect2UI
+fgImgPyrReduceDims(FgVect2UI dims,FgImgPyrFilter filter)
+{
+    if (filter == FgImgPyrFilter::box)
+        return dims / 2U;
+    return (dims + FgVect2UI(1)) / 2U;
+}
+
+void
+fgImgPyrReduce(const FgImgRgbaUb & src,FgImgRgbaUb & dst,FgImgPyrFilter filter,uint numThreads)
+{reduce(src,dst,filter,numThreads); }
+
+void
+fgImgPyrReduce(const FgImgF & src,FgImgF & dst,FgImgPyrFilter filter,uint numThreads)
+{reduce(src,dst,filter,numThreads); }
+
+void
+fgImgPyrReduce(const FgImg3F & src,FgImg3F & dst,FgImgPyrFilter filter,uint numThreads)
+{reduce(src,dst,filter,numThreads); }
+
+void
+fgImgPyrReduce(const FgImg4F & src,FgImg4F & dst,FgImgPyrFilter filter,uint numThreads)
+{reduce(src,dst,filter,numThreads); }
+
+FgImgs
+fgImgPyramid(const FgImgRgbaUb & img,FgImgPyrFilter filter,uint maxLevels,uint numThreads)
+{return pyramid(img,filter,maxLevels,numThreads); }
+
+FgImgFs
+fgImgPyramid(const FgImgF & img,FgImgPyrFilter filter,uint maxLevels,uint numThreads)
+{return pyramid(img,filter,maxLevels,numThreads); }
+
+FgImg3Fs
+fgImgPyramid(const FgImg3F & img,FgImgPyrFilter filter,uint maxLevels,uint numThreads)
+{return pyramid(img,filter,maxLevels,numThreads); }
+
+FgImg4Fs
+fgImgPyramid(const FgImg4F & img,FgImgPyrFilter filter,uint maxLevels,uint numThreads)
+{return pyramid(img,filter,maxLevels,numThreads); }
+
+FgImgF
+fgImgPyrExpand(const FgImgF & img,FgVect2UI dims,uint numThreads)
+{return expand(img,dims,(const FgImgF*)NULL,numThreads); }
+
+FgImg3F
+fgImgPyrExpand(const FgImg3F & img,FgVect2UI dims,uint numThreads)
+{return expand(img,dims,(const FgImg3F*)NULL,numThreads); }
+
+FgImg4F
+fgImgPyrExpand(const FgImg4F & img,FgVect2UI dims,uint numThreads)
+{return expand(img,dims,(const FgImg4F*)NULL,numThreads); }
+
+FgImgFs
+fgImgLaplacian(const FgImgF & img,uint maxLevels,uint numThreads)
+{return laplacian(img,maxLevels,numThreads); }
+
+FgImg3Fs
+fgImgLaplacian(const FgImg3F & img,uint maxLevels,uint numThreads)
+{return laplacian(img,maxLevels,numThreads); }
+
+FgImg4Fs
+fgImgLaplacian(const FgImg4F & img,uint maxLevels,uint numThreads)
+{return laplacian(img,maxLevels,numThreads); }
+
+FgImg4Fs
+fgImgLaplacian(const FgImgRgbaUb & img,uint maxLevels,uint numThreads)
+{
+    FgImg4F         imgF(img.dims());
+    for (size_t ii=0; ii<imgF.numPixels(); ++ii)
+        imgF[ii] = FgVect4F(img[ii].m_c);
+    return laplacian(imgF,maxLevels,numThreads);
+}
+
+FgImgF
+fgImgLaplacianReconstruct(const FgImgFs & lap,uint numThreads)
+{return reconstruct(lap,numThreads); }
+
+FgImg3F
+fgImgLaplacianReconstruct(const FgImg3Fs & lap,uint numThreads)
+{return reconstruct(lap,numThreads); }
+
+FgImg4F
+fgImgLaplacianReconstruct(const FgImg4Fs & lap,uint numThreads)
+{return reconstruct(lap,numThreads); }
+
+// */
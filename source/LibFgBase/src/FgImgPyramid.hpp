@@ -0,0 +1,81 @@
+//
+// Copyright (c) 2015 Singular Inversions Inc. (facegen.com)
+// Use, modification and distribution is subject to the MIT License,
+// see accompanying file LICENSE.txt or facegen.com/base_library_license.txt
+//
+// Image pyramids, built level by level in a single call. Each level is split into bands of rows
+// which are computed in parallel, except for small levels which are computed in one task.
+//
+// Reduction filters:
+//
+// box:   2x2 block average. Odd dimensions are rounded down. Identical to 'fgImgShrink2' for
+//        RGBA (rounds to nearest) and to 'fgShrink2Float' for float types.
+// gauss: 5-tap [1 4 6 4 1]/16 separable filter centred on the even pixels, with borders clamped.
+//        Odd dimensions are rounded up so every pixel contributes, and 'fgImgPyrExpand' inverts
+//        the size change exactly.
+//
+// Levels are returned from the original (level 0) down to the first level with a dimension of 1,
+// or only the first 'maxLevels' levels if non-zero. 'numThreads' of 0 means one per hardware thread.
+//
+
+#ifndef FGIMGPYRAMID_HPP
+#define FGIMGPYRAMID_HPP
+
+#include "FgStdLibs.hpp"
+#include "FgImageBase.hpp"
+
+enum class FgImgPyrFilter { box, gauss };
+
+// Dimensions of the level below one of size 'dims':
+FgVect2UI
+fgImgPyrReduceDims(FgVect2UI dims,FgImgPyrFilter filter);
+
+// Single level reduction ('dst' must be a different instance):
+void
+fgImgPyrReduce(const FgImgRgbaUb & src,FgImgRgbaUb & dst,FgImgPyrFilter filter,uint numThreads=0);
+void
+fgImgPyrReduce(const FgImgF & src,FgImgF & dst,FgImgPyrFilter filter,uint numThreads=0);
+void
+fgImgPyrReduce(const FgImg3F & src,FgImg3F & dst,FgImgPyrFilter filter,uint numThreads=0);
+void
+fgImgPyrReduce(const FgImg4F & src,FgImg4F & dst,FgImgPyrFilter filter,uint numThreads=0);
+
+FgImgs
+fgImgPyramid(const FgImgRgbaUb & img,FgImgPyrFilter filter,uint maxLevels=0,uint numThreads=0);
+FgImgFs
+fgImgPyramid(const FgImgF & img,FgImgPyrFilter filter,uint maxLevels=0,uint numThreads=0);
+FgImg3Fs
+fgImgPyramid(const FgImg3F & img,FgImgPyrFilter filter,uint maxLevels=0,uint numThreads=0);
+FgImg4Fs
+fgImgPyramid(const FgImg4F & img,FgImgPyrFilter filter,uint maxLevels=0,uint numThreads=0);
+
+// Expands an image reduced by the 'gauss' filter to 'dims', the size before reduction, by
+// interpolating with the matching [1 4 6 4 1]/8 kernel:
+FgImgF
+fgImgPyrExpand(const FgImgF & img,FgVect2UI dims,uint numThreads=0);
+FgImg3F
+fgImgPyrExpand(const FgImg3F & img,FgVect2UI dims,uint numThreads=0);
+FgImg4F
+fgImgPyrExpand(const FgImg4F & img,FgVect2UI dims,uint numThreads=0);
+
+// Laplacian pyramid. Each level is the difference between the 'gauss' pyramid level and the
+// expansion of the level below, except the last which is the last 'gauss' level:
+FgImgFs
+fgImgLaplacian(const FgImgF & img,uint maxLevels=0,uint numThreads=0);
+FgImg3Fs
+fgImgLaplacian(const FgImg3F & img,uint maxLevels=0,uint numThreads=0);
+FgImg4Fs
+fgImgLaplacian(const FgImg4F & img,uint maxLevels=0,uint numThreads=0);
+// Converts to float channels (no scaling):
+FgImg4Fs
+fgImgLaplacian(const FgImgRgbaUb & img,uint maxLevels=0,uint numThreads=0);
+
+// Inverse of 'fgImgLaplacian' (exact up to floating point rounding):
+FgImgF
+fgImgLaplacianReconstruct(const FgImgFs & lap,uint numThreads=0);
+FgImg3F
+fgImgLaplacianReconstruct(const FgImg3Fs & lap,uint numThreads=0);
+FgImg4F
+fgImgLaplacianReconstruct(const FgImg4Fs & lap,uint numThreads=0);
+
+#endif
@@ -0,0 +1,305 @@
+//
+// Copyright (c) 2015 Singular Inversions Inc. (facegen.com)
+// Use, modification and distribution is subject to the MIT License,
+// see accompanying file LICENSE.txt or facegen.com/base_library_license.txt
+//
+// The horizontal pass for 4 channel pixels uses SSE2 (always available on x64). The vertical
+// pass is a weighted sum of contiguous rows which the compiler vectorizes.
+//
+
+#include "stdafx.h"
+
+#include "FgImgResample.hpp"
+#include "FgImgKernel.hpp"
+#include "FgMath.hpp"
+
+using namespace std;
+
+namespace {
+
+double
+kernelRadius(FgResampleFilter filter)
+{
+    if (filter == FgResampleFilter::linear)
+        return 1.0;
+    if (filter == FgResampleFilter::mitchell)
+        return 2.0;
+    return 3.0;
+}
+
+double
+sinc(double x)
+{
+    if (std::abs(x) < 1.0e-8)
+        return 1.0;
+    x *= fgPi();
+    return std::sin(x) / x;
+}
+
+// 'x' is the distance in (scaled) source pixels:
+double
+kernel(FgResampleFilter filter,double x)
+{
+    x = std::abs(x);
+    if (filter == FgResampleFilter::linear)
+        return (x < 1.0) ? 1.0 - x : 0.0;
+    if (filter == FgResampleFilter::mitchell) {
+        const double    B = 1.0 / 3.0,
+                        C = 1.0 / 3.0;
+        if (x < 1.0)
+            return ((12-9*B-6*C)*x*x*x + (-18+12*B+6*C)*x*x + (6-2*B)) / 6.0;
+        if (x < 2.0)
+            return ((-B-6*C)*x*x*x + (6*B+30*C)*x*x + (-12*B-48*C)*x + (8*B+24*C)) / 6.0;
+        return 0.0;
+    }
+    return (x < 3.0) ? sinc(x) * sinc(x/3.0) : 0.0;
+}
+
+}
+
+FgResampleTable::FgResampleTable(uint srcSize,uint dstSize,FgResampleFilter filter)
+{
+    FGASSERT((srcSize > 0) && (dstSize > 0));
+    double                  scale = double(srcSize) / double(dstSize);
+    vector<vector<double> > wgts(dstSize);      // Clamped weights starting at 'first'
+    first.resize(dstSize);
+    taps = 0;
+    for (uint dd=0; dd<dstSize; ++dd) {
+        // Unclamped source range [beg,end) and weights:
+        int             beg,
+                        end;
+        vector<double>  ws;
+        if (filter == FgResampleFilter::box) {
+            double      lo = dd * scale,
+                        hi = lo + scale;
+            beg = int(std::floor(lo));
+            end = int(std::ceil(hi));
+            for (int ii=beg; ii<end; ++ii)
+                ws.push_back(std::min(hi,double(ii+1)) - std::max(lo,double(ii)));
+        }
+        else {
+            double      fs = std::max(scale,1.0),       // Widen to anti-alias when shrinking
+                        rad = kernelRadius(filter) * fs,
+                        ctr = (dd + 0.5) * scale - 0.5; // IRCS
+            beg = int(std::floor(ctr - rad));
+            end = int(std::ceil(ctr + rad)) + 1;
+            for (int ii=beg; ii<end; ++ii)
+                ws.push_back(kernel(filter,(ii - ctr) / fs));
+        }
+        int             lo = std::max(beg,0),
+                        hi = std::min(end-1,int(srcSize)-1);
+        FGASSERT(lo <= hi);
+        vector<double> & cw = wgts[dd];
+        cw.resize(hi-lo+1,0.0);
+        double          sum = 0.0;
+        for (int ii=beg; ii<end; ++ii) {
+            cw[std::max(lo,std::min(hi,ii))-lo] += ws[ii-beg];
+            sum += ws[ii-beg];
+        }
+        FGASSERT(sum > 0.0);
+        for (size_t ii=0; ii<cw.size(); ++ii)
+            cw[ii] /= sum;
+        first[dd] = uint(lo);
+        taps = std::max(taps,uint(cw.size()));
+    }
+    // Make the number of weights uniform, keeping all source indices within range:
+    weights.resize(size_t(dstSize)*taps,0.0f);
+    for (uint dd=0; dd<dstSize; ++dd) {
+        uint            lo = first[dd];
+        first[dd] = std::min(lo,srcSize-taps);
+        uint            off = lo - first[dd];
+        for (size_t ii=0; ii<wgts[dd].size(); ++ii)
+            weights[dd*taps+off+ii] = float(wgts[dd][ii]);
+    }
+}
+
+namespace {
+
+template<class S,class A,uint C>
+void
+hRowGen(const S * src,A * dst,const FgResampleTable & tab)
+{
+    uint            taps = tab.taps;
+    for (size_t xx=0; xx<tab.first.size(); ++xx) {
+        const S *       ps = src + tab.first[xx]*C;
+        const float *   pw = &tab.weights[xx*taps];
+        A               acc[C];
+        for (uint cc=0; cc<C; ++cc)
+            acc[cc] = 0;
+        for (uint kk=0; kk<taps; ++kk)
+            for (uint cc=0; cc<C; ++cc)
+                acc[cc] += A(ps[kk*C+cc]) * pw[kk];
+        for (uint cc=0; cc<C; ++cc)
+            dst[xx*C+cc] = acc[cc];
+    }
+}
+
+template<uint C>
+void
+hRow(const uchar * src,float * dst,const FgResampleTable & tab)
+{hRowGen<uchar,float,C>(src,dst,tab); }
+
+template<uint C>
+void
+hRow(const float * src,float * dst,const FgResampleTable & tab)
+{hRowGen<float,float,C>(src,dst,tab); }
+
+template<uint C>
+void
+hRow(const double * src,double * dst,const FgResampleTable & tab)
+{hRowGen<double,double,C>(src,dst,tab); }
+
+#ifdef FG_IMG_SSE2
+
+template<>
+void
+hRow<4>(const uchar * src,float * dst,const FgResampleTable & tab)
+{
+    const __m128i   zero = _mm_setzero_si128();
+    uint            taps = tab.taps;
+    for (size_t xx=0; xx<tab.first.size(); ++xx) {
+        const uchar *   ps = src + tab.first[xx]*4;
+        const float *   pw = &tab.weights[xx*taps];
+        __m128          acc = _mm_setzero_ps();
+        for (uint kk=0; kk<taps; ++kk) {
+            int         pix;
+            memcpy(&pix,ps+4*kk,4);
+            __m128i     pi = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(pix),zero),zero);
+            acc = _mm_add_ps(acc,_mm_mul_ps(_mm_cvtepi32_ps(pi),_mm_set1_ps(pw[kk])));
+        }
+        _mm_storeu_ps(dst+4*xx,acc);
+    }
+}
+
+template<>
+void
+hRow<4>(const float * src,float * dst,const FgResampleTable & tab)
+{
+    uint            taps = tab.taps;
+    for (size_t xx=0; xx<tab.first.size(); ++xx) {
+        const float *   ps = src + tab.first[xx]*4;
+        const float *   pw = &tab.weights[xx*taps];
+        __m128          acc = _mm_setzero_ps();
+        for (uint kk=0; kk<taps; ++kk)
+            acc = _mm_add_ps(acc,_mm_mul_ps(_mm_loadu_ps(ps+4*kk),_mm_set1_ps(pw[kk])));
+        _mm_storeu_ps(dst+4*xx,acc);
+    }
+}
+
+#endif
+
+void
+storeRow(const float * acc,uchar * dst,size_t num)
+{
+    for (size_t ii=0; ii<num; ++ii) {
+        float       val = std::max(0.0f,std::min(255.0f,acc[ii]));
+        dst[ii] = uchar(val + 0.5f);
+    }
+}
+
+template<class A>
+void
+storeRow(const A * acc,A * dst,size_t num)
+{std::copy(acc,acc+num,dst); }
+
+template<class T>
+struct  Resample
+{
+    typedef typename FgImgPix<T>::Scalar    S;
+    typedef typename FgImgPix<T>::Acc       A;
+    static const uint   C = FgImgPix<T>::channels;
+
+    const FgImgResampler &  rs;
+    const FgImage<T> &      src;
+    FgImage<T> &            dst;
+    vector<A>               tmp;        // Horizontally resampled source rows
+    size_t                  rowSize;
+
+    Resample(const FgImgResampler & r,const FgImage<T> & s,FgImage<T> & d)
+    : rs(r), src(s), dst(d), rowSize(size_t(r.dstDims[0])*C)
+    {tmp.resize(rowSize*src.height()); }
+
+    void
+    horiz(uint bandRows,size_t band)
+    {
+        uint        y0 = uint(band) * bandRows,
+                    y1 = std::min(y0+bandRows,src.height());
+        for (uint yy=y0; yy<y1; ++yy)
+            hRow<C>(reinterpret_cast<const S*>(src.rowPtr(yy)),&tmp[yy*rowSize],rs.cols);
+    }
+
+    void
+    vert(uint bandRows,size_t band)
+    {
+        uint        y0 = uint(band) * bandRows,
+                    y1 = std::min(y0+bandRows,dst.height()),
+                    taps = rs.rows.taps;
+        vector<A>   acc(rowSize);
+        for (uint yy=y0; yy<y1; ++yy) {
+            const A *       row = &tmp[rs.rows.first[yy]*rowSize];
+            const float *   pw = &rs.rows.weights[yy*taps];
+            A               w0 = pw[0];
+            for (size_t ii=0; ii<rowSize; ++ii)
+                acc[ii] = row[ii] * w0;
+            for (uint kk=1; kk<taps; ++kk) {
+                row += rowSize;
+                A           wk = pw[kk];
+                if (wk == 0)
+                    continue;
+                for (size_t ii=0; ii<rowSize; ++ii)
+                    acc[ii] += row[ii] * wk;
+            }
+            storeRow(&acc[0],reinterpret_cast<S*>(dst.rowPtr(yy)),rowSize);
+        }
+    }
+};
+
+template<class T>
+void
+resample(const FgImgResampler & rs,const FgImage<T> & src,FgImage<T> & dst,uint numThreads)
+{
+    if (src.dims() != rs.srcDims)
+        fgThrow("FgImgResampler source image dimensions mismatch",fgToString(src.dims()));
+    FGASSERT(src.dataPtr() != dst.dataPtr());
+    dst.resize(rs.dstDims);
+    Resample<T>     rsm(rs,src,dst);
+    fgImgBands(boost::bind(&Resample<T>::horiz,&rsm,_1,_2),src.height(),
+               size_t(src.height())*rs.dstDims[0],numThreads);
+    fgImgBands(boost::bind(&Resample<T>::vert,&rsm,_1,_2),dst.height(),dst.numPixels(),numThreads);
+}
+
+}
+
+FgImgResampler::FgImgResampler(FgVect2UI sd,FgVect2UI dd,FgResampleFilter filter)
+    : srcDims(sd), dstDims(dd), cols(sd[0],dd[0],filter), rows(sd[1],dd[1],filter)
+{}
+
+void
+FgImgResampler::apply(const FgImgUC & src,FgImgUC & dst,uint numThreads) const
+{resample(*this,src,dst,numThreads); }
+
+void
+FgImgResampler::apply(const FgImgRgbaUb & src,FgImgRgbaUb & dst,uint numThreads) const
+{resample(*this,src,dst,numThreads); }
+
+void
+FgImgResampler::apply(const FgImgF & src,FgImgF & dst,uint numThreads) const
+{resample(*this,src,dst,numThreads); }
+
+void
+FgImgResampler::apply(const FgImg3F & src,FgImg3F & dst,uint numThreads) const
+{resample(*this,src,dst,numThreads); }
+
+void
+FgImgResampler::apply(const FgImg4F & src,FgImg4F & dst,uint numThreads) const
+{resample(*this,src,dst,numThreads); }
+
+void
+FgImgResampler::apply(const FgImgRgbaF & src,FgImgRgbaF & dst,uint numThreads) const
+{resample(*this,src,dst,numThreads); }
+
+void
+FgImgResampler::apply(const FgImgD & src,FgImgD & dst,uint numThreads) const
+{resample(*this,src,dst,numThreads); }
+
+// */
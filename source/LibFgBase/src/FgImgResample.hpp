@@ -0,0 +1,80 @@
+//
+// Copyright (c) 2015 Singular Inversions Inc. (facegen.com)
+// Use, modification and distribution is subject to the MIT License,
+// see accompanying file LICENSE.txt or facegen.com/base_library_license.txt
+//
+// Separable (polyphase) image resampling with a choice of filter kernel.
+//
+// The filter weights for each destination column and row are computed once when the resampler
+// is constructed for a pair of image sizes, so a resampler can be reused for any number of
+// images of those sizes. Resampling is a horizontal pass over the source rows into a float
+// intermediate followed by a vertical pass, each computed in parallel bands of rows.
+//
+// When shrinking, the kernels are widened by the shrink factor so they also act as the
+// anti-aliasing filter. Source pixels beyond the borders are clamped to the border pixel.
+//
+
+#ifndef FGIMGRESAMPLE_HPP
+#define FGIMGRESAMPLE_HPP
+
+#include "FgStdLibs.hpp"
+#include "FgImageBase.hpp"
+
+enum class FgResampleFilter
+{
+    box,        // Exact area coverage of the destination pixel, as 'fgImgResize'
+    linear,     // Triangle (bilinear when expanding)
+    mitchell,   // Mitchell-Netravali cubic (B = C = 1/3), radius 2
+    lanczos     // Lanczos windowed sinc, radius 3
+};
+
+// Source pixels and weights for each destination pixel in one dimension:
+struct  FgResampleTable
+{
+    uint            taps;       // Weights per destination pixel
+    vector<uint>    first;      // First source pixel for each destination pixel
+    vector<float>   weights;    // 'taps' weights for each destination pixel, summing to 1
+
+    FgResampleTable() : taps(0) {}
+
+    FgResampleTable(uint srcSize,uint dstSize,FgResampleFilter filter);
+};
+
+struct  FgImgResampler
+{
+    FgVect2UI           srcDims;
+    FgVect2UI           dstDims;
+    FgResampleTable     cols;
+    FgResampleTable     rows;
+
+    FgImgResampler(FgVect2UI srcDims,FgVect2UI dstDims,FgResampleFilter filter);
+
+    // 'src' must have dimensions 'srcDims' and 'dst' is resized to 'dstDims'. 8-bit values are
+    // rounded and clamped. 'numThreads' of 0 means one per hardware thread:
+    void
+    apply(const FgImgUC & src,FgImgUC & dst,uint numThreads=0) const;
+    void
+    apply(const FgImgRgbaUb & src,FgImgRgbaUb & dst,uint numThreads=0) const;
+    void
+    apply(const FgImgF & src,FgImgF & dst,uint numThreads=0) const;
+    void
+    apply(const FgImg3F & src,FgImg3F & dst,uint numThreads=0) const;
+    void
+    apply(const FgImg4F & src,FgImg4F & dst,uint numThreads=0) const;
+    void
+    apply(const FgImgRgbaF & src,FgImgRgbaF & dst,uint numThreads=0) const;
+    void
+    apply(const FgImgD & src,FgImgD & dst,uint numThreads=0) const;
+};
+
+// Convenience for a single image:
+template<class T>
+FgImage<T>
+fgImgResample(const FgImage<T> & src,FgVect2UI dims,FgResampleFilter filter,uint numThreads=0)
+{
+    FgImage<T>      ret;
+    FgImgResampler(src.dims(),dims,filter).apply(src,ret,numThreads);
+    return ret;
+}
+
+#endif
@@ -0,0 +1,303 @@
+//
+// Copyright (c) 2015 Singular Inversions Inc. (facegen.com)
+// Use, modification and distribution is subject to the MIT License,
+// see accompanying file LICENSE.txt or facegen.com/base_library_license.txt
+//
+// Non-owning view of image pixels: pointer, dimensions and row stride. Views of an FgImage are
+// implicit, so a kernel written against views accepts whole images as well as sub-images
+// (regions of interest and tiles), which are views into the parent's memory with the parent's
+// stride. Const views are FgImgView<const T>, and mutable views convert implicitly to them.
+// Like a pointer, the view's constness is shallow: a const FgImgView<T> still allows modifying pixels.
+//
+// FgImgAligned is an owning image whose rows each start on a 64 byte boundary, for cache line
+// aligned tiles and aligned SIMD loads. It is used through its views.
+//
+// INVARIANTS:
+//
+// m_stride >= m_dims[0]
+//
+
+#ifndef FGIMGVIEW_HPP
+#define FGIMGVIEW_HPP
+
+#include "FgStdLibs.hpp"
+#include "FgDiagnostics.hpp"
+#include "FgIter.hpp"
+#include <boost/type_traits/remove_const.hpp>
+#include <boost/type_traits/is_convertible.hpp>
+#include <boost/type_traits/is_const.hpp>
+#include <boost/type_traits/is_same.hpp>
+#include <boost/utility/enable_if.hpp>
+#include <boost/align/aligned_allocator.hpp>
+
+template<typename T> struct FgImage;
+
+template<class T>
+struct  FgImgView
+{
+    typedef typename boost::remove_const<T>::type  PixelType;
+    typedef FgImgView<const PixelType>              ConstView;
+
+    T *             m_data;         // First pixel of first row. NULL if empty.
+    FgVect2UI       m_dims;         // [width,height]
+    size_t          m_stride;       // Pixels (not bytes) from the start of one row to the start of the next
+
+    FgImgView() : m_data(NULL), m_dims(0), m_stride(0) {}
+
+    FgImgView(T * data,FgVect2UI dims,size_t stride)
+    : m_data(data), m_dims(dims), m_stride(stride)
+    {FGASSERT(stride >= dims[0]); }
+
+    FgImgView(FgImage<PixelType> & img)
+    : m_data(img.dataPtr()), m_dims(img.dims()), m_stride(img.width())
+    {}
+
+    // Const views only (a template so it is removed from overload resolution otherwise):
+    template<class U>
+    FgImgView(
+        const FgImage<U> & img,
+        typename boost::enable_if_c<boost::is_const<T>::value && boost::is_same<U,PixelType>::value,int>::type=0)
+    : m_data(img.dataPtr()), m_dims(img.dims()), m_stride(img.width())
+    {}
+
+    // Mutable to const view:
+    template<class U>
+    FgImgView(
+        const FgImgView<U> & view,
+        typename boost::enable_if<boost::is_convertible<U*,T*>,int>::type=0)
+    : m_data(view.m_data), m_dims(view.m_dims), m_stride(view.m_stride)
+    {}
+
+    uint
+    width() const
+    {return m_dims[0]; }
+
+    uint
+    height() const
+    {return m_dims[1]; }
+
+    FgVect2UI
+    dims() const
+    {return m_dims; }
+
+    size_t
+    stride() const
+    {return m_stride; }
+
+    size_t
+    numPixels() const
+    {return size_t(m_dims[0]) * m_dims[1]; }
+
+    bool
+    empty() const
+    {return ((m_dims[0] == 0) || (m_dims[1] == 0)); }
+
+    // True if there is no padding between rows so the pixels can be addressed linearly:
+    bool
+    contiguous() const
+    {return ((m_stride == m_dims[0]) || (m_dims[1] < 2)); }
+
+    T *
+    rowPtr(uint row) const
+    {return m_data + row*m_stride; }
+
+    T &
+    xy(size_t ircs_x,size_t ircs_y) const
+    {
+        FGASSERT_FAST((ircs_x < m_dims[0]) && (ircs_y < m_dims[1]));
+        return m_data[ircs_y*m_stride+ircs_x];
+    }
+
+    T &
+    operator[](FgVect2UI ircsPos) const
+    {return xy(ircsPos[0],ircsPos[1]); }
+
+    template<typename U>
+    T &
+    operator[](const FgIter<U,2> & it) const
+    {return xy(it()[0],it()[1]); }
+
+    // Zero-copy sub-image of dimensions 'dims' with top left pixel at 'ircs':
+    FgImgView
+    sub(FgVect2UI ircs,FgVect2UI dims) const
+    {
+        FGASSERT((ircs[0]+dims[0] <= m_dims[0]) && (ircs[1]+dims[1] <= m_dims[1]));
+        return FgImgView(m_data+ircs[1]*m_stride+ircs[0],dims,m_stride);
+    }
+};
+
+template<class T>
+FgImgView<T>
+fgImgView(FgImage<T> & img)
+{return FgImgView<T>(img); }
+
+template<class T>
+FgImgView<const T>
+fgImgView(const FgImage<T> & img)
+{return FgImgView<const T>(img); }
+
+// Zero-copy sub-image of dimensions 'dims' with top left pixel at 'ircs':
+template<class T>
+FgImgView<T>
+fgSubImage(FgImage<T> & img,FgVect2UI ircs,FgVect2UI dims)
+{return FgImgView<T>(img).sub(ircs,dims); }
+
+template<class T>
+FgImgView<const T>
+fgSubImage(const FgImage<T> & img,FgVect2UI ircs,FgVect2UI dims)
+{return FgImgView<const T>(img).sub(ircs,dims); }
+
+// Views must be the same size and must not overlap:
+template<class T,class U>
+void
+fgImgCopy(FgImgView<T> src,FgImgView<U> dst)
+{
+    FGASSERT(src.dims() == dst.dims());
+    for (uint yy=0; yy<src.height(); ++yy) {
+        const T *   s = src.rowPtr(yy);
+        std::copy(s,s+src.width(),dst.rowPtr(yy));
+    }
+}
+
+template<class T>
+void
+fgImgFill(FgImgView<T> img,typename FgImgView<T>::PixelType val)
+{
+    for (uint yy=0; yy<img.height(); ++yy) {
+        T *         r = img.rowPtr(yy);
+        std::fill(r,r+img.width(),val);
+    }
+}
+
+// Pixel type must be trivially copyable:
+template<class T>
+struct  FgImgAligned
+{
+    static const size_t align = 64;     // Bytes. Cache line size and a multiple of all SIMD widths.
+
+    FgVect2UI       m_dims;             // [width,height]
+    size_t          m_stride;           // Pixels
+    std::vector<T,boost::alignment::aligned_allocator<T,align> > m_data;
+
+    FgImgAligned() : m_dims(0), m_stride(0) {}
+
+    explicit
+    FgImgAligned(FgVect2UI dims)
+    {resize(dims); }
+
+    FgImgAligned(FgVect2UI dims,T fillVal)
+    {resize(dims,fillVal); }
+
+    explicit
+    FgImgAligned(FgImgView<const T> src)
+    {
+        resize(src.dims());
+        fgImgCopy(src,view());
+    }
+
+    // Smallest stride >= 'width' for which every row starts on an alignment boundary:
+    static
+    size_t
+    alignedStride(uint width)
+    {
+        size_t      aa = align,
+                    bb = sizeof(T);
+        while (bb != 0) {               // Euclid
+            size_t      tt = aa % bb;
+            aa = bb;
+            bb = tt;
+        }
+        size_t      quantum = align / aa;   // Pixels per alignment period
+        return ((width + quantum - 1) / quantum) * quantum;
+    }
+
+    // WARNING: This does not adjust any existing image data, just allocated dimensions and memory:
+    void
+    resize(FgVect2UI dims)
+    {
+        m_dims = dims;
+        m_stride = alignedStride(dims[0]);
+        m_data.resize(m_stride*dims[1]);
+    }
+
+    void
+    resize(FgVect2UI dims,T fillVal)
+    {
+        resize(dims);
+        std::fill(m_data.begin(),m_data.end(),fillVal);
+    }
+
+    uint
+    width() const
+    {return m_dims[0]; }
+
+    uint
+    height() const
+    {return m_dims[1]; }
+
+    FgVect2UI
+    dims() const
+    {return m_dims; }
+
+    size_t
+    stride() const
+    {return m_stride; }
+
+    size_t
+    numPixels() const
+    {return size_t(m_dims[0]) * m_dims[1]; }
+
+    bool
+    empty() const
+    {return m_data.empty(); }
+
+    T *
+    rowPtr(uint row)
+    {return &m_data[row*m_stride]; }
+
+    const T *
+    rowPtr(uint row) const
+    {return &m_data[row*m_stride]; }
+
+    T &
+    xy(size_t ircs_x,size_t ircs_y)
+    {
+        FGASSERT_FAST((ircs_x < m_dims[0]) && (ircs_y < m_dims[1]));
+        return m_data[ircs_y*m_stride+ircs_x];
+    }
+    const T &
+    xy(size_t ircs_x,size_t ircs_y) const
+    {
+        FGASSERT_FAST((ircs_x < m_dims[0]) && (ircs_y < m_dims[1]));
+        return m_data[ircs_y*m_stride+ircs_x];
+    }
+
+    T &
+    operator[](FgVect2UI ircsPos)
+    {return xy(ircsPos[0],ircsPos[1]); }
+
+    const T &
+    operator[](FgVect2UI ircsPos) const
+    {return xy(ircsPos[0],ircsPos[1]); }
+
+    FgImgView<T>
+    view()
+    {return FgImgView<T>((m_data.empty() ? NULL : &m_data[0]),m_dims,m_stride); }
+
+    FgImgView<const T>
+    view() const
+    {return FgImgView<const T>((m_data.empty() ? NULL : &m_data[0]),m_dims,m_stride); }
+
+    operator FgImgView<T>()
+    {return view(); }
+
+    operator FgImgView<const T>() const
+    {return view(); }
+
+    // Tightly packed copy:
+    FgImage<T>
+    image() const
+    {return FgImage<T>(view()); }
+};
+
+#endif
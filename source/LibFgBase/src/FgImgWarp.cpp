@@ -0,0 +1,448 @@
+//
+// Copyright (c) 2015 Singular Inversions Inc. (facegen.com)
+// Use, modification and distribution is subject to the MIT License,
+// see accompanying file LICENSE.txt or facegen.com/base_library_license.txt
+//
+// Each sample is separable: 'taps' source columns and rows with weights, where the border
+// policy either clamps out of range indices or zeros their weights. The 4 channel gathers use
+// SSE2 (always available on x64).
+//
+
+#include "stdafx.h"
+
+#include "FgImgWarp.hpp"
+#include "FgImgKernel.hpp"
+#include "FgThread.hpp"
+#include "FgMath.hpp"
+
+using namespace std;
+
+FgWarpMap::FgWarpMap(const FgImage<FgVect2F> & srcIpcs)
+    : dims(srcIpcs.dims()), dense(&srcIpcs), projective(false)
+{}
+
+FgWarpMap::FgWarpMap(FgVect2UI d,const FgAffine2F & dstToSrc)
+    : dims(d), dense(NULL), projective(false)
+{
+    homog.setIdentity();
+    for (uint rr=0; rr<2; ++rr) {
+        for (uint cc=0; cc<2; ++cc)
+            homog.rc(rr,cc) = dstToSrc.linear.rc(rr,cc);
+        homog.rc(rr,2) = dstToSrc.translation[rr];
+    }
+}
+
+FgWarpMap::FgWarpMap(FgVect2UI d,const FgMat33F & dstToSrc)
+    : dims(d), dense(NULL), homog(dstToSrc), projective(true)
+{}
+
+void
+FgWarpMap::row(uint yy,uint x0,uint num,FgVect2F * srcIpcs) const
+{
+    FGASSERT((yy < dims[1]) && (x0+num <= dims[0]));
+    if (dense != NULL) {
+        std::copy(dense->rowPtr(yy)+x0,dense->rowPtr(yy)+x0+num,srcIpcs);
+        return;
+    }
+    const FgMat33F &    h = homog;
+    float               y = float(yy) + 0.5f,
+                        bx = h.rc(0,1) * y + h.rc(0,2),
+                        by = h.rc(1,1) * y + h.rc(1,2),
+                        bw = h.rc(2,1) * y + h.rc(2,2);
+    if (projective) {
+        for (uint ii=0; ii<num; ++ii) {
+            float       x = float(x0+ii) + 0.5f,
+                        iw = 1.0f / (h.rc(2,0) * x + bw);
+            srcIpcs[ii] = FgVect2F((h.rc(0,0) * x + bx) * iw,(h.rc(1,0) * x + by) * iw);
+        }
+    }
+    else {
+        for (uint ii=0; ii<num; ++ii) {
+            float       x = float(x0+ii) + 0.5f;
+            srcIpcs[ii] = FgVect2F(h.rc(0,0) * x + bx,h.rc(1,0) * x + by);
+        }
+    }
+}
+
+namespace {
+
+// INTERPOLATION POLICIES:
+
+struct  Bilinear
+{
+    static const uint   taps = 2;
+    static const int    offset = 0;
+
+    static void
+    weights(float f,float * w)
+    {
+        w[0] = 1.0f - f;
+        w[1] = f;
+    }
+};
+
+struct  Bicubic
+{
+    static const uint   taps = 4;
+    static const int    offset = -1;
+
+    static void
+    weights(float f,float * w)
+    {
+        float       f2 = f * f,
+                    f3 = f2 * f;
+        w[0] = -0.5f*f3 + f2 - 0.5f*f;
+        w[1] = 1.5f*f3 - 2.5f*f2 + 1.0f;
+        w[2] = -1.5f*f3 + 2.0f*f2 + 0.5f*f;
+        w[3] = 0.5f*f3 - 0.5f*f2;
+    }
+};
+
+// BORDER POLICIES:
+
+struct  Clamp
+{
+    static void
+    apply(int * idx,float *,uint num,int size)
+    {
+        for (uint ii=0; ii<num; ++ii)
+            idx[ii] = std::max(0,std::min(size-1,idx[ii]));
+    }
+};
+
+struct  Zero
+{
+    static void
+    apply(int * idx,float * wgt,uint num,int size)
+    {
+        for (uint ii=0; ii<num; ++ii) {
+            if ((idx[ii] < 0) || (idx[ii] >= size)) {
+                wgt[ii] = 0.0f;
+                idx[ii] = std::max(0,std::min(size-1,idx[ii]));
+            }
+        }
+    }
+};
+
+// Source indices and weights in one dimension for IPCS coordinate 'pos':
+template<class I,class B>
+inline
+void
+taps1D(float pos,int size,int * idx,float * wgt)
+{
+    float           ircs = pos - 0.5f;
+    // Keep within int range (also maps NaN to outside):
+    ircs = std::min(float(size+8),std::max(-8.0f,ircs));
+    int             ii = int(ircs + 16.0f) - 16;        // Floor without a library call
+    I::weights(ircs-float(ii),wgt);
+    for (uint kk=0; kk<I::taps; ++kk)
+        idx[kk] = ii + I::offset + int(kk);
+    B::apply(idx,wgt,I::taps,size);
+}
+
+// GATHERS:
+
+template<uint N,class T>
+inline
+void
+gather(const FgImage<T> & src,const int * xi,const int * yi,const float * wx,const float * wy,T & out)
+{
+    const uint      nc = FgImgPix<T>::channels;
+    const float *   base = reinterpret_cast<const float*>(src.dataPtr());
+    size_t          wid = src.width();
+    float           acc[nc];
+    for (uint cc=0; cc<nc; ++cc)
+        acc[cc] = 0.0f;
+    for (uint jj=0; jj<N; ++jj) {
+        const float *   row = base + yi[jj]*wid*nc;
+        float           racc[nc];
+        for (uint cc=0; cc<nc; ++cc)
+            racc[cc] = 0.0f;
+        for (uint ii=0; ii<N; ++ii)
+            for (uint cc=0; cc<nc; ++cc)
+                racc[cc] += row[xi[ii]*nc+cc] * wx[ii];
+        for (uint cc=0; cc<nc; ++cc)
+            acc[cc] += racc[cc] * wy[jj];
+    }
+    float *         po = reinterpret_cast<float*>(&out);
+    for (uint cc=0; cc<nc; ++cc)
+        po[cc] = acc[cc];
+}
+
+template<uint N>
+inline
+void
+gather(const FgImgUC & src,const int * xi,const int * yi,const float * wx,const float * wy,uchar & out)
+{
+    size_t          wid = src.width();
+    float           acc = 0.0f;
+    for (uint jj=0; jj<N; ++jj) {
+        const uchar *   row = src.dataPtr() + yi[jj]*wid;
+        float           racc = 0.0f;
+        for (uint ii=0; ii<N; ++ii)
+            racc += float(row[xi[ii]]) * wx[ii];
+        acc += racc * wy[jj];
+    }
+    out = uchar(std::max(0.0f,std::min(255.0f,acc)) + 0.5f);
+}
+
+#ifdef FG_IMG_SSE2
+
+template<uint N>
+inline
+void
+gather(const FgImgRgbaUb & src,const int * xi,const int * yi,const float * wx,const float * wy,FgRgbaUB & out)
+{
+    const __m128i   zero = _mm_setzero_si128();
+    const uchar *   base = reinterpret_cast<const uchar*>(src.dataPtr());
+    size_t          wid = src.width();
+    __m128          acc = _mm_setzero_ps();
+    for (uint jj=0; jj<N; ++jj) {
+        const uchar *   row = base + 4*yi[jj]*wid;
+        __m128          racc = _mm_setzero_ps();
+        for (uint ii=0; ii<N; ++ii) {
+            int         pix;
+            memcpy(&pix,row+4*xi[ii],4);
+            __m128i     pi = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(pix),zero),zero);
+            racc = _mm_add_ps(racc,_mm_mul_ps(_mm_cvtepi32_ps(pi),_mm_set1_ps(wx[ii])));
+        }
+        acc = _mm_add_ps(acc,_mm_mul_ps(racc,_mm_set1_ps(wy[jj])));
+    }
+    __m128i         res = _mm_cvtps_epi32(acc);     // Round to nearest
+    res = _mm_packus_epi16(_mm_packs_epi32(res,res),zero);
+    int             pix = _mm_cvtsi128_si32(res);
+    memcpy(&out,&pix,4);
+}
+
+template<uint N>
+inline
+void
+gather(const FgImg4F & src,const int * xi,const int * yi,const float * wx,const float * wy,FgVect4F & out)
+{
+    const float *   base = reinterpret_cast<const float*>(src.dataPtr());
+    size_t          wid = src.width();
+    __m128          acc = _mm_setzero_ps();
+    for (uint jj=0; jj<N; ++jj) {
+        const float *   row = base + 4*yi[jj]*wid;
+        __m128          racc = _mm_setzero_ps();
+        for (uint ii=0; ii<N; ++ii)
+            racc = _mm_add_ps(racc,_mm_mul_ps(_mm_loadu_ps(row+4*xi[ii]),_mm_set1_ps(wx[ii])));
+        acc = _mm_add_ps(acc,_mm_mul_ps(racc,_mm_set1_ps(wy[jj])));
+    }
+    _mm_storeu_ps(&out[0],acc);
+}
+
+#else
+
+template<uint N>
+inline
+void
+gather(const FgImgRgbaUb & src,const int * xi,const int * yi,const float * wx,const float * wy,FgRgbaUB & out)
+{
+    const uchar *   base = reinterpret_cast<const uchar*>(src.dataPtr());
+    size_t          wid = src.width();
+    float           acc[4] = {0,0,0,0};
+    for (uint jj=0; jj<N; ++jj) {
+        const uchar *   row = base + 4*yi[jj]*wid;
+        for (uint ii=0; ii<N; ++ii)
+            for (uint cc=0; cc<4; ++cc)
+                acc[cc] += float(row[4*xi[ii]+cc]) * wx[ii] * wy[jj];
+    }
+    for (uint cc=0; cc<4; ++cc)
+        out.m_c[cc] = uchar(std::max(0.0f,std::min(255.0f,acc[cc])) + 0.5f);
+}
+
+#endif
+
+// TILES:
+
+const uint      tileWid = 64,
+                tileHgt = 16;
+
+// Smaller outputs are computed in a single task:
+const size_t    minParallelPixels = 1 << 14;
+
+struct  Tile
+{
+    uint        x0,y0,x1,y1;
+
+    Tile(FgVect2UI dims,size_t tile)
+    {
+        uint    tilesX = (dims[0] + tileWid - 1) / tileWid;
+        x0 = uint(tile % tilesX) * tileWid;
+        y0 = uint(tile / tilesX) * tileHgt;
+        x1 = std::min(x0+tileWid,dims[0]);
+        y1 = std::min(y0+tileHgt,dims[1]);
+    }
+};
+
+void
+runTiles(const boost::function<void(size_t)> & func,FgVect2UI dims,uint numThreads)
+{
+    size_t          num = size_t((dims[0] + tileWid - 1) / tileWid) * ((dims[1] + tileHgt - 1) / tileHgt);
+    if (size_t(dims[0]) * dims[1] < minParallelPixels)
+        numThreads = 1;
+    fgParallelFor(num,func,numThreads);
+}
+
+template<class T,class I,class B>
+void
+warpTile(const FgImage<T> * src,const FgWarpMap * map,FgImage<T> * dst,size_t tile)
+{
+    const uint      N = I::taps;
+    Tile            tt(dst->dims(),tile);
+    FgVect2F        ipcs[tileWid];
+    int             xi[N],
+                    yi[N];
+    float           wx[N],
+                    wy[N];
+    int             wid = int(src->width()),
+                    hgt = int(src->height());
+    for (uint yy=tt.y0; yy<tt.y1; ++yy) {
+        map->row(yy,tt.x0,tt.x1-tt.x0,ipcs);
+        T *         out = dst->rowPtr(yy) + tt.x0;
+        for (uint xx=0; xx<tt.x1-tt.x0; ++xx) {
+            taps1D<I,B>(ipcs[xx][0],wid,xi,wx);
+            taps1D<I,B>(ipcs[xx][1],hgt,yi,wy);
+            gather<N>(*src,xi,yi,wx,wy,out[xx]);
+        }
+    }
+}
+
+template<class I,class B>
+void
+planTile(FgWarpPlan * plan,const FgWarpMap * map,size_t tile)
+{
+    const uint      N = I::taps;
+    Tile            tt(plan->dstDims,tile);
+    FgVect2F        ipcs[tileWid];
+    int             wid = int(plan->srcDims[0]),
+                    hgt = int(plan->srcDims[1]);
+    for (uint yy=tt.y0; yy<tt.y1; ++yy) {
+        map->row(yy,tt.x0,tt.x1-tt.x0,ipcs);
+        size_t      off = (size_t(yy) * plan->dstDims[0] + tt.x0) * N;
+        for (uint xx=0; xx<tt.x1-tt.x0; ++xx,off+=N) {
+            taps1D<I,B>(ipcs[xx][0],wid,&plan->xIdx[off],&plan->xWgt[off]);
+            taps1D<I,B>(ipcs[xx][1],hgt,&plan->yIdx[off],&plan->yWgt[off]);
+        }
+    }
+}
+
+template<class T,uint N>
+void
+applyTile(const FgWarpPlan * plan,const FgImage<T> * src,FgImage<T> * dst,size_t tile)
+{
+    Tile            tt(plan->dstDims,tile);
+    for (uint yy=tt.y0; yy<tt.y1; ++yy) {
+        size_t      off = (size_t(yy) * plan->dstDims[0] + tt.x0) * N;
+        T *         out = dst->rowPtr(yy) + tt.x0;
+        for (uint xx=0; xx<tt.x1-tt.x0; ++xx,off+=N)
+            gather<N>(*src,&plan->xIdx[off],&plan->yIdx[off],&plan->xWgt[off],&plan->yWgt[off],out[xx]);
+    }
+}
+
+template<class T>
+void
+warp(const FgImage<T> & src,const FgWarpMap & map,FgImage<T> & dst,FgWarpInterp interp,FgWarpBorder border,uint numThreads)
+{
+    FGASSERT(!src.empty());
+    FGASSERT(src.dataPtr() != dst.dataPtr());
+    dst.resize(map.dims);
+    boost::function<void(size_t)>   func;
+    if (interp == FgWarpInterp::bilinear) {
+        if (border == FgWarpBorder::clamp)
+            func = boost::bind(warpTile<T,Bilinear,Clamp>,&src,&map,&dst,_1);
+        else
+            func = boost::bind(warpTile<T,Bilinear,Zero>,&src,&map,&dst,_1);
+    }
+    else {
+        if (border == FgWarpBorder::clamp)
+            func = boost::bind(warpTile<T,Bicubic,Clamp>,&src,&map,&dst,_1);
+        else
+            func = boost::bind(warpTile<T,Bicubic,Zero>,&src,&map,&dst,_1);
+    }
+    runTiles(func,map.dims,numThreads);
+}
+
+template<class T>
+void
+applyPlan(const FgWarpPlan & plan,const FgImage<T> & src,FgImage<T> & dst,uint numThreads)
+{
+    if (src.dims() != plan.srcDims)
+        fgThrow("FgWarpPlan source image dimensions mismatch",fgToString(src.dims()));
+    FGASSERT(src.dataPtr() != dst.dataPtr());
+    dst.resize(plan.dstDims);
+    if (plan.taps == 2)
+        runTiles(boost::bind(applyTile<T,2>,&plan,&src,&dst,_1),plan.dstDims,numThreads);
+    else
+        runTiles(boost::bind(applyTile<T,4>,&plan,&src,&dst,_1),plan.dstDims,numThreads);
+}
+
+}
+
+void
+fgImgWarp(const FgImgUC & src,const FgWarpMap & map,FgImgUC & dst,FgWarpInterp interp,FgWarpBorder border,uint numThreads)
+{warp(src,map,dst,interp,border,numThreads); }
+
+void
+fgImgWarp(const FgImgRgbaUb & src,const FgWarpMap & map,FgImgRgbaUb & dst,FgWarpInterp interp,FgWarpBorder border,uint numThreads)
+{warp(src,map,dst,interp,border,numThreads); }
+
+void
+fgImgWarp(const FgImgF & src,const FgWarpMap & map,FgImgF & dst,FgWarpInterp interp,FgWarpBorder border,uint numThreads)
+{warp(src,map,dst,interp,border,numThreads); }
+
+void
+fgImgWarp(const FgImg3F & src,const FgWarpMap & map,FgImg3F & dst,FgWarpInterp interp,FgWarpBorder border,uint numThreads)
+{warp(src,map,dst,interp,border,numThreads); }
+
+void
+fgImgWarp(const FgImg4F & src,const FgWarpMap & map,FgImg4F & dst,FgWarpInterp interp,FgWarpBorder border,uint numThreads)
+{warp(src,map,dst,interp,border,numThreads); }
+
+FgWarpPlan::FgWarpPlan(FgVect2UI sd,const FgWarpMap & map,FgWarpInterp interp,FgWarpBorder border,uint numThreads)
+    : srcDims(sd), dstDims(map.dims), taps((interp == FgWarpInterp::bilinear) ? 2 : 4)
+{
+    FGASSERT(fgMinElem(srcDims) > 0);
+    size_t          num = size_t(dstDims[0]) * dstDims[1] * taps;
+    xIdx.resize(num);
+    yIdx.resize(num);
+    xWgt.resize(num);
+    yWgt.resize(num);
+    boost::function<void(size_t)>   func;
+    if (interp == FgWarpInterp::bilinear) {
+        if (border == FgWarpBorder::clamp)
+            func = boost::bind(planTile<Bilinear,Clamp>,this,&map,_1);
+        else
+            func = boost::bind(planTile<Bilinear,Zero>,this,&map,_1);
+    }
+    else {
+        if (border == FgWarpBorder::clamp)
+            func = boost::bind(planTile<Bicubic,Clamp>,this,&map,_1);
+        else
+            func = boost::bind(planTile<Bicubic,Zero>,this,&map,_1);
+    }
+    runTiles(func,dstDims,numThreads);
+}
+
+void
+FgWarpPlan::apply(const FgImgUC & src,FgImgUC & dst,uint numThreads) const
+{applyPlan(*this,src,dst,numThreads); }
+
+void
+FgWarpPlan::apply(const FgImgRgbaUb & src,FgImgRgbaUb & dst,uint numThreads) const
+{applyPlan(*this,src,dst,numThreads); }
+
+void
+FgWarpPlan::apply(const FgImgF & src,FgImgF & dst,uint numThreads) const
+{applyPlan(*this,src,dst,numThreads); }
+
+void
+FgWarpPlan::apply(const FgImg3F & src,FgImg3F & dst,uint numThreads) const
+{applyPlan(*this,src,dst,numThreads); }
+
+void
+FgWarpPlan::apply(const FgImg4F & src,FgImg4F & dst,uint numThreads) const
+{applyPlan(*this,src,dst,numThreads); }
+
+// */
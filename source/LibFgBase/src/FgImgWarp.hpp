@@ -0,0 +1,100 @@
+//
+// Copyright (c) 2015 Singular Inversions Inc. (facegen.com)
+// Use, modification and distribution is subject to the MIT License,
+// see accompanying file LICENSE.txt or facegen.com/base_library_license.txt
+//
+// Image warping through a coordinate map: each output pixel is interpolated from the source
+// image at the source position given by the map for the output pixel centre.
+//
+// The output is computed in tiles distributed over threads. The sampling loops are compiled
+// separately for each interpolation and border policy so there is no per-sample dispatch.
+// For repeated warps of same-size images through the same map (eg. video) an FgWarpPlan
+// precomputes the sample indices and weights so only the weighted gathering remains.
+//
+
+#ifndef FGIMGWARP_HPP
+#define FGIMGWARP_HPP
+
+#include "FgStdLibs.hpp"
+#include "FgImageBase.hpp"
+#include "FgAffineC.hpp"
+
+enum class FgWarpInterp { bilinear, bicubic };     // Bicubic is Catmull-Rom (Keys a = -0.5)
+
+enum class FgWarpBorder
+{
+    clamp,      // Samples outside the source take the nearest border pixel value
+    zero        // Samples outside the source are zero (transparent for RGBA)
+};
+
+// Maps output image pixel centres to source image IPCS:
+struct  FgWarpMap
+{
+    FgVect2UI                   dims;           // Output image dimensions
+    const FgImage<FgVect2F> *   dense;          // Borrowed. NULL unless constructed from one.
+    FgMat33F                    homog;          // Used when 'dense' is NULL
+    bool                        projective;
+
+    // Source IPCS of each output pixel (must outlive this object):
+    explicit
+    FgWarpMap(const FgImage<FgVect2F> & srcIpcs);
+
+    // Transform from output IPCS to source IPCS:
+    FgWarpMap(FgVect2UI dims,const FgAffine2F & dstToSrc);
+
+    // Homogeneous transform from output IPCS to source IPCS:
+    FgWarpMap(FgVect2UI dims,const FgMat33F & dstToSrc);
+
+    // Source IPCS for output pixels [x0,x0+num) of row 'yy':
+    void
+    row(uint yy,uint x0,uint num,FgVect2F * srcIpcs) const;
+};
+
+// 8-bit values are rounded and saturated. 'dst' is resized to the map dimensions.
+// 'numThreads' of 0 means one per hardware thread:
+void
+fgImgWarp(const FgImgUC & src,const FgWarpMap & map,FgImgUC & dst,
+          FgWarpInterp interp=FgWarpInterp::bilinear,FgWarpBorder border=FgWarpBorder::clamp,uint numThreads=0);
+void
+fgImgWarp(const FgImgRgbaUb & src,const FgWarpMap & map,FgImgRgbaUb & dst,
+          FgWarpInterp interp=FgWarpInterp::bilinear,FgWarpBorder border=FgWarpBorder::clamp,uint numThreads=0);
+void
+fgImgWarp(const FgImgF & src,const FgWarpMap & map,FgImgF & dst,
+          FgWarpInterp interp=FgWarpInterp::bilinear,FgWarpBorder border=FgWarpBorder::clamp,uint numThreads=0);
+void
+fgImgWarp(const FgImg3F & src,const FgWarpMap & map,FgImg3F & dst,
+          FgWarpInterp interp=FgWarpInterp::bilinear,FgWarpBorder border=FgWarpBorder::clamp,uint numThreads=0);
+void
+fgImgWarp(const FgImg4F & src,const FgWarpMap & map,FgImg4F & dst,
+          FgWarpInterp interp=FgWarpInterp::bilinear,FgWarpBorder border=FgWarpBorder::clamp,uint numThreads=0);
+
+// Precomputed sample indices and weights of a warp for source images of dimensions 'srcDims':
+struct  FgWarpPlan
+{
+    FgVect2UI       srcDims;
+    FgVect2UI       dstDims;
+    uint            taps;       // Per dimension; 2 for bilinear, 4 for bicubic
+    vector<int>     xIdx;       // 'taps' source columns per output pixel
+    vector<int>     yIdx;       // 'taps' source rows per output pixel
+    vector<float>   xWgt;
+    vector<float>   yWgt;
+
+    FgWarpPlan() : taps(0) {}
+
+    FgWarpPlan(FgVect2UI srcDims,const FgWarpMap & map,
+               FgWarpInterp interp=FgWarpInterp::bilinear,FgWarpBorder border=FgWarpBorder::clamp,uint numThreads=0);
+
+    // Same results as 'fgImgWarp' with the construction arguments:
+    void
+    apply(const FgImgUC & src,FgImgUC & dst,uint numThreads=0) const;
+    void
+    apply(const FgImgRgbaUb & src,FgImgRgbaUb & dst,uint numThreads=0) const;
+    void
+    apply(const FgImgF & src,FgImgF & dst,uint numThreads=0) const;
+    void
+    apply(const FgImg3F & src,FgImg3F & dst,uint numThreads=0) const;
+    void
+    apply(const FgImg4F & src,FgImg4F & dst,uint numThreads=0) const;
+};
+
+#endif
@@ -39,13 +39,20 @@ fgArgs(int argc,const wchar_t * argv[])
     return args;
 }
 
-// Final EOL required to due fgout idiom of fgnl at beginning of line:
+// Final EOL required to due fgout idiom of fgnl at beginning of line. Also waits for any
+// asynchronous output to be written, including on exception:
+static
+void
+flushOut()
+{
 #ifdef _WIN32
-// Windows cmd.exe automatically adds an EOL so we only need one more:
-#define FLUSH fgout << endl
+    // Windows cmd.exe automatically adds an EOL so we only need one more:
+    fgout << endl;
 #else
-#define FLUSH fgout << endl << endl
+    fgout << endl << endl;
 #endif
+    fgout.flush();
+}
 
 static FgArgs s_mainArgs;
 
@@ -56,7 +63,7 @@ fgMainConsole(FgCmdFunc func,int argc,const char * argv[])
     {
         s_mainArgs = fgArgs(argc,argv);
         func(s_mainArgs);
-        FLUSH;
+        flushOut();
         return 0;
     }
     catch(FgExceptionCommandSyntax const &)
@@ -69,14 +76,14 @@ fgMainConsole(FgCmdFunc func,int argc,const char * argv[])
              << endl << "    -2 -- Standard library exception"
              << endl << "    -3 -- Unknown exception"
              << endl << "    -4 -- This message";
-        FLUSH;
+        flushOut();
         return -4;
     }
     catch(FgException const & e)
     {
         fgout.setCout(true);
         fgout << endl << "ERROR (FG exception): " << e.no_tr_message();
-        FLUSH;
+        flushOut();
         return -1;
     }
     catch(std::bad_alloc const &)
@@ -86,21 +93,21 @@ fgMainConsole(FgCmdFunc func,int argc,const char * argv[])
 #ifndef FG_64
         fgout << fgnl << "Try running a 64-bit binary instead of this 32-bit binary";
 #endif
-        FLUSH;
+        flushOut();
         return -2;
     }
     catch(std::exception const & e)
     {
         fgout.setCout(true);
         fgout << endl << "ERROR (std::exception): " << e.what();
-        FLUSH;
+        flushOut();
         return -2;
     }
     catch(...)
     {
         fgout.setCout(true);
         fgout << endl << "ERROR (unknown type):";
-        FLUSH;
+        flushOut();
         return -3;
     }
 }
@@ -112,7 +119,7 @@ fgMainConsole(FgCmdFunc func,int argc,const wchar_t * argv[])
     {
         s_mainArgs = fgArgs(argc,argv);
         func(s_mainArgs);
-        FLUSH;
+        flushOut();
         return 0;
     }
     catch(FgExceptionCommandSyntax const &)
@@ -125,14 +132,14 @@ fgMainConsole(FgCmdFunc func,int argc,const wchar_t * argv[])
              << endl << "    -2 -- Standard library exception"
              << endl << "    -3 -- Unknown exception"
              << endl << "    -4 -- This message";
-        FLUSH;
+        flushOut();
         return -4;
     }
     catch(FgException const & e)
     {
         fgout.setCout(true);
         fgout << endl << "ERROR (FG exception): " << e.no_tr_message();
-        FLUSH;
+        flushOut();
         return -1;
     }
     catch(std::bad_alloc const &)
@@ -142,21 +149,21 @@ fgMainConsole(FgCmdFunc func,int argc,const wchar_t * argv[])
 #ifndef FG_64
         fgout << fgnl << "Try running a 64-bit binary instead of this 32-bit binary";
 #endif
-        FLUSH;
+        flushOut();
         return -2;
     }
     catch(std::exception const & e)
     {
         fgout.setCout(true);
         fgout << endl << "ERROR (std::exception): " << e.what();
-        FLUSH;
+        flushOut();
         return -2;
     }
     catch(...)
     {
         fgout.setCout(true);
         fgout << endl << "ERROR (unknown type):";
-        FLUSH;
+        flushOut();
         return -3;
     }
 }
@@ -141,11 +141,46 @@ testFgRand()
     FGASSERT(std::abs(rms * 3.0 - 1.0) < 0.001);
 }
 
+double
+fgMedian(vector<double> vals)
+{
+    FGASSERT(!vals.empty());
+    size_t              mid = vals.size() / 2;
+    std::nth_element(vals.begin(),vals.begin()+mid,vals.end());
+    double              ret = vals[mid];
+    if ((vals.size() & 1) == 0)
+        ret = 0.5 * (ret + *std::max_element(vals.begin(),vals.begin()+mid));
+    return ret;
+}
+
+double
+fgMedianAbsDev(const vector<double> & vals,double median)
+{
+    vector<double>      devs(vals.size());
+    for (size_t ii=0; ii<vals.size(); ++ii)
+        devs[ii] = std::abs(vals[ii]-median);
+    return fgMedian(devs);
+}
+
+static
+void
+testMedian()
+{
+    double              vs[] = {5,1,4,2,3};
+    vector<double>      vals(vs,vs+5);
+    FGASSERT(fgMedian(vals) == 3);
+    FGASSERT(fgMedianAbsDev(vals,3) == 1);
+    vals.push_back(100);                        // Robust to outliers
+    FGASSERT(fgMedian(vals) == 3.5);
+    FGASSERT(fgMedianAbsDev(vals,3.5) == 1.5);
+}
+
 void
 fgMathTest(const FgArgs &)
 {
     FgIndent    dummy("Testing rand");
     testFgRand();
+    testMedian();
 }
 
 // The following code is a modified part of the 'fastermath' library:
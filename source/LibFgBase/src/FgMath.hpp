@@ -98,6 +98,14 @@ inline double   fgDegToRad(double degrees) {return degrees * fgPi() / 180.0; };
 inline float    fgRadToDeg(float radians) {return radians * 180.0f / 3.14159265f; };
 inline float    fgDegToRad(float degrees) {return degrees * 3.14159265f / 180.0f; };
 
+// Mean of the middle two values for an even number of values:
+double
+fgMedian(std::vector<double> vals);
+
+// Median absolute deviation from the given median. A robust alternative to the standard deviation:
+double
+fgMedianAbsDev(const std::vector<double> & vals,double median);
+
 namespace fgMath
 {
 
@@ -363,6 +363,16 @@ fgMatRandNormal()
     return vec;
 }
 
+// Using a per-thread generator:
+template<uint nrows,uint ncols>
+FgMatrixC<double,nrows,ncols>
+fgMatRandNormal(FgRandGen & gen)
+{
+    FgMatrixC<double,nrows,ncols>   ret;
+    gen.fillNormal(ret.m,nrows*ncols);
+    return ret;
+}
+
 template<uint nrows,uint ncols>
 FgMatrixC<double,nrows,ncols> 
 fgMatRandUniform(double lo,double hi)
@@ -35,7 +35,7 @@
 #include "FgTypes.hpp"
 #include "FgStdVector.hpp"
 #include "FgDiagnostics.hpp"
-#include "FgSerialize.hpp"
+#include "FgSerializeFast.hpp"
 #include "FgOut.hpp"
 
 // Declare only due to mutual dependence; FgMatrixC and FgMatrixV can be constructed
@@ -428,6 +428,12 @@ struct  FgTraits<FgMatrixC<T,nrows,ncols> >
     typedef FgMatrixC<typename FgTraits<T>::Floating,nrows,ncols>       Floating;
 };
 
+template<class T,uint nrows,uint ncols>
+struct  FgSerialBits<FgMatrixC<T,nrows,ncols> >
+{
+    static const bool value = FgSerialBits<T>::value;
+};
+
 typedef FgMatrixC<float,2,2>        FgMat22F;
 typedef FgMatrixC<double,2,2>       FgMat22D;
 typedef FgMatrixC<int,2,2>          FgMat22I;
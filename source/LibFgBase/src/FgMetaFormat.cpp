@@ -12,6 +12,9 @@
 #include "FgDiagnostics.hpp"
 #include "FgTestUtils.hpp"
 #include "FgCommand.hpp"
+#include "FgSerializeFast.hpp"
+#include "FgImage.hpp"
+#include "FgMatrixV.hpp"
 
 using namespace std;
 
@@ -107,4 +110,103 @@ fgSerializeTest(const FgArgs &)
         FGASSERT(va[ii].m0 == vc[ii].m0);
 }
 
+enum    FastEnum {fastZero, fastOne, fastTwo};
+
+struct  FastInner
+{
+    FgString            name;
+    FgVect3F            pos;
+    vector<double>      vals;
+    FG_SERIALIZE3(name,pos,vals)
+};
+
+struct  FastOuter
+{
+    int                 ii;
+    double              dd;
+    bool                bb;
+    FastEnum            ee;
+    string              str;
+    vector<FgVect3F>    verts;
+    vector<bool>        flags;
+    vector<string>      strs;
+    map<string,int>     counts;
+    vector<FastInner>   inners;
+    FgImgRgbaUb         img;
+    FgMatrixD           mat;
+    FG_SERIALIZE12(ii,dd,bb,ee,str,verts,flags,strs,counts,inners,img,mat)
+};
+
+static
+bool
+fastThrows(const string & blob,FastOuter & val)
+{
+    try {
+        fgDeserializeFast(blob,val);
+    }
+    catch (FgException const &) {
+        return true;
+    }
+    return false;
+}
+
+void
+fgSerializeFastTest(const FgArgs &)
+{
+    FastOuter           out;
+    out.ii = -7;
+    out.dd = 3.25;
+    out.bb = true;
+    out.ee = fastTwo;
+    out.str = "hello";
+    out.verts.push_back(FgVect3F(1,2,3));
+    out.verts.push_back(FgVect3F(4,5,6));
+    out.flags.push_back(true);
+    out.flags.push_back(false);
+    out.flags.push_back(true);
+    out.strs.push_back("");
+    out.strs.push_back("two");
+    out.counts["a"] = 1;
+    out.counts["b"] = 2;
+    out.inners.resize(2);
+    out.inners[1].name = "inner";
+    out.inners[1].pos = FgVect3F(7,8,9);
+    out.inners[1].vals.push_back(0.5);
+    out.img = FgImgRgbaUb(FgVect2UI(3,2),FgRgbaUB(1,2,3,4));
+    out.img.xy(2,1) = FgRgbaUB(5,6,7,8);
+    out.mat = fgMatRandNormal<double>(3,4);
+    string              blob;
+    fgSerializeFast(out,blob);
+    FastOuter           in;
+    fgDeserializeFast(blob,in);
+    FGASSERT(in.ii == out.ii);
+    FGASSERT(in.dd == out.dd);
+    FGASSERT(in.bb == out.bb);
+    FGASSERT(in.ee == out.ee);
+    FGASSERT(in.str == out.str);
+    FGASSERT(in.verts == out.verts);
+    FGASSERT(in.flags == out.flags);
+    FGASSERT(in.strs == out.strs);
+    FGASSERT(in.counts == out.counts);
+    FGASSERT(in.inners.size() == 2);
+    FGASSERT(in.inners[1].name == out.inners[1].name);
+    FGASSERT(in.inners[1].pos == out.inners[1].pos);
+    FGASSERT(in.inners[1].vals == out.inners[1].vals);
+    FGASSERT(in.img.dims() == out.img.dims());
+    FGASSERT(in.img.m_data == out.img.m_data);
+    FGASSERT(in.mat == out.mat);
+    // The buffer is reused:
+    size_t              size = blob.size(),
+                        capacity = blob.capacity();
+    fgSerializeFast(out,blob);
+    FGASSERT(blob.size() == size);
+    FGASSERT(blob.capacity() == capacity);
+    // Invalid data is detected:
+    FGASSERT(fastThrows(blob.substr(0,blob.size()-1),in));
+    FGASSERT(fastThrows(blob+'x',in));
+    string              badVersion = blob;
+    badVersion[0] = char(fgSerialFastVersion + 1);
+    FGASSERT(fastThrows(badVersion,in));
+}
+
 // */
@@ -13,6 +13,12 @@
 #include "FgDiagnostics.hpp"
 #include "FgException.hpp"
 #include "FgTime.hpp"
+#include "FgThread.hpp"
+#include "FgCommand.hpp"
+#include "FgParse.hpp"
+
+#include <boost/atomic.hpp>
+#include <boost/thread/tss.hpp>
 
 using namespace std;
 
@@ -52,9 +58,189 @@ fgreset(ostream & ss)
     return ss << endl;
 }
 
+namespace {
+
+// Node of the asynchronous queue:
+struct  Line
+{
+    Line *          next;
+    string          text;
+};
+
+}
+
+struct  FgOutThread
+{
+    FgOut *         out;
+    FgOutAsync *    owner;
+    ostringstream   buf;
+    uint            indent;
+
+    FgOutThread(FgOut * o,FgOutAsync * a,uint i) : out(o), owner(a), indent(i)
+    {buf.precision(9); }
+};
+
+static void releaseThread(FgOutThread *);
+
+struct  FgOutAsync
+{
+    FgOut *                                 out;
+    // Lines are pushed by any thread onto this lock-free stack and the writer takes the whole
+    // stack at once, reversing it to restore the order:
+    boost::atomic<Line *>                   lines;
+    boost::atomic<uint64>                   numQueued;
+    boost::mutex                            mtx;        // Guards the members below (only used for waiting)
+    boost::condition_variable               cvWork;
+    boost::condition_variable               cvFlushed;
+    uint64                                  numFlushed;
+    bool                                    stop;
+    boost::thread_specific_ptr<FgOutThread> threads;
+    boost::thread                           writer;
+
+    explicit
+    FgOutAsync(FgOut * o) : out(o), lines(NULL), numQueued(0), numFlushed(0), stop(false),
+        threads(releaseThread)
+    {}
+};
+
+// Plain pointer caching the above 'threads' so the compiler's native thread local storage can
+// be used (much faster than boost::thread_specific_ptr):
+#ifdef _MSC_VER
+static __declspec(thread) FgOutThread *     tlsThread = NULL;
+#else
+static __thread FgOutThread *               tlsThread = NULL;
+#endif
+
+static
+FgOutThread &
+threadState(FgOutAsync & as)
+{
+    if ((tlsThread == NULL) || (tlsThread->owner != &as)) {
+        FgOutThread *       ot = as.threads.get();
+        if (ot == NULL) {
+            ot = new FgOutThread(as.out,&as,as.out->m_indent);
+            as.threads.reset(ot);
+        }
+        tlsThread = ot;
+    }
+    return *tlsThread;
+}
+
+// Caller must hold 'out.m_mutex':
+static
+void
+writeText(FgOut & out,const string & text)
+{
+    if (out.m_stream)
+        *out.m_stream << text;
+    if (out.m_ofstream.is_open())
+        out.m_ofstream << text;
+}
+
+static
+void
+flushStreams(FgOut & out)
+{
+    if (out.m_ofstream)
+        out.m_ofstream.flush();
+    if (out.m_stream && *out.m_stream)
+        out.m_stream->flush();
+}
+
+// Writes the given lines (most recent first) in order and deletes them.
+// Caller must hold 'out.m_mutex':
+static
+uint64
+writeLines(FgOut & out,Line * lifo)
+{
+    Line *          fifo = NULL;
+    while (lifo != NULL) {
+        Line *      next = lifo->next;
+        lifo->next = fifo;
+        fifo = lifo;
+        lifo = next;
+    }
+    uint64          num = 0;
+    while (fifo != NULL) {
+        writeText(out,fifo->text);
+        Line *      next = fifo->next;
+        delete fifo;
+        fifo = next;
+        ++num;
+    }
+    return num;
+}
+
+static
+void
+runWriter(FgOutAsync * as)
+{
+    FgOut &         out = *as->out;
+    uint64          numWritten = 0;
+    for (;;) {
+        Line *      lifo = as->lines.exchange(NULL,boost::memory_order_acquire);
+        if (lifo == NULL) {
+            boost::mutex::scoped_lock   lock(as->mtx);
+            if (as->stop)
+                return;
+            // Timeout in case a notification arrived between the exchange and the wait:
+            as->cvWork.timed_wait(lock,boost::posix_time::milliseconds(10));
+            continue;
+        }
+        {
+            boost::mutex::scoped_lock   lock(out.m_mutex);
+            numWritten += writeLines(out,lifo);
+            flushStreams(out);
+        }
+        boost::mutex::scoped_lock   lock(as->mtx);
+        as->numFlushed = numWritten;
+        as->cvFlushed.notify_all();
+    }
+}
+
+// Passes on the buffered output of a thread:
+static
+void
+submit(FgOutThread & ot)
+{
+    if (ot.buf.tellp() <= 0)
+        return;
+    Line *          line = new Line;
+    line->text = ot.buf.str();
+    ot.buf.str(string());
+    FgOutAsync *    as = ot.out->m_async;
+    if (as == NULL) {                       // Thread outlived asynchronous mode
+        boost::mutex::scoped_lock   lock(ot.out->m_mutex);
+        line->next = NULL;
+        writeLines(*ot.out,line);
+        return;
+    }
+    line->next = as->lines.load(boost::memory_order_relaxed);
+    while (!as->lines.compare_exchange_weak(line->next,line,boost::memory_order_release,boost::memory_order_relaxed))
+        ;
+    ++as->numQueued;
+    as->cvWork.notify_one();
+}
+
+// Called on thread exit (or destruction of 'FgOutAsync' for the destroying thread):
+static
+void
+releaseThread(FgOutThread * ot)
+{
+    if (tlsThread == ot)
+        tlsThread = NULL;
+    submit(*ot);
+    delete ot;
+}
+
+FgOut::~FgOut()
+{setAsync(false); }
+
 bool
 FgOut::setCout(bool b)
 {
+    if (m_async)
+        flush();
     m_mutex.lock();
     bool    ret = (m_stream != 0);
     if (b) {
@@ -69,6 +255,8 @@ FgOut::setCout(bool b)
 void
 FgOut::logFile(const FgString & fname,bool append,bool prependDate)
 {
+    if (m_async)
+        flush();
     m_mutex.lock();
     if (m_ofstream.is_open())
         m_ofstream.close();
@@ -79,29 +267,149 @@ FgOut::logFile(const FgString & fname,bool append,bool prependDate)
     m_mutex.unlock();
 }
 
+void
+FgOut::logFileClose()
+{
+    if (m_async)
+        flush();
+    m_mutex.lock();
+    if (m_ofstream.is_open())
+        m_ofstream.close();
+    m_mutex.unlock();
+}
+
+void
+FgOut::setAsync(bool async)
+{
+    if (async == (m_async != NULL))
+        return;
+    if (async) {
+        FgOutAsync *    as = new FgOutAsync(this);
+        as->writer = boost::thread(runWriter,as);
+        m_async = as;
+    }
+    else {
+        uint            indent = indentLevel();
+        flush();
+        FgOutAsync *    as = m_async;
+        {
+            boost::mutex::scoped_lock   lock(as->mtx);
+            as->stop = true;
+            as->cvWork.notify_all();
+        }
+        as->writer.join();
+        m_async = NULL;
+        m_mutex.lock();
+        // Any lines queued by other threads since the flush:
+        writeLines(*this,as->lines.exchange(NULL));
+        flushStreams(*this);
+        m_indent = indent;
+        m_mutex.unlock();
+        delete as;
+        tlsThread = NULL;
+    }
+}
+
+void
+FgOut::push()
+{
+    if (m_async)
+        ++threadState(*m_async).indent;
+    else {
+        m_mutex.lock();
+        m_indent++;
+        m_mutex.unlock();
+    }
+}
+
+void
+FgOut::pop()
+{
+    if (m_async) {
+        FgOutThread &   ot = threadState(*m_async);
+        if (ot.indent > 0)
+            --ot.indent;
+    }
+    else {
+        m_mutex.lock();
+        if (m_indent > 0)   // Can't throw inside mutex lock it appears ...
+            --m_indent;
+        m_mutex.unlock();
+    }
+}
+
+uint
+FgOut::indentLevel() const
+{
+    if (m_async)
+        return threadState(*m_async).indent;
+    return m_indent;
+}
+
+void
+FgOut::reset()
+{setIndentLevel(0); }
+
 void
 FgOut::flush() 
 { 
+    if (m_async) {
+        FgOutAsync &    as = *m_async;
+        submit(threadState(as));
+        uint64          ticket = as.numQueued;
+        boost::mutex::scoped_lock   lock(as.mtx);
+        while (as.numFlushed < ticket) {
+            as.cvWork.notify_one();
+            as.cvFlushed.timed_wait(lock,boost::posix_time::milliseconds(10));
+        }
+        return;
+    }
     m_mutex.lock();
-    if (m_ofstream)
-        m_ofstream.flush();
-    if (m_stream && *m_stream)
-        m_stream->flush();
+    flushStreams(*this);
     m_mutex.unlock();
 }
 
 void
 FgOut::setIndentLevel(uint l)
 {
+    if (m_async) {
+        threadState(*m_async).indent = l;
+        return;
+    }
     m_mutex.lock();
     m_indent = l;
     m_mutex.unlock();
 }
 
+std::ostream &
+FgOut::asyncBuffer()
+{return threadState(*m_async).buf; }
+
 FgOut &
 FgOut::operator<<(std::ostream& (*manip)(std::ostream&))
 {
-    if (notMute())
+    if (notMute() && m_async) {
+        FgOutThread &   ot = threadState(*m_async);
+        if (manip == fgpush)
+            ++ot.indent;
+        else if (manip == fgpop) {
+            if (ot.indent > 0)
+                --ot.indent;
+        }
+        else if (manip == fgnl) {
+            submit(ot);             // The previous line is complete
+            ot.buf << '\n';
+            for (uint ii=0; ii<ot.indent; ii++)
+                ot.buf << "    ";
+        }
+        else {
+            ot.buf << manip;
+            typedef std::ostream & (*Manip)(std::ostream &);
+            if ((manip == static_cast<Manip>(std::endl)) || (manip == static_cast<Manip>(std::flush)))
+                submit(ot);
+        }
+    }
+    else if (notMute())
     {
         // Handle the case of fgpush and fgpop explicitly since otherwise they
         // may be passed on to both streams and double called resulting in twice
@@ -134,3 +442,52 @@ FgOut::operator<<(std::ostream& (*manip)(std::ostream&))
     }
     return *this;
 }
+
+static
+void
+outputLines(FgOut * out,size_t idx)
+{
+    *out << fgnl << "thread " << idx << fgpush;
+    for (uint ii=0; ii<100; ++ii)
+        *out << fgnl << idx << " " << ii;
+    *out << fgpop;
+}
+
+void
+fgOutTest(const FgArgs &)
+{
+    ostringstream       oss;
+    {
+        FgOut               out(oss);
+        out << "start" << fgpush;
+        out.setAsync(true);
+        fgParallelFor(8,boost::bind(outputLines,&out,_1),4);
+        out << fgpop << fgnl << "end";
+        out.flush();
+        FGASSERT(fgEndsWith(oss.str(),"\nend"));
+        out << fgnl << "after";
+        out.setAsync(false);
+        FGASSERT(fgEndsWith(oss.str(),"\nafter"));
+        FGASSERT(out.indentLevel() == 0);
+    }
+    // Each thread's lines are complete, in order and indented by that thread starting from the
+    // indent level when asynchronous mode was set:
+    vector<string>      lines = fgSplitChar(oss.str(),'\n');
+    FGASSERT(lines.size() == 1 + 8*101 + 2);
+    FGASSERT(lines.front() == "start");
+    vector<uint>        next(8,0);
+    for (size_t ll=1; ll<lines.size()-2; ++ll) {
+        const string &  line = lines[ll];
+        if (fgStartsWith(line,"    thread "))
+            continue;
+        FGASSERT(fgStartsWith(line,"        "));
+        vector<string>  words = fgSplitChar(line.substr(8),' ');
+        FGASSERT(words.size() == 2);
+        size_t          idx = fgFromString<size_t>(words[0]);
+        FGASSERT(idx < 8);
+        FGASSERT(fgFromString<uint>(words[1]) == next[idx]);
+        ++next[idx];
+    }
+    for (size_t ii=0; ii<next.size(); ++ii)
+        FGASSERT(next[ii] == 100);
+}
@@ -41,27 +41,35 @@ template<class T>
 std::ostream &
 operator<<(std::ostream & ss,const std::vector<T> & vv);
 
+struct  FgOutAsync;
+
 struct  FgOut
 {
-    boost::mutex        m_mutex;        // Guard m_indent
-    uint                m_indent;
+    boost::mutex        m_mutex;        // Guard m_indent and writing to the streams
+    uint                m_indent;       // Initial indent of each thread in asynchronous mode
     FgOfstream          m_ofstream;     // Stream to file ?
     std::ostream *      m_stream;       // Arbitrary stream - Null if no stream
     bool                m_mute;         // Mute all output
+    FgOutAsync *        m_async;        // Null unless in asynchronous mode
 
     FgOut()
     :   m_indent(0),
         m_stream(&std::cout),
-        m_mute(false)
+        m_mute(false),
+        m_async(NULL)
     {std::cout.precision(9); }
 
     explicit
     FgOut(std::ostream & os)
     :   m_indent(0),
         m_stream(&os),
-        m_mute(false)
+        m_mute(false),
+        m_async(NULL)
     {}
 
+    // Writes any asynchronous output:
+    ~FgOut();
+
     bool
     setCout(bool b);
 
@@ -73,46 +81,38 @@ struct  FgOut
     logFile(const FgString & fname,bool append=true,bool prependDate=true);
 
     void
-    logFileClose()
-    {
-        m_mutex.lock();
-        if (m_ofstream.is_open())
-            m_ofstream.close();
-        m_mutex.unlock();
-    }
+    logFileClose();
+
+    // In asynchronous mode each thread formats its output into its own buffer, and each line is
+    // passed when complete (at the next 'fgnl', 'endl' or 'flush') through a lock-free queue to a
+    // background thread which writes it. Calling threads thus never wait for the console or log
+    // file and never contend for a lock. Indentation is per-thread (starting at the level current
+    // when this mode was set). Lines from different threads are interleaved in the order they
+    // were completed. Only change mode while no other threads are producing output:
+    void
+    setAsync(bool);
+
+    bool
+    isAsync() const
+    {return (m_async != NULL); }
 
     void
-    push()
-    {
-        m_mutex.lock();
-        m_indent++;
-        m_mutex.unlock();
-    }
+    push();
 
     void
-    pop()
-    {
-        m_mutex.lock();
-        if (m_indent > 0)   // Can't throw inside mutex lock it appears ...
-            --m_indent;
-        m_mutex.unlock();
-    }
+    pop();
 
     uint
-    indentLevel() const
-    {return m_indent; }
+    indentLevel() const;
 
     void
     setIndentLevel(uint);
 
     void
-    reset()
-    {
-        m_mutex.lock();
-        m_indent = 0;
-        m_mutex.unlock();
-    }
+    reset();
 
+    // Also waits for any asynchronous output (including that from other threads which has been
+    // queued) to be written:
     void
     flush();
 
@@ -122,10 +122,14 @@ struct  FgOut
     {
         if (notMute())
         {
-            if (m_stream)
-                (*m_stream) << arg;
-            if (m_ofstream.is_open())
-                m_ofstream << arg;
+            if (m_async)
+                asyncBuffer() << arg;
+            else {
+                if (m_stream)
+                    (*m_stream) << arg;
+                if (m_ofstream.is_open())
+                    m_ofstream << arg;
+            }
         }
         return *this;
     }
@@ -135,10 +139,14 @@ struct  FgOut
     {
         if (notMute())
         {
-            if (m_stream)
-                (*m_stream) << str;
-            if (m_ofstream.is_open())
-                m_ofstream << str;
+            if (m_async)
+                asyncBuffer() << str;
+            else {
+                if (m_stream)
+                    (*m_stream) << str;
+                if (m_ofstream.is_open())
+                    m_ofstream << str;
+            }
         }
         return *this;
     }
@@ -151,6 +159,10 @@ private:
     notMute()
     {return ((!m_mute) && (m_stream || m_ofstream.is_open())); }
 
+    // The calling thread's format buffer in asynchronous mode:
+    std::ostream &
+    asyncBuffer();
+
     FgOut(const FgOut&);              // ofstream objects cannot be copy constructed or operator=
     FgOut& operator=(const FgOut&);   // so we must prevent both for this class as well.
 };
@@ -273,6 +273,27 @@ fgWhiteBreak(const string & str)
     return retval;
 }
 
+bool
+fgParseDouble(const char * & ptr,const char * end,double & val)
+{
+    while ((ptr < end) && isspace(uchar(*ptr)))
+        ++ptr;
+    // Longer than any sensibly formatted number:
+    char            buf[64];
+    size_t          len = 0;
+    while ((ptr+len < end) && (len+1 < sizeof(buf)) && !isspace(uchar(ptr[len]))) {
+        buf[len] = ptr[len];
+        ++len;
+    }
+    buf[len] = 0;
+    char *          next;
+    val = strtod(buf,&next);
+    if (next == buf)
+        return false;
+    ptr += next - buf;
+    return true;
+}
+
 void
 fgTestmLoadCsv(const FgArgs & args)
 {
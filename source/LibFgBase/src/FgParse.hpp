@@ -50,6 +50,12 @@ fgSplitChar(const string & str,char sep=' ',bool includeEmptyStrings=false);
 FgStrs
 fgWhiteBreak(const string &);
 
+// Parses a number (after any whitespace) from the start of [ptr,end) as 'strtod' does, but without
+// reading past 'end', so the buffer need not be null terminated (eg. a memory mapped file).
+// Returns false if there is no number, otherwise 'ptr' is advanced past it:
+bool
+fgParseDouble(const char * & ptr,const char * end,double & val);
+
 // Map all non-ASCII characters that look like an ASCII character (homoglyphs) to that ASCII character,
 // and all others to '?':
 string
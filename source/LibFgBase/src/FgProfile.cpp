@@ -0,0 +1,409 @@
+//
+// Copyright (c) 2015 Singular Inversions Inc. (facegen.com)
+// Use, modification and distribution is subject to the MIT License,
+// see accompanying file LICENSE.txt or facegen.com/base_library_license.txt
+//
+
+#include "stdafx.h"
+
+#include "FgProfile.hpp"
+#include "FgTime.hpp"
+#include "FgThread.hpp"
+#include "FgStdStream.hpp"
+#include "FgStdString.hpp"
+#include "FgFileSystem.hpp"
+#include "FgCommand.hpp"
+
+#include <boost/thread/tss.hpp>
+
+using namespace std;
+
+namespace {
+
+struct  Event
+{
+    const char *        name;
+    uint64              beginNs;
+    uint64              endNs;          // 0 while the scope is active
+    uint                depth;
+};
+
+}
+
+// std::deque so appending never moves existing events:
+struct  FgProfileBuffer
+{
+    uint                threadIdx;
+    uint                depth;
+    std::deque<Event>   events;
+    uint64              dropped;        // Scopes not recorded as 'events' was full
+
+    explicit FgProfileBuffer(uint idx) : threadIdx(idx), depth(0), dropped(0) {}
+};
+
+namespace {
+
+void
+releaseBuffer(FgProfileBuffer *);
+
+// Buffers persist after their thread exits so results can still be read, and are then reused
+// by the next new thread so memory is bounded by the peak number of profiled threads. The
+// registry is never freed as threads may be recording during static destruction:
+struct  Registry
+{
+    boost::mutex                mtx;            // Guards 'buffers', 'freeBuffers' and 'names'
+    vector<FgProfileBuffer *>   buffers;
+    vector<FgProfileBuffer *>   freeBuffers;    // Subset of the above whose thread has exited
+    std::set<string>            names;          // Interned names for scopes named at runtime
+    size_t                      maxEvents;      // Per buffer
+    // Only used to release the buffer when its thread exits:
+    boost::thread_specific_ptr<FgProfileBuffer> owners;
+
+    Registry() : maxEvents(size_t(1) << 20), owners(releaseBuffer) {}
+};
+
+Registry &
+registry()
+{
+    static Registry *   reg = new Registry;
+    return *reg;
+}
+
+void
+releaseBuffer(FgProfileBuffer * buf)
+{
+    Registry &          reg = registry();
+    boost::mutex::scoped_lock   lock(reg.mtx);
+    reg.freeBuffers.push_back(buf);
+}
+
+}
+
+// Plain pointer caching the above 'owners' so the compiler's native thread local storage can
+// be used (much faster than boost::thread_specific_ptr):
+#ifdef _MSC_VER
+static __declspec(thread) FgProfileBuffer *     tlsBuffer = NULL;
+#else
+static __thread FgProfileBuffer *               tlsBuffer = NULL;
+#endif
+
+static
+FgProfileBuffer *
+threadBuffer()
+{
+    if (tlsBuffer == NULL) {
+        Registry &          reg = registry();
+        {
+            boost::mutex::scoped_lock   lock(reg.mtx);
+            if (reg.freeBuffers.empty()) {
+                tlsBuffer = new FgProfileBuffer(uint(reg.buffers.size()));
+                reg.buffers.push_back(tlsBuffer);
+            }
+            else {
+                tlsBuffer = reg.freeBuffers.back();
+                reg.freeBuffers.pop_back();
+            }
+        }
+        reg.owners.reset(tlsBuffer);
+    }
+    return tlsBuffer;
+}
+
+static
+const char *
+internName(const string & name)
+{
+    Registry &          reg = registry();
+    boost::mutex::scoped_lock   lock(reg.mtx);
+    return reg.names.insert(name).first->c_str();
+}
+
+void
+FgProfileScope::begin(const char * name)
+{
+    m_buffer = threadBuffer();
+    if (m_buffer->events.size() >= registry().maxEvents) {
+        ++m_buffer->dropped;
+        m_buffer = NULL;
+        return;
+    }
+    m_idx = m_buffer->events.size();
+    Event           ev;
+    ev.name = name;
+    ev.depth = m_buffer->depth++;
+    ev.endNs = 0;
+    ev.beginNs = fgTimeNs();
+    m_buffer->events.push_back(ev);
+}
+
+FgProfileScope::FgProfileScope(const char * name)
+{begin(name); }
+
+FgProfileScope::FgProfileScope(const string & name)
+{begin(internName(name)); }
+
+FgProfileScope::~FgProfileScope()
+{
+    if (m_buffer == NULL)
+        return;
+    m_buffer->events[m_idx].endNs = fgTimeNs();
+    --m_buffer->depth;
+}
+
+// Calls 'func' with the path of each completed event:
+static
+void
+forEachEvent(const boost::function<void(const FgProfileBuffer &,const Event &,const string &)> & func)
+{
+    Registry &          reg = registry();
+    boost::mutex::scoped_lock   lock(reg.mtx);
+    for (size_t bb=0; bb<reg.buffers.size(); ++bb) {
+        const FgProfileBuffer & buf = *reg.buffers[bb];
+        vector<string>      paths;      // Current path at each depth
+        for (size_t ee=0; ee<buf.events.size(); ++ee) {
+            const Event &       ev = buf.events[ee];
+            paths.resize(ev.depth);
+            paths.push_back((ev.depth == 0) ? string(ev.name) : paths.back() + "/" + ev.name);
+            if (ev.endNs != 0)
+                func(buf,ev,paths.back());
+        }
+    }
+}
+
+typedef std::map<string,vector<uint64> >    PathDurations;
+
+static
+void
+collectDuration(PathDurations * pds,const FgProfileBuffer &,const Event & ev,const string & path)
+{(*pds)[path].push_back(ev.endNs - ev.beginNs); }
+
+vector<FgProfileStat>
+fgProfileStats()
+{
+    PathDurations       pds;
+    forEachEvent(boost::bind(collectDuration,&pds,_1,_2,_3));
+    vector<FgProfileStat>   ret;
+    for (PathDurations::iterator it=pds.begin(); it!=pds.end(); ++it) {
+        vector<uint64> &    durs = it->second;
+        std::sort(durs.begin(),durs.end());
+        FgProfileStat       st;
+        st.path = it->first;
+        st.depth = uint(std::count(st.path.begin(),st.path.end(),'/'));
+        st.count = durs.size();
+        st.total = 0;
+        for (size_t ii=0; ii<durs.size(); ++ii)
+            st.total += durs[ii];
+        st.min = durs.front();
+        st.max = durs.back();
+        // Nearest rank:
+        st.p50 = durs[(durs.size()-1) * 50 / 100];
+        st.p90 = durs[(durs.size()-1) * 90 / 100];
+        st.p99 = durs[(durs.size()-1) * 99 / 100];
+        ret.push_back(st);
+    }
+    return ret;
+}
+
+static
+string
+toUs(uint64 ns)
+{return fgToFixed(double(ns) * 1.0e-3,1); }
+
+string
+fgProfileReport()
+{
+    vector<FgProfileStat>   stats = fgProfileStats();
+    ostringstream       oss;
+    oss << "Scope" << string(35,' ') << "     count    total ms     mean us      min us      p50 us"
+        "      p90 us      p99 us      max us\n";
+    for (size_t ii=0; ii<stats.size(); ++ii) {
+        const FgProfileStat &   st = stats[ii];
+        string              name = string(st.depth*2,' ') + st.path.substr(st.path.rfind('/')+1);
+        oss << std::left << setw(40) << name << std::right
+            << setw(10) << st.count
+            << setw(12) << fgToFixed(double(st.total) * 1.0e-6,3)
+            << setw(12) << toUs(st.total / st.count)
+            << setw(12) << toUs(st.min)
+            << setw(12) << toUs(st.p50)
+            << setw(12) << toUs(st.p90)
+            << setw(12) << toUs(st.p99)
+            << setw(12) << toUs(st.max) << "\n";
+    }
+    uint64              dropped = fgProfileDropped();
+    if (dropped > 0)
+        oss << dropped << " scopes not recorded (per-thread limit of " << registry().maxEvents
+            << " reached)\n";
+    return oss.str();
+}
+
+static
+void
+minBegin(uint64 * ret,const FgProfileBuffer &,const Event & ev,const string &)
+{*ret = std::min(*ret,ev.beginNs); }
+
+static
+string
+jsonEscape(const char * str)
+{
+    string          ret;
+    for (const char * ch=str; *ch!=0; ++ch) {
+        if ((*ch == '"') || (*ch == '\\'))
+            ret += '\\';
+        ret += *ch;
+    }
+    return ret;
+}
+
+static
+void
+writeTraceEvent(ostream * os,uint64 origin,bool * first,const FgProfileBuffer & buf,const Event & ev,const string &)
+{
+    if (!*first)
+        *os << ",\n";
+    *first = false;
+    *os << "{\"name\":\"" << jsonEscape(ev.name) << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buf.threadIdx
+        << ",\"ts\":" << fgToFixed(double(ev.beginNs-origin) * 1.0e-3,3)
+        << ",\"dur\":" << fgToFixed(double(ev.endNs-ev.beginNs) * 1.0e-3,3) << "}";
+}
+
+void
+fgProfileSaveChromeTrace(const FgString & fname)
+{
+    uint64              origin = numeric_limits<uint64>::max();
+    forEachEvent(boost::bind(minBegin,&origin,_1,_2,_3));
+    FgOfstream          ofs(fname);
+    bool                first = true;
+    ofs << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+    forEachEvent(boost::bind(writeTraceEvent,&ofs,origin,&first,_1,_2,_3));
+    ofs << "\n]}\n";
+}
+
+void
+fgProfileClear()
+{
+    Registry &          reg = registry();
+    boost::mutex::scoped_lock   lock(reg.mtx);
+    for (size_t bb=0; bb<reg.buffers.size(); ++bb) {
+        reg.buffers[bb]->events.clear();
+        reg.buffers[bb]->dropped = 0;
+    }
+}
+
+void
+fgProfileSetMaxEvents(size_t maxEvents)
+{
+    Registry &          reg = registry();
+    boost::mutex::scoped_lock   lock(reg.mtx);
+    reg.maxEvents = maxEvents;
+}
+
+uint64
+fgProfileDropped()
+{
+    Registry &          reg = registry();
+    boost::mutex::scoped_lock   lock(reg.mtx);
+    uint64              ret = 0;
+    for (size_t bb=0; bb<reg.buffers.size(); ++bb)
+        ret += reg.buffers[bb]->dropped;
+    return ret;
+}
+
+static
+void
+profiledWork(size_t)
+{
+    FgProfileScope      outer("outer");
+    for (uint ii=0; ii<10; ++ii) {
+        FgProfileScope      inner("inner");
+        {
+            FgProfileScope      leaf("leaf");
+        }
+    }
+}
+
+void
+fgProfileTest(const FgArgs & args)
+{
+    FGTESTDIR
+    fgProfileClear();
+    {
+        FgProfileScope      top("top");
+        fgParallelFor(8,profiledWork,4);
+    }
+    // 'top' is only in the calling thread so the work from other threads is at the root:
+    vector<FgProfileStat>   stats = fgProfileStats();
+    uint64              numOuter = 0,
+                        numInner = 0,
+                        numLeaf = 0,
+                        numTop = 0;
+    for (size_t ii=0; ii<stats.size(); ++ii) {
+        const FgProfileStat &   st = stats[ii];
+        FGASSERT(st.min <= st.p50);
+        FGASSERT(st.p50 <= st.p90);
+        FGASSERT(st.p90 <= st.p99);
+        FGASSERT(st.p99 <= st.max);
+        FGASSERT(st.total >= st.max);
+        string              name = st.path.substr(st.path.rfind('/')+1);
+        if (name == "top") {
+            FGASSERT(st.depth == 0);
+            numTop += st.count;
+        }
+        else if (name == "outer")
+            numOuter += st.count;
+        else if (name == "inner") {
+            FGASSERT(fgEndsWith(st.path,"outer/inner"));
+            numInner += st.count;
+        }
+        else if (name == "leaf") {
+            FGASSERT(fgEndsWith(st.path,"outer/inner/leaf"));
+            numLeaf += st.count;
+        }
+    }
+    FGASSERT(numTop == 1);
+    FGASSERT(numOuter == 8);
+    FGASSERT(numInner == 80);
+    FGASSERT(numLeaf == 80);
+    fgout << fgnl << fgProfileReport();
+    fgProfileSaveChromeTrace("trace.json");
+    string              trace = fgSlurp("trace.json");
+    size_t              numEvents = 0;
+    for (size_t pos=trace.find("\"ph\":\"X\""); pos!=string::npos; pos=trace.find("\"ph\":\"X\"",pos+1))
+        ++numEvents;
+    FGASSERT(numEvents == 1+8+80+80);
+    // Buffers of exited threads are reused:
+    size_t              numBuffers = registry().buffers.size();
+    for (uint ii=0; ii<8; ++ii) {
+        boost::thread       thread(profiledWork,ii);
+        thread.join();
+    }
+    FGASSERT(registry().buffers.size() <= numBuffers+1);
+    // Per-thread limit:
+    fgProfileClear();
+    fgProfileSetMaxEvents(5);
+    profiledWork(0);
+    FGASSERT(fgProfileDropped() == 1+10+10-5);
+    fgProfileSetMaxEvents(size_t(1) << 20);
+    // Scopes named at runtime, including via FgTimeScope when instrumentation is enabled:
+    fgProfileClear();
+    {
+        FgProfileScope      named(string("runtime")+"Name");
+        FgTimeScope         timed("timeScope");
+    }
+    stats = fgProfileStats();
+    FGASSERT(stats[0].path == "runtimeName");
+#ifdef FG_PROFILE
+    FGASSERT(stats.size() == 2);
+    FGASSERT(stats[1].path == "runtimeName/timeScope");
+#else
+    FGASSERT(stats.size() == 1);
+#endif
+    // Overhead:
+    fgProfileClear();
+    const uint          num = 100000;
+    FgTimer             timer;
+    for (uint ii=0; ii<num; ++ii)
+        FgProfileScope      scope("overhead");
+    double              ns = double(timer.readNs()) / num;
+    fgout << fgnl << "Overhead per scope: " << ns << "ns";
+    fgProfileClear();
+}
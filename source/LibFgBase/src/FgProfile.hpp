@@ -0,0 +1,98 @@
+//
+// Copyright (c) 2015 Singular Inversions Inc. (facegen.com)
+// Use, modification and distribution is subject to the MIT License,
+// see accompanying file LICENSE.txt or facegen.com/base_library_license.txt
+//
+// Hierarchical scoped profiler with nanosecond timing.
+//
+// Each thread records its scope begin/end times into its own buffer so recording takes no locks
+// (except once per thread to register the buffer). The buffers of exited threads are reused by
+// new threads. Results are aggregated across threads by scope path (the names of the enclosing
+// scopes) or exported as a Chrome trace (chrome://tracing or https://ui.perfetto.dev) showing
+// each thread's timeline.
+//
+// Instrumentation with FG_PROFILE_SCOPE is compiled out unless FG_PROFILE is defined.
+// FgProfileScope can always be used explicitly.
+//
+// Results must only be read or cleared when no profiled scopes are active in any thread.
+//
+
+#ifndef FGPROFILE_HPP
+#define FGPROFILE_HPP
+
+#include "FgStdLibs.hpp"
+#include "FgTypes.hpp"
+#include "FgString.hpp"
+#include "FgNonCopyable.hpp"
+
+struct  FgProfileBuffer;
+
+struct  FgProfileScope : FgNonCopyable
+{
+    // 'name' must have static lifetime (eg. a string literal):
+    explicit
+    FgProfileScope(const char * name);
+
+    // For names built at runtime. Slower as the name is copied once into a global table:
+    explicit
+    FgProfileScope(const std::string & name);
+
+    ~FgProfileScope();
+
+private:
+    FgProfileBuffer *   m_buffer;       // NULL if not recorded
+    size_t              m_idx;
+
+    void
+    begin(const char * name);
+};
+
+#define FG_PROFILE_CAT2(a,b) a##b
+#define FG_PROFILE_CAT(a,b) FG_PROFILE_CAT2(a,b)
+
+#ifdef FG_PROFILE
+#define FG_PROFILE_SCOPE(name) FgProfileScope FG_PROFILE_CAT(fgProfileScope,__LINE__)(name)
+#else
+#define FG_PROFILE_SCOPE(name)
+#endif
+
+struct  FgProfileStat
+{
+    std::string     path;           // Scope names from outermost separated by '/'
+    uint            depth;          // Number of enclosing scopes
+    uint64          count;
+    // Nanoseconds:
+    uint64          total;
+    uint64          min;
+    uint64          max;
+    uint64          p50;
+    uint64          p90;
+    uint64          p99;
+};
+
+// Aggregated over all threads and sorted by path (so children follow their parent):
+std::vector<FgProfileStat>
+fgProfileStats();
+
+// Formatted table of the above:
+std::string
+fgProfileReport();
+
+// Every recorded scope as a complete event in the Chrome trace event JSON format:
+void
+fgProfileSaveChromeTrace(const FgString & fname);
+
+// Discards all recorded scopes:
+void
+fgProfileClear();
+
+// Each thread records at most this many scopes (default 2^20) between calls to 'fgProfileClear',
+// further scopes are only counted:
+void
+fgProfileSetMaxEvents(size_t maxEvents);
+
+// Number of scopes not recorded due to the above limit:
+uint64
+fgProfileDropped();
+
+#endif
@@ -6,7 +6,7 @@
 // Authors:     Andrew Beatty
 // Created:     Jan 27, 2009
 //
-// Not currently threadsafe.
+// The global generator is not threadsafe. 'FgRandGen' is for concurrent use.
 
 #include "stdafx.h"
 
@@ -21,6 +21,8 @@
 #include "FgMath.hpp"
 #include "FgNormal.hpp"
 #include "FgAffine1.hpp"
+#include "FgThread.hpp"
+#include "FgTime.hpp"
 #include "FgMain.hpp"
 
 using namespace std;
@@ -113,6 +115,181 @@ fgRandString(uint numChars)
     return ret;
 }
 
+const double FgRandGen::s_ulp53 = 1.0 / double(1ULL << 53);
+
+FgRandGen::FgRandGen(uint64 seed,uint64 stream)
+    : m_key(mix(mix(seed + s_gamma) ^ (stream * 0xD1B54A32D192ED03ULL))), m_counter(0)
+{}
+
+uint
+FgRandGen::uint_(uint size)
+{
+    FGASSERT(size > 0);
+    // Reject the partial range at the top to avoid bias:
+    uint32  lim = numeric_limits<uint32>::max(),
+            max = lim - (lim % size + 1) % size,
+            ret;
+    while ((ret = uint32_()) > max) {}
+    return ret % size;
+}
+
+// Box-Muller transform of a pair of 64-bit values into two independent unit normals. The first
+// uniform is in (0,1] to avoid log(0):
+static inline
+void
+boxMuller(uint64 v0,uint64 v1,double & n0,double & n1)
+{
+    const double    ulp = 1.0 / double(1ULL << 53);
+    double          u0 = double((v0 >> 11) + 1) * ulp,
+                    u1 = double(v1 >> 11) * ulp,
+                    rad = sqrt(-2.0 * log(u0)),
+                    ang = 2.0 * fgPi() * u1;
+    n0 = rad * cos(ang);
+    n1 = rad * sin(ang);
+}
+
+double
+FgRandGen::normal(double mean,double stdev)
+{
+    uint64      v0 = uint64_(),
+                v1 = uint64_();
+    double      n0,n1;
+    boxMuller(v0,v1,n0,n1);
+    return n0 * stdev + mean;
+}
+
+// The loops below have no dependency between iterations so the compiler can vectorise them:
+void
+FgRandGen::fillUniform(double * dst,size_t num,double lo,double hi)
+{
+    double      scale = (hi - lo) * s_ulp53;
+    uint64      base = m_key + s_gamma * m_counter;
+    for (size_t ii=0; ii<num; ++ii)
+        dst[ii] = double(mix(base + s_gamma * (ii+1)) >> 11) * scale + lo;
+    m_counter += num;
+}
+
+void
+FgRandGen::fillNormal(double * dst,size_t num,double mean,double stdev)
+{
+    uint64      base = m_key + s_gamma * m_counter;
+    size_t      numPairs = num / 2;
+    for (size_t ii=0; ii<numPairs; ++ii) {
+        double      n0,n1;
+        boxMuller(mix(base + s_gamma * (2*ii+1)),mix(base + s_gamma * (2*ii+2)),n0,n1);
+        dst[2*ii] = n0 * stdev + mean;
+        dst[2*ii+1] = n1 * stdev + mean;
+    }
+    if (num % 2 == 1) {
+        double      n0,n1;
+        boxMuller(mix(base + s_gamma * (2*numPairs+1)),mix(base + s_gamma * (2*numPairs+2)),n0,n1);
+        dst[num-1] = n0 * stdev + mean;
+    }
+    m_counter += 2 * ((num + 1) / 2);
+}
+
+// Block size must be even so the normal pairs do not depend on the block partition:
+static const size_t randBlockSize = 1 << 16;
+
+static
+void
+uniformsBlock(FgRandGen gen,double * dst,size_t num,double lo,double hi,size_t block)
+{
+    size_t      beg = block * randBlockSize,
+                end = std::min(beg + randBlockSize,num);
+    gen.skip(beg);
+    gen.fillUniform(dst+beg,end-beg,lo,hi);
+}
+
+FgDbls
+fgRandUniforms(FgRandGen & gen,size_t num,double lo,double hi,uint numThreads)
+{
+    FgDbls      ret(num);
+    if (num > 0)
+        fgParallelFor((num+randBlockSize-1)/randBlockSize,
+            boost::bind(uniformsBlock,gen,&ret[0],num,lo,hi,_1),numThreads);
+    gen.skip(num);
+    return ret;
+}
+
+static
+void
+normalsBlock(FgRandGen gen,double * dst,size_t num,double mean,double stdev,size_t block)
+{
+    size_t      beg = block * randBlockSize,
+                end = std::min(beg + randBlockSize,num);
+    gen.skip(beg);
+    gen.fillNormal(dst+beg,end-beg,mean,stdev);
+}
+
+FgDbls
+fgRandNormals(FgRandGen & gen,size_t num,double mean,double stdev,uint numThreads)
+{
+    FgDbls      ret(num);
+    if (num > 0)
+        fgParallelFor((num+randBlockSize-1)/randBlockSize,
+            boost::bind(normalsBlock,gen,&ret[0],num,mean,stdev,_1),numThreads);
+    gen.skip(2 * ((num + 1) / 2));
+    return ret;
+}
+
+void
+fgRandGenTest(const FgArgs &)
+{
+    // Bulk fills must be independent of the number of threads and the same as the serial fills.
+    // The latter only up to rounding for normals as vectorised and scalar transcendental
+    // functions can differ in the last place:
+    size_t          num = 3 * randBlockSize + 7;
+    FgRandGen       gen0(7),
+                    gen1(7),
+                    gen4(7);
+    FgDbls          ref(num);
+    gen0.fillNormal(&ref[0],num);
+    FgTimer         timer;
+    FgDbls          norms1 = fgRandNormals(gen1,num,0.0,1.0,1);
+    double          time1 = timer.read();
+    timer.start();
+    FgDbls          norms4 = fgRandNormals(gen4,num,0.0,1.0,4);
+    double          time4 = timer.read();
+    FGASSERT(norms1 == norms4);
+    for (size_t ii=0; ii<num; ++ii)
+        FGASSERT(std::abs(norms1[ii]-ref[ii]) < 1.0e-12);
+    uint64          next = gen0.uint64_();
+    FGASSERT(gen1.uint64_() == next);
+    FGASSERT(gen4.uint64_() == next);
+    gen0.fillUniform(&ref[0],num,-1.0,2.0);
+    FGASSERT(fgRandUniforms(gen1,num,-1.0,2.0,1) == ref);
+    FGASSERT(fgRandUniforms(gen4,num,-1.0,2.0,4) == ref);
+    // Skip must match generation:
+    FgRandGen       genA(3,5),
+                    genB(3,5);
+    for (uint ii=0; ii<1000; ++ii)
+        genA.uint64_();
+    genB.skip(1000);
+    FGASSERT(genA.uint64_() == genB.uint64_());
+    // Different streams and seeds differ:
+    FGASSERT(FgRandGen(3,5).uint64_() != FgRandGen(3,6).uint64_());
+    FGASSERT(FgRandGen(3,5).uint64_() != FgRandGen(4,5).uint64_());
+    // Moments:
+    double          mean = fgMean(norms4),
+                    var = 0.0;
+    for (size_t ii=0; ii<norms4.size(); ++ii)
+        var += fgSqr(norms4[ii]-mean);
+    var /= double(norms4.size());
+    FGASSERT(std::abs(mean) < 0.01);
+    FGASSERT(std::abs(var-1.0) < 0.01);
+    FGASSERT((fgMin(ref) >= -1.0) && (fgMax(ref) < 2.0));
+    FGASSERT(std::abs(fgMean(ref)-0.5) < 0.01);
+    for (uint ii=0; ii<1000; ++ii)
+        FGASSERT(gen0.uint_(7) < 7);
+    timer.start();
+    for (size_t ii=0; ii<num; ++ii)
+        ref[ii] = fgRandNormal();
+    double          timeGlobal = timer.read();
+    fgout << fgnl << num << " normals: global " << timeGlobal << "s, bulk " << time1
+        << "s, bulk on 4 threads " << time4 << "s";
+}
+
 void
 fgRandomTest(const FgArgs &)
 {
@@ -13,6 +13,9 @@
 #include "FgStdLibs.hpp"
 #include "FgTypes.hpp"
 
+// The global generator used by the free functions below is not threadsafe. For concurrent use
+// give each thread its own 'FgRandGen'.
+
 void
 fgRandSeedRepeatable(uint seed=42);
 
@@ -38,6 +41,7 @@ fgRandUniform(double lo,double hi)
 double
 fgRandNormal(double mean=0.0,double stdev=1.0);
 
+// Drawn one at a time from the global generator. See below for a concurrent bulk fill:
 std::vector<double>
 fgRandNormals(size_t num,double mean=0.0,double stdev=1.0);
 
@@ -49,4 +53,78 @@ fgRandExp()
 std::string
 fgRandString(uint numChars);
 
+// Counter-based generator: the n-th 64-bit value is a fixed mixing function of (key,n) where the
+// key is a hash of the seed and stream number. So separate streams (eg. one per thread or per
+// work item) are independent, any position can be reached in constant time by 'skip', and bulk
+// fills have no dependency between values and so can be split across threads and vectorised.
+// Not the same sequence as the global generator.
+struct  FgRandGen
+{
+    explicit
+    FgRandGen(uint64 seed=42,uint64 stream=0);
+
+    uint64
+    uint64_()
+    {return mix(m_key + s_gamma * (++m_counter)); }
+
+    uint32
+    uint32_()
+    {return uint32(uint64_() >> 32); }
+
+    // Uniform in [0,size):
+    uint
+    uint_(uint size);
+
+    // Uniform in [0,1):
+    double
+    uniform()
+    {return double(uint64_() >> 11) * s_ulp53; }
+
+    double
+    uniform(double lo,double hi)
+    {return uniform() * (hi-lo) + lo; }
+
+    // Always consumes two values (Box-Muller):
+    double
+    normal(double mean=0.0,double stdev=1.0);
+
+    // Advance as if 'num' values had been generated:
+    void
+    skip(uint64 num)
+    {m_counter += num; }
+
+    // Consumes 'num' values:
+    void
+    fillUniform(double * dst,size_t num,double lo=0.0,double hi=1.0);
+
+    // Consumes 2*ceil(num/2) values (both Box-Muller outputs are used):
+    void
+    fillNormal(double * dst,size_t num,double mean=0.0,double stdev=1.0);
+
+private:
+    uint64              m_key;
+    uint64              m_counter;
+
+    static const uint64 s_gamma = 0x9E3779B97F4A7C15ULL;
+    static const double s_ulp53;
+
+    // SplitMix64 finalizer (bijective):
+    static
+    uint64
+    mix(uint64 z)
+    {
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+};
+
+// Bulk fills computed concurrently in fixed blocks so results depend only on the generator state
+// and not on 'numThreads'. The generator is advanced as for the serial fill:
+std::vector<double>
+fgRandUniforms(FgRandGen & gen,size_t num,double lo=0.0,double hi=1.0,uint numThreads=0);
+
+std::vector<double>
+fgRandNormals(FgRandGen & gen,size_t num,double mean=0.0,double stdev=1.0,uint numThreads=0);
+
 #endif
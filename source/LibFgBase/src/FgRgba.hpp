@@ -139,6 +139,12 @@ struct      FgRgba
     }
 };
 
+template<typename T>
+struct  FgSerialBits<FgRgba<T> >
+{
+    static const bool value = FgSerialBits<T>::value;
+};
+
 template<typename T>
 FgRgba<T> operator*(FgRgba<T> lhs, T rhs)
 {
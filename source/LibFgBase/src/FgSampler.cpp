@@ -33,15 +33,14 @@ valsDiffer(
         (fgMaxElem(fgAbs(corners[3].m_c - centre.m_c)) > maxDiff));
 }
 
-static uint64 rayCount;
-
 static
 FgRgbaF
 sampleRecurse(
     FgFuncSample            sample,
     FgMat22F                bounds,
     FgMatrixC<FgRgbaF,2,2>  cornerVals,
-    float                   maxDiff)
+    float                   maxDiff,
+    uint64 &                rayCount)
 {
     FgVect2F        lc = bounds.colVec(0),
                     uc = bounds.colVec(1),
@@ -72,7 +71,8 @@ sampleRecurse(
                     sample,
                     fgConcatHoriz(lc2,lc2+del),
                     vals.subMatrix<2,2>(coord[1],coord[0]), // Matrices are (row,col) not (x,y)
-                    maxDiff*2.0f);
+                    maxDiff*2.0f,
+                    rayCount);
         }
         ret = acc * 0.25f;
     }
@@ -90,7 +90,8 @@ fgSamplerF(
     FgImgRgbaF          img(dims);
     FGASSERT(dims.volume() > 0);
     FGASSERT((antiAliasBitDepth > 0) && (antiAliasBitDepth <= 16));
-    rayCount = (img.width()+1) * (img.height()+1);
+    // Per call rather than global since views can be sampled concurrently:
+    uint64              rayCount = (img.width()+1) * (img.height()+1);
     float               widf = float(img.width()),
                         hgtf = float(img.height());
     FgImgRgbaF          sampleLines(img.width()+1,2);
@@ -117,7 +118,8 @@ fgSamplerF(
                         sampleLines.xy(col+1,fbit),
                         sampleLines.xy(col,sbit),
                         sampleLines.xy(col+1,sbit)),
-                    float(1 << (9-antiAliasBitDepth)));
+                    float(1 << (9-antiAliasBitDepth)),
+                    rayCount);
         }
     }
     //fgout << "Raycast count: " << rayCount;
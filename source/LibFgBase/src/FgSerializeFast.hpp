@@ -0,0 +1,347 @@
+//
+// Copyright (c) 2015 Singular Inversions Inc. (facegen.com)
+// Use, modification and distribution is subject to the MIT License,
+// see accompanying file LICENSE.txt or facegen.com/base_library_license.txt
+//
+// Header-only binary serialization driven by the same FG_SERIALIZEn member lists (or any
+// boost-style 'serialize' member template) as the boost archives in FgSerialize.hpp, but much
+// faster, especially for small messages:
+//
+// * No archive objects, streams or virtual dispatch. Output is appended to a reusable growable
+//   buffer and input is read directly from a borrowed buffer.
+// * Contiguous plain data (arithmetic and enum types, and FgMatrixC / FgRgba of them) in C arrays
+//   and std::vector is copied in bulk.
+// * The data begins with a format version which is checked when reading.
+//
+// The format is native endian, does not store class versions ('serialize' is passed 0) and is
+// not compatible with the boost archives. Reading requires the identical structure.
+//
+
+#ifndef FGSERIALIZEFAST_HPP
+#define FGSERIALIZEFAST_HPP
+
+#include "FgSerialize.hpp"
+#include "FgException.hpp"
+#include "FgStdString.hpp"
+
+#include <boost/type_traits/is_arithmetic.hpp>
+#include <boost/type_traits/is_enum.hpp>
+#include <boost/type_traits/integral_constant.hpp>
+
+// Specialize to true for types whose serialization is exactly their in-memory bytes:
+template<class T>
+struct  FgSerialBits
+{
+    static const bool value = boost::is_arithmetic<T>::value || boost::is_enum<T>::value;
+};
+
+const unsigned char fgSerialFastVersion = 1;
+
+struct  FgSerialWriter
+{
+    std::string &       buf;
+
+    explicit
+    FgSerialWriter(std::string & b) : buf(b) {}
+
+    void
+    write(const void * data,size_t size)
+    {buf.append(static_cast<const char *>(data),size); }
+
+    void
+    writeSize(size_t size)
+    {
+        uint64          sz = size;
+        write(&sz,sizeof(sz));
+    }
+
+    template<class T>
+    FgSerialWriter &
+    operator&(const boost::serialization::nvp<T> & nvp);
+
+private:
+    FgSerialWriter & operator=(const FgSerialWriter &);
+};
+
+struct  FgSerialReader
+{
+    const char *        ptr;
+    const char *        end;
+
+    FgSerialReader(const char * data,size_t size) : ptr(data), end(data+size) {}
+
+    void
+    read(void * data,size_t size)
+    {
+        if (size_t(end-ptr) < size)
+            fgThrow("fgDeserializeFast data truncated");
+        if (size > 0)
+            std::memcpy(data,ptr,size);
+        ptr += size;
+    }
+
+    // Each element is at least 'minElemSize' bytes, which guards against allocating for
+    // corrupt sizes:
+    size_t
+    readSize(size_t minElemSize)
+    {
+        uint64          sz;
+        read(&sz,sizeof(sz));
+        if (sz > uint64(end-ptr) / std::max(minElemSize,size_t(1)))
+            fgThrow("fgDeserializeFast invalid container size",fgToString(sz));
+        return size_t(sz);
+    }
+
+    template<class T>
+    FgSerialReader &
+    operator&(const boost::serialization::nvp<T> & nvp);
+};
+
+// Write overloads:
+
+template<class T>
+void
+fgSerialWriteVal(FgSerialWriter & sw,const T & val,boost::true_type)
+{sw.write(&val,sizeof(T)); }
+
+template<class T>
+void
+fgSerialWriteVal(FgSerialWriter & sw,const T & val,boost::false_type)
+{const_cast<T &>(val).serialize(sw,0); }
+
+template<class T>
+void
+fgSerialWrite(FgSerialWriter & sw,const T & val)
+{fgSerialWriteVal(sw,val,boost::integral_constant<bool,FgSerialBits<T>::value>()); }
+
+template<class T>
+void
+fgSerialWriteArray(FgSerialWriter & sw,const T * ptr,size_t num,boost::true_type)
+{sw.write(ptr,num*sizeof(T)); }
+
+template<class T>
+void
+fgSerialWriteArray(FgSerialWriter & sw,const T * ptr,size_t num,boost::false_type)
+{
+    for (size_t ii=0; ii<num; ++ii)
+        fgSerialWrite(sw,ptr[ii]);
+}
+
+template<class T,size_t N>
+void
+fgSerialWrite(FgSerialWriter & sw,const T (&arr)[N])
+{fgSerialWriteArray(sw,arr,N,boost::integral_constant<bool,FgSerialBits<T>::value>()); }
+
+inline
+void
+fgSerialWrite(FgSerialWriter & sw,const std::string & str)
+{
+    sw.writeSize(str.size());
+    sw.write(str.data(),str.size());
+}
+
+template<class T>
+void
+fgSerialWrite(FgSerialWriter & sw,const std::vector<T> & vec)
+{
+    sw.writeSize(vec.size());
+    if (!vec.empty())
+        fgSerialWriteArray(sw,&vec[0],vec.size(),boost::integral_constant<bool,FgSerialBits<T>::value>());
+}
+
+inline
+void
+fgSerialWrite(FgSerialWriter & sw,const std::vector<bool> & vec)
+{
+    sw.writeSize(vec.size());
+    for (size_t ii=0; ii<vec.size(); ++ii) {
+        bool            val = vec[ii];
+        sw.write(&val,sizeof(val));
+    }
+}
+
+template<class T,class U>
+void
+fgSerialWrite(FgSerialWriter & sw,const std::pair<T,U> & pr)
+{
+    fgSerialWrite(sw,pr.first);
+    fgSerialWrite(sw,pr.second);
+}
+
+template<class K,class V>
+void
+fgSerialWrite(FgSerialWriter & sw,const std::map<K,V> & map)
+{
+    sw.writeSize(map.size());
+    for (typename std::map<K,V>::const_iterator it=map.begin(); it!=map.end(); ++it) {
+        fgSerialWrite(sw,it->first);
+        fgSerialWrite(sw,it->second);
+    }
+}
+
+template<class T>
+void
+fgSerialWrite(FgSerialWriter & sw,const std::set<T> & set)
+{
+    sw.writeSize(set.size());
+    for (typename std::set<T>::const_iterator it=set.begin(); it!=set.end(); ++it)
+        fgSerialWrite(sw,*it);
+}
+
+template<class T>
+FgSerialWriter &
+FgSerialWriter::operator&(const boost::serialization::nvp<T> & nvp)
+{
+    fgSerialWrite(*this,nvp.const_value());
+    return *this;
+}
+
+// Read overloads:
+
+template<class T>
+void
+fgSerialReadVal(FgSerialReader & sr,T & val,boost::true_type)
+{sr.read(&val,sizeof(T)); }
+
+template<class T>
+void
+fgSerialReadVal(FgSerialReader & sr,T & val,boost::false_type)
+{val.serialize(sr,0); }
+
+template<class T>
+void
+fgSerialRead(FgSerialReader & sr,T & val)
+{fgSerialReadVal(sr,val,boost::integral_constant<bool,FgSerialBits<T>::value>()); }
+
+template<class T>
+void
+fgSerialReadArray(FgSerialReader & sr,T * ptr,size_t num,boost::true_type)
+{sr.read(ptr,num*sizeof(T)); }
+
+template<class T>
+void
+fgSerialReadArray(FgSerialReader & sr,T * ptr,size_t num,boost::false_type)
+{
+    for (size_t ii=0; ii<num; ++ii)
+        fgSerialRead(sr,ptr[ii]);
+}
+
+template<class T,size_t N>
+void
+fgSerialRead(FgSerialReader & sr,T (&arr)[N])
+{fgSerialReadArray(sr,arr,N,boost::integral_constant<bool,FgSerialBits<T>::value>()); }
+
+inline
+void
+fgSerialRead(FgSerialReader & sr,std::string & str)
+{
+    str.resize(sr.readSize(1));
+    if (!str.empty())
+        sr.read(&str[0],str.size());
+}
+
+template<class T>
+void
+fgSerialRead(FgSerialReader & sr,std::vector<T> & vec)
+{
+    const bool          bits = FgSerialBits<T>::value;
+    vec.resize(sr.readSize(bits ? sizeof(T) : 0));
+    if (!vec.empty())
+        fgSerialReadArray(sr,&vec[0],vec.size(),boost::integral_constant<bool,bits>());
+}
+
+inline
+void
+fgSerialRead(FgSerialReader & sr,std::vector<bool> & vec)
+{
+    vec.resize(sr.readSize(sizeof(bool)));
+    for (size_t ii=0; ii<vec.size(); ++ii) {
+        bool            val;
+        sr.read(&val,sizeof(val));
+        vec[ii] = val;
+    }
+}
+
+template<class T,class U>
+void
+fgSerialRead(FgSerialReader & sr,std::pair<T,U> & pr)
+{
+    fgSerialRead(sr,pr.first);
+    fgSerialRead(sr,pr.second);
+}
+
+template<class K,class V>
+void
+fgSerialRead(FgSerialReader & sr,std::map<K,V> & map)
+{
+    map.clear();
+    size_t              sz = sr.readSize(0);
+    for (size_t ii=0; ii<sz; ++ii) {
+        K               key;
+        fgSerialRead(sr,key);
+        fgSerialRead(sr,map[key]);
+    }
+}
+
+template<class T>
+void
+fgSerialRead(FgSerialReader & sr,std::set<T> & set)
+{
+    set.clear();
+    size_t              sz = sr.readSize(0);
+    for (size_t ii=0; ii<sz; ++ii) {
+        T               val;
+        fgSerialRead(sr,val);
+        set.insert(set.end(),val);
+    }
+}
+
+template<class T>
+FgSerialReader &
+FgSerialReader::operator&(const boost::serialization::nvp<T> & nvp)
+{
+    fgSerialRead(*this,nvp.value());
+    return *this;
+}
+
+// Clears 'buf' (keeping its capacity so it can be reused without allocation) and writes 'val':
+template<class T>
+void
+fgSerializeFast(const T & val,std::string & buf)
+{
+    buf.clear();
+    FgSerialWriter      sw(buf);
+    sw.write(&fgSerialFastVersion,1);
+    fgSerialWrite(sw,val);
+}
+
+template<class T>
+std::string
+fgSerializeFast(const T & val)
+{
+    std::string         ret;
+    fgSerializeFast(val,ret);
+    return ret;
+}
+
+// 'data' is only borrowed for the duration of the call:
+template<class T>
+void
+fgDeserializeFast(const char * data,size_t size,T & val)
+{
+    FgSerialReader      sr(data,size);
+    unsigned char       version;
+    sr.read(&version,1);
+    if (version != fgSerialFastVersion)
+        fgThrow("fgDeserializeFast unsupported format version",fgToString(uint(version)));
+    fgSerialRead(sr,val);
+    if (sr.ptr != sr.end)
+        fgThrow("fgDeserializeFast data has unread bytes",fgToString(sr.end-sr.ptr));
+}
+
+template<class T>
+void
+fgDeserializeFast(const std::string & buf,T & val)
+{fgDeserializeFast(buf.data(),buf.size(),val); }
+
+#endif
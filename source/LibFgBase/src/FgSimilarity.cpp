@@ -60,32 +60,44 @@ fgSimilarityRand()
             fgMatRandNormal<3,1>());
 }
 
+void
+FgSimilarityStats::add(FgVect3D d,FgVect3D r,double w)
+{
+    wgt += w;
+    domSum += d * w;
+    ranSum += r * w;
+    cross += (d * w) * r.transpose();
+    domMag += d.mag() * w;
+    ranMag += r.mag() * w;
+}
+
+FgSimilarityStats &
+FgSimilarityStats::operator+=(const FgSimilarityStats & rhs)
+{
+    wgt += rhs.wgt;
+    domSum += rhs.domSum;
+    ranSum += rhs.ranSum;
+    cross += rhs.cross;
+    domMag += rhs.domMag;
+    ranMag += rhs.ranMag;
+    return *this;
+}
+
 // Uses approach originally from [Horn '87 "Closed-Form Solution of Absolute Orientation..."
 // (taken from [Jain '95 "machine vision" 12.3]) to find an approximate similarity transform
-// between two sets of corresponding points, FROM the domain points TO the range points:
+// FROM the domain points TO the range points:
 FgSimilarity
-fgSimilarityApprox(
-    const vector<FgVect3D> &    domainPts,
-    const vector<FgVect3D> &    rangePts)
+FgSimilarityStats::solve(bool withScale) const
 {
-    FgSimilarity            ret;
-    FGASSERT(domainPts.size() > 2);     // Not solvable with only 2 points.
-    uint                    numPts = uint(domainPts.size());
-    FGASSERT(numPts == rangePts.size());
-    // Compute the sufficient statistics for scale & rotation
-    FgVect3D        domMean = fgMean(domainPts),
-                    ranMean = fgMean(rangePts);
-    double          domRayMag = 0.0,
-                    ranRayMag = 0.0;
-    FgMat33D     S(0.0);
-    for (uint ii=0; ii<numPts; ii++) {
-        FgVect3D    domRay = domainPts[ii] - domMean,
-                    ranRay = rangePts[ii] - ranMean;
-        domRayMag += domRay.mag();
-        ranRayMag += ranRay.mag();
-        S += domRay * ranRay.transpose();
-    }
-    double          scale = sqrt(ranRayMag / domRayMag );
+    FGASSERT(wgt > 0.0);
+    // Centre the statistics on the means:
+    FgVect3D        domMean = domSum / wgt,
+                    ranMean = ranSum / wgt;
+    double          domRayMag = domMag - domMean.mag() * wgt,
+                    ranRayMag = ranMag - ranMean.mag() * wgt;
+    FgMat33D        S = cross - (domMean * wgt) * ranMean.transpose();
+    FGASSERT(domRayMag > 0.0);
+    double          scale = withScale ? sqrt(ranRayMag / domRayMag) : 1.0;
     FgMat44D        N(0.0);
     double  Sxx = S.cr(0,0),   Sxy = S.cr(1,0),   Sxz = S.cr(2,0),
             Syx = S.cr(0,1),   Syy = S.cr(1,1),   Syz = S.cr(2,1),
@@ -106,7 +118,23 @@ fgSimilarityApprox(
     // Calculate the 'trans' term: The transform is given by:
     // X = SR(d-dm)+rm = SR(d)-SR(dm)+rm
     FgVect3D        trans = -scale * (pose.asMatrix() * domMean) + ranMean;
-    ret = FgSimilarity(scale,pose,trans);
+    return FgSimilarity(scale,pose,trans);
+}
+
+FgSimilarity
+fgSimilarityApprox(
+    const vector<FgVect3D> &    domainPts,
+    const vector<FgVect3D> &    rangePts)
+{
+    FGASSERT(domainPts.size() > 2);     // Not solvable with only 2 points.
+    FGASSERT(domainPts.size() == rangePts.size());
+    // Accumulate relative to the domain and range means for precision:
+    FgVect3D            domMean = fgMean(domainPts),
+                        ranMean = fgMean(rangePts);
+    FgSimilarityStats   stats;
+    for (size_t ii=0; ii<domainPts.size(); ii++)
+        stats.add(domainPts[ii]-domMean,rangePts[ii]-ranMean);
+    FgSimilarity        ret = FgSimilarity(ranMean) * stats.solve() * FgSimilarity(-domMean);
     // Measure residual:
     double  resid = fgRms(rangePts-fgTransform(domainPts,ret.asAffine())) / fgMaxElem(fgDims(rangePts));
     fgout << fgnl << "SimilarityApprox() relative RMS residual: " << resid;
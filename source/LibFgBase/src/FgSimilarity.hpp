@@ -89,6 +89,31 @@ operator<<(std::ostream & os,const FgSimilarity & v);
 FgSimilarity
 fgSimilarityRand();
 
+// Weighted sufficient statistics for the similarity transform between corresponding point sets.
+// Partial statistics over subsets can be summed, allowing concurrent accumulation:
+struct  FgSimilarityStats
+{
+    double          wgt;            // Sum of weights
+    FgVect3D        domSum;         // Weighted sums ...
+    FgVect3D        ranSum;
+    FgMat33D        cross;          // Weighted sum of domain * range^T
+    double          domMag;         // Weighted sum of squared magnitudes
+    double          ranMag;
+
+    FgSimilarityStats() : wgt(0.0), domSum(0.0), ranSum(0.0), cross(0.0), domMag(0.0), ranMag(0.0) {}
+
+    void
+    add(FgVect3D domainPt,FgVect3D rangePt,double weight=1.0);
+
+    FgSimilarityStats &
+    operator+=(const FgSimilarityStats & rhs);
+
+    // Requires at least 3 non-collinear points of non-zero weight. If 'withScale' is false the
+    // scale is fixed at 1 (rigid transform):
+    FgSimilarity
+    solve(bool withScale=true) const;
+};
+
 FgSimilarity
 fgSimilarityApprox(
     const std::vector<FgVect3D> &    domainPts,
@@ -10,6 +10,7 @@
 #include "stdafx.h"
 
 #include "FgSoftRender.hpp"
+#include "FgProfile.hpp"
 #include "FgSampler.hpp"
 #include "Fg3dMesh.hpp"
 #include "FgAffineCwC.hpp"
@@ -20,6 +21,7 @@
 #include "Fg3dMeshIo.hpp"
 #include "Fg3dCamera.hpp"
 #include "FgTime.hpp"
+#include "FgThread.hpp"
 
 using namespace std;
 
@@ -57,34 +59,45 @@ shader(
     return FgRgbaF(acc[0],acc[1],acc[2],texSample.alpha());
 }
 
+FgSoftRenderMeshes::FgSoftRenderMeshes(const vector<Fg3dMesh> & meshes) :
+    meshesPtr(&meshes),
+    tris(meshes.size()),
+    norms(meshes.size())
+{
+    FG_PROFILE_SCOPE("FgSoftRenderMeshes");
+    for (size_t ii=0; ii<meshes.size(); ++ii) {
+        const Fg3dMesh &    mesh = meshes[ii];
+        FGASSERT(mesh.surfaces.size() == 1);
+        fgCalcNormals(mesh.surfaces,mesh.verts,norms[ii]);
+        tris[ii] = mesh.surfaces[0].convertToTris();
+    }
+}
+
 FgImgRgbaUb
 fgSoftRender(
     FgVect2UI                   pxSz,
-    const vector<Fg3dMesh> &    meshes,
+    const FgSoftRenderMeshes &  rms,
     const FgLighting &          light,
     FgAffine3D                  modelview,
     FgAffineCw2D                itcsToIucs,
     FgRgbaF                     backgroundColor,
     uint                        antiAliasBitDepth)
 {
-    FgImgRgbaUb             img;
+    FG_PROFILE_SCOPE("fgSoftRender");
+    FGASSERT(rms.meshesPtr != NULL);
+    const vector<Fg3dMesh> &    meshes = *rms.meshesPtr;
     FgVectF2                colorBounds = fgBounds(backgroundColor.m_c);
     FGASSERT((colorBounds[0] >= 0.0f) && (colorBounds[1] <= 255.0f));
-    vector<Fg3dSurface>     surfs(meshes.size());
     vector<FgSurfPtr>       rendSurfs(meshes.size());
-    vector<Fg3dNormals>     norms(meshes.size());
     for (size_t ii=0; ii<meshes.size(); ++ii) {
         const Fg3dMesh &    mesh = meshes[ii];
-        FGASSERT(mesh.surfaces.size() == 1);
-        fgCalcNormals(mesh.surfaces,mesh.verts,norms[ii]);
-        surfs[ii] = mesh.surfaces[0].convertToTris();
         FgSurfPtr   &       rs = rendSurfs[ii];
         rs.material = mesh.material;
         rs.verts = &mesh.verts;
-        rs.vertInds = &surfs[ii].tris.vertInds;
-        rs.norms = &norms[ii];
+        rs.vertInds = &rms.tris[ii].tris.vertInds;
+        rs.norms = &rms.norms[ii];
         rs.uvs = &mesh.uvs;
-        rs.uvInds = &surfs[ii].tris.uvInds;
+        rs.uvInds = &rms.tris[ii].tris.uvInds;
         rs.texImg = (mesh.surfaces[0].albedoMap ? mesh.surfaces[0].albedoMap.get() : NULL);
     }
     Fg3dRayCaster   rc(rendSurfs,
@@ -93,8 +106,73 @@ fgSoftRender(
             fgD2F(itcsToIucs),
             backgroundColor);
     // The 'boost::cref' for the 'rc' arg is critical; otherwise 'rc' gets copied on every call:
-    img = fgSampler(pxSz,boost::bind(&Fg3dRayCaster::cast,boost::cref(rc),_1),antiAliasBitDepth);
-    return img;
+    return fgSampler(pxSz,boost::bind(&Fg3dRayCaster::cast,boost::cref(rc),_1),antiAliasBitDepth);
+}
+
+FgImgRgbaUb
+fgSoftRender(
+    FgVect2UI                   pxSz,
+    const vector<Fg3dMesh> &    meshes,
+    const FgLighting &          light,
+    FgAffine3D                  modelview,
+    FgAffineCw2D                itcsToIucs,
+    FgRgbaF                     backgroundColor,
+    uint                        antiAliasBitDepth)
+{
+    return fgSoftRender(pxSz,FgSoftRenderMeshes(meshes),light,modelview,itcsToIucs,
+        backgroundColor,antiAliasBitDepth);
+}
+
+static
+void
+renderView(
+    FgVect2UI                           pxSz,
+    const FgSoftRenderMeshes &          rms,
+    const vector<FgSoftRenderView> &    views,
+    FgRgbaF                             backgroundColor,
+    uint                                antiAliasBitDepth,
+    const FgFuncRenderSink &            sink,
+    size_t                              idx)
+{
+    const FgSoftRenderView &    view = views[idx];
+    sink(idx,fgSoftRender(pxSz,rms,view.lighting,view.modelview,view.itcsToIucs,
+        backgroundColor,antiAliasBitDepth));
+}
+
+void
+fgSoftRenderBatch(
+    FgVect2UI                           pxSz,
+    const FgSoftRenderMeshes &          rms,
+    const vector<FgSoftRenderView> &    views,
+    FgRgbaF                             backgroundColor,
+    uint                                antiAliasBitDepth,
+    const FgFuncRenderSink &            sink,
+    uint                                numThreads)
+{
+    fgParallelFor(views.size(),
+        boost::bind(renderView,pxSz,boost::cref(rms),boost::cref(views),backgroundColor,
+            antiAliasBitDepth,boost::cref(sink),_1),
+        numThreads);
+}
+
+static
+void
+storeImg(vector<FgImgRgbaUb> & imgs,size_t idx,const FgImgRgbaUb & img)
+{imgs[idx] = img; }     // Each thread writes a different pre-allocated element
+
+vector<FgImgRgbaUb>
+fgSoftRenderBatch(
+    FgVect2UI                           pxSz,
+    const FgSoftRenderMeshes &          rms,
+    const vector<FgSoftRenderView> &    views,
+    FgRgbaF                             backgroundColor,
+    uint                                antiAliasBitDepth,
+    uint                                numThreads)
+{
+    vector<FgImgRgbaUb>     ret(views.size());
+    fgSoftRenderBatch(pxSz,rms,views,backgroundColor,antiAliasBitDepth,
+        boost::bind(storeImg,boost::ref(ret),_1,_2),numThreads);
+    return ret;
 }
 
 // */
@@ -29,6 +29,68 @@ fgSoftRender(
     FgRgbaF                     backgroundColor,        // PRE-WEIGHTED values in range [0,255]
     uint                        antiAliasBitDepth=3);   // in [1,8], higher is slower
 
+// The view-independent part of a render (triangulated surfaces and vertex normals). Compute once
+// to share across many views and threads. Keeps a pointer to 'meshes' which must outlive it:
+struct  FgSoftRenderMeshes
+{
+    const vector<Fg3dMesh> *    meshesPtr;
+    vector<Fg3dSurface>         tris;       // Single tri-only surface for each mesh
+    vector<Fg3dNormals>         norms;
+
+    FgSoftRenderMeshes() : meshesPtr(NULL) {}
+
+    explicit
+    FgSoftRenderMeshes(const vector<Fg3dMesh> & meshes);    // Each must have exactly 1 surface
+};
+
+FgImgRgbaUb
+fgSoftRender(
+    FgVect2UI                   pixelSize,
+    const FgSoftRenderMeshes &  meshes,
+    const FgLighting &          light,
+    FgAffine3D                  modelview,
+    FgAffineCw2D                itcsToIucs,
+    FgRgbaF                     backgroundColor,
+    uint                        antiAliasBitDepth=3);
+
+struct  FgSoftRenderView
+{
+    FgAffine3D                  modelview;
+    FgAffineCw2D                itcsToIucs;
+    FgLighting                  lighting;
+
+    FgSoftRenderView() {}
+
+    FgSoftRenderView(FgAffine3D mv,FgAffineCw2D i2i,const FgLighting & l)
+    : modelview(mv), itcsToIucs(i2i), lighting(l)
+    {}
+};
+
+// Called with the view index and its render as each one completes. Calls are made from worker
+// threads in no particular order, so must be MT safe:
+typedef boost::function<void(size_t,const FgImgRgbaUb &)>   FgFuncRenderSink;
+
+// Renders all views concurrently (the ray-casting acceleration structures are per-view so are
+// built concurrently as well):
+void
+fgSoftRenderBatch(
+    FgVect2UI                           pixelSize,
+    const FgSoftRenderMeshes &          meshes,
+    const vector<FgSoftRenderView> &    views,
+    FgRgbaF                             backgroundColor,
+    uint                                antiAliasBitDepth,
+    const FgFuncRenderSink &            sink,
+    uint                                numThreads=0);      // 0: use all hardware threads
+
+vector<FgImgRgbaUb>
+fgSoftRenderBatch(
+    FgVect2UI                           pixelSize,
+    const FgSoftRenderMeshes &          meshes,
+    const vector<FgSoftRenderView> &    views,
+    FgRgbaF                             backgroundColor,
+    uint                                antiAliasBitDepth=3,
+    uint                                numThreads=0);
+
 #endif
 
 // */
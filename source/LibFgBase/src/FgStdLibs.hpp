@@ -36,6 +36,7 @@
 
 #include <vector>
 #include <algorithm>
+#include <deque>
 #include <exception>
 #include <fstream>
 #include <functional>
@@ -45,6 +46,7 @@
 #include <limits>
 #include <map>
 #include <memory>
+#include <queue>
 #include <set>
 #include <sstream>
 #include <stack>
@@ -14,14 +14,17 @@
 #include "FgStdString.hpp"
 #include "FgTypes.hpp"
 
-// Returns false if unable to connect to server:
+// Returns false if unable to connect to server, or if 'getResponse' and the response is
+// interrupted or times out:
 bool
 fgTcpClient(
     const string &      hostname,       // DNS or IP
     uint16              port,
     const string &      data,
     bool                getResponse,
-    string &            response);      // Ignored if 'getResponse' == false
+    string &            response,       // Ignored if 'getResponse' == false
+    // Maximum wait in milliseconds for each part of the response. 0: wait indefinitely:
+    uint                recvTimeoutMs=5000);
 
 inline
 bool
@@ -33,8 +36,8 @@ fgTcpClient(const string & hostname,uint16 port,const string & data)
 
 inline
 bool
-fgTcpClient(const string & hostname,uint16 port,const string & data,string & response)
-{return fgTcpClient(hostname,port,data,true,response); }
+fgTcpClient(const string & hostname,uint16 port,const string & data,string & response,uint recvTimeoutMs=5000)
+{return fgTcpClient(hostname,port,data,true,response,recvTimeoutMs); }
 
 typedef boost::function<bool        // Return false to terminate server
     (const string &,                // IP Address of the client
@@ -51,4 +54,21 @@ fgTcpServer(
     FgFuncTcpHandler    handler,
     size_t              maxRecvBytes);  // Maximum number of bytes to receive in incomimg message
 
+// As above with 'respond' true, but each connection is received, handled and responded to on one
+// of a pool of worker threads so clients are served concurrently. The handler must be MT safe.
+// Once a handler returns false no more connections are accepted, and this function returns
+// after the connections already accepted have been served:
+void
+fgTcpServerConcurrent(
+    uint16              port,
+    FgFuncTcpHandler    handler,
+    size_t              maxRecvBytes,
+    uint                numThreads=0,   // 0: use all hardware threads
+    // If false, listen on the loopback interface so only connections from this machine are accepted:
+    bool                external=false);
+
+// Returns a port on the loopback interface which is free at the time of the call:
+uint16
+fgTcpFreePort();
+
 #endif
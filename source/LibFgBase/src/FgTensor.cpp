@@ -11,9 +11,78 @@
 
 #include "FgTensor.hpp"
 #include "FgCommand.hpp"
+#include "FgRandom.hpp"
 
 using namespace std;
 
+template<uint rank>
+static
+FgTensor<double,rank>
+randTensor(FgMatrixC<uint,rank,1> dims)
+{
+    FgTensor<double,rank>   ret;
+    ret.m_dims = dims;
+    ret.m_data = fgRandNormals(dims.volume());
+    return ret;
+}
+
+// Checks the blocked kernel against the element-wise reference for every permutation:
+template<uint rank>
+static
+void
+testReorder(FgMatrixC<uint,rank,1> dims)
+{
+    FgTensor<double,rank>   ten = randTensor(dims);
+    FgMatrixC<uint,rank,1>  perm;
+    for (uint dd=0; dd<rank; ++dd)
+        perm[dd] = dd;
+    do {
+        FGASSERT(ten.reorder(perm) == ten.reorderSimple(perm));
+        FGASSERT(ten.reorder(perm,1) == ten.reorderSimple(perm));
+    }
+    while (std::next_permutation(perm.m,perm.m+rank));
+    for (uint d0=0; d0<rank; ++d0)
+        for (uint d1=0; d1<rank; ++d1)
+            FGASSERT(ten.transpose(d0,d1) == ten.transposeSimple(d0,d1));
+}
+
+template<uint rank>
+static
+void
+testModeProduct(FgMatrixC<uint,rank,1> dims,uint numRows)
+{
+    typedef FgMatrixC<uint,rank,1>  Crd;
+    FgTensor<double,rank>   ten = randTensor(dims);
+    for (uint mode=0; mode<rank; ++mode) {
+        FgMatrixD               mat = fgMatRandNormal<double>(numRows,dims[mode]);
+        FgTensor<double,rank>   prod = fgModeProduct(ten,mode,mat),
+                                ref;
+        ref.m_dims = dims;
+        ref.m_dims[mode] = numRows;
+        ref.m_data.resize(ref.m_dims.volume(),0.0);
+        for (FgIter<uint,rank> it(dims); it.valid(); it.next()) {
+            Crd                 crd = it();
+            double              val = ten[crd];
+            for (uint jj=0; jj<numRows; ++jj) {
+                crd[mode] = jj;
+                ref[crd] += mat.rc(jj,it()[mode]) * val;
+            }
+        }
+        FGASSERT(prod.m_dims == ref.m_dims);
+        double                  tol = fgMax(fgMapAbs(ref.m_data)) * 1.0e-12;
+        for (size_t ii=0; ii<ref.m_data.size(); ++ii)
+            FGASSERT(std::abs(prod.m_data[ii]-ref.m_data[ii]) <= tol);
+        // Tensor-times-vector equals the single row product with that axis removed:
+        vector<double>          vec = fgRandNormals(dims[mode]);
+        FgTensor<double,rank-1> ttv = fgModeProduct(ten,mode,vec);
+        FgTensor<double,rank>   row = fgModeProduct(ten,mode,FgMatrixD(1,vec.size(),vec));
+        FGASSERT(ttv.m_data == row.m_data);
+        for (uint dd=0,rr=0; dd<rank; ++dd)
+            if (dd != mode)
+                FGASSERT(ttv.m_dims[rr++] == dims[dd]);
+    }
+}
+
 void
 fgTensorTest(const FgArgs &)
 {
@@ -39,6 +108,19 @@ fgTensorTest(const FgArgs &)
                     y = t.reorder(FgVect3UI(2,1,0));
     FGASSERT(x == v);
     FGASSERT(y == w);
+    // Small, unit and large (parallel) dimensions:
+    testReorder(FgVect3UI(2,3,4));
+    testReorder(FgVect3UI(1,37,5));
+    testReorder(FgVect3UI(45,1,70));
+    testReorder(FgVect3UI(67,43,29));
+    testReorder(FgVect4UI(3,1,4,2));
+    testReorder(FgVect4UI(5,7,1,9));
+    testReorder(FgVect4UI(33,17,41,13));
+    testModeProduct(FgVect3UI(4,5,6),3);
+    testModeProduct(FgVect3UI(1,7,130),70);
+    testModeProduct(FgVect3UI(50,40,30),90);
+    testModeProduct(FgVect4UI(3,4,5,6),7);
+    testModeProduct(FgVect4UI(20,1,30,40),25);
 }
 
 // */
@@ -18,6 +18,157 @@
 #include "FgDiagnostics.hpp"
 #include "FgMatrix.hpp"
 #include "FgIter.hpp"
+#include "FgThread.hpp"
+
+// C = A * B for row-major arrays with row strides 'lda', 'ldb' and 'ldc'. Blocked over the inner
+// and column dimensions so the active block of B stays in cache while each row of A passes over
+// it. The innermost loop runs along rows of B and C so it vectorizes:
+template<class T>
+void
+fgGemm(
+    size_t      m,
+    size_t      n,
+    size_t      k,
+    const T *   a,
+    size_t      lda,
+    const T *   b,
+    size_t      ldb,
+    T *         c,
+    size_t      ldc)
+{
+    const size_t    kBlock = 128,
+                    nBlock = 256;
+    for (size_t ii=0; ii<m; ++ii)
+        std::fill(c+ii*ldc,c+ii*ldc+n,T(0));
+    for (size_t k0=0; k0<k; k0+=kBlock) {
+        size_t          k1 = std::min(k0+kBlock,k);
+        for (size_t j0=0; j0<n; j0+=nBlock) {
+            size_t          j1 = std::min(j0+nBlock,n);
+            for (size_t ii=0; ii<m; ++ii) {
+                const T *       ar = a + ii*lda;
+                T *             cr = c + ii*ldc;
+                size_t          kk = k0;
+                // 4 rows of B at a time to reduce loads and stores of C:
+                for (; kk+4<=k1; kk+=4) {
+                    T               a0 = ar[kk],
+                                    a1 = ar[kk+1],
+                                    a2 = ar[kk+2],
+                                    a3 = ar[kk+3];
+                    const T *       b0 = b + kk*ldb;
+                    const T *       b1 = b0 + ldb;
+                    const T *       b2 = b1 + ldb;
+                    const T *       b3 = b2 + ldb;
+                    for (size_t jj=j0; jj<j1; ++jj)
+                        cr[jj] += a0*b0[jj] + a1*b1[jj] + a2*b2[jj] + a3*b3[jj];
+                }
+                for (; kk<k1; ++kk) {
+                    T               aik = ar[kk];
+                    const T *       br = b + kk*ldb;
+                    for (size_t jj=j0; jj<j1; ++jj)
+                        cr[jj] += aik * br[jj];
+                }
+            }
+        }
+    }
+}
+
+// Copies a strided 4D array into a contiguous one. 'dims' and 'srcStrides' are per destination
+// axis (from minor to major). The destination minor axis is tiled together with the axis which
+// is contiguous in the source so that both reads and writes stay within cache lines. The
+// remaining two (outer) axes are split into tasks which can run in parallel:
+template<class T>
+struct  FgPermuteKernel
+{
+    const T *           src;
+    T *                 dst;
+    size_t              dims[4];
+    size_t              srcStrides[4];
+    size_t              dstStrides[4];
+    uint                tileAxis;       // Axis with the smallest source stride; 0 if none other
+    uint                outerAxes[3];   // Axes iterated per element row (or tile)
+    uint                numOuter;
+    size_t              outerSize;      // Product of the outer dimensions
+    size_t              chunk;          // Outer indices per task
+
+    FgPermuteKernel(const T * s,T * d,const size_t * ds,const size_t * ss)
+    : src(s), dst(d), tileAxis(0), numOuter(0), outerSize(1), chunk(1)
+    {
+        size_t          stride = 1;
+        for (uint ii=0; ii<4; ++ii) {
+            dims[ii] = ds[ii];
+            srcStrides[ii] = ss[ii];
+            dstStrides[ii] = stride;
+            stride *= dims[ii];
+        }
+        for (uint ii=1; ii<4; ++ii)
+            if ((dims[ii] > 1) && ((dims[tileAxis] < 2) || (srcStrides[ii] < srcStrides[tileAxis])))
+                tileAxis = ii;
+        if ((dims[0] > 1) && (srcStrides[0] <= srcStrides[tileAxis]))
+            tileAxis = 0;
+        for (uint ii=1; ii<4; ++ii) {
+            if (ii != tileAxis) {
+                outerAxes[numOuter++] = ii;
+                outerSize *= dims[ii];
+            }
+        }
+    }
+
+    size_t
+    numTasks(uint numThreads)
+    {
+        // Enough tasks to balance but each large enough to amortize the task overhead:
+        size_t          rowSize = (tileAxis == 0) ? dims[0] : dims[0] * dims[tileAxis],
+                        minChunk = std::max(size_t(1),size_t(1 << 14) / std::max(rowSize,size_t(1))),
+                        maxTasks = size_t(fgNumThreads(numThreads)) * 4;
+        chunk = std::max(minChunk,(outerSize + maxTasks - 1) / maxTasks);
+        return (outerSize + chunk - 1) / chunk;
+    }
+
+    void
+    run(size_t task) const
+    {
+        const size_t    tb = 32;                    // Tile side (elements)
+        size_t          beg = task * chunk,
+                        end = std::min(beg+chunk,outerSize),
+                        d0 = dims[0],
+                        s0 = srcStrides[0];
+        for (size_t oo=beg; oo<end; ++oo) {
+            const T *       s = src;
+            T *             d = dst;
+            size_t          rem = oo;
+            for (uint aa=0; aa<numOuter; ++aa) {
+                uint            ax = outerAxes[aa];
+                size_t          crd = rem % dims[ax];
+                rem /= dims[ax];
+                s += crd * srcStrides[ax];
+                d += crd * dstStrides[ax];
+            }
+            if (tileAxis == 0) {
+                if (s0 == 1)
+                    std::copy(s,s+d0,d);
+                else
+                    for (size_t ii=0; ii<d0; ++ii)
+                        d[ii] = s[ii*s0];
+                continue;
+            }
+            size_t          dt = dims[tileAxis],
+                            tss = srcStrides[tileAxis],
+                            tds = dstStrides[tileAxis];
+            for (size_t t0=0; t0<dt; t0+=tb) {
+                size_t          t1 = std::min(t0+tb,dt);
+                for (size_t i0=0; i0<d0; i0+=tb) {
+                    size_t          i1 = std::min(i0+tb,d0);
+                    for (size_t tt=t0; tt<t1; ++tt) {
+                        const T *       sr = s + tt*tss;
+                        T *             dr = d + tt*tds;
+                        for (size_t ii=i0; ii<i1; ++ii)
+                            dr[ii] = sr[ii*s0];
+                    }
+                }
+            }
+        }
+    }
+};
 
 template <class T,uint rank>
 struct  FgTensor
@@ -66,8 +217,53 @@ struct  FgTensor
     operator[](const Crd & crd)                // Index from minor to major
     {return m_data[crdToIdx(crd)]; }
 
+    // Must represent a valid permutation; axis 'ii' of the result is axis 'perm[ii]' of this.
+    // Ranks up to 4 use the cache-blocked kernel, in parallel for large tensors:
+    FgTensor
+    reorder(const Crd & perm,uint numThreads=0) const
+    {
+        FGASSERT(fgIsValidPermutation(perm));
+        if (rank > 4)
+            return reorderSimple(perm);
+        FgTensor        ret;
+        ret.m_dims = fgPermute(m_dims,perm);
+        ret.m_data.resize(m_data.size());
+        if (m_data.empty())
+            return ret;
+        size_t          strides[rank],
+                        stride = 1,
+                        dims[4] = {1,1,1,1},
+                        srcStrides[4] = {0,0,0,0};
+        for (uint dd=0; dd<rank; ++dd) {
+            strides[dd] = stride;
+            stride *= m_dims[dd];
+        }
+        for (uint dd=0; dd<rank; ++dd) {
+            dims[dd] = ret.m_dims[dd];
+            srcStrides[dd] = strides[perm[dd]];
+        }
+        FgPermuteKernel<T>  kernel(&m_data[0],&ret.m_data[0],dims,srcStrides);
+        size_t              numTasks = kernel.numTasks(numThreads);
+        if (m_data.size() < (1 << 16))
+            numThreads = 1;
+        fgParallelFor(numTasks,boost::bind(&FgPermuteKernel<T>::run,boost::cref(kernel),_1),numThreads);
+        return ret;
+    }
+
+    FgTensor
+    transpose(uint d0,uint d1,uint numThreads=0) const
+    {
+        FGASSERT((d0<rank) && (d1<rank));
+        Crd             perm;
+        for (uint dd=0; dd<rank; ++dd)
+            perm[dd] = dd;
+        std::swap(perm[d0],perm[d1]);
+        return reorder(perm,numThreads);
+    }
+
+    // Element-wise versions of the above, for reference:
     FgTensor
-    reorder(const Crd & perm) const             // Must represent a valid permutation
+    reorderSimple(const Crd & perm) const
     {
         FGASSERT(fgIsValidPermutation(perm));
         FgTensor        ret;
@@ -80,7 +276,7 @@ struct  FgTensor
     }
 
     FgTensor
-    transpose(uint d0,uint d1) const
+    transposeSimple(uint d0,uint d1) const
     {
         FGASSERT((d0<rank) && (d1<rank));
         FgTensor        ret;
@@ -100,6 +296,104 @@ struct  FgTensor
     {return ((m_dims == rhs.m_dims) && (m_data == rhs.m_data)); }
 };
 
+// Tensor-times-matrix contraction (mode-n product) over contiguous slices using 'fgGemm':
+template<class T>
+struct  FgModeProductKernel
+{
+    const T *           src;
+    T *                 dst;
+    const FgMatrixV<T> & mat;       // Or its transpose when 'inner' is 1
+    size_t              inner;      // Product of the dimensions below the mode
+    size_t              outer;      // Product of the dimensions above the mode
+    size_t              rowBlock;   // Rows of the output slice (or of the output when 'inner' is 1) per task
+    size_t              rowBlocks;
+
+    FgModeProductKernel(const T * s,T * d,const FgMatrixV<T> & m,size_t i,size_t o)
+    : src(s), dst(d), mat(m), inner(i), outer(o), rowBlock(64)
+    {rowBlocks = (((inner == 1) ? outer : mat.nrows) + rowBlock - 1) / rowBlock; }
+
+    size_t
+    numTasks() const
+    {return (inner == 1) ? rowBlocks : outer * rowBlocks; }
+
+    void
+    run(size_t task) const
+    {
+        size_t          r0 = (task % rowBlocks) * rowBlock;
+        if (inner == 1) {
+            // The tensor is an outer x K row-major matrix which is multiplied by the transpose:
+            size_t          r1 = std::min(r0+rowBlock,outer),
+                            kk = mat.nrows,
+                            jj = mat.ncols;
+            fgGemm(r1-r0,jj,kk,src+r0*kk,kk,&mat.m_data[0],jj,dst+r0*jj,jj);
+        }
+        else {
+            // Each slice of the tensor is a K x inner row-major matrix:
+            size_t          oo = task / rowBlocks,
+                            r1 = std::min(r0+rowBlock,size_t(mat.nrows)),
+                            kk = mat.ncols;
+            const T *       s = src + oo*kk*inner;
+            T *             d = dst + oo*mat.nrows*inner;
+            fgGemm(r1-r0,inner,kk,&mat.m_data[r0*kk],kk,s,inner,d+r0*inner,inner);
+        }
+    }
+};
+
+// Mode-n product: contracts axis 'mode' of 'ten' with the rows of 'mat' (whose number of
+// columns must equal that dimension), so the result has 'mat.nrows' along that axis:
+//   ret[..,j,..] = sum_k mat.rc(j,k) * ten[..,k,..]
+// Runs in parallel over the outer axes and row blocks of 'mat' for large products:
+template<class T,uint rank>
+FgTensor<T,rank>
+fgModeProduct(
+    const FgTensor<T,rank> &    ten,
+    uint                        mode,
+    const FgMatrixV<T> &        mat,
+    uint                        numThreads=0)
+{
+    FGASSERT(mode < rank);
+    FGASSERT(mat.ncols == ten.m_dims[mode]);
+    FgTensor<T,rank>    ret;
+    ret.m_dims = ten.m_dims;
+    ret.m_dims[mode] = mat.nrows;
+    size_t              inner = 1,
+                        outer = 1;
+    for (uint dd=0; dd<mode; ++dd)
+        inner *= ten.m_dims[dd];
+    for (uint dd=mode+1; dd<rank; ++dd)
+        outer *= ten.m_dims[dd];
+    ret.m_data.resize(inner*mat.nrows*outer);
+    if (ret.m_data.empty() || ten.m_data.empty())
+        return ret;
+    FgMatrixV<T>        matT;
+    if (inner == 1)
+        matT = mat.transpose();
+    FgModeProductKernel<T>  kernel(&ten.m_data[0],&ret.m_data[0],(inner == 1) ? matT : mat,inner,outer);
+    if (double(ret.m_data.size()) * mat.ncols < double(1 << 20))
+        numThreads = 1;
+    fgParallelFor(kernel.numTasks(),boost::bind(&FgModeProductKernel<T>::run,boost::cref(kernel),_1),numThreads);
+    return ret;
+}
+
+// Tensor-times-vector: as above with a single row, the contracted axis is then removed. Eg. for
+// a multilinear model tensor, contracting the coefficient axes evaluates the model:
+template<class T,uint rank>
+FgTensor<T,rank-1>
+fgModeProduct(
+    const FgTensor<T,rank> &    ten,
+    uint                        mode,
+    const vector<T> &           vec,
+    uint                        numThreads=0)
+{
+    FgTensor<T,rank>    prod = fgModeProduct(ten,mode,FgMatrixV<T>(1,vec.size(),vec),numThreads);
+    FgTensor<T,rank-1>  ret;
+    for (uint dd=0,rr=0; dd<rank; ++dd)
+        if (dd != mode)
+            ret.m_dims[rr++] = prod.m_dims[dd];
+    ret.m_data.swap(prod.m_data);       // The removed axis has dimension 1 so the order is unchanged
+    return ret;
+}
+
 typedef FgTensor<int,3>         FgTensor3I;
 typedef FgTensor<int,4>         FgTensor4I;
 typedef FgTensor<float,3>       FgTensor3F;
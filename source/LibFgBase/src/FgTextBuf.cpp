@@ -0,0 +1,443 @@
+//
+// Copyright (c) 2015 Singular Inversions Inc. (facegen.com)
+// Use, modification and distribution is subject to the MIT License,
+// see accompanying file LICENSE.txt or facegen.com/base_library_license.txt
+//
+
+#include "stdafx.h"
+
+#include "FgTextBuf.hpp"
+#include "FgStdStream.hpp"
+#include "FgThread.hpp"
+#include "FgRandom.hpp"
+#include "FgCommand.hpp"
+#include "FgTime.hpp"
+
+using namespace std;
+
+namespace {
+
+// All exactly representable as doubles:
+const double    s_pow10[] = {
+    1e0,1e1,1e2,1e3,1e4,1e5,1e6,1e7,1e8,1e9,1e10,1e11,
+    1e12,1e13,1e14,1e15,1e16,1e17,1e18,1e19,1e20,1e21,1e22
+};
+
+const uint64    s_pow10i[] = {
+    1ULL,10ULL,100ULL,1000ULL,10000ULL,100000ULL,1000000ULL,10000000ULL,100000000ULL,
+    1000000000ULL,10000000000ULL,100000000000ULL,1000000000000ULL
+};
+
+// Value of 'mant' * 10^'exp10', correctly rounded to double for |exp10| <= 22:
+inline double
+decimalValue(uint64 mant,int exp10)
+{
+    return (exp10 >= 0) ? double(mant) * s_pow10[exp10] : double(mant) / s_pow10[-exp10];
+}
+
+// Writes the non-negative value 'mant' * 10^'exp10' and returns the number of chars:
+uint
+writeDecimal(uint64 mant,int exp10,char * buf)
+{
+    if (mant == 0) {
+        buf[0] = '0';
+        return 1;
+    }
+    while (mant % 10 == 0) {
+        mant /= 10;
+        ++exp10;
+    }
+    char        digits[24] = {0};
+    int         nd = 0;
+    for (uint64 mm=mant; mm!=0; mm/=10)
+        digits[nd++] = char('0' + mm % 10);
+    reverse(digits,digits+nd);
+    int         sciExp = exp10 + nd - 1;
+    char *      ptr = buf;
+    if ((sciExp >= -4) && (sciExp < 9)) {
+        if (sciExp < 0) {
+            *ptr++ = '0';
+            *ptr++ = '.';
+            for (int ii=0; ii<-sciExp-1; ++ii)
+                *ptr++ = '0';
+            for (int ii=0; ii<nd; ++ii)
+                *ptr++ = digits[ii];
+        }
+        else if (nd <= sciExp+1) {
+            for (int ii=0; ii<nd; ++ii)
+                *ptr++ = digits[ii];
+            for (int ii=nd; ii<sciExp+1; ++ii)
+                *ptr++ = '0';
+        }
+        else {
+            for (int ii=0; ii<nd; ++ii) {
+                if (ii == sciExp+1)
+                    *ptr++ = '.';
+                *ptr++ = digits[ii];
+            }
+        }
+    }
+    else {
+        *ptr++ = digits[0];
+        if (nd > 1) {
+            *ptr++ = '.';
+            for (int ii=1; ii<nd; ++ii)
+                *ptr++ = digits[ii];
+        }
+        *ptr++ = 'e';
+        *ptr++ = (sciExp < 0) ? '-' : '+';
+        int         ee = abs(sciExp);
+        if (ee >= 100)
+            *ptr++ = char('0' + ee / 100);
+        *ptr++ = char('0' + (ee / 10) % 10);
+        *ptr++ = char('0' + ee % 10);
+    }
+    return uint(ptr - buf);
+}
+
+// Parse the output of printf("%.*e") back into mantissa and exponent:
+void
+parseSci(const char * str,uint64 & mant,int & exp10)
+{
+    mant = 0;
+    int         numFrac = 0;
+    bool        frac = false;
+    for (; *str != 'e'; ++str) {
+        if ((*str >= '0') && (*str <= '9')) {
+            mant = mant * 10 + uint64(*str - '0');
+            if (frac)
+                ++numFrac;
+        }
+        else                // Decimal point (whatever the locale):
+            frac = true;
+    }
+    exp10 = atoi(str+1) - numFrac;
+}
+
+// Fallback for values outside the range of the exact power-of-ten table:
+template<class T>
+uint
+shortestSlow(T val,int minDigits,int maxDigits,char * buf)
+{
+    char        str[64];
+    for (int pp=minDigits; pp<maxDigits; ++pp) {
+        snprintf(str,sizeof(str),"%.*e",pp-1,double(val));
+        if (T(strtod(str,NULL)) == val)
+            break;
+    }
+    uint64      mant;
+    int         exp10;
+    parseSci(str,mant,exp10);
+    return writeDecimal(mant,exp10,buf);
+}
+
+// Returns 0 if finite, 1 if infinite and 2 if NaN. Bit tests rather than comparisons
+// since this library is compiled with fast (finite-only) math:
+inline uint
+nonFinite(float val)
+{
+    uint32      bits;
+    memcpy(&bits,&val,4);
+    if ((bits & 0x7F800000U) != 0x7F800000U)
+        return 0;
+    return ((bits & 0x007FFFFFU) == 0) ? 1 : 2;
+}
+
+inline uint
+nonFinite(double val)
+{
+    uint64      bits;
+    memcpy(&bits,&val,8);
+    if ((bits & 0x7FF0000000000000ULL) != 0x7FF0000000000000ULL)
+        return 0;
+    return ((bits & 0x000FFFFFFFFFFFFFULL) == 0) ? 1 : 2;
+}
+
+template<class T>
+uint
+specialValue(T & val,char * buf,bool & done)
+{
+    done = true;
+    uint        len = 0;
+    uint        nf = nonFinite(val);
+    if (nf == 2) {
+        memcpy(buf,"nan",3);
+        return 3;
+    }
+    if (std::signbit(val)) {
+        buf[len++] = '-';
+        val = -val;
+    }
+    if (nf == 1) {
+        memcpy(buf+len,"inf",3);
+        return len + 3;
+    }
+    if (val == T(0)) {
+        buf[len++] = '0';
+        return len;
+    }
+    done = false;
+    return len;
+}
+
+}
+
+uint
+fgFormatShortest(float val,char * buf)
+{
+    bool        done;
+    uint        len = specialValue(val,buf,done);
+    if (done)
+        return len;
+    buf += len;
+    double      dv = val;
+    int         e10 = int(floor(log10(dv)));
+    // The power-of-ten tables limit the fast path. This covers all normal mesh coordinates:
+    if ((e10 < -13) || (e10 > 20))
+        return len + shortestSlow(val,1,10,buf);
+    if (dv >= decimalValue(1,e10+1))
+        ++e10;
+    else if (dv < decimalValue(1,e10))
+        --e10;
+    // 9 significant digits always suffice for a float so start from those:
+    uint64      m9 = (e10 <= 8) ?
+        uint64(dv * s_pow10[8-e10] + 0.5) :
+        uint64(dv / s_pow10[e10-8] + 0.5);
+    if (m9 >= s_pow10i[9]) {
+        m9 /= 10;
+        ++e10;
+    }
+    for (int pp=1; pp<9; ++pp) {
+        uint64      div = s_pow10i[9-pp],
+                    lo = m9 / div,
+                    rem = m9 % div;
+        int         exp10 = e10 - pp + 1;
+        bool        loOk = (float(decimalValue(lo,exp10)) == val),
+                    hiOk = (float(decimalValue(lo+1,exp10)) == val);
+        if (loOk && (!hiOk || (rem*2 <= div)))
+            return len + writeDecimal(lo,exp10,buf);
+        if (hiOk)
+            return len + writeDecimal(lo+1,exp10,buf);
+    }
+    if (float(decimalValue(m9,e10-8)) == val)
+        return len + writeDecimal(m9,e10-8,buf);
+    return len + shortestSlow(val,1,10,buf);
+}
+
+uint
+fgFormatShortest(double val,char * buf)
+{
+    bool        done;
+    uint        len = specialValue(val,buf,done);
+    if (done)
+        return len;
+    // 15 digits are unique for any double so if the value can be represented in 15 or fewer
+    // digits this gives that representation once trailing zeros are removed:
+    return len + shortestSlow(val,15,18,buf+len);
+}
+
+uint
+fgFormatFixed(double val,uint decimals,char * buf)
+{
+    double      av = fabs(val);
+    if ((decimals > 9) || (av >= 1e9) || (nonFinite(val) != 0))
+        return uint(snprintf(buf,352,"%.*f",int(decimals),val));
+    uint64      scale = s_pow10i[decimals];
+    double      scaled = av * double(scale),
+                whole = floor(scaled);
+    // The scaling can be off by an ulp so values within that of a rounding tie are left to
+    // printf, which rounds the exact binary value:
+    if (fabs(scaled - whole - 0.5) <= scaled * 4.0e-16)
+        return uint(snprintf(buf,352,"%.*f",int(decimals),val));
+    uint        len = 0;
+    if (std::signbit(val))
+        buf[len++] = '-';
+    uint64      num = uint64(whole) + ((scaled - whole > 0.5) ? 1 : 0),
+                ip = num / scale,
+                fp = num % scale;
+    char        digits[24];
+    int         nd = 0;
+    do {
+        digits[nd++] = char('0' + ip % 10);
+        ip /= 10;
+    } while (ip != 0);
+    while (nd > 0)
+        buf[len++] = digits[--nd];
+    if (decimals > 0) {
+        buf[len++] = '.';
+        for (uint ii=decimals; ii>0; --ii) {
+            buf[len+ii-1] = char('0' + fp % 10);
+            fp /= 10;
+        }
+        len += decimals;
+    }
+    return len;
+}
+
+void
+fgDump(const FgTextBuf & text,const FgString & filename)
+{
+    FgOfstream      ofs(filename);
+    ofs.write(text.str.data(),text.str.size());
+    ofs.flush();
+    if (!ofs)
+        fgThrow("Unable to write file",filename);
+}
+
+static
+void
+formatBlock(const FgFuncTextBlock & block,vector<FgTextBuf> & bufs,size_t idx)
+{block(idx,bufs[idx]); }
+
+void
+fgTextBlocks(
+    FgTextBuf &                 out,
+    size_t                      numBlocks,
+    const FgFuncTextBlock &     block,
+    uint                        numThreads)
+{
+    vector<FgTextBuf>           bufs(numBlocks);
+    fgParallelFor(numBlocks,boost::bind(formatBlock,boost::cref(block),boost::ref(bufs),_1),numThreads);
+    size_t                      sz = out.size();
+    for (size_t ii=0; ii<bufs.size(); ++ii)
+        sz += bufs[ii].size();
+    out.str.reserve(sz);
+    for (size_t ii=0; ii<bufs.size(); ++ii)
+        out.str.append(bufs[ii].str);
+}
+
+static
+void
+formatRange(const FgFuncTextRange & range,size_t num,size_t chunk,size_t idx,FgTextBuf & buf)
+{range(idx*chunk,std::min((idx+1)*chunk,num),buf); }
+
+void
+fgTextRanges(
+    FgTextBuf &                 out,
+    size_t                      num,
+    const FgFuncTextRange &     range,
+    uint                        numThreads)
+{
+    // Below this the cost of a thread outweighs the formatting:
+    const size_t                minChunk = 4096;
+    numThreads = fgNumThreads(numThreads);
+    if ((numThreads == 1) || (num < 2*minChunk)) {
+        range(0,num,out);
+        return;
+    }
+    // A few chunks per thread to balance load:
+    size_t                      chunk = std::max(minChunk,(num + 4*numThreads - 1) / (4*numThreads)),
+                                numChunks = (num + chunk - 1) / chunk;
+    fgTextBlocks(out,numChunks,boost::bind(formatRange,boost::cref(range),num,chunk,_1,_2),numThreads);
+}
+
+static
+string
+shortest(float v)
+{
+    char        buf[32];
+    return string(buf,fgFormatShortest(v,buf));
+}
+
+static
+string
+shortest(double v)
+{
+    char        buf[32];
+    return string(buf,fgFormatShortest(v,buf));
+}
+
+static
+void
+formatFloats(const vector<float> * vals,size_t begin,size_t end,FgTextBuf & out)
+{
+    for (size_t ii=begin; ii<end; ++ii)
+        out << (*vals)[ii] << '\n';
+}
+
+void
+fgTextBufTest(const FgArgs &)
+{
+    FGASSERT(shortest(0.1f) == "0.1");
+    FGASSERT(shortest(1.0f) == "1");
+    FGASSERT(shortest(100.0f) == "100");
+    FGASSERT(shortest(0.0001f) == "0.0001");
+    FGASSERT(shortest(1e-5f) == "1e-05");
+    FGASSERT(shortest(-2.5e-7f) == "-2.5e-07");
+    FGASSERT(shortest(123456.7f) == "123456.7");
+    FGASSERT(shortest(1e9f) == "1e+09");
+    FGASSERT(shortest(16777216.0f) == "16777216");
+    FGASSERT(shortest(numeric_limits<float>::max()) == "3.4028235e+38");
+    FGASSERT(shortest(numeric_limits<float>::min()) == "1.1754944e-38");
+    FGASSERT(shortest(numeric_limits<float>::infinity()) == "inf");
+    FGASSERT(shortest(0.1) == "0.1");
+    FGASSERT(shortest(1.0/3.0) == "0.3333333333333333");
+    FGASSERT(shortest(-1e100) == "-1e+100");
+    char        buf[352];
+    FGASSERT(string(buf,fgFormatFixed(-0.0000001,6,buf)) == "-0.000000");
+    FGASSERT(string(buf,fgFormatFixed(2.71828,3,buf)) == "2.718");
+    // Random bit patterns cover the whole range of floats. Check that each value reads back
+    // exactly and that no shorter printf representation also does:
+    fgRandSeedRepeatable();
+    vector<float>   vals;
+    while (vals.size() < 100000) {
+        uint32      bits = fgRandUint32();
+        float       val;
+        memcpy(&val,&bits,4);
+        if ((bits & 0x7F800000U) != 0x7F800000U)
+            vals.push_back(val);
+    }
+    for (size_t ii=0; ii<vals.size(); ++ii) {
+        float       val = vals[ii];
+        string      str = shortest(val);
+        if (strtof(str.c_str(),NULL) != val)
+            fgThrow("fgFormatShortest round trip failed",str);
+        string      sig;
+        for (size_t jj=0; (jj<str.size()) && (str[jj]!='e'); ++jj)
+            if ((str[jj] >= '0') && (str[jj] <= '9') && (!sig.empty() || (str[jj] != '0')))
+                sig += str[jj];
+        while (!sig.empty() && (sig[sig.size()-1] == '0'))
+            sig.resize(sig.size()-1);
+        char        ref[64];
+        for (int pp=1; pp<=9; ++pp) {
+            snprintf(ref,sizeof(ref),"%.*e",pp-1,double(val));
+            if (strtof(ref,NULL) == val) {
+                if (sig.size() > size_t(pp))
+                    fgThrow("fgFormatShortest result not shortest",str+" vs "+ref);
+                break;
+            }
+        }
+        double      dv = ldexp(double(val),-100);
+        snprintf(ref,sizeof(ref),"%.6f",dv);
+        if (fabs(dv) < 1e9) {
+            string      fixed(buf,fgFormatFixed(dv,6,buf));
+            if (fixed != ref)
+                fgThrow("fgFormatFixed mismatch",fixed+" vs "+ref);
+        }
+    }
+    // Parallel formatting must give identical output:
+    FgTextBuf       serial,
+                    parallel;
+    fgTextRanges(serial,vals.size(),boost::bind(formatFloats,&vals,_1,_2,_3),1);
+    fgTextRanges(parallel,vals.size(),boost::bind(formatFloats,&vals,_1,_2,_3),4);
+    FGASSERT(serial.str == parallel.str);
+    // Timing compared to iostreams on typical vertex coordinates (iostreams only writes
+    // 6 significant digits by default so it is doing less work):
+    for (size_t ii=0; ii<vals.size(); ++ii) {
+        vals[ii] = float(fgRandUniform(-100,100));
+        char        ref[64];
+        snprintf(ref,sizeof(ref),"%.6f",double(vals[ii]) / 100.0);
+        if (string(buf,fgFormatFixed(double(vals[ii]) / 100.0,6,buf)) != ref)
+            fgThrow("fgFormatFixed mismatch",ref);
+    }
+    FgTimer         timer;
+    ostringstream   oss;
+    for (size_t ii=0; ii<vals.size(); ++ii)
+        oss << vals[ii] << '\n';
+    double          timeStream = timer.read();
+    timer.start();
+    FgTextBuf       text;
+    formatFloats(&vals,0,vals.size(),text);
+    double          timeText = timer.read();
+    fgout << fgnl << vals.size() << " floats: ostream " << timeStream << "s, FgTextBuf " << timeText << "s";
+}
@@ -0,0 +1,172 @@
+//
+// Copyright (c) 2015 Singular Inversions Inc. (facegen.com)
+// Use, modification and distribution is subject to the MIT License,
+// see accompanying file LICENSE.txt or facegen.com/base_library_license.txt
+//
+// Fast text emission for large ASCII file formats (mesh exporters etc).
+//
+// Text is formatted into an in-memory buffer rather than through iostreams, which are
+// slow for numeric output (locale lookups, virtual calls and sentries on every value).
+// Floating point values are written with the fewest significant digits that read back
+// to exactly the same value (so 0.1f is written as "0.1" and no precision is lost).
+// The output is always in the "C" locale.
+//
+// Independent blocks of text (eg. each morph target or a range of vertices) can be
+// formatted concurrently with 'fgTextBlocks' / 'fgTextRanges' and are appended in order.
+//
+
+#ifndef FGTEXTBUF_HPP
+#define FGTEXTBUF_HPP
+
+#include "FgStdLibs.hpp"
+#include "FgTypes.hpp"
+#include "FgStdFunction.hpp"
+#include "FgString.hpp"
+#include "FgMatrixC.hpp"
+
+// Writes the shortest round-trip representation of 'val' into 'buf' (which must hold at least
+// 32 chars) and returns the number of chars written (no null terminator).
+// Uses fixed notation for decimal exponents in [-4,9) and scientific (eg. "1.5e-07") otherwise:
+uint
+fgFormatShortest(float val,char * buf);
+
+uint
+fgFormatShortest(double val,char * buf);
+
+// As above with a fixed number of digits after the decimal point, like printf("%.*f"):
+uint
+fgFormatFixed(double val,uint decimals,char * buf);
+
+struct  FgTextBuf
+{
+    std::string     str;
+
+    FgTextBuf() {}
+
+    // Pre-allocate when the output size can be estimated:
+    explicit
+    FgTextBuf(size_t reserve)
+    {str.reserve(reserve); }
+
+    FgTextBuf & operator<<(const char * s) {str.append(s); return *this; }
+    FgTextBuf & operator<<(const std::string & s) {str.append(s); return *this; }
+    FgTextBuf & operator<<(const FgString & s) {str.append(s.as_utf8_string()); return *this; }
+    FgTextBuf & operator<<(const FgTextBuf & t) {str.append(t.str); return *this; }
+    FgTextBuf & operator<<(char c) {str.push_back(c); return *this; }
+    FgTextBuf & operator<<(int v) {return appendInt(v); }
+    FgTextBuf & operator<<(long v) {return appendInt(v); }
+    FgTextBuf & operator<<(long long v) {return appendInt(v); }
+    FgTextBuf & operator<<(unsigned int v) {return appendUint(v); }
+    FgTextBuf & operator<<(unsigned long v) {return appendUint(v); }
+    FgTextBuf & operator<<(unsigned long long v) {return appendUint(v); }
+    FgTextBuf & operator<<(unsigned short v) {return appendUint(v); }
+
+    FgTextBuf &
+    operator<<(float v)
+    {
+        char        buf[32];
+        str.append(buf,fgFormatShortest(v,buf));
+        return *this;
+    }
+
+    FgTextBuf &
+    operator<<(double v)
+    {
+        char        buf[32];
+        str.append(buf,fgFormatShortest(v,buf));
+        return *this;
+    }
+
+    // Space separated elements:
+    template<class T,uint nrows,uint ncols>
+    FgTextBuf &
+    operator<<(const FgMatrixC<T,nrows,ncols> & mat)
+    {
+        for (uint ii=0; ii<nrows*ncols; ++ii) {
+            if (ii > 0)
+                str.push_back(' ');
+            *this << mat.m[ii];
+        }
+        return *this;
+    }
+
+    FgTextBuf &
+    fixed(double v,uint decimals)
+    {
+        char        buf[352];
+        FGASSERT(decimals <= 32);
+        str.append(buf,fgFormatFixed(v,decimals,buf));
+        return *this;
+    }
+
+    size_t size() const {return str.size(); }
+    bool empty() const {return str.empty(); }
+    void clear() {str.clear(); }            // Keeps the allocation for re-use
+
+private:
+    FgTextBuf &
+    appendUint(unsigned long long v)
+    {
+        char        buf[24];
+        char *      end = buf + sizeof(buf),
+             *      ptr = end;
+        do {
+            *(--ptr) = char('0' + v % 10);
+            v /= 10;
+        } while (v != 0);
+        str.append(ptr,end);
+        return *this;
+    }
+
+    FgTextBuf &
+    appendInt(long long v)
+    {
+        if (v < 0) {
+            str.push_back('-');
+            // Avoid overflow negating the most negative value:
+            return appendUint(0ULL - static_cast<unsigned long long>(v));
+        }
+        return appendUint(static_cast<unsigned long long>(v));
+    }
+};
+
+// Fixed notation output, eg. 'text << FgTextFixed(val,6)':
+struct  FgTextFixed
+{
+    double      val;
+    uint        decimals;
+
+    FgTextFixed(double v,uint d) : val(v), decimals(d) {}
+};
+
+inline FgTextBuf &
+operator<<(FgTextBuf & text,const FgTextFixed & tf)
+{return text.fixed(tf.val,tf.decimals); }
+
+// Write the buffer to file (text mode, as with FgOfstream). Throws if the file cannot be written:
+void
+fgDump(const FgTextBuf & text,const FgString & filename);
+
+typedef boost::function<void(size_t,FgTextBuf &)>           FgFuncTextBlock;
+
+// Formats blocks [0,numBlocks) concurrently, each into its own buffer, then appends them
+// to 'out' in index order. The block function must only read shared state:
+void
+fgTextBlocks(
+    FgTextBuf &                 out,
+    size_t                      numBlocks,
+    const FgFuncTextBlock &     block,
+    uint                        numThreads=0);
+
+typedef boost::function<void(size_t,size_t,FgTextBuf &)>    FgFuncTextRange;
+
+// Splits the elements [0,num) into contiguous ranges [begin,end) formatted concurrently
+// and appended to 'out' in order. Small arrays are formatted directly into 'out':
+void
+fgTextRanges(
+    FgTextBuf &                 out,
+    size_t                      num,
+    const FgFuncTextRange &     range,
+    uint                        numThreads=0);
+
+#endif
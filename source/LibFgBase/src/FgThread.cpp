@@ -9,6 +9,7 @@
 #include "stdafx.h"
 #include "FgThread.hpp"
 #include "FgOut.hpp"
+#include "FgSmartPtr.hpp"
 
 using namespace std;
 
@@ -22,3 +23,178 @@ bool    fg_debug_thread = false;
 */
 #define LOG_DEBUG_THREAD(x)
 
+
+uint
+fgNumThreads(uint requested)
+{
+    if (requested > 0)
+        return requested;
+    uint    hc = uint(boost::thread::hardware_concurrency());
+    return (hc > 0) ? hc : 1;
+}
+
+namespace {
+
+struct  ParallelFor
+{
+    const boost::function<void(size_t)> &   func;
+    size_t                                  num;
+    boost::mutex                            mtx;        // Guards members below
+    size_t                                  next;
+    bool                                    failed;
+    FgException                             exception;
+
+    ParallelFor(const boost::function<void(size_t)> & f,size_t n)
+    : func(f), num(n), next(0), failed(false), exception("")
+    {}
+
+    void
+    fail(const FgException & e)
+    {
+        boost::mutex::scoped_lock   lock(mtx);
+        if (!failed) {
+            failed = true;
+            exception = e;
+        }
+    }
+
+    void
+    work()
+    {
+        for (;;) {
+            size_t      idx;
+            {
+                boost::mutex::scoped_lock   lock(mtx);
+                if (failed || (next == num))
+                    return;
+                idx = next++;
+            }
+            try {
+                func(idx);
+            }
+            catch(FgException const & e) {
+                fail(e);
+            }
+            catch(std::exception const & e) {
+                fail(FgException("Standard library exception",e.what()));
+            }
+            catch(...) {
+                fail(FgException("Unknown exception type"));
+            }
+        }
+    }
+};
+
+}
+
+void
+fgParallelFor(
+    size_t                                  num,
+    const boost::function<void(size_t)> &   func,
+    uint                                    numThreads)
+{
+    if (num == 0)
+        return;
+    numThreads = fgNumThreads(numThreads);
+    ParallelFor                 pf(func,num);
+    size_t                      numWorkers = std::min(size_t(numThreads),num);
+    // The calling thread is one of the workers, and the only one for a single thread or task
+    // (tasks still run through 'work' so exceptions reach the caller the same way):
+    vector<FgSinglePtr<boost::thread> > threads(numWorkers-1);
+    for (size_t tt=0; tt<threads.size(); ++tt)
+        threads[tt] = new boost::thread(&ParallelFor::work,&pf);
+    pf.work();
+    for (size_t tt=0; tt<threads.size(); ++tt)
+        threads[tt]->join();
+    if (pf.failed) {
+        pf.exception.pushMsg("Exception thrown within fgParallelFor task");
+        throw pf.exception;
+    }
+}
+
+FgAsyncWorker::FgAsyncWorker(size_t maxPending)
+    : m_maxPending(std::max(maxPending,size_t(1))), m_stop(false), m_failed(false), m_exception("")
+{m_thread = boost::thread(&FgAsyncWorker::run,this); }
+
+void
+FgAsyncWorker::submit(const FgFunc & task)
+{
+    boost::mutex::scoped_lock   lock(m_mtx);
+    while (!m_failed && !m_stop && (m_queue.size() >= m_maxPending))
+        m_cvSpace.wait(lock);
+    // Tasks submitted after a failure are dropped; the failure is reported by 'finish':
+    if (m_failed || m_stop)
+        return;
+    m_queue.push_back(task);
+    m_cvWork.notify_one();
+}
+
+void
+FgAsyncWorker::run()
+{
+    for (;;) {
+        FgFunc      task;
+        {
+            boost::mutex::scoped_lock   lock(m_mtx);
+            while (m_queue.empty() && !m_stop)
+                m_cvWork.wait(lock);
+            if (m_queue.empty())
+                return;
+            task = m_queue.front();
+            m_queue.pop_front();
+            m_cvSpace.notify_all();
+        }
+        FgException     exc("");
+        bool            failed = true;
+        try {
+            task();
+            failed = false;
+        }
+        catch(FgException const & e) {
+            exc = e;
+        }
+        catch(std::exception const & e) {
+            exc = FgException("Standard library exception",e.what());
+        }
+        catch(...) {
+            exc = FgException("Unknown exception type");
+        }
+        if (failed) {
+            boost::mutex::scoped_lock   lock(m_mtx);
+            m_failed = true;
+            m_exception = exc;
+            m_queue.clear();
+            m_cvSpace.notify_all();
+            return;
+        }
+    }
+}
+
+void
+FgAsyncWorker::stop()
+{
+    {
+        boost::mutex::scoped_lock   lock(m_mtx);
+        m_stop = true;
+        m_cvWork.notify_all();
+        m_cvSpace.notify_all();
+    }
+    if (m_thread.joinable())
+        m_thread.join();
+}
+
+void
+FgAsyncWorker::finish()
+{
+    stop();
+    if (m_failed) {
+        m_failed = false;       // Only report once
+        m_exception.pushMsg("Exception thrown within FgAsyncWorker task");
+        throw m_exception;
+    }
+}
+
+FgAsyncWorker::~FgAsyncWorker()
+{stop(); }
+
+// */
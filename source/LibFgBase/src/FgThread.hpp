@@ -10,6 +10,9 @@
 #define INCLUDED_FGTHREAD_HPP
 
 #include "FgTypes.hpp"
+#include "FgStdFunction.hpp"
+#include "FgException.hpp"
+#include "FgNonCopyable.hpp"
 
 extern bool     fg_debug_thread;        // Set to true for copious debug messages
 
@@ -64,4 +67,56 @@ struct FgOnce
 void fgRunOnce(FgOnce & once,
                void(*init_routine)());
 
+// Number of worker threads to use when the client doesn't specify (ie. passes 0):
+uint
+fgNumThreads(uint requested=0);
+
+// Calls 'func' for each index in [0,num) using up to 'numThreads' worker threads (0 means one per
+// hardware thread). Indices are handed out one at a time so tasks of unequal cost balance.
+// If any task throws, remaining indices are skipped and the first exception is re-thrown
+// (as an FgException) in the calling thread once all workers have joined:
+void
+fgParallelFor(
+    size_t                                  num,
+    const boost::function<void(size_t)> &   func,
+    uint                                    numThreads=0);
+
+// Runs submitted tasks in submission order on a single background thread. Useful for
+// serializing output (eg. image encoding) behind parallel computation without holding up the
+// workers. 'submit' blocks when 'maxPending' tasks are already queued to bound memory use.
+// Exceptions from tasks are re-thrown by 'finish', after which no more tasks are run:
+struct  FgAsyncWorker : FgNonCopyable
+{
+    explicit
+    FgAsyncWorker(size_t maxPending=16);
+
+    // MT safe:
+    void
+    submit(const FgFunc & task);
+
+    // Waits for all submitted tasks to complete. Only call from the owning thread:
+    void
+    finish();
+
+    // Waits for submitted tasks but does not throw:
+    ~FgAsyncWorker();
+
+private:
+    boost::mutex                m_mtx;          // Guards all members below
+    boost::condition_variable   m_cvWork;
+    boost::condition_variable   m_cvSpace;
+    std::deque<FgFunc>          m_queue;
+    size_t                      m_maxPending;
+    bool                        m_stop;
+    bool                        m_failed;
+    FgException                 m_exception;
+    boost::thread               m_thread;
+
+    void
+    run();
+
+    void
+    stop();
+};
+
 #endif
@@ -13,6 +13,7 @@
 #include "FgStdLibs.hpp"
 #include "FgTypes.hpp"
 #include "FgOut.hpp"
+#include "FgProfile.hpp"
 
 // Cross-platform version always has units of seconds:
 void
@@ -22,6 +23,10 @@ fgSleep(uint seconds);
 uint64
 fgTimeMs();
 
+// Monotonic time in nanoseconds from an arbitrary origin. Only differences are meaningful:
+uint64
+fgTimeNs();
+
 // GMT date and time string in format: yyyy.mm.dd hh:mm:ss
 std::string
 fgDateTimeString();
@@ -39,36 +44,44 @@ fgDateTimePath();
 
 struct  FgTimer
 {
-    uint64      m_startTime;
+    uint64      m_startTime;    // Nanoseconds
 
     FgTimer()
     {start(); }
 
     void
     start()
-    {m_startTime = fgTimeMs(); }
+    {m_startTime = fgTimeNs(); }
 
     // Returns the time since 'start()' (or object construction) in seconds.
     double
     read() const
-    {
-        uint64  stopTime = fgTimeMs();
-        return (double(stopTime - m_startTime) / 1000.0);
-    }
+    {return double(readNs()) * 1.0e-9; }
 
     uint64
     readMs() const
-    {return fgTimeMs()-m_startTime; }
+    {return readNs() / 1000000ULL; }
+
+    uint64
+    readNs() const
+    {return fgTimeNs()-m_startTime; }
 };
 
 std::ostream &
 operator<<(std::ostream &,const FgTimer &);
 
+// Also recorded by the profiler (FgProfile.hpp) if FG_PROFILE is defined:
 struct FgTimeScope
 {
-    FgTimer     timer;
+    FgTimer             timer;
+#ifdef FG_PROFILE
+    FgProfileScope      profile;
+#endif
 
     FgTimeScope(const std::string & msg)
+#ifdef FG_PROFILE
+    : profile(msg)
+#endif
     {fgout << fgnl << "Beginning " << msg << ":" << fgpush; }
 
     ~FgTimeScope()
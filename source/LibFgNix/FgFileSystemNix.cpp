@@ -12,6 +12,8 @@
 #include <unistd.h>
 #include <dirent.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
 #include "FgFileSystem.hpp"
 #include "FgException.hpp"
 #include "FgDiagnostics.hpp"
@@ -175,4 +177,33 @@ fgExecutablePath()
 
 #endif
 
+FgFileMap::FgFileMap(const FgString & fname) : data(NULL), size(0)
+{
+    string          utf8 = fname.as_utf8_string();
+    int             fd = open(utf8.c_str(),O_RDONLY);
+    if (fd < 0)
+        fgThrow("Unable to open file for reading",fname);
+    struct stat     st;
+    if (fstat(fd,&st) != 0) {
+        close(fd);
+        fgThrow("Unable to get size of file",fname);
+    }
+    size = size_t(st.st_size);
+    if (size > 0) {
+        void *      ptr = mmap(NULL,size,PROT_READ,MAP_PRIVATE,fd,0);
+        if (ptr == MAP_FAILED) {
+            close(fd);
+            fgThrow("Unable to memory map file",fname);
+        }
+        data = static_cast<const uchar*>(ptr);
+    }
+    close(fd);                  // The mapping remains valid
+}
+
+FgFileMap::~FgFileMap()
+{
+    if (data != NULL)
+        munmap(const_cast<uchar*>(data),size);
+}
+
 // */
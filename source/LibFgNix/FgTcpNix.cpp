@@ -30,6 +30,7 @@
 #include "FgStdString.hpp"
 #include "FgScopeGuard.hpp"
 #include "FgOut.hpp"
+#include "FgThread.hpp"
 
 // Do NOT use std namespace to avoid collision with posix 'bind'
 
@@ -39,7 +40,8 @@ fgTcpClient(
     uint16              port,
     const std::string & data,
     bool                getResponse,
-    std::string &       response)
+    std::string &       response,
+    uint                recvTimeoutMs)
 {
     int     clientSock = socket(
                 AF_INET,            // IPv4 protocol family
@@ -47,10 +49,11 @@ fgTcpClient(
                 IPPROTO_TCP);       // TCP transport protocol
     FGASSERT(clientSock >= 0);
     FgScopeGuard        closeSocket(boost::bind(close,clientSock));
-    // Set the timeout so the user doesn't have to wait forever if the connection fails:
+    // Set the timeout so the user doesn't have to wait forever if the connection fails.
+    // A zero timeout is the socket default of never timing out:
     timeval         timeout;
-    timeout.tv_sec = 5;
-    timeout.tv_usec = 0;
+    timeout.tv_sec = recvTimeoutMs / 1000;
+    timeout.tv_usec = (recvTimeoutMs % 1000) * 1000;
     if (setsockopt(clientSock,SOL_SOCKET,SO_RCVTIMEO,&timeout,sizeof(timeout)) == -1)
         FGASSERT_FALSE;
     struct hostent *    remoteHost = gethostbyname(hostname.c_str());
@@ -82,16 +85,17 @@ fgTcpClient(
     shutdown(clientSock,1);
     if (getResponse) {
         response.clear();
-        char    buff[1024];
+        char    buff[0x10000];
         do {
             // read() same as recv() with flag=0:
             nBytes = read(clientSock,buff,sizeof(buff));
-            FGASSERT(nBytes >= 0);
+            // Timed out (EAGAIN) or connection broken, which can happen for many reasons so don't throw:
+            if ((nBytes < 0) && (errno != EINTR))
+                return false;
             if (nBytes > 0)
                 response += std::string(buff,nBytes);
         }
-        while (nBytes > 0);
-        FGASSERT(nBytes == 0);
+        while (nBytes != 0);
     }
     return true;
 }
@@ -112,26 +116,30 @@ void *get_in_addr(struct sockaddr *sa)
     return &(((struct sockaddr_in6*)sa)->sin6_addr);
 }
 
-void
-fgTcpServer(
-    uint16              port,
-    bool                respond,
-    FgFuncTcpHandler    handler,
-    size_t              maxRecvBytes)
+namespace {
+
+// If not 'external', only the loopback interface is used so other machines can't connect:
+int
+openListenSocket(uint16 port,bool external)
 {
-    struct sockaddr_storage clientAddress;
     int                 listenSockFd = -1;  // Avoid uninitialized warning
     struct addrinfo     hints,
                         *servinfo,
                         *p;
-    struct sigaction    sa;
     int                 yes=1;
     std::memset(&hints, 0, sizeof hints);
     // On most unix systems, AF_UNSPEC choice will listen for either IPv4 or IPv6 incoming connections:
     hints.ai_family = AF_UNSPEC;
     hints.ai_socktype = SOCK_STREAM;
-    hints.ai_flags = AI_PASSIVE; // use my IP
-    int rv = getaddrinfo(NULL,fgToString(port).c_str(),&hints,&servinfo);
+    const char *        node = NULL;
+    if (external)
+        hints.ai_flags = AI_PASSIVE; // use my IP
+    else {
+        // Use IPv4 loopback since that's what clients connecting to 127.0.0.1 expect:
+        hints.ai_family = AF_INET;
+        node = "127.0.0.1";
+    }
+    int rv = getaddrinfo(node,fgToString(port).c_str(),&hints,&servinfo);
     FGASSERT1(rv == 0,std::string(gai_strerror(rv)));
 
     // loop through all the results and bind to the first we can
@@ -155,6 +163,83 @@ fgTcpServer(
     // Set the socket to listen and queue up to 10 incoming connections:
     if (listen(listenSockFd,10) == -1)
         FGASSERT_FALSE;
+    return listenSockFd;
+}
+
+// Set the timeout. Very important since the default is to never time out so in some
+// cases a broken connection causes 'recv' to block forever:
+void
+setRecvTimeout(int dataSockFd)
+{
+    timeval         timeout;
+    timeout.tv_sec = 5;
+    timeout.tv_usec = 0;
+    if (setsockopt(dataSockFd,SOL_SOCKET,SO_RCVTIMEO,&timeout,sizeof(timeout)) == -1)
+        FGASSERT_FALSE;
+}
+
+std::string
+clientIp(const sockaddr_storage & clientAddress)
+{
+    char                sbuf[INET6_ADDRSTRLEN];
+    inet_ntop(
+        clientAddress.ss_family,
+        get_in_addr((struct sockaddr *)&clientAddress),
+        sbuf,
+        sizeof sbuf);
+    return std::string(sbuf);
+}
+
+// Returns the last 'read' result; zero if the whole message was received:
+int
+recvMessage(int dataSockFd,size_t maxRecvBytes,std::string & dataBuff,bool progress)
+{
+    int             bytesRecvd;
+    do {
+        char        buffer[0x10000];
+        // read() will return when either it has filled the buffer, copied over everything
+        // from the socket input buffer (only if non-empty), or when the the connection
+        // is closed by the client. Otherwise it will block (ie if input buffer empty).
+        bytesRecvd = read(dataSockFd,buffer,sizeof(buffer));
+        if (progress)
+            fgout << "." << std::flush;
+        if (bytesRecvd > 0)
+            dataBuff += std::string(buffer,bytesRecvd);
+    }
+    while ((bytesRecvd > 0) && (dataBuff.size() <= maxRecvBytes));
+    return bytesRecvd;
+}
+
+// A single 'send' can accept less than the whole buffer for large messages. MSG_NOSIGNAL avoids
+// SIGPIPE terminating the server if the client has gone away. Returns the number of bytes sent:
+size_t
+sendAll(int dataSockFd,const std::string & data)
+{
+    size_t          sent = 0;
+    while (sent < data.size()) {
+        ssize_t         num = send(dataSockFd,data.data()+sent,data.size()-sent,MSG_NOSIGNAL);
+        if (num <= 0) {
+            if ((num < 0) && (errno == EINTR))
+                continue;
+            break;
+        }
+        sent += size_t(num);
+    }
+    return sent;
+}
+
+}
+
+void
+fgTcpServer(
+    uint16              port,
+    bool                respond,
+    FgFuncTcpHandler    handler,
+    size_t              maxRecvBytes)
+{
+    struct sockaddr_storage clientAddress;
+    struct sigaction    sa;
+    int                 listenSockFd = openListenSocket(port,true);
     sa.sa_handler = sigchld_handler; // reap all dead processes
     sigemptyset(&sa.sa_mask);
     sa.sa_flags = SA_RESTART;
@@ -163,45 +248,21 @@ fgTcpServer(
 
     // Listen for client:
     int         dataSockFd;
-    bool        handlerRetval;
+    bool        handlerRetval = true;
     do {
         socklen_t   sz = sizeof(clientAddress);
         // Get incoming message socketFd. Will block until a message arrives since the
         // listen socket does not have the O_NONBLOCK option set.
         // The data socket is unique to the client IP:PORT, so multiple TCP connections can
-        // take place simultaneously (not made use of here):
+        // take place simultaneously (see 'fgTcpServerConcurrent'):
         dataSockFd = accept(listenSockFd,(struct sockaddr *)&clientAddress,&sz);
         FGASSERT(dataSockFd >= 0);
-        // Set the timeout. Very important since the default is to never time out so in some
-        // cases a broken connection causes 'recv' below to block forever:
-        timeval         timeout;
-        timeout.tv_sec = 5;
-        timeout.tv_usec = 0;
-        if (setsockopt(dataSockFd,SOL_SOCKET,SO_RCVTIMEO,&timeout,sizeof(timeout)) == -1)
-            FGASSERT_FALSE;
-        // Convert IP address to string:
-        char                sbuf[INET6_ADDRSTRLEN];
-        inet_ntop(
-            clientAddress.ss_family,
-            get_in_addr((struct sockaddr *)&clientAddress),
-            sbuf,
-            sizeof sbuf);
-        std::string  ipAddr = std::string(sbuf);
+        setRecvTimeout(dataSockFd);
+        std::string  ipAddr = clientIp(clientAddress);
         // Read incoming message:
         std::string 	dataBuff;
-        int         	bytesRecvd;
         fgout << fgnl << "> " << std::flush;
-        do {
-            char        buffer[1024];
-            // read() will return when either it has filled the buffer, copied over everything
-            // from the socket input buffer (only if non-empty), or when the the connection
-            // is closed by the client. Otherwise it will block (ie if input buffer empty).
-            bytesRecvd = read(dataSockFd,buffer,sizeof(buffer));
-            fgout << "." << std::flush;
-            if (bytesRecvd > 0)
-                dataBuff += std::string(buffer,bytesRecvd);
-        }
-        while ((bytesRecvd > 0) && (dataBuff.size() <= maxRecvBytes));
+        int         	bytesRecvd = recvMessage(dataSockFd,maxRecvBytes,dataBuff,true);
         if (bytesRecvd != 0) {
             fgout << "RECEIVE ERROR: ";
             close(dataSockFd);
@@ -229,11 +290,9 @@ fgTcpServer(
             fgout << "Handler exception (unknown type)";
         }
         if (respond) {
-            if (!response.empty()) {
-                int     bytesSent = write(dataSockFd,response.data(),response.size());
-                if (bytesSent != int(response.size()))
-                    fgout << "TCP WRITE ERROR: " << bytesSent << " (of " << response.size() << "). ";
-            }
+            size_t      bytesSent = sendAll(dataSockFd,response);
+            if (bytesSent != response.size())
+                fgout << "TCP WRITE ERROR: " << bytesSent << " (of " << response.size() << "). ";
             close(dataSockFd);
         }
         fgout << std::flush;
@@ -242,4 +301,138 @@ fgTcpServer(
         close(listenSockFd);
 }
 
+namespace {
+
+struct  Connections
+{
+    boost::mutex                mtx;            // Guards members below and 'fgout'
+    boost::condition_variable   cvQueued;
+    // Accepted data sockets and client IP addresses. A negative socket tells a worker to exit:
+    std::deque<std::pair<int,std::string> > queue;
+    bool                        stop;           // A handler has returned false
+
+    Connections() : stop(false) {}
+};
+
+void
+serveConnections(
+    Connections *               conns,
+    const FgFuncTcpHandler &    handler,
+    size_t                      maxRecvBytes,
+    uint16                      port)
+{
+    for (;;) {
+        std::pair<int,std::string>  conn;
+        {
+            boost::unique_lock<boost::mutex>    lock(conns->mtx);
+            while (conns->queue.empty())
+                conns->cvQueued.wait(lock);
+            conn = conns->queue.front();
+            conns->queue.pop_front();
+        }
+        if (conn.first < 0)
+            return;
+        std::string     dataBuff;
+        if (recvMessage(conn.first,maxRecvBytes,dataBuff,false) != 0) {
+            close(conn.first);          // Oversize, timed out or broken; the client sees no response
+            continue;
+        }
+        std::string     response,
+                        error;
+        bool            handlerRetval = true;
+        try {
+            handlerRetval = handler(conn.second,dataBuff,response);
+        }
+        catch(FgException const & e) {
+            error = "Handler exception (FG4 exception): " + e.no_tr_message().m_str;
+        }
+        catch(std::exception const & e) {
+            error = "Handler exception (std::exception): " + std::string(e.what());
+        }
+        catch(...) {
+            error = "Handler exception (unknown type)";
+        }
+        sendAll(conn.first,response);
+        close(conn.first);
+        bool            wake = false;
+        {
+            boost::lock_guard<boost::mutex>     lock(conns->mtx);
+            if (!error.empty())
+                fgout << fgnl << error << std::flush;
+            if (!handlerRetval && !conns->stop)
+                wake = conns->stop = true;
+        }
+        // The accept loop is blocked waiting for a connection, so give it one:
+        if (wake)
+            fgTcpClient("127.0.0.1",port,std::string());
+    }
+}
+
+}
+
+void
+fgTcpServerConcurrent(
+    uint16              port,
+    FgFuncTcpHandler    handler,
+    size_t              maxRecvBytes,
+    uint                numThreads,
+    bool                external)
+{
+    numThreads = fgNumThreads(numThreads);
+    int                 listenSockFd = openListenSocket(port,external);
+    FgScopeGuard        closeSocket(boost::bind(close,listenSockFd));
+    Connections         conns;
+    boost::thread_group workers;
+    for (uint ii=0; ii<numThreads; ++ii)
+        workers.create_thread(boost::bind(serveConnections,&conns,boost::cref(handler),maxRecvBytes,port));
+    int                 acceptErrno = 0;
+    for (;;) {
+        struct sockaddr_storage clientAddress;
+        socklen_t       sz = sizeof(clientAddress);
+        int             dataSockFd = accept(listenSockFd,(struct sockaddr *)&clientAddress,&sz);
+        if (dataSockFd < 0) {
+            if ((errno == EINTR) || (errno == ECONNABORTED))
+                continue;
+            acceptErrno = errno;
+        }
+        boost::lock_guard<boost::mutex>     lock(conns.mtx);
+        if (conns.stop || (acceptErrno != 0)) {
+            if (dataSockFd >= 0)
+                close(dataSockFd);
+            break;
+        }
+        setRecvTimeout(dataSockFd);
+        conns.queue.push_back(std::make_pair(dataSockFd,clientIp(clientAddress)));
+        conns.cvQueued.notify_one();
+    }
+    // Connections already queued are served before the workers exit:
+    {
+        boost::lock_guard<boost::mutex>     lock(conns.mtx);
+        for (uint ii=0; ii<numThreads; ++ii)
+            conns.queue.push_back(std::make_pair(-1,std::string()));
+        conns.cvQueued.notify_all();
+    }
+    workers.join_all();
+    FGASSERT1(acceptErrno == 0,"accept failed: "+std::string(strerror(acceptErrno)));
+}
+
+uint16
+fgTcpFreePort()
+{
+    int                 sockFd = socket(AF_INET,SOCK_STREAM,IPPROTO_TCP);
+    FGASSERT(sockFd >= 0);
+    FgScopeGuard        closeSocket(boost::bind(close,sockFd));
+    sockaddr_in         addr;
+    std::memset(&addr,0,sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;              // Let the system choose
+    if (bind(sockFd,(struct sockaddr*)&addr,sizeof(addr)) != 0)
+        fgThrow("fgTcpFreePort bind failed",std::string(strerror(errno)));
+    socklen_t           sz = sizeof(addr);
+    if (getsockname(sockFd,(struct sockaddr*)&addr,&sz) != 0)
+        fgThrow("fgTcpFreePort getsockname failed",std::string(strerror(errno)));
+    return ntohs(addr.sin_port);
+}
+
 // */
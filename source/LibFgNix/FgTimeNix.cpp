@@ -13,6 +13,7 @@
 #include <sys/types.h>
 #include <sys/timeb.h>
 #include <unistd.h>
+#include <time.h>
 
 using namespace std;
 
@@ -24,6 +25,14 @@ fgTimeMs()
     return uint64(timeptr.time) * 1000ULL + uint64(timeptr.millitm);
 }
 
+uint64
+fgTimeNs()
+{
+    struct  timespec    ts;
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return uint64(ts.tv_sec) * 1000000000ULL + uint64(ts.tv_nsec);
+}
+
 void
 fgSleep(uint seconds)
 {
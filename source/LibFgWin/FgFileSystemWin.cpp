@@ -231,3 +231,39 @@ fgMakeWritableByAll(const FgString & name)
     if (hFile != INVALID_HANDLE_VALUE)
         SetSecurityInfo(hFile,SE_FILE_OBJECT,DACL_SECURITY_INFORMATION,NULL,NULL,NULL,NULL);
 }
+
+FgFileMap::FgFileMap(const FgString & fname) : data(NULL), size(0)
+{
+    HANDLE          hFile =
+        CreateFile(fname.as_wstring().c_str(),GENERIC_READ,FILE_SHARE_READ,NULL,OPEN_EXISTING,
+                   FILE_ATTRIBUTE_NORMAL|FILE_FLAG_SEQUENTIAL_SCAN,NULL);
+    if (hFile == INVALID_HANDLE_VALUE)
+        fgThrowWindows("Unable to open file for reading",fname);
+    LARGE_INTEGER   sz;
+    if (!GetFileSizeEx(hFile,&sz)) {
+        CloseHandle(hFile);
+        fgThrowWindows("Unable to get size of file",fname);
+    }
+    size = size_t(sz.QuadPart);
+    if (size > 0) {
+        HANDLE      hMap = CreateFileMapping(hFile,NULL,PAGE_READONLY,0,0,NULL);
+        if (hMap == NULL) {
+            CloseHandle(hFile);
+            fgThrowWindows("Unable to memory map file",fname);
+        }
+        data = static_cast<const uchar*>(MapViewOfFile(hMap,FILE_MAP_READ,0,0,0));
+        // The view holds references to the mapping and the file:
+        CloseHandle(hMap);
+        if (data == NULL) {
+            CloseHandle(hFile);
+            fgThrowWindows("Unable to map view of file",fname);
+        }
+    }
+    CloseHandle(hFile);
+}
+
+FgFileMap::~FgFileMap()
+{
+    if (data != NULL)
+        UnmapViewOfFile(data);
+}
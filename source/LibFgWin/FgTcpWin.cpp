@@ -13,6 +13,7 @@
 #include "FgStdString.hpp"
 #include "FgDiagnostics.hpp"
 #include "FgOut.hpp"
+#include "FgThread.hpp"
 
 // Tell compiler to link to these libs:
 #pragma comment (lib, "Ws2_32.lib")
@@ -53,7 +54,8 @@ fgTcpClient(
     uint16              port,
     const string &      data,
     bool                getResponse,
-    string &            response)
+    string &            response,
+    uint                recvTimeoutMs)
 {
     initWinsock();
     SOCKET              socketHandle;
@@ -90,8 +92,9 @@ fgTcpClient(
             freeaddrinfo(addressInfo);
             FGASSERT_FALSE1(fgToString(WSAGetLastError()));
         }
-        // Set the timeout so the user isn't waiting for ages if the connection fails:
-        DWORD           timeout = 5000;     // 5 seconds
+        // Set the timeout so the user isn't waiting for ages if the connection fails.
+        // A zero timeout is the socket default of never timing out:
+        DWORD           timeout = recvTimeoutMs;
         setsockopt(socketHandle,SOL_SOCKET,SO_RCVTIMEO,(const char*)&timeout,sizeof(timeout));
         // Try to connect to the server
         itmp = connect(socketHandle,ptr->ai_addr,(int)ptr->ai_addrlen);
@@ -116,7 +119,7 @@ fgTcpClient(
     if (getResponse) {
         response.clear();
         do {
-            char    buff[1024];
+            char    buff[0x10000];
             // If server doesn't respond and closes connection we'll immediately get
             // a value of zero here and nothing will be placed in buff. Otherwise
             // we'll continue to receive data until server closes connection causing
@@ -139,12 +142,11 @@ fgTcpClient(
     return true;
 }
 
-void
-fgTcpServer(
-    uint16              port,
-    bool                respond,
-    FgFuncTcpHandler    handler,
-    size_t              maxRecvBytes)
+namespace {
+
+// If not 'external', only the loopback interface is used so other machines can't connect:
+SOCKET
+openListenSocket(uint16 port,bool external)
 {
     initWinsock();
     SOCKET      sockListen = INVALID_SOCKET;
@@ -155,9 +157,13 @@ fgTcpServer(
     hints.ai_family = AF_INET;          // IPv4
     hints.ai_socktype = SOCK_STREAM;    // A reliable, 2-way, stream-based connection (requires TCP)
     hints.ai_protocol = IPPROTO_TCP;
-    hints.ai_flags = AI_PASSIVE;
+    const char *        node = "127.0.0.1";
+    if (external) {
+        hints.ai_flags = AI_PASSIVE;
+        node = NULL;
+    }
     struct addrinfo     *addrInfoPtr = NULL;
-    int itmp = getaddrinfo(NULL,fgToString(port).c_str(),&hints,&addrInfoPtr);
+    int itmp = getaddrinfo(node,fgToString(port).c_str(),&hints,&addrInfoPtr);
     FGASSERT1(itmp == 0,fgToString(itmp));
     sockListen = socket(addrInfoPtr->ai_family,addrInfoPtr->ai_socktype,addrInfoPtr->ai_protocol);
     if (sockListen == INVALID_SOCKET) {
@@ -177,6 +183,48 @@ fgTcpServer(
         FGASSERT_FALSE1(fgToString(WSAGetLastError()));
     }
     freeaddrinfo(addrInfoPtr);
+    return sockListen;
+}
+
+// Set the timeout. Very important since the default is to never time out so in some
+// cases a broken connection causes 'recv' to block forever:
+void
+setRecvTimeout(SOCKET sockClient)
+{
+    DWORD           timeout = 5000;     // 5 seconds
+    setsockopt(sockClient,SOL_SOCKET,SO_RCVTIMEO,(const char*)&timeout,sizeof(timeout));
+}
+
+// Returns the last 'recv' result; zero if the whole message was received:
+int
+recvMessage(SOCKET sockClient,size_t maxRecvBytes,string & dataBuff,bool progress)
+{
+    int retVal = 0;
+    do {
+        char    recvbuf[0x10000];
+        // recv() will return when either it has filled the buffer, copied over everthing
+        // from the socket input buffer (only if non-empty), or when the the read connection
+        // is closed by the client. Otherwise it will block (ie if input buffer empty):
+        retVal = recv(sockClient,recvbuf,sizeof(recvbuf),0);
+        if (progress)
+            fgout << "." << std::flush;
+        if (retVal > 0)
+            dataBuff += string(recvbuf,retVal);
+    }
+    while ((retVal > 0) && (dataBuff.size() <= maxRecvBytes));
+    return retVal;
+}
+
+}
+
+void
+fgTcpServer(
+    uint16              port,
+    bool                respond,
+    FgFuncTcpHandler    handler,
+    size_t              maxRecvBytes)
+{
+    SOCKET      sockListen = openListenSocket(port,true);
 
     // Receive messages and respond until finished:
     SOCKET      sockClient;
@@ -191,27 +239,13 @@ fgTcpServer(
             closesocket(sockListen);
             FGASSERT_FALSE1(fgToString(WSAGetLastError()));
         }
-        // Set the timeout. Very important since the default is to never time out so in some
-        // cases a broken connection causes 'recv' below to block forever:
-        DWORD           timeout = 5000;     // 5 seconds
-        setsockopt(sockClient,SOL_SOCKET,SO_RCVTIMEO,(const char*)&timeout,sizeof(timeout));
+        setRecvTimeout(sockClient);
 		char * clientStringPtr = inet_ntoa(sa.sin_addr);
             FGASSERT(clientStringPtr != NULL);
         string     ipAddr = string(clientStringPtr);
         //fgout << "receiving from " << ipAddr << " ... " << std::flush;
         string     dataBuff;
-        int retVal = 0;
-        do {
-            char    recvbuf[1024];
-            // recv() will return when either it has filled the buffer, copied over everthing
-            // from the socket input buffer (only if non-empty), or when the the read connection
-            // is closed by the client. Otherwise it will block (ie if input buffer empty):
-            retVal = recv(sockClient,recvbuf,sizeof(recvbuf),0);
-            fgout << "." << std::flush;
-            if (retVal > 0)
-                dataBuff += string(recvbuf,retVal);
-        }
-        while ((retVal > 0) && (dataBuff.size() <= maxRecvBytes));
+        int retVal = recvMessage(sockClient,maxRecvBytes,dataBuff,true);
         if (retVal != 0) {
             closesocket(sockClient);
             if (retVal < 0)
@@ -251,4 +285,148 @@ fgTcpServer(
     closesocket(sockListen);
 }
 
+namespace {
+
+struct  Connections
+{
+    boost::mutex                mtx;            // Guards members below and 'fgout'
+    boost::condition_variable   cvQueued;
+    // Accepted data sockets and client IP addresses. INVALID_SOCKET tells a worker to exit:
+    std::deque<std::pair<SOCKET,string> >   queue;
+    bool                        stop;           // A handler has returned false
+
+    Connections() : stop(false) {}
+};
+
+void
+serveConnections(
+    Connections *               conns,
+    const FgFuncTcpHandler &    handler,
+    size_t                      maxRecvBytes,
+    uint16                      port)
+{
+    for (;;) {
+        std::pair<SOCKET,string>    conn;
+        {
+            boost::unique_lock<boost::mutex>    lock(conns->mtx);
+            while (conns->queue.empty())
+                conns->cvQueued.wait(lock);
+            conn = conns->queue.front();
+            conns->queue.pop_front();
+        }
+        if (conn.first == INVALID_SOCKET)
+            return;
+        string          dataBuff;
+        if (recvMessage(conn.first,maxRecvBytes,dataBuff,false) != 0) {
+            closesocket(conn.first);    // Oversize, timed out or broken; the client sees no response
+            continue;
+        }
+        string          response,
+                        error;
+        bool            handlerRetval = true;
+        try {
+            handlerRetval = handler(conn.second,dataBuff,response);
+        }
+        catch(FgException const & e) {
+            error = "Handler exception (FG exception): " + e.no_tr_message().m_str;
+        }
+        catch(std::exception const & e) {
+            error = "Handler exception (std::exception): " + string(e.what());
+        }
+        catch(...) {
+            error = "Handler exception (unknown type)";
+        }
+        // 'send' blocks until the whole buffer is taken since this is a blocking socket:
+        if (!response.empty())
+            send(conn.first,response.data(),int(response.size()),0);
+        shutdown(conn.first,SD_SEND);
+        closesocket(conn.first);
+        bool            wake = false;
+        {
+            boost::lock_guard<boost::mutex>     lock(conns->mtx);
+            if (!error.empty())
+                fgout << fgnl << error << std::flush;
+            if (!handlerRetval && !conns->stop)
+                wake = conns->stop = true;
+        }
+        // The accept loop is blocked waiting for a connection, so give it one:
+        if (wake)
+            fgTcpClient("127.0.0.1",port,string());
+    }
+}
+
+}
+
+void
+fgTcpServerConcurrent(
+    uint16              port,
+    FgFuncTcpHandler    handler,
+    size_t              maxRecvBytes,
+    uint                numThreads,
+    bool                external)
+{
+    numThreads = fgNumThreads(numThreads);
+    SOCKET              sockListen = openListenSocket(port,external);
+    Connections         conns;
+    boost::thread_group workers;
+    for (uint ii=0; ii<numThreads; ++ii)
+        workers.create_thread(boost::bind(serveConnections,&conns,boost::cref(handler),maxRecvBytes,port));
+    int                 acceptError = 0;
+    for (;;) {
+        sockaddr_in     sa;
+        sa.sin_family = AF_INET;
+        socklen_t       sz = sizeof(sa);
+        SOCKET          sockClient = accept(sockListen,(sockaddr*)(&sa),&sz);
+        if (sockClient == INVALID_SOCKET) {
+            acceptError = WSAGetLastError();
+            if (acceptError == WSAECONNRESET) {     // Client gave up before being accepted
+                acceptError = 0;
+                continue;
+            }
+        }
+        boost::lock_guard<boost::mutex>     lock(conns.mtx);
+        if (conns.stop || (acceptError != 0)) {
+            if (sockClient != INVALID_SOCKET)
+                closesocket(sockClient);
+            break;
+        }
+        setRecvTimeout(sockClient);
+        char *          clientStringPtr = inet_ntoa(sa.sin_addr);
+        conns.queue.push_back(std::make_pair(sockClient,string(clientStringPtr ? clientStringPtr : "")));
+        conns.cvQueued.notify_one();
+    }
+    closesocket(sockListen);
+    // Connections already queued are served before the workers exit:
+    {
+        boost::lock_guard<boost::mutex>     lock(conns.mtx);
+        for (uint ii=0; ii<numThreads; ++ii)
+            conns.queue.push_back(std::make_pair(INVALID_SOCKET,string()));
+        conns.cvQueued.notify_all();
+    }
+    workers.join_all();
+    FGASSERT1(acceptError == 0,fgToString(acceptError));
+}
+
+uint16
+fgTcpFreePort()
+{
+    initWinsock();
+    SOCKET              sock = socket(AF_INET,SOCK_STREAM,IPPROTO_TCP);
+    FGASSERT1(sock != INVALID_SOCKET,fgToString(WSAGetLastError()));
+    sockaddr_in         addr;
+    ZeroMemory(&addr,sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;              // Let the system choose
+    int                 sz = sizeof(addr);
+    if ((bind(sock,(sockaddr*)&addr,sz) == SOCKET_ERROR) ||
+        (getsockname(sock,(sockaddr*)&addr,&sz) == SOCKET_ERROR)) {
+        int             err = WSAGetLastError();
+        closesocket(sock);
+        FGASSERT_FALSE1(fgToString(err));
+    }
+    closesocket(sock);
+    return ntohs(addr.sin_port);
+}
+
 // */
@@ -23,6 +23,20 @@ fgTimeMs()
     return timeptr.time * 1000ULL + uint64(timeptr.millitm);
 }
 
+uint64
+fgTimeNs()
+{
+    static LARGE_INTEGER    freq = {0};
+    if (freq.QuadPart == 0)
+        QueryPerformanceFrequency(&freq);   // Fixed at boot so benign if raced
+    LARGE_INTEGER           count;
+    QueryPerformanceCounter(&count);
+    // Split to avoid overflow of count * 1e9:
+    uint64                  secs = uint64(count.QuadPart / freq.QuadPart),
+                            rem = uint64(count.QuadPart % freq.QuadPart);
+    return secs * 1000000000ULL + (rem * 1000000000ULL) / uint64(freq.QuadPart);
+}
+
 void
 fgSleep(uint seconds)
 {